@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""Compare two benchmark runs and fail on regressions.
+
+Each input is either the JSON document or a log containing the `BENCH_JSON:` line the benchmark
+app prints:
+
+    ./compare.py baseline.json bench.log --threshold 10
+
+A benchmark regresses when its time per operation grew by more than the threshold in percent, or
+when it does more heap operations per operation than before: those are deterministic, so any
+increase counts. Benchmarks present in only one of the runs are listed but do not fail.
+"""
+import argparse
+import json
+import sys
+
+MARKER = 'BENCH_JSON:'
+
+
+def load(path):
+    with open(path) as f:
+        text = f.read()
+    if text.lstrip().startswith('{'):
+        return json.loads(text)
+    for line in text.splitlines():
+        if MARKER in line:
+            return json.loads(line.split(MARKER, 1)[1])
+    sys.exit(f'{path}: no benchmark results')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('baseline')
+    parser.add_argument('current')
+    parser.add_argument('--threshold', type=float, default=10, help='allowed slowdown in percent')
+    parser.add_argument('--json', action='store_true', help='print the comparison as JSON')
+    args = parser.parse_args()
+
+    baseline = {r['name']: r for r in load(args.baseline)['results']}
+    current = {r['name']: r for r in load(args.current)['results']}
+
+    rows = []
+    for name in sorted(baseline.keys() & current.keys()):
+        old, new = baseline[name], current[name]
+        change = (new['ns_per_op'] - old['ns_per_op']) / old['ns_per_op'] * 100 if old['ns_per_op'] else 0
+        slower = change > args.threshold
+        more_heap = new['heap_ops_per_op'] > old['heap_ops_per_op'] + 1e-3
+        rows.append({
+            'name': name,
+            'baseline_ns': old['ns_per_op'],
+            'current_ns': new['ns_per_op'],
+            'change_pct': round(change, 1),
+            'baseline_heap_ops': old['heap_ops_per_op'],
+            'current_heap_ops': new['heap_ops_per_op'],
+            'regression': slower or more_heap,
+        })
+    missing = sorted(baseline.keys() - current.keys())
+    added = sorted(current.keys() - baseline.keys())
+    regressions = [row['name'] for row in rows if row['regression']]
+
+    if args.json:
+        print(json.dumps({'rows': rows, 'missing': missing, 'added': added, 'regressions': regressions}, indent=2))
+    else:
+        print(f'{"benchmark":<24} {"baseline ns":>12} {"current ns":>12} {"change":>8} {"heap ops":>14}')
+        for row in rows:
+            heap = f'{row["baseline_heap_ops"]:g} -> {row["current_heap_ops"]:g}'
+            flag = '  REGRESSION' if row['regression'] else ''
+            print(f'{row["name"]:<24} {row["baseline_ns"]:>12.1f} {row["current_ns"]:>12.1f} '
+                  f'{row["change_pct"]:>+7.1f}% {heap:>14}{flag}')
+        for name in missing:
+            print(f'{name:<24} missing from the current run')
+        for name in added:
+            print(f'{name:<24} new')
+        print(f'{len(regressions)} regression(s), threshold {args.threshold:g}%')
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,413 @@
+/**
+ * @file bench_main.c
+ * @brief Benchmarks of the smart_home and WebSocket hot paths
+ *
+ * Every benchmark repeats one operation and reports the time and the heap operations per
+ * operation. The results are printed as a single `BENCH_JSON:` line, host_test/benchmark/compare.py
+ * compares two of them. Sends need the stand-in server, they are skipped without it.
+ */
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_event.h>
+#include <esp_websocket_client.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "smart_home/smart_home.h"
+#include "smart_home/smart_home_priv.h"
+#include "dlog/dlog.h"
+#include "metrics/metrics.h"
+#include "dht11.h"
+#include "sim/gpio_sim.h"
+#include "util/format.h"
+
+static const char *TAG = "BENCH";
+
+#define BENCH_MAX_RESULTS   32
+#define BENCH_JSON_SIZE     4096
+#define CONNECTED_BIT       BIT0
+
+typedef struct {
+    char name[32];
+    uint32_t iterations;
+    double ns_per_op;
+    double heap_ops_per_op;
+    double bytes_per_s;       // 0 if the benchmark does not move payload
+} bench_result_t;
+
+static bench_result_t s_results[BENCH_MAX_RESULTS];
+static int s_result_count = 0;
+static char s_skipped[BENCH_MAX_RESULTS][32];
+static int s_skipped_count = 0;
+
+// Heap operations of the calling task, the allocator is wrapped at link time
+static __thread uint32_t s_heap_ops;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size)
+{
+    s_heap_ops++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    s_heap_ops++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    s_heap_ops++;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr) {
+        s_heap_ops++;
+    }
+    __real_free(ptr);
+}
+
+typedef struct {
+    int64_t start_us;
+    uint32_t start_heap_ops;
+} bench_timer_t;
+
+static void bench_start(bench_timer_t *timer)
+{
+    timer->start_heap_ops = s_heap_ops;
+    timer->start_us = esp_timer_get_time();
+}
+
+static bench_result_t *bench_stop(bench_timer_t *timer, const char *name, uint32_t iterations, size_t bytes_per_op)
+{
+    int64_t elapsed_us = esp_timer_get_time() - timer->start_us;
+    uint32_t heap_ops = s_heap_ops - timer->start_heap_ops;
+    if (s_result_count == BENCH_MAX_RESULTS) {
+        return NULL;
+    }
+    bench_result_t *result = &s_results[s_result_count++];
+    strlcpy(result->name, name, sizeof(result->name));
+    result->iterations = iterations;
+    result->ns_per_op = elapsed_us * 1000.0 / iterations;
+    result->heap_ops_per_op = (double)heap_ops / iterations;
+    result->bytes_per_s = bytes_per_op && elapsed_us ? bytes_per_op * (double)iterations * 1e6 / elapsed_us : 0;
+    ESP_LOGI(TAG, "%-22s %8.1f ns/op %6.2f heap ops/op", name, result->ns_per_op, result->heap_ops_per_op);
+    return result;
+}
+
+static void bench_skip(const char *name, const char *reason)
+{
+    ESP_LOGW(TAG, "%s skipped: %s", name, reason);
+    if (s_skipped_count < BENCH_MAX_RESULTS) {
+        strlcpy(s_skipped[s_skipped_count++], name, sizeof(s_skipped[0]));
+    }
+}
+
+static volatile uint32_t s_commands;
+
+static void command_callback(int device_id, control_type_t control_type, const char *value,
+                             esp_websocket_client_handle_t client, void *user_context)
+{
+    s_commands++;
+}
+
+// Inbound command: tokenize, look up the control type and call the application callback
+static void bench_parse(void)
+{
+    static const struct {
+        const char *name;
+        const char *message;
+    } cases[] = {
+        { "parse/switch", "datasend:102:SWITCH:0" },
+        { "parse/slider", "datasend:155:SLIDER:42" },
+        { "parse/unknown_type", "datasend:200:THERMOSTAT:21" },
+        { "parse/reject", "temperature=22" },
+    };
+    const uint32_t iterations = 200000;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        size_t length = strlen(cases[i].message);
+        bench_timer_t timer;
+        bench_start(&timer);
+        for (uint32_t n = 0; n < iterations; n++) {
+            smart_home_parse_message(cases[i].message, length, esp_timer_get_time());
+        }
+        bench_stop(&timer, cases[i].name, iterations, 0);
+    }
+}
+
+static void bench_bind_format(void)
+{
+    const uint32_t iterations = 1000000;
+    char message[64];
+    bench_timer_t timer;
+    bench_start(&timer);
+    for (uint32_t n = 0; n < iterations; n++) {
+        smart_home_format_bind(message, sizeof(message), 155, "47");
+    }
+    bench_stop(&timer, "bind_format", iterations, 0);
+}
+
+// Every received message increments counters and observes its size and handling time
+static void bench_metrics(void)
+{
+    const uint32_t iterations = 1000000;
+    bench_timer_t timer;
+    bench_start(&timer);
+    for (uint32_t n = 0; n < iterations; n++) {
+        metrics_inc(METRIC_MESSAGES_IN);
+    }
+    bench_stop(&timer, "metrics_inc", iterations, 0);
+
+    // Spread the values over the buckets, observing one value over and over keeps its bucket in cache
+    bench_start(&timer);
+    for (uint32_t n = 0; n < iterations; n++) {
+        metrics_observe(METRIC_HANDLE_US, n & 0x3ffff);
+    }
+    bench_stop(&timer, "metrics_observe", iterations, 0);
+}
+
+static int discard_vprintf(const char *format, va_list args)
+{
+    char line[256];
+    return vsnprintf(line, sizeof(line), format, args);
+}
+
+// The received message log of smart_home, formatted in place and deferred. The formatted
+// line is thrown away, so neither case includes the console.
+static void bench_log(void)
+{
+    static const char *LOG_TAG = "BENCH_LOG";
+    static const char message[] = "datasend:155:SLIDER:42";
+    const int length = sizeof(message) - 1;
+    const uint32_t iterations = 100000;
+    // Records of this size that fit in the default dlog buffer, with room to spare
+    const uint32_t batch = 16;
+
+    esp_log_level_set(LOG_TAG, ESP_LOG_INFO);
+    vprintf_like_t previous = esp_log_set_vprintf(discard_vprintf);
+    bench_timer_t timer;
+    bench_start(&timer);
+    for (uint32_t n = 0; n < iterations; n++) {
+        ESP_LOGI(LOG_TAG, "Message received from server: %.*s", length, message);
+    }
+    bench_stop(&timer, "log/esp_logi", iterations, 0);
+
+    // The dlog task prints through the same discarding vprintf. This task writes above its
+    // priority 1 and drops below it after every batch until the buffer is drained, the
+    // draining is not counted.
+    uint32_t dropped = dlog_dropped();
+    UBaseType_t priority = uxTaskPriorityGet(NULL);
+    vTaskPrioritySet(NULL, tskIDLE_PRIORITY + 2);
+    bench_start(&timer);
+    for (uint32_t n = 0; n < iterations; n += batch) {
+        for (uint32_t i = 0; i < batch; i++) {
+            DLOGI_STR(LOG_TAG, "Message received from server: %.*s", message, length);
+        }
+        int64_t drain_start_us = esp_timer_get_time();
+        vTaskPrioritySet(NULL, tskIDLE_PRIORITY);
+        vTaskPrioritySet(NULL, tskIDLE_PRIORITY + 2);
+        timer.start_us += esp_timer_get_time() - drain_start_us;
+    }
+    bench_stop(&timer, "log/dlogi", iterations, 0);
+    vTaskPrioritySet(NULL, priority);
+    esp_log_set_vprintf(previous);
+    if (dlog_dropped() != dropped) {
+        ESP_LOGW(TAG, "%" PRIu32 " deferred records dropped, log/dlogi is too low", dlog_dropped() - dropped);
+    }
+}
+
+ESP_EVENT_DEFINE_BASE(BENCH_EVENTS);
+
+static void count_event(void *arg, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    (*(uint32_t *)arg)++;
+}
+
+// The WebSocket client posts every event through a loop like this and runs it in its task
+static void bench_event_dispatch(void)
+{
+    const size_t sizes[] = { 0, 64, 1024 };
+    const uint32_t iterations = 100000;
+    esp_event_loop_args_t loop_args = {
+        .queue_size = 1,
+        .task_name = NULL,
+    };
+    esp_event_loop_handle_t loop;
+    if (esp_event_loop_create(&loop_args, &loop) != ESP_OK) {
+        bench_skip("event_dispatch", "no event loop");
+        return;
+    }
+    uint32_t handled = 0;
+    esp_event_handler_register_with(loop, BENCH_EVENTS, ESP_EVENT_ANY_ID, count_event, &handled);
+
+    char data[1024] = { 0 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "event_dispatch/%d", (int)sizes[i]);
+        bench_timer_t timer;
+        bench_start(&timer);
+        for (uint32_t n = 0; n < iterations; n++) {
+            esp_event_post_to(loop, BENCH_EVENTS, 0, sizes[i] ? data : NULL, sizes[i], portMAX_DELAY);
+            esp_event_loop_run(loop, 0);
+        }
+        bench_stop(&timer, name, iterations, sizes[i]);
+    }
+    esp_event_loop_delete(loop);
+}
+
+static void bench_dht_decode(void)
+{
+    const uint32_t iterations = 5000;
+    if (gpio_sim_load_pulses(CONFIG_BENCH_DHT11_PULSES) != ESP_OK) {
+        bench_skip("dht_decode", "no pulse trains");
+        return;
+    }
+    DHT11_init(GPIO_NUM_9);
+    uint32_t decoded = 0;
+    bench_timer_t timer;
+    bench_start(&timer);
+    for (uint32_t n = 0; n < iterations; n++) {
+        decoded += DHT11_read_now().status == DHT11_OK;
+    }
+    bench_stop(&timer, "dht_decode", iterations, 0);
+    ESP_LOGI(TAG, "%" PRIu32 " of %" PRIu32 " reads decoded", decoded, iterations);
+}
+
+static void connected_handler(void *arg, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    if (event_id == WEBSOCKET_EVENT_CONNECTED) {
+        xEventGroupSetBits((EventGroupHandle_t)arg, CONNECTED_BIT);
+    }
+}
+
+// Send path as smart_home uses it: blocking binary frames on a connected client
+static void bench_send(void)
+{
+    const int sizes[] = { 16, 64, 256, 1024, 4096, 16384 };
+    EventGroupHandle_t bits = xEventGroupCreate();
+    esp_websocket_client_config_t config = {
+        .uri = CONFIG_BENCH_SERVER_URI,
+        .buffer_size = 1024,
+        .disable_auto_reconnect = true,
+    };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&config);
+    char *payload = malloc(sizes[sizeof(sizes) / sizeof(sizes[0]) - 1]);
+    if (!bits || !client || !payload) {
+        bench_skip("send_bin", "out of memory");
+        goto cleanup;
+    }
+    memset(payload, 'x', sizes[sizeof(sizes) / sizeof(sizes[0]) - 1]);
+    esp_websocket_register_events(client, WEBSOCKET_EVENT_CONNECTED, connected_handler, bits);
+    esp_websocket_client_start(client);
+    if (!(xEventGroupWaitBits(bits, CONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(3000)) & CONNECTED_BIT)) {
+        bench_skip("send_bin", "stand-in server not reachable at " CONFIG_BENCH_SERVER_URI);
+        goto cleanup;
+    }
+    const char *token = CONFIG_BENCH_AUTH_TOKEN;
+    esp_websocket_client_send_bin(client, token, strlen(token), portMAX_DELAY);
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        // about 8 MB per size, at least 200 sends
+        uint32_t iterations = 8 * 1024 * 1024 / sizes[i];
+        iterations = iterations < 200 ? 200 : iterations > 50000 ? 50000 : iterations;
+        char name[32];
+        snprintf(name, sizeof(name), "send_bin/%d", sizes[i]);
+        bench_timer_t timer;
+        bench_start(&timer);
+        uint32_t n;
+        for (n = 0; n < iterations; n++) {
+            if (esp_websocket_client_send_bin(client, payload, sizes[i], portMAX_DELAY) < 0) {
+                break;
+            }
+        }
+        if (n < iterations) {
+            bench_skip(name, "send failed");
+            break;
+        }
+        bench_stop(&timer, name, iterations, sizes[i]);
+    }
+
+cleanup:
+    if (client) {
+        esp_websocket_client_destroy(client);
+    }
+    if (bits) {
+        vEventGroupDelete(bits);
+    }
+    free(payload);
+}
+
+static void print_results(void)
+{
+    char *json = malloc(BENCH_JSON_SIZE);
+    if (!json) {
+        return;
+    }
+    int written = 0;
+    format_append(json, BENCH_JSON_SIZE, &written, "{\"target\":\"%s\",\"results\":[", CONFIG_IDF_TARGET);
+    for (int i = 0; i < s_result_count; i++) {
+        const bench_result_t *r = &s_results[i];
+        format_append(json, BENCH_JSON_SIZE, &written,
+                    "%s{\"name\":\"%s\",\"iterations\":%" PRIu32 ",\"ns_per_op\":%.1f,\"heap_ops_per_op\":%.3f",
+                    i ? "," : "", r->name, r->iterations, r->ns_per_op, r->heap_ops_per_op);
+        if (r->bytes_per_s) {
+            format_append(json, BENCH_JSON_SIZE, &written, ",\"bytes_per_s\":%.0f", r->bytes_per_s);
+        }
+        format_append(json, BENCH_JSON_SIZE, &written, "}");
+    }
+    format_append(json, BENCH_JSON_SIZE, &written, "],\"skipped\":[");
+    for (int i = 0; i < s_skipped_count; i++) {
+        format_append(json, BENCH_JSON_SIZE, &written, "%s\"%s\"", i ? "," : "", s_skipped[i]);
+    }
+    format_append(json, BENCH_JSON_SIZE, &written, "]}");
+    if (written >= BENCH_JSON_SIZE) {
+        ESP_LOGE(TAG, "Results truncated, BENCH_JSON_SIZE is too small");
+    }
+    printf("BENCH_JSON:%s\n", json);
+    free(json);
+}
+
+void app_main(void)
+{
+    // The application logs go to the deferred log as on the device, only its printing is muted
+    dlog_init(NULL);
+    esp_log_level_set("*", ESP_LOG_WARN);
+    esp_log_level_set(TAG, ESP_LOG_INFO);
+    esp_log_level_set("DLOG", ESP_LOG_ERROR);
+
+    smart_home_config_t config = {
+        .websocket_uri = CONFIG_BENCH_SERVER_URI,
+        .auth_token = CONFIG_BENCH_AUTH_TOKEN,
+    };
+    if (smart_home_init(&config, command_callback, NULL) != ESP_OK) {
+        ESP_LOGE(TAG, "smart_home_init failed");
+        return;
+    }
+
+    bench_parse();
+    bench_bind_format();
+    bench_metrics();
+    bench_log();
+    bench_event_dispatch();
+    bench_dht_decode();
+    bench_send();
+
+    smart_home_deinit();
+    ESP_LOGI(TAG, "%" PRIu32 " commands dispatched", s_commands);
+    print_results();
+    fflush(stdout);
+    exit(0);
+}
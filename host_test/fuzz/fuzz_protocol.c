@@ -0,0 +1,133 @@
+/**
+ * @file fuzz_protocol.c
+ * @brief Fuzz target of the smart_home message parser and the reassembly of chunked messages
+ *
+ * The first input byte selects the chunk size the rest is delivered in, as the WebSocket client
+ * does for a message larger than its buffer. The message is parsed as one piece and after
+ * reassembly, both have to agree and every decoded command has to be well formed. A numbered
+ * command has to be a duplicate the second time the dedup window sees it. The same bytes are
+ * decoded as an RPC request frame, whose requests have to cover it exactly. A command value
+ * stored in the state table twice changes its version once.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "smart_home/protocol.h"
+#include "smart_home/state_table.h"
+
+#define ASSEMBLY_SIZE 1024
+
+static void check_command(const protocol_command_t *command)
+{
+    if (command->device_id < 0 || command->value_len == 0 || command->value_len > PROTOCOL_VALUE_MAX ||
+            strlen(command->value) != command->value_len || memchr(command->value, ':', command->value_len) ||
+            command->control_type > CONTROL_TYPE_UNKNOWN) {
+        abort();
+    }
+    protocol_dedup_t dedup;
+    protocol_dedup_init(&dedup);
+    if (protocol_dedup_check(&dedup, command->seq) || protocol_dedup_check(&dedup, command->seq) != (command->seq != 0)) {
+        abort();
+    }
+
+    static state_table_t state;     // keeps the values of earlier inputs, up to a full table
+    uint32_t version = state.version;
+    if (!state_table_set(&state, command->device_id, command->value)) {
+        if (command->value_len <= STATE_VALUE_MAX && !memchr(command->value, ',', command->value_len) &&
+                state.count < STATE_TABLE_MAX) {
+            abort();
+        }
+        return;
+    }
+    if (state.version < version || !state_table_set(&state, command->device_id, command->value) ||
+            state.version > version + 1) {
+        abort();
+    }
+    char delta[32];
+    int len = state_table_format(&state, state.version, delta, sizeof(delta));
+    if (len <= 0 || (size_t)len >= sizeof(delta) || delta[len - 1] != ':') {
+        abort();    // nothing changed since the current version
+    }
+    state_table_acked(&state, state.version);
+    if (state.acked != state.version) {
+        abort();
+    }
+}
+
+static void check_rpc(const uint8_t *frame, size_t length)
+{
+    int count = protocol_rpc_requests(frame, length);
+    if (count == 0) {
+        return;
+    }
+    size_t offset = PROTOCOL_RPC_FRAME_HEADER;
+    protocol_rpc_request_t request;
+    int decoded = 0;
+    while (protocol_rpc_next(frame, length, &offset, &request)) {
+        if (request.args < frame + PROTOCOL_RPC_FRAME_HEADER || request.args + request.args_len > frame + length ||
+                request.args + request.args_len != frame + offset) {
+            abort();
+        }
+        decoded++;
+    }
+    if (decoded != count || offset != length) {
+        abort();
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size < 1) {
+        return 0;
+    }
+    size_t chunk = data[0] % 64 + 1;
+    const char *message = (const char *)data + 1;
+    size_t length = size - 1;
+
+    // A copy of exactly the message length, reads past it are caught by ASan
+    char *exact = malloc(length ? length : 1);
+    memcpy(exact, message, length);
+    protocol_command_t command;
+    protocol_message_t type = protocol_parse(exact, length, &command);
+    if (type == PROTOCOL_MSG_COMMAND) {
+        check_command(&command);
+    } else if (type == PROTOCOL_MSG_SYNCED && command.version == 0) {
+        abort();
+    }
+    check_rpc((const uint8_t *)exact, length);
+
+    static char buffer[ASSEMBLY_SIZE];
+    protocol_assembler_t assembler;
+    protocol_assembler_init(&assembler, buffer, sizeof(buffer));
+    const char *assembled = NULL;
+    size_t assembled_len = 0;
+    size_t offset = 0;
+    do {
+        size_t len = length - offset < chunk ? length - offset : chunk;
+        assembled = protocol_assemble(&assembler, exact + offset, len, offset, length, offset == 0, true, &assembled_len);
+        offset += len;
+        if (assembled && offset != length) {
+            abort();    // complete before the last chunk
+        }
+    } while (offset < length);
+
+    if (length > ASSEMBLY_SIZE && length > chunk) {
+        if (assembled || !protocol_assembler_overflowed(&assembler)) {
+            abort();
+        }
+    } else {
+        if (!assembled || assembled_len != length || memcmp(assembled, message, length) != 0) {
+            abort();
+        }
+        protocol_command_t again;
+        if (protocol_parse(assembled, assembled_len, &again) != type ||
+                (type == PROTOCOL_MSG_COMMAND && (again.device_id != command.device_id ||
+                        again.control_type != command.control_type || strcmp(again.value, command.value) != 0 ||
+                        again.seq != command.seq)) ||
+                (type == PROTOCOL_MSG_SYNCED && again.version != command.version)) {
+            abort();
+        }
+    }
+    free(exact);
+    return 0;
+}
@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+"""Seed corpora of the fuzz targets from server traffic.
+
+The messages are those smart_home_server.py --record stored, plus the ones the server can send
+that a short load run does not: every control type and the edge cases of the parser.
+
+    ../smart_home_server/smart_home_server.py --rate 20 --duration 5 --record /tmp/traffic
+    ./make_corpus.py /tmp/traffic
+
+corpus/protocol/ gets inputs of fuzz_protocol: a chunk size byte and the message.
+corpus/ws_receiver/ gets inputs of ws_receiver: a flags byte and the server bytes, the messages
+framed whole, in fragments with control frames in between, compressed and split across reads.
+"""
+import argparse
+import hashlib
+import os
+import struct
+import sys
+import zlib
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+OP_CONT, OP_TEXT, OP_BINARY, OP_CLOSE, OP_PING, OP_PONG = 0x0, 0x1, 0x2, 0x8, 0x9, 0xA
+RSV1 = 0x40
+
+SEEDS = [
+    b'Successfully connected',
+    b'latency',
+    b'metrics',
+    b'memprof',
+    b'calibration',
+    b'datasend:102:SWITCH:1',
+    b'datasend:102:SLIDER:75',
+    b'datasend:7:RGB_PICKER:#ff8000',
+    b'datasend:3:BUTTON_GROUP:2',
+    b'datasend:4:NUMERIC_INPUT:-12.5',
+    b'datasend:5:TEXT_DISPLAY:hello',
+    b'datasend:6:DROPDOWN:auto',
+    b'datasend:8:SCHEDULE:0800-2200',
+    b'datasend:102:LASER:1',
+    b'datasend:2147483647:SWITCH:0',
+    b'datasend:2147483648:SWITCH:0',
+    b'datasend:-1:SWITCH:0',
+    b'datasend:102::1',
+    b'datasend:102:SWITCH:',
+    b'datasend:102:SWITCH',
+    b'datasend:102:SWITCH:1:seq=1',
+    b'datasend:102:SWITCH:0:seq=4294967295:xxxxxxxx',
+    b'datasend:102:SWITCH:0:seq=4294967296',
+    b'datasend:102:SWITCH:0:seq=0',
+    b'datasend:102:SWITCH:0:seq=',
+    b'datasend:102:SWITCH:0:sequence',
+    b'Success',
+    b'snapshot',
+    b'synced:1',
+    b'synced:4294967295',
+    b'synced:4294967296',
+    b'synced:0',
+    b'synced:',
+    # RPC request frames: type count, then id:u16 method:u8 args_len:u16 args per request
+    b'\x01\x01\x01\x00\x00\x00\x00',
+    b'\x01\x03\x01\x00\x10\x0c\x00\x66\x00\x00\x00\x9a\x00\x00\x00\x9b\x00\x00\x00'
+    b'\x02\x00\x02\x00\x00\x03\x00\x01\x00\x00',
+    b'\x01\x02\x01\x00\x00\x04\x00ping',
+    b'\x01\x01\x01\x00\x00\xff\xff',
+    b'\x01\x00',
+]
+
+
+def frame(opcode, payload, fin=True, rsv=0):
+    """A server frame, these are not masked."""
+    first = (0x80 if fin else 0) | rsv | opcode
+    length = len(payload)
+    if length < 126:
+        header = struct.pack('!BB', first, length)
+    elif length < 65536:
+        header = struct.pack('!BBH', first, 126, length)
+    else:
+        header = struct.pack('!BBQ', first, 127, length)
+    return header + payload
+
+
+def deflate(payload):
+    """Compressed as in RFC 7692, the sync flush tail stripped."""
+    compressor = zlib.compressobj(wbits=-9)
+    data = compressor.compress(payload) + compressor.flush(zlib.Z_SYNC_FLUSH)
+    return data[:-4] if data.endswith(b'\x00\x00\xff\xff') else data
+
+
+def flags(deflated=False, buffer_index=3, read_index=7, no_context=False):
+    """Flags byte of fuzz_ws_receiver, deflated makes the server accept permessage-deflate."""
+    return bytes([(int(no_context) << 6) | (read_index << 3) | (buffer_index << 1) | int(deflated)])
+
+
+def fragments(message, count):
+    step = max(1, len(message) // count)
+    parts = [message[i:i + step] for i in range(0, len(message), step)] or [b'']
+    out = b''
+    for i, part in enumerate(parts):
+        out += frame(OP_TEXT if i == 0 else OP_CONT, part, fin=i == len(parts) - 1)
+        if i == 0:
+            out += frame(OP_PING, b'keepalive')     # control frames may come between fragments
+    return out
+
+
+def ws_inputs(message):
+    yield flags() + frame(OP_TEXT, message)
+    yield flags(buffer_index=0, read_index=1) + frame(OP_BINARY, message)   # 16 byte chunks, 3 byte reads
+    yield flags(buffer_index=1, read_index=2) + fragments(message, 3)
+    yield flags(deflated=True) + frame(OP_TEXT, deflate(message), rsv=RSV1)
+    yield flags(deflated=True, buffer_index=0, read_index=0) + frame(OP_TEXT, deflate(message), rsv=RSV1)
+    yield flags(deflated=True, no_context=True) + 2 * frame(OP_TEXT, deflate(message), rsv=RSV1)
+
+
+def write(directory, data):
+    path = os.path.join(directory, hashlib.sha1(data).hexdigest()[:16])
+    with open(path, 'wb') as f:
+        f.write(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('traffic', nargs='*', help='directories written by smart_home_server.py --record')
+    parser.add_argument('--out', default=os.path.join(HERE, 'corpus'))
+    args = parser.parse_args()
+
+    messages = list(SEEDS)
+    for directory in args.traffic:
+        for name in sorted(os.listdir(directory)):
+            with open(os.path.join(directory, name), 'rb') as f:
+                messages.append(f.read())
+    messages = list(dict.fromkeys(messages))
+
+    protocol_dir = os.path.join(args.out, 'protocol')
+    ws_dir = os.path.join(args.out, 'ws_receiver')
+    os.makedirs(protocol_dir, exist_ok=True)
+    os.makedirs(ws_dir, exist_ok=True)
+    for message in messages:
+        write(protocol_dir, bytes([63]) + message)      # in one piece
+        if len(message) > 8:
+            write(protocol_dir, bytes([4]) + message)   # in 5 byte chunks
+        for data in ws_inputs(message):
+            write(ws_dir, data)
+
+    # A whole session: the auth reply, commands, a ping and the close of the server
+    session = b''.join(frame(OP_TEXT, m) for m in messages[:8]) + frame(OP_PING, b'') + \
+        frame(OP_TEXT, b'datasend:102:SWITCH:0:' + b'x' * 300) + frame(OP_CLOSE, struct.pack('!H', 1000))
+    write(ws_dir, flags() + session)
+    write(ws_dir, flags(buffer_index=1, read_index=3) + session)
+    print(f'{len(messages)} messages, {len(os.listdir(protocol_dir))} protocol and '
+          f'{len(os.listdir(ws_dir))} ws_receiver inputs in {args.out}', file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
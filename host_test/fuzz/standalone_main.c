@@ -0,0 +1,48 @@
+/**
+ * @file standalone_main.c
+ * @brief Runs a libFuzzer target without libFuzzer: once per file given, or once on stdin
+ *
+ * This is the program AFL drives, `afl-fuzz ... -- ./fuzz_protocol` feeds stdin and
+ * `afl-fuzz ... -- ./fuzz_protocol @@` a file. Built with afl-clang-fast it loops in persistent
+ * mode. With plain gcc it replays a corpus, which is how the seeds are checked without clang.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define INPUT_MAX (1024 * 1024)
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static uint8_t s_input[INPUT_MAX];
+
+static size_t read_input(FILE *file)
+{
+    return fread(s_input, 1, sizeof(s_input), file);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+#ifdef __AFL_LOOP
+        while (__AFL_LOOP(10000)) {
+            LLVMFuzzerTestOneInput(s_input, read_input(stdin));
+        }
+#else
+        LLVMFuzzerTestOneInput(s_input, read_input(stdin));
+#endif
+        return 0;
+    }
+    for (int i = 1; i < argc; i++) {
+        FILE *file = fopen(argv[i], "rb");
+        if (!file) {
+            fprintf(stderr, "Cannot open %s\n", argv[i]);
+            return 1;
+        }
+        size_t size = read_input(file);
+        fclose(file);
+        LLVMFuzzerTestOneInput(s_input, size);
+    }
+    printf("%d inputs passed\n", argc - 1);
+    return 0;
+}
@@ -0,0 +1,279 @@
+/**
+ * @file fuzz_ws_receiver.c
+ * @brief Fuzz target of the WebSocket client receive path, from the frame bytes to the parsed message
+ *
+ * A fake TCP transport, returned by the wrapped esp_transport_tcp_init() to the transports the client
+ * creates, answers the upgrade request and then serves the input as the bytes of the server. The
+ * client offers permessage-deflate on every input. Frames are parsed by esp_transport_ws, read in
+ * buffer_size chunks, inflated and posted by esp_websocket_client, and reassembled and parsed
+ * as in smart_home. Whatever ASan or the checks of the event handler catch aborts the run.
+ *
+ * Input: one flags byte, then the server bytes after the upgrade response
+ *   bit 0      the server accepts permessage-deflate, every data message is inflated
+ *   bits 1-2   client buffer_size, see s_buffer_sizes
+ *   bits 3-5   most bytes the transport returns per read, see s_read_sizes
+ *   bit 6      the accepted extension has server_no_context_takeover
+ *
+ * The client runs in a FreeRTOS task, so this is no libFuzzer target: the inputs are read from
+ * FUZZ_INPUT, a file or a directory of files, or from stdin, which is what AFL feeds.
+ */
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <esp_log.h>
+#include <esp_transport.h>
+#include <esp_transport_ws.h>
+#include <esp_tls_crypto.h>
+#include <esp_websocket_client.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "smart_home/protocol.h"
+
+static const char *TAG = "FUZZ_WS";
+
+#define WS_GUID             "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define INPUT_MAX           (256 * 1024)
+#define ASSEMBLY_SIZE       1024
+#define FINISHED_BIT        BIT0
+
+static const int s_buffer_sizes[] = { 16, 125, 256, 1024 };
+static const int s_read_sizes[] = { 1, 3, 16, 64, 256, 1024, 4096, INPUT_MAX };
+
+// The server side of the fake connection
+typedef struct {
+    char response[384];         // upgrade response, served before the input
+    size_t response_len;
+    size_t response_pos;
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+    int read_size;
+    uint8_t flags;
+} fake_server_t;
+
+static fake_server_t s_server;
+static EventGroupHandle_t s_events;
+static int s_buffer_size;
+static protocol_assembler_t s_assembler;
+static char s_assembly[ASSEMBLY_SIZE];
+static uint8_t s_input[INPUT_MAX];
+
+static int fake_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    s_server.response_len = 0;
+    s_server.response_pos = 0;
+    return 0;
+}
+
+// The first write is the upgrade request, it is answered with the accept key the client expects
+static int fake_write(esp_transport_handle_t t, const char *buffer, int len, int timeout_ms)
+{
+    if (s_server.response_len) {
+        return len;     // PONG and CLOSE replies
+    }
+    const char *key = memmem(buffer, len, "Sec-WebSocket-Key: ", 19);
+    if (!key) {
+        return -1;
+    }
+    key += 19;
+    const char *end = memchr(key, '\r', buffer + len - key);
+    if (!end || end - key > 32) {
+        return -1;
+    }
+
+    char concatenated[32 + sizeof(WS_GUID)];
+    int concatenated_len = snprintf(concatenated, sizeof(concatenated), "%.*s%s", (int)(end - key), key, WS_GUID);
+    unsigned char digest[20];
+    unsigned char accept[32];
+    size_t accept_len = 0;
+    esp_crypto_sha1((const unsigned char *)concatenated, concatenated_len, digest);
+    esp_crypto_base64_encode(accept, sizeof(accept), &accept_len, digest, sizeof(digest));
+
+    const char *extensions = "";
+    if ((s_server.flags & 1) && memmem(buffer, len, "permessage-deflate", 18)) {
+        extensions = (s_server.flags & 0x40) ? "Sec-WebSocket-Extensions: permessage-deflate; server_no_context_takeover\r\n"
+                     : "Sec-WebSocket-Extensions: permessage-deflate\r\n";
+    }
+    s_server.response_len = snprintf(s_server.response, sizeof(s_server.response),
+                                     "HTTP/1.1 101 Switching Protocols\r\n"
+                                     "Upgrade: websocket\r\n"
+                                     "Connection: Upgrade\r\n"
+                                     "%s"
+                                     "Sec-WebSocket-Accept: %.*s\r\n\r\n", extensions, (int)accept_len, accept);
+    return len;
+}
+
+// The response is served on its own, the input in reads of at most read_size bytes
+static int fake_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
+{
+    const uint8_t *source;
+    size_t available;
+    if (s_server.response_pos < s_server.response_len) {
+        source = (const uint8_t *)s_server.response + s_server.response_pos;
+        available = s_server.response_len - s_server.response_pos;
+        s_server.response_pos += available < (size_t)len ? available : (size_t)len;
+    } else {
+        source = s_server.data + s_server.pos;
+        available = s_server.len - s_server.pos;
+        if (available > (size_t)s_server.read_size) {
+            available = s_server.read_size;
+        }
+        s_server.pos += available < (size_t)len ? available : (size_t)len;
+    }
+    if (available == 0) {
+        return -1;      // the connection ends with the input
+    }
+    int rlen = available < (size_t)len ? available : len;
+    memcpy(buffer, source, rlen);
+    return rlen;
+}
+
+static int fake_poll(esp_transport_handle_t t, int timeout_ms)
+{
+    return 1;
+}
+
+static int fake_close(esp_transport_handle_t t)
+{
+    return 0;
+}
+
+// Linked with --wrap=esp_transport_tcp_init, see CMakeLists.txt
+esp_transport_handle_t __wrap_esp_transport_tcp_init(void)
+{
+    esp_transport_handle_t tcp = esp_transport_init();
+    if (tcp) {
+        esp_transport_set_func(tcp, fake_connect, fake_read, fake_write, fake_close, fake_poll, fake_poll, NULL);
+    }
+    return tcp;
+}
+
+static void check(bool condition, const char *what)
+{
+    if (!condition) {
+        fprintf(stderr, "FUZZ CHECK FAILED: %s\n", what);
+        abort();
+    }
+}
+
+static void websocket_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    esp_websocket_event_data_t *data = (esp_websocket_event_data_t *)event_data;
+
+    if (event_id == WEBSOCKET_EVENT_FINISH) {
+        xEventGroupSetBits(s_events, FINISHED_BIT);
+        return;
+    }
+    if (event_id != WEBSOCKET_EVENT_DATA) {
+        return;
+    }
+
+    check(data->data_len >= 0 && data->payload_offset >= 0, "negative length or offset");
+    check(data->data_len == 0 || data->data_ptr != NULL, "data without a pointer");
+    check((int64_t)data->payload_offset + data->data_len <= data->payload_len, "chunk beyond the payload");
+    if (data->op_code >= WS_TRANSPORT_OPCODES_CLOSE) {
+        check(data->data_len <= 125, "control frame over 125 bytes");
+        return;
+    }
+    check(data->data_len <= s_buffer_size, "chunk larger than the buffer");
+
+    // Every byte is read, ASan reports a chunk reaching outside its buffer
+    volatile uint8_t sum = 0;
+    for (int i = 0; i < data->data_len; i++) {
+        sum += (uint8_t)data->data_ptr[i];
+    }
+
+    size_t length;
+    bool first = data->op_code != WS_TRANSPORT_OPCODES_CONT && data->payload_offset == 0;
+    const char *message = protocol_assemble(&s_assembler, data->data_ptr, data->data_len,
+                                            data->payload_offset, data->payload_len, first, data->fin, &length);
+    if (message) {
+        protocol_command_t command;
+        if (protocol_parse(message, length, &command) == PROTOCOL_MSG_COMMAND) {
+            check(strlen(command.value) == command.value_len, "value length");
+        }
+    }
+}
+
+static void run_input(const uint8_t *input, size_t size)
+{
+    if (size < 1) {
+        return;
+    }
+    uint8_t flags = input[0];
+    memset(&s_server, 0, sizeof(s_server));
+    s_server.data = input + 1;
+    s_server.len = size - 1;
+    s_server.read_size = s_read_sizes[(flags >> 3) & 7];
+    s_server.flags = flags;
+    s_buffer_size = s_buffer_sizes[(flags >> 1) & 3];
+    protocol_assembler_init(&s_assembler, s_assembly, sizeof(s_assembly));
+
+    const esp_websocket_client_config_t config = {
+        .uri = "ws://fuzz.invalid/ws/esp32",
+        .port = 80,
+        .buffer_size = s_buffer_size,
+        .disable_auto_reconnect = true,
+        .network_timeout_ms = 100,
+        .permessage_deflate_enable = true,
+    };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&config);
+    if (!client) {
+        ESP_LOGE(TAG, "Client init failed");
+        abort();
+    }
+    esp_websocket_register_events(client, WEBSOCKET_EVENT_ANY, websocket_event_handler, NULL);
+    xEventGroupClearBits(s_events, FINISHED_BIT);
+    esp_websocket_client_start(client);
+    xEventGroupWaitBits(s_events, FINISHED_BIT, pdTRUE, pdTRUE, portMAX_DELAY);
+
+    esp_websocket_client_destroy(client);
+}
+
+static void run_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        ESP_LOGE(TAG, "Cannot open %s", path);
+        abort();
+    }
+    size_t size = fread(s_input, 1, sizeof(s_input), file);
+    fclose(file);
+    run_input(s_input, size);
+}
+
+void app_main(void)
+{
+    s_events = xEventGroupCreate();
+    if (!getenv("FUZZ_VERBOSE")) {
+        esp_log_level_set("*", ESP_LOG_NONE);
+    }
+
+    const char *path = getenv("FUZZ_INPUT");
+    int count = 0;
+    struct stat st;
+    if (!path) {
+        run_input(s_input, fread(s_input, 1, sizeof(s_input), stdin));
+        count = 1;
+    } else if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        DIR *dir = opendir(path);
+        for (struct dirent *entry = readdir(dir); entry; entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            char file[512];
+            snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+            run_file(file);
+            count++;
+        }
+        closedir(dir);
+    } else {
+        run_file(path);
+        count = 1;
+    }
+    printf("%d inputs passed\n", count);
+    fflush(stdout);
+    exit(0);
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Checks that numbered commands are deduplicated per connection, not across them.
+
+Serves the device twice, as a server that restarted would: both connections number their
+commands from seq=1. The device has to execute seq=1 on each connection, and a resend of it
+within a connection has to be acknowledged without being executed again.
+
+    ./dedup_session_test.py --port 8080     # then start the linux build or reset the device
+
+Exits with 0 if the device behaved, 1 otherwise.
+"""
+import argparse
+import asyncio
+import sys
+
+from smart_home_server import DEFAULT_TOKEN, Connection
+
+
+class Session:
+    def __init__(self, conn, device):
+        self.conn = conn
+        self.device = device
+        self.binds = 0
+        self.acks = asyncio.Queue()
+
+    async def read(self):
+        while True:
+            message = await self.conn.receive()
+            if message is None:
+                return
+            text = message[1].decode(errors='replace')
+            if text.startswith(f'bind:{self.device}:'):
+                self.binds += 1
+            elif text.startswith('ack:'):
+                await self.acks.put(int(text[4:]))
+
+    async def command(self, value, seq, timeout):
+        """Sends a numbered command, returns the binds it caused once it is acknowledged."""
+        binds = self.binds
+        await self.conn.send(f'datasend:{self.device}:SWITCH:{value}:seq={seq}')
+        ack = await asyncio.wait_for(self.acks.get(), timeout)
+        if ack != seq:
+            raise AssertionError(f'ack:{ack} for seq={seq}')
+        # The bind is queued before the ack, both went out by now
+        return self.binds - binds
+
+
+async def serve(reader, writer, args, results, done):
+    conn = Connection(reader, writer, None)
+    try:
+        if not await conn.handshake():
+            return
+        _, token = await conn.receive() or (None, b'')
+        if token.decode(errors='replace') != args.token:
+            await conn.close(1008)
+            return
+        await conn.send('Successfully connected')
+        session = Session(conn, args.device)
+        reader_task = asyncio.create_task(session.read())
+        number = len(results) + 1
+        first = await session.command(number % 2, 1, args.timeout)
+        resent = await session.command(number % 2, 1, args.timeout)
+        results.append((first, resent))
+        print(f'connection {number}: seq=1 executed {first}x, resend executed {resent}x', file=sys.stderr)
+        reader_task.cancel()
+        await conn.close()
+    except (asyncio.TimeoutError, AssertionError, ConnectionError, asyncio.IncompleteReadError) as e:
+        print(f'connection failed: {e!r}', file=sys.stderr)
+        results.append((0, 0))
+    finally:
+        writer.close()
+        if len(results) == 2:
+            done.set()
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--host', default='0.0.0.0')
+    parser.add_argument('--port', type=int, default=8080)
+    parser.add_argument('--token', default=DEFAULT_TOKEN)
+    parser.add_argument('--device', type=int, default=102)
+    parser.add_argument('--timeout', type=float, default=5, help='seconds to wait for an ack')
+    parser.add_argument('--connect-timeout', type=float, default=60)
+    args = parser.parse_args()
+
+    results = []
+    done = asyncio.Event()
+    server = await asyncio.start_server(lambda r, w: serve(r, w, args, results, done), args.host, args.port)
+    async with server:
+        await asyncio.wait_for(done.wait(), args.connect_timeout)
+    # Executed once per connection, the resend never
+    ok = results == [(1, 0), (1, 0)]
+    print('PASS' if ok else f'FAIL {results}')
+    return 0 if ok else 1
+
+
+if __name__ == '__main__':
+    sys.exit(asyncio.run(main()))
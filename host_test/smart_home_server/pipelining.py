@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""Command throughput one at a time against pipelined with sequence numbers and acks.
+
+Runs smart_home_server.py twice against the same device, which reconnects between the runs:
+first every command waits for the bind echo of the one before, then the commands are numbered
+and up to --window of them are in flight, each acknowledged by an `ack:<seq>` frame.
+
+    ./pipelining.py --duration 20
+    ./pipelining.py --window 32 --duplicate 0.05 --out /tmp/pipelining
+
+Both runs offer the same --rate, high enough that the one at a time run is bound by the round
+trip. The table compares acknowledged commands per second and their latency.
+"""
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+SERVER = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'smart_home_server.py')
+
+
+def run(name, extra, args):
+    out = os.path.join(args.out, name + '.json')
+    command = [sys.executable, SERVER, '--port', str(args.port), '--rate', str(args.rate),
+               '--burst', str(args.window), '--duration', str(args.duration), '--out', out, '--quiet'] + extra
+    print(f'== {name}: waiting for the device', file=sys.stderr, flush=True)
+    subprocess.run(command, check=True, stdout=subprocess.DEVNULL, timeout=args.duration + args.connect_timeout)
+    with open(out) as f:
+        result = json.load(f)
+    latency = result['latency_us']
+    return {
+        'mode': name,
+        'throughput_cmd_s': result['throughput_cmd_s'],
+        'acked': result['commands_acked'],
+        'lost': result['commands_lost'],
+        'p50_us': latency.get('p50'),
+        'p99_us': latency.get('p99'),
+        'duplicates_sent': result['duplicates_sent'],
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--port', type=int, default=8080)
+    parser.add_argument('--rate', type=float, default=2000, help='commands per second offered')
+    parser.add_argument('--window', type=int, default=16, help='commands in flight when pipelined')
+    parser.add_argument('--duration', type=float, default=20)
+    parser.add_argument('--duplicate', type=float, default=0, help='fraction resent in the pipelined run')
+    parser.add_argument('--connect-timeout', type=float, default=60)
+    parser.add_argument('--out', default='.')
+    args = parser.parse_args()
+    os.makedirs(args.out, exist_ok=True)
+
+    rows = [
+        run('one_at_a_time', ['--max-in-flight', '1'], args),
+        run('pipelined', ['--seq', '--max-in-flight', str(args.window), '--duplicate', str(args.duplicate)], args),
+    ]
+    columns = list(rows[0].keys())
+    widths = [max(len(c), *(len(str(r[c])) for r in rows)) for c in columns]
+    print('  '.join(c.ljust(w) for c, w in zip(columns, widths)))
+    for row in rows:
+        print('  '.join(str(row[c]).ljust(w) for c, w in zip(columns, widths)))
+    if rows[0]['throughput_cmd_s']:
+        print(f'speedup {rows[1]["throughput_cmd_s"] / rows[0]["throughput_cmd_s"]:.2f}x')
+
+
+if __name__ == '__main__':
+    main()
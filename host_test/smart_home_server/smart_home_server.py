@@ -0,0 +1,555 @@
+#!/usr/bin/env python3
+"""Stand-in for the smart_home server and a command load generator.
+
+Speaks the device protocol of main/smart_home: the first message of the device is its auth
+token and is answered with "Successfully connected", the server pushes
+`datasend:<id>:<TYPE>:<value>` commands and the device reports `bind:<id>:<value>`. Python
+standard library only, works against the linux build and a real device alike:
+
+    ./smart_home_server.py --port 8080                      # stand-in, logs what the device binds
+    ./smart_home_server.py --rate 50 --duration 30 --out result.json
+    ./smart_home_server.py --rate 200 --burst 20 --size 512 --duration 10
+
+Commands toggle the relay (device 102 by default), the firmware acknowledges each with a bind
+of the same value, which is what the end-to-end latency is measured to. With --seq the commands
+are numbered and the latency is measured to the `ack:<seq>` of each, so with --max-in-flight
+above 1 they are pipelined instead of sent one echo at a time; --duplicate resends some of them
+as a flapping link would, the device acknowledges those without executing them again. --size
+pads a command with a field the firmware ignores. The device "metrics", "latency", "memprof" and
+"calibration" reports are requested after the run and added to the results, which are printed
+as JSON. --record keeps every message sent to the device as a file, host_test/fuzz/make_corpus.py
+turns them into seeds.
+
+--rpc-devices reads the state of the listed devices over the RPC layer of main/rpc, in BINARY
+frames, --rpc-rounds times one request per device and the same number of times all of them
+batched in one frame, and compares the round trips:
+
+    ./smart_home_server.py --rpc-devices 102,154,155 --rpc-rounds 50 --out rpc.json
+
+After authenticating, the device sends `state:<version>:<base>:<id>=<value>,...`, the values
+changed since the version this server confirmed with `synced:<version>`. The table is kept across
+reconnects of the device. A delta on a base the server does not know, after the server restarted,
+is answered with `snapshot` and the device sends the full table. A device with no changes since the
+last confirmed version sends nothing, so a server without a table asks with `snapshot` right away.
+"""
+import argparse
+import asyncio
+import base64
+import collections
+import hashlib
+import json
+import os
+import random
+import statistics
+import struct
+import sys
+import time
+
+WS_GUID = '258EAFA5-E914-47DA-95CA-C5AB0DC85B11'
+
+# RPC frames of main/smart_home/protocol.h, method ids of main/rpc/rpc.h and main/main.c
+RPC_REQUEST, RPC_RESPONSE = 0x01, 0x02
+RPC_METHOD_STATS = 1
+RPC_METHOD_DEVICE_GET = 16
+RPC_STATUS = ['ok', 'unknown_method', 'bad_args', 'no_space', 'failed']
+OP_CONT, OP_TEXT, OP_BINARY, OP_CLOSE, OP_PING, OP_PONG = 0x0, 0x1, 0x2, 0x8, 0x9, 0xA
+DEFAULT_TOKEN = 'auth:PIgXssg1dhXIGpcJxiri7Py6J5wYfangki'
+
+
+def unmask(payload, mask):
+    """XOR with the repeated masking key as one big integer, per byte it is too slow for 16 KB frames."""
+    length = len(payload)
+    key = int.from_bytes((mask * (length // 4 + 1))[:length], 'little')
+    return (int.from_bytes(payload, 'little') ^ key).to_bytes(length, 'little')
+
+
+class Connection:
+    """Server side of one WebSocket connection, frames from the client are masked."""
+
+    def __init__(self, reader, writer, record_dir=None):
+        self.reader = reader
+        self.writer = writer
+        self.record_dir = record_dir
+        self.bytes_in = 0
+        self.bytes_out = 0
+
+    async def handshake(self):
+        request = await self.reader.readuntil(b'\r\n\r\n')
+        headers = {}
+        for line in request.decode('latin-1').split('\r\n')[1:]:
+            if ':' in line:
+                name, value = line.split(':', 1)
+                headers[name.strip().lower()] = value.strip()
+        key = headers.get('sec-websocket-key')
+        if not key:
+            self.writer.write(b'HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n')
+            await self.writer.drain()
+            return False
+        accept = base64.b64encode(hashlib.sha1((key + WS_GUID).encode()).digest()).decode()
+        self.writer.write(('HTTP/1.1 101 Switching Protocols\r\n'
+                           'Upgrade: websocket\r\nConnection: Upgrade\r\n'
+                           f'Sec-WebSocket-Accept: {accept}\r\n\r\n').encode())
+        await self.writer.drain()
+        return True
+
+    async def send(self, payload, opcode=OP_TEXT):
+        if isinstance(payload, str):
+            payload = payload.encode()
+        length = len(payload)
+        if length < 126:
+            header = struct.pack('!BB', 0x80 | opcode, length)
+        elif length < 65536:
+            header = struct.pack('!BBH', 0x80 | opcode, 126, length)
+        else:
+            header = struct.pack('!BBQ', 0x80 | opcode, 127, length)
+        self.writer.write(header + payload)
+        self.bytes_out += len(header) + length
+        if self.record_dir and opcode in (OP_TEXT, OP_BINARY):
+            record(self.record_dir, payload)
+        await self.writer.drain()
+
+    async def receive(self):
+        """Next data message as (opcode, bytes), None once the connection is closed."""
+        message = b''
+        message_opcode = None
+        while True:
+            first, second = await self.reader.readexactly(2)
+            opcode = first & 0x0F
+            length = second & 0x7F
+            header = 2
+            if length == 126:
+                length, = struct.unpack('!H', await self.reader.readexactly(2))
+                header += 2
+            elif length == 127:
+                length, = struct.unpack('!Q', await self.reader.readexactly(8))
+                header += 8
+            mask = await self.reader.readexactly(4) if second & 0x80 else None
+            payload = await self.reader.readexactly(length)
+            self.bytes_in += header + (4 if mask else 0) + length
+            if mask:
+                payload = unmask(payload, mask)
+
+            if opcode == OP_PING:
+                await self.send(payload, OP_PONG)
+            elif opcode == OP_CLOSE:
+                try:
+                    await self.send(payload[:2], OP_CLOSE)
+                except ConnectionError:
+                    pass
+                return None
+            elif opcode in (OP_TEXT, OP_BINARY, OP_CONT):
+                if opcode != OP_CONT:
+                    message_opcode = opcode
+                message += payload
+                if first & 0x80:
+                    return message_opcode, message
+
+    async def close(self, code=1000):
+        try:
+            await self.send(struct.pack('!H', code), OP_CLOSE)
+        except ConnectionError:
+            pass
+        self.writer.close()
+
+
+class DeviceState:
+    """Device values kept from the state messages, across reconnects."""
+
+    def __init__(self):
+        self.values = {}
+        self.version = 0
+        self.snapshots = 0
+        self.deltas = 0
+        self.snapshot_requests = 0
+        self.sync_bytes = []
+
+    def on_state(self, text):
+        """Applies a state message, returns the reply: synced:<version> or snapshot."""
+        try:
+            _, version, base, entries = text.split(':', 3)
+            version, base = int(version), int(base)
+            values = dict(entry.split('=', 1) for entry in entries.split(',') if entry)
+        except ValueError:
+            return None
+        if base and base != self.version:
+            self.snapshot_requests += 1
+            return 'snapshot'
+        if base:
+            self.deltas += 1
+        else:
+            self.snapshots += 1
+            self.values = {}
+        self.values.update(values)
+        self.version = version
+        self.sync_bytes.append(len(text))
+        return f'synced:{version}'
+
+    def summary(self):
+        return {
+            'version': self.version,
+            'values': self.values,
+            'snapshots': self.snapshots,
+            'deltas': self.deltas,
+            'snapshot_requests': self.snapshot_requests,
+            'sync_bytes': self.sync_bytes[-20:],
+        }
+
+
+def record(directory, payload):
+    """Messages are stored once, named after their content."""
+    path = os.path.join(directory, hashlib.sha1(payload).hexdigest()[:16])
+    if not os.path.exists(path):
+        with open(path, 'wb') as f:
+            f.write(payload)
+
+
+class LoadRun:
+    """Commands sent to one device connection and their acknowledgements."""
+
+    def __init__(self, args, state):
+        self.args = args
+        self.state = state
+        self.pending = collections.OrderedDict()    # seq: (value, send time) of unacknowledged commands
+        self.next_seq = 0
+        self.duplicates = 0
+        self.unexpected_acks = 0
+        self.latencies_us = []
+        self.sent = 0
+        self.mismatched = 0
+        self.binds = collections.Counter()
+        self.reports = {}
+        self.report_waiters = {}
+        self.next_rpc_id = 0
+        self.rpc_waiters = {}   # request id: future of (status, result)
+        self.rpc = {}
+        self.started = None
+        self.finished = None
+
+    def command(self, value, seq):
+        message = f'datasend:{self.args.device}:{self.args.control}:{value}'
+        if self.args.seq:
+            message += f':seq={seq}'
+        if self.args.size > len(message) + 1:
+            message += ':' + 'x' * (self.args.size - len(message) - 1)
+        return message
+
+    def on_bind(self, device, value):
+        self.binds[device] += 1
+        if self.args.seq or device != str(self.args.device) or not self.pending:
+            return
+        expected, sent_ns = self.pending.popitem(last=False)[1]
+        if value != expected:
+            self.mismatched += 1
+        self.latencies_us.append((time.perf_counter_ns() - sent_ns) / 1000)
+
+    def on_ack(self, seq):
+        entry = self.pending.pop(seq, None)
+        if entry is None:
+            self.unexpected_acks += 1     # a duplicate or a command of an earlier run
+            return
+        self.latencies_us.append((time.perf_counter_ns() - entry[1]) / 1000)
+
+    def on_report(self, name, body):
+        self.reports[name] = body
+        waiter = self.report_waiters.pop(name, None)
+        if waiter and not waiter.done():
+            waiter.set_result(body)
+
+    async def request_report(self, conn, name, timeout):
+        waiter = asyncio.get_running_loop().create_future()
+        self.report_waiters[name] = waiter
+        await conn.send(name)
+        try:
+            return await asyncio.wait_for(waiter, timeout)
+        except asyncio.TimeoutError:
+            return None
+
+    def on_rpc_response(self, frame):
+        """Resolves the requests a response frame answers, False if it is malformed."""
+        if len(frame) < 2 or frame[0] != RPC_RESPONSE:
+            return False
+        offset = 2
+        for _ in range(frame[1]):
+            if len(frame) - offset < 6:
+                return False
+            request_id, _method, status, length = struct.unpack_from('<HBBH', frame, offset)
+            offset += 6
+            result = frame[offset:offset + length]
+            offset += length
+            waiter = self.rpc_waiters.pop(request_id, None)
+            if waiter and not waiter.done():
+                waiter.set_result((status, result))
+        return offset == len(frame)
+
+    async def rpc_call(self, conn, requests, timeout):
+        """Sends (method, args) requests in one frame, returns their (status, result) in order."""
+        loop = asyncio.get_running_loop()
+        frame = bytearray([RPC_REQUEST, len(requests)])
+        waiters = []
+        for method, args in requests:
+            self.next_rpc_id = (self.next_rpc_id + 1) & 0xFFFF
+            waiter = loop.create_future()
+            self.rpc_waiters[self.next_rpc_id] = waiter
+            waiters.append(waiter)
+            frame += struct.pack('<HBH', self.next_rpc_id, method, len(args)) + args
+        await conn.send(bytes(frame), OP_BINARY)
+        try:
+            return await asyncio.wait_for(asyncio.gather(*waiters), timeout)
+        except asyncio.TimeoutError:
+            return None
+
+    async def query_devices(self, conn):
+        """Device states one request at a time against one batch per round."""
+        args = self.args
+        devices = [int(d) for d in args.rpc_devices.split(',')]
+        requests = [(RPC_METHOD_DEVICE_GET, struct.pack('<I', d)) for d in devices]
+        sequential_us, batched_us, states, failures = [], [], {}, 0
+        for _ in range(args.rpc_rounds):
+            start = time.perf_counter_ns()
+            replies = []
+            for request in requests:
+                replies += await self.rpc_call(conn, [request], args.drain) or [None]
+            sequential_us.append((time.perf_counter_ns() - start) / 1000)
+
+            start = time.perf_counter_ns()
+            batch = await self.rpc_call(conn, requests, args.drain) or [None] * len(requests)
+            batched_us.append((time.perf_counter_ns() - start) / 1000)
+
+            for reply in replies + batch:
+                if reply is None or reply[0] != 0:
+                    failures += 1
+                    continue
+                result = reply[1]
+                while len(result) >= 5:
+                    device, length = struct.unpack_from('<IB', result)
+                    states[device] = result[5:5 + length].decode(errors='replace')
+                    result = result[5 + length:]
+        stats = await self.rpc_call(conn, [(RPC_METHOD_STATS, b'')], args.drain)
+        sequential, batched = latency_summary(sequential_us), latency_summary(batched_us)
+        self.rpc = {
+            'devices': devices,
+            'rounds': args.rpc_rounds,
+            'failures': failures,
+            'states': {str(d): states.get(d) for d in devices},
+            'sequential_us': sequential,
+            'batched_us': batched,
+            'speedup': round(sequential['mean'] / batched['mean'], 2) if batched_us and batched['mean'] else None,
+        }
+        if stats and stats[0][0] == 0:
+            self.reports['rpc_stats'] = stats[0][1].decode(errors='replace')
+
+    async def drive(self, conn):
+        args = self.args
+        interval = args.burst / args.rate
+        value = 0
+        self.started = time.perf_counter()
+        next_burst = self.started
+        deadline = self.started + args.duration
+        while time.perf_counter() < deadline:
+            for _ in range(args.burst):
+                if args.max_in_flight and len(self.pending) >= args.max_in_flight:
+                    break
+                value ^= 1
+                self.next_seq += 1
+                command = self.command(value, self.next_seq)
+                self.pending[self.next_seq] = (str(value), time.perf_counter_ns())
+                await conn.send(command)
+                self.sent += 1
+                if args.duplicate and random.random() < args.duplicate:
+                    await conn.send(command)
+                    self.duplicates += 1
+            next_burst += interval
+            await asyncio.sleep(max(0.0, next_burst - time.perf_counter()))
+        self.finished = time.perf_counter()
+
+        # Acknowledgements still on their way
+        drain_until = time.perf_counter() + args.drain
+        while self.pending and time.perf_counter() < drain_until:
+            await asyncio.sleep(0.01)
+
+    def results(self, conn):
+        elapsed = (self.finished or time.perf_counter()) - (self.started or time.perf_counter())
+        acked = len(self.latencies_us)
+        result = {
+            'config': {k: v for k, v in vars(self.args).items() if k not in ('out', 'token', 'record')},
+            'duration_s': round(elapsed, 3),
+            'commands_sent': self.sent,
+            'commands_acked': acked,
+            'commands_lost': len(self.pending),
+            'ack_mismatches': self.mismatched,
+            'duplicates_sent': self.duplicates,
+            'unexpected_acks': self.unexpected_acks,
+            'throughput_cmd_s': round(acked / elapsed, 2) if elapsed > 0 else 0,
+            'bytes_in': conn.bytes_in,
+            'bytes_out': conn.bytes_out,
+            'binds': dict(self.binds),
+            'latency_us': latency_summary(self.latencies_us),
+        }
+        if self.rpc:
+            result['rpc'] = self.rpc
+        result['state'] = self.state.summary()
+        for name, body in self.reports.items():
+            try:
+                result['device_' + name] = json.loads(body)
+            except ValueError:
+                result['device_' + name] = body
+        return result
+
+
+def percentile(ordered, fraction):
+    index = min(len(ordered) - 1, int(round(fraction * (len(ordered) - 1))))
+    return round(ordered[index], 1)
+
+
+def latency_summary(samples):
+    if not samples:
+        return {'n': 0}
+    ordered = sorted(samples)
+    return {
+        'n': len(ordered),
+        'min': round(ordered[0], 1),
+        'mean': round(statistics.fmean(ordered), 1),
+        'p50': percentile(ordered, 0.50),
+        'p90': percentile(ordered, 0.90),
+        'p99': percentile(ordered, 0.99),
+        'max': round(ordered[-1], 1),
+    }
+
+
+def log(args, text):
+    if not args.quiet:
+        print(text, file=sys.stderr, flush=True)
+
+
+async def serve_device(reader, writer, args, state, done):
+    conn = Connection(reader, writer, args.record)
+    peer = writer.get_extra_info('peername')
+    try:
+        if not await conn.handshake():
+            return
+        log(args, f'device connected from {peer}')
+
+        opcode, token = await conn.receive() or (None, b'')
+        if token.decode(errors='replace') != args.token:
+            log(args, 'wrong auth token, closing')
+            await conn.close(1008)
+            return
+        await conn.send('Successfully connected')
+        log(args, 'device authenticated')
+        if state.version == 0:
+            await conn.send('snapshot')
+
+        run = LoadRun(args, state)
+        reader_task = asyncio.create_task(read_device(conn, run, args))
+        if args.rate > 0 or args.rpc_devices:
+            await asyncio.sleep(args.warmup)
+            if args.rate > 0:
+                await run.drive(conn)
+            if args.rpc_devices:
+                await run.query_devices(conn)
+            for name in ('metrics', 'latency', 'memprof', 'calibration'):
+                await run.request_report(conn, name, args.drain)
+            result = run.results(conn)
+            write_result(args, result)
+            reader_task.cancel()
+            await conn.close()
+            done.set()
+        else:
+            await reader_task
+    except (asyncio.IncompleteReadError, ConnectionError) as e:
+        log(args, f'device {peer} disconnected: {e!r}')
+    finally:
+        writer.close()
+
+
+async def read_device(conn, run, args):
+    while True:
+        message = await conn.receive()
+        if message is None:
+            return
+        opcode, payload = message
+        if opcode == OP_BINARY and payload[:1] == bytes([RPC_RESPONSE]):
+            if not run.on_rpc_response(payload):
+                log(args, f'malformed RPC response: {payload[:40].hex()}')
+            continue
+        text = payload.decode(errors='replace')
+        if text.startswith('ack:'):
+            try:
+                run.on_ack(int(text[4:]))
+            except ValueError:
+                log(args, f'malformed ack: {text[:80]}')
+        elif text.startswith('bind:'):
+            parts = text.split(':', 2)
+            if len(parts) == 3:
+                run.on_bind(parts[1], parts[2])
+                if args.rate == 0:
+                    log(args, f'bind device={parts[1]} value={parts[2]}')
+        elif text.startswith('state:'):
+            reply = run.state.on_state(text)
+            if reply is None:
+                log(args, f'malformed state: {text[:80]}')
+                continue
+            await conn.send(reply)
+            log(args, f'state {text.split(":")[1]} from {text.split(":")[2]}: {len(text)} bytes, {reply}')
+        elif ':' in text and text.split(':', 1)[0] in ('metrics', 'latency', 'memprof', 'calibration'):
+            name, body = text.split(':', 1)
+            run.on_report(name, body)
+        else:
+            log(args, f'unexpected message: {text[:80]}')
+
+
+def write_result(args, result):
+    text = json.dumps(result, indent=2)
+    if args.out:
+        with open(args.out, 'w') as f:
+            f.write(text + '\n')
+    print(text)
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--host', default='0.0.0.0')
+    parser.add_argument('--port', type=int, default=8080)
+    parser.add_argument('--token', default=os.environ.get('SMART_HOME_TOKEN', DEFAULT_TOKEN))
+    parser.add_argument('--rate', type=float, default=0, help='commands per second, 0 only serves')
+    parser.add_argument('--burst', type=int, default=1, help='commands sent back to back')
+    parser.add_argument('--size', type=int, default=0, help='pad commands to this many bytes')
+    parser.add_argument('--duration', type=float, default=10, help='seconds of load')
+    parser.add_argument('--warmup', type=float, default=2, help='seconds between auth and load')
+    parser.add_argument('--drain', type=float, default=5, help='seconds to wait for late acks')
+    parser.add_argument('--max-in-flight', type=int, default=0, help='unacked commands at most, 0 unlimited')
+    parser.add_argument('--seq', action='store_true', help='number the commands and wait for ack:<seq> instead of the bind')
+    parser.add_argument('--duplicate', type=float, default=0, help='fraction of the commands sent twice, needs --seq')
+    parser.add_argument('--device', type=int, default=102)
+    parser.add_argument('--control', default='SWITCH')
+    parser.add_argument('--rpc-devices', metavar='ID,...', help='read the state of these devices over RPC')
+    parser.add_argument('--rpc-rounds', type=int, default=20, help='state reads of --rpc-devices per mode')
+    parser.add_argument('--out', help='also write the JSON result to this file')
+    parser.add_argument('--record', metavar='DIR', help='store the messages sent to the device here')
+    parser.add_argument('--quiet', action='store_true')
+    args = parser.parse_args()
+    if args.record:
+        os.makedirs(args.record, exist_ok=True)
+    if args.burst < 1:
+        parser.error('--burst must be at least 1')
+    if args.rpc_devices and not all(d.strip().isdigit() for d in args.rpc_devices.split(',')):
+        parser.error('--rpc-devices is a comma separated list of device ids')
+    if args.duplicate and not args.seq:
+        parser.error('--duplicate needs --seq, the device cannot tell a resent command otherwise')
+
+    done = asyncio.Event()
+    state = DeviceState()
+    server = await asyncio.start_server(lambda r, w: serve_device(r, w, args, state, done), args.host, args.port)
+    log(args, f'listening on {args.host}:{args.port}')
+    async with server:
+        if args.rate > 0 or args.rpc_devices:
+            await done.wait()
+        else:
+            await server.serve_forever()
+
+
+if __name__ == '__main__':
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass
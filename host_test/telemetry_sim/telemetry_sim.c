@@ -0,0 +1,134 @@
+/**
+ * @file telemetry_sim.c
+ * @brief Replays a synthetic day of DHT11 samples and commands through the telemetry batching
+ *        and the radio model, for every report policy and WiFi power save mode
+ *
+ * The sampling loop is the one of app_main(): a sample every second, a batch when due, and an
+ * early batch right after a command while the radio is still awake.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "telemetry/telemetry.h"
+#include "power/radio_model.h"
+
+#define SAMPLE_INTERVAL_MS 1000
+#define COMMAND_EVERY_S    300   // mean time between relay commands
+
+typedef struct {
+    const char *name;
+    telemetry_config_t config;
+} policy_t;
+
+typedef struct {
+    const char *name;
+    uint32_t wake_interval_us;
+} power_mode_t;
+
+typedef struct {
+    uint32_t messages;
+    uint32_t bursts;
+    uint64_t radio_on_us;
+    uint32_t max_delay_ms;       // longest time a changed value waited to be sent
+} result_t;
+
+// DHT11 readings: a slow drift with the +-1 flicker of the integer sensor
+static void sample(unsigned *seed, int t_s, int *temperature, int *humidity)
+{
+    static double temp = 22.0, hum = 45.0;
+    if (t_s == 0) {
+        temp = 22.0;
+        hum = 45.0;
+    }
+    temp += ((int)(rand_r(seed) % 201) - 100) / 4000.0;
+    hum += ((int)(rand_r(seed) % 201) - 100) / 2000.0;
+    *temperature = (int)(temp + 0.5 + ((int)(rand_r(seed) % 61) - 30) / 100.0);
+    *humidity = (int)(hum + 0.5 + ((int)(rand_r(seed) % 61) - 30) / 100.0);
+}
+
+static result_t simulate(const policy_t *policy, const power_mode_t *mode, int duration_s, unsigned seed)
+{
+    telemetry_t telemetry;
+    radio_model_t radio;
+    result_t result = {0};
+    uint32_t changed_since_ms[2] = {0};
+    bool changed[2] = {false};
+
+    telemetry_init(&telemetry, &policy->config, 2);
+    radio_model_init(&radio, mode->wake_interval_us);
+
+    for (int t_s = 0; t_s < duration_s; t_s++) {
+        uint32_t now_ms = t_s * SAMPLE_INTERVAL_MS;
+        int values[2];
+        sample(&seed, t_s, &values[0], &values[1]);
+        for (int ch = 0; ch < 2; ch++) {
+            telemetry_update(&telemetry, ch, values[ch]);
+            int pending;
+            if (telemetry_pending(&telemetry, ch, &pending) && !changed[ch]) {
+                changed[ch] = true;
+                changed_since_ms[ch] = now_ms;
+            } else if (!telemetry_pending(&telemetry, ch, NULL)) {
+                changed[ch] = false;
+            }
+        }
+
+        // a command wakes the loop up right after the relay state was sent
+        bool command = rand_r(&seed) % COMMAND_EVERY_S == 0;
+        if (command) {
+            radio_model_note_traffic(&radio, (uint64_t)now_ms * 1000);
+            result.messages++;
+        }
+
+        if (telemetry_due(&telemetry, now_ms, radio_model_awake(&radio, (uint64_t)now_ms * 1000))) {
+            for (int ch = 0; ch < 2; ch++) {
+                int value;
+                if (telemetry_pending(&telemetry, ch, &value)) {
+                    telemetry_sent(&telemetry, ch, value);
+                    radio_model_note_traffic(&radio, (uint64_t)now_ms * 1000 + 200);
+                    result.messages++;
+                    uint32_t delay_ms = now_ms - changed_since_ms[ch];
+                    if (delay_ms > result.max_delay_ms) {
+                        result.max_delay_ms = delay_ms;
+                    }
+                    changed[ch] = false;
+                }
+            }
+            telemetry_batch_done(&telemetry, now_ms);
+        }
+    }
+
+    result.bursts = radio.bursts;
+    result.radio_on_us = radio_model_on_us(&radio, (uint64_t)duration_s * 1000000);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int hours = argc > 1 ? atoi(argv[1]) : 24;
+    unsigned seed = argc > 2 ? (unsigned)atoi(argv[2]) : 1;
+    int duration_s = hours * 3600;
+
+    const policy_t policies[] = {
+        { "every change", { .report_interval_ms = 0, .urgent_delta = 0 } },
+        { "batch 10 s", { .report_interval_ms = 10000, .urgent_delta = 2 } },
+        { "batch 30 s", { .report_interval_ms = 30000, .urgent_delta = 2 } },
+        { "batch 60 s", { .report_interval_ms = 60000, .urgent_delta = 2 } },
+    };
+    const power_mode_t modes[] = {
+        { "none", 0 },
+        { "min_modem", RADIO_MODEL_BEACON_INTERVAL_US },
+        { "max_modem/3", RADIO_MODEL_BEACON_INTERVAL_US * 3 },
+        { "max_modem/10", RADIO_MODEL_BEACON_INTERVAL_US * 10 },
+    };
+
+    printf("%d h, sample every %d ms, a command every ~%d s\n\n", hours, SAMPLE_INTERVAL_MS, COMMAND_EVERY_S);
+    printf("%-14s %-13s %9s %8s %10s %12s\n", "policy", "power save", "messages", "bursts", "radio on", "max delay");
+    for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+        for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+            result_t r = simulate(&policies[p], &modes[m], duration_s, seed);
+            printf("%-14s %-13s %9u %8u %9.2f%% %10.1f s\n", policies[p].name, modes[m].name,
+                   r.messages, r.bursts, 100.0 * r.radio_on_us / ((uint64_t)duration_s * 1000000),
+                   r.max_delay_ms / 1000.0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""Compare task topologies by DHT11 error rate and command latency under network load.
+
+Every *.defaults file here is a topology, an sdkconfig fragment applied on top of the project's
+sdkconfig.defaults. For each one the firmware is built and flashed, and once the device is back
+smart_home_server.py drives it with commands while the DHT11 keeps being read:
+
+    ./run_topologies.py -p /dev/ttyUSB0 --rate 100 --burst 10 --size 512 --duration 300
+    ./run_topologies.py --only isolated --no-flash          # a device flashed beforehand
+
+The device has to reach this host at the WEBSOCKET_URI of main/main.c. The DHT counters of the
+metrics report count since boot, the warmup included, so a long --duration keeps the rates
+those of the loaded network. Per topology the results of the server are kept in --out, the
+summary table is printed and written there as summary.json.
+"""
+import argparse
+import glob
+import json
+import os
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+PROJECT = os.path.abspath(os.path.join(HERE, '..', '..'))
+SERVER = os.path.join(PROJECT, 'host_test', 'smart_home_server', 'smart_home_server.py')
+
+
+def topologies(only):
+    names = sorted(os.path.splitext(os.path.basename(p))[0] for p in glob.glob(os.path.join(HERE, '*.defaults')))
+    if only:
+        missing = set(only) - set(names)
+        if missing:
+            sys.exit(f'unknown topology: {", ".join(sorted(missing))}')
+        names = [n for n in names if n in only]
+    return names
+
+
+def flash(name, args):
+    build_dir = os.path.join(args.build_root, name)
+    defaults = ';'.join([os.path.join(PROJECT, 'sdkconfig.defaults'), os.path.join(HERE, name + '.defaults')])
+    command = ['idf.py', '-B', build_dir, '-D', f'SDKCONFIG={os.path.join(build_dir, "sdkconfig")}',
+               '-D', f'SDKCONFIG_DEFAULTS={defaults}']
+    if args.port:
+        command += ['-p', args.port]
+    subprocess.run(command + ['flash'], cwd=PROJECT, check=True)
+
+
+def parse_metrics(report):
+    """`name=value` pairs of the metrics report, histograms are kept as text."""
+    metrics = {}
+    for field in report.split() if isinstance(report, str) else []:
+        name, _, value = field.partition('=')
+        try:
+            metrics[name] = int(value)
+        except ValueError:
+            metrics[name] = value
+    return metrics
+
+
+def rate(count, total):
+    return round(100.0 * count / total, 3) if total else None
+
+
+def summarize(name, result):
+    metrics = parse_metrics(result.get('device_metrics', ''))
+    reads = metrics.get('dht_reads', 0)
+    latency = result.get('latency_us', {})
+    return {
+        'topology': name,
+        'dht_reads': reads,
+        'dht_timeout_pct': rate(metrics.get('dht_timeout', 0), reads),
+        'dht_crc_pct': rate(metrics.get('dht_crc', 0), reads),
+        'latency_p50_us': latency.get('p50'),
+        'latency_p99_us': latency.get('p99'),
+        'latency_max_us': latency.get('max'),
+        'throughput_cmd_s': result.get('throughput_cmd_s'),
+        'commands_lost': result.get('commands_lost'),
+        'send_fail': metrics.get('send_fail'),
+        'tx_full': metrics.get('tx_full'),
+    }
+
+
+def measure(name, args):
+    out = os.path.join(args.out, name + '.json')
+    if os.path.exists(out):
+        os.remove(out)
+    server = subprocess.Popen([sys.executable, SERVER, '--port', str(args.server_port), '--rate', str(args.rate),
+                               '--burst', str(args.burst), '--size', str(args.size),
+                               '--duration', str(args.duration), '--warmup', str(args.warmup),
+                               '--out', out, '--quiet'], stdout=subprocess.DEVNULL)
+    try:
+        if not args.no_flash:
+            flash(name, args)
+        # boot, WiFi, the WebSocket connection and the run itself
+        server.wait(timeout=args.duration + args.warmup + args.connect_timeout)
+    except subprocess.TimeoutExpired:
+        print(f'{name}: the device did not finish the run', file=sys.stderr)
+        return None
+    finally:
+        if server.poll() is None:
+            server.kill()
+    with open(out) as f:
+        return summarize(name, json.load(f))
+
+
+def print_table(rows):
+    columns = list(rows[0].keys())
+    widths = [max(len(c), *(len(str(r[c])) for r in rows)) for c in columns]
+    print('  '.join(c.ljust(w) for c, w in zip(columns, widths)))
+    for row in rows:
+        print('  '.join(str(row[c]).ljust(w) for c, w in zip(columns, widths)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('-p', '--port', help='serial port of the device')
+    parser.add_argument('--only', nargs='+', help='topologies to run, all of them by default')
+    parser.add_argument('--no-flash', action='store_true', help='measure the firmware the device runs')
+    parser.add_argument('--server-port', type=int, default=8080)
+    parser.add_argument('--rate', type=float, default=100)
+    parser.add_argument('--burst', type=int, default=10)
+    parser.add_argument('--size', type=int, default=512)
+    parser.add_argument('--duration', type=float, default=300)
+    parser.add_argument('--warmup', type=float, default=5)
+    parser.add_argument('--connect-timeout', type=float, default=120, help='seconds for flashing and connecting')
+    parser.add_argument('--build-root', default=os.path.join(PROJECT, 'build_topology'))
+    parser.add_argument('--out', default=os.path.join(PROJECT, 'build_topology', 'results'))
+    args = parser.parse_args()
+
+    names = topologies(args.only)
+    if args.no_flash and len(names) != 1:
+        parser.error('--no-flash measures a single topology, name it with --only')
+    os.makedirs(args.out, exist_ok=True)
+
+    rows = []
+    for name in names:
+        print(f'== {name}', file=sys.stderr, flush=True)
+        row = measure(name, args)
+        if row:
+            rows.append(row)
+        time.sleep(1)
+    if not rows:
+        sys.exit('no topology was measured')
+    print_table(rows)
+    with open(os.path.join(args.out, 'summary.json'), 'w') as f:
+        json.dump(rows, f, indent=2)
+        f.write('\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,69 @@
+/**
+ * @file boot_timeline.c
+ * @brief Boot timeline trace
+ */
+#include "boot_timeline.h"
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+static const char *TAG = "BOOT";
+
+typedef struct {
+    const char *name;
+    int64_t time_us;
+} boot_mark_t;
+
+static boot_mark_t s_marks[BOOT_TIMELINE_MAX_MARKS];
+static int s_count = 0;
+static bool s_finished = false;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Caller holds s_lock
+static int find_mark(const char *name)
+{
+    for (int i = 0; i < s_count; i++) {
+        if (strcmp(s_marks[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void boot_timeline_mark(const char *name)
+{
+    portENTER_CRITICAL(&s_lock);
+    if (!s_finished && s_count < BOOT_TIMELINE_MAX_MARKS && find_mark(name) < 0) {
+        s_marks[s_count].name = name;
+        // taken under the lock, so the marks stay in order; esp_timer starts with the application
+        s_marks[s_count].time_us = esp_timer_get_time();
+        s_count++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+int64_t boot_timeline_get(const char *name)
+{
+    portENTER_CRITICAL(&s_lock);
+    int i = find_mark(name);
+    int64_t time_us = i < 0 ? -1 : s_marks[i].time_us;
+    portEXIT_CRITICAL(&s_lock);
+    return time_us;
+}
+
+void boot_timeline_finish(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_finished = true;
+    portEXIT_CRITICAL(&s_lock);
+
+    int64_t previous = 0;
+    for (int i = 0; i < s_count; i++) {
+        ESP_LOGI(TAG, "%-18s %7" PRId64 " ms  (+%" PRId64 " ms)", s_marks[i].name,
+                 s_marks[i].time_us / 1000, (s_marks[i].time_us - previous) / 1000);
+        previous = s_marks[i].time_us;
+    }
+}
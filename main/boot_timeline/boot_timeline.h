@@ -0,0 +1,31 @@
+/**
+ * @file boot_timeline.h
+ * @brief Boot timeline trace: named milestones timestamped from power on
+ */
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+#include <stdint.h>
+
+#define BOOT_TIMELINE_MAX_MARKS 16
+
+/**
+ * @brief Record a milestone, may be called from any task
+ *
+ * Only the first occurrence of a name is kept, marks after boot_timeline_finish() are ignored.
+ *
+ * @param name Milestone name, has to outlive the timeline (a string literal)
+ */
+void boot_timeline_mark(const char *name);
+
+/**
+ * @brief Time of a milestone in microseconds since boot, or -1 if it was not reached
+ */
+int64_t boot_timeline_get(const char *name);
+
+/**
+ * @brief Close the timeline and log all milestones with the time since boot and since the previous one
+ */
+void boot_timeline_finish(void);
+
+#endif // BOOT_TIMELINE_H
@@ -0,0 +1,166 @@
+/**
+ * @file calibration.c
+ * @brief Stack and buffer sizing from typical traffic
+ */
+#include "calibration.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "util/format.h"
+
+#if CONFIG_HOME_CALIBRATE
+
+static const char *TAG = "CALIBRATION";
+
+#define REPORT_SIZE 384
+#define ROUND_UP(value, step) (((value) + (step) - 1) / (step) * (step))
+
+typedef struct {
+    const char *name;       // in the report
+    const char *config;     // sdkconfig option of the stack size
+} task_info_t;
+
+static const task_info_t s_tasks[CALIBRATION_TASK_MAX] = {
+    [CALIBRATION_TASK_WEBSOCKET] = { "ws", "CONFIG_HOME_WS_TASK_STACK" },
+    [CALIBRATION_TASK_TX] = { "tx", "CONFIG_HOME_TX_TASK_STACK" },
+    [CALIBRATION_TASK_SENSOR] = { "sensor", "CONFIG_HOME_SENSOR_TASK_STACK" },
+};
+
+static uint32_t s_stack_size[CALIBRATION_TASK_MAX];
+static uint32_t s_stack_min_free[CALIBRATION_TASK_MAX];   // UINT32_MAX until sampled
+static uint32_t s_rx_frame_max = 0;
+static uint32_t s_rx_message_max = 0;
+static uint32_t s_tx_frame_max = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void update_max(uint32_t *max, uint32_t value)
+{
+    portENTER_CRITICAL(&s_lock);
+    if (value > *max) {
+        *max = value;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void calibration_set_stack(calibration_task_t task, uint32_t stack_size)
+{
+    if (task >= CALIBRATION_TASK_MAX) {
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    s_stack_size[task] = stack_size;
+    s_stack_min_free[task] = UINT32_MAX;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void calibration_sample_stack(calibration_task_t task)
+{
+    if (task >= CALIBRATION_TASK_MAX) {
+        return;
+    }
+    // in bytes on ESP-IDF, the scan stops at the first overwritten word
+    uint32_t free_bytes = uxTaskGetStackHighWaterMark(NULL);
+    portENTER_CRITICAL(&s_lock);
+    if (free_bytes < s_stack_min_free[task]) {
+        s_stack_min_free[task] = free_bytes;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void calibration_observe_rx(size_t frame_len, size_t message_len)
+{
+    update_max(&s_rx_frame_max, frame_len);
+    update_max(&s_rx_message_max, message_len);
+}
+
+void calibration_observe_tx(size_t len)
+{
+    update_max(&s_tx_frame_max, len);
+}
+
+// Used stack of a sampled task, false if it was not sampled
+static bool stack_used(calibration_task_t task, uint32_t *used)
+{
+    portENTER_CRITICAL(&s_lock);
+    uint32_t size = s_stack_size[task];
+    uint32_t min_free = s_stack_min_free[task];
+    portEXIT_CRITICAL(&s_lock);
+    if (size == 0 || min_free == UINT32_MAX) {
+        return false;
+    }
+    *used = min_free < size ? size - min_free : 0;
+    return true;
+}
+
+static uint32_t stack_recommended(uint32_t used)
+{
+    uint32_t margin = used / 4 > CALIBRATION_STACK_MARGIN_MIN ? used / 4 : CALIBRATION_STACK_MARGIN_MIN;
+    return ROUND_UP(used + margin, 256);
+}
+
+static uint32_t buffer_recommended(uint32_t largest)
+{
+    uint32_t size = ROUND_UP(largest, 64);
+    return size > CALIBRATION_BUFFER_MIN ? size : CALIBRATION_BUFFER_MIN;
+}
+
+int calibration_format(char *buffer, size_t len)
+{
+    int written = 0;
+    if (len > 0) {
+        buffer[0] = '\0';
+    }
+    for (int i = 0; i < CALIBRATION_TASK_MAX; i++) {
+        uint32_t used;
+        if (stack_used(i, &used)) {
+            format_append(buffer, len, &written, "%s_stack=%" PRIu32 " %s_used=%" PRIu32 " %s_min=%" PRIu32 " ",
+                          s_tasks[i].name, s_stack_size[i], s_tasks[i].name, used,
+                          s_tasks[i].name, stack_recommended(used));
+        }
+    }
+    uint32_t largest_frame = s_rx_frame_max > s_tx_frame_max ? s_rx_frame_max : s_tx_frame_max;
+    format_append(buffer, len, &written, "rx_frame_max=%" PRIu32 " rx_msg_max=%" PRIu32 " tx_frame_max=%" PRIu32
+                  " buffer_min=%" PRIu32 " rx_msg_min=%" PRIu32, s_rx_frame_max, s_rx_message_max,
+                  s_tx_frame_max, buffer_recommended(largest_frame), buffer_recommended(s_rx_message_max));
+    return written;
+}
+
+void calibration_log(void)
+{
+    char *report = malloc(REPORT_SIZE);
+    if (!report) {
+        return;
+    }
+    calibration_format(report, REPORT_SIZE);
+    ESP_LOGI(TAG, "%s", report);
+    free(report);
+
+    for (int i = 0; i < CALIBRATION_TASK_MAX; i++) {
+        uint32_t used;
+        if (stack_used(i, &used)) {
+            ESP_LOGI(TAG, "%s=%" PRIu32, s_tasks[i].config, stack_recommended(used));
+        }
+    }
+    if (s_rx_frame_max || s_tx_frame_max) {
+        uint32_t largest_frame = s_rx_frame_max > s_tx_frame_max ? s_rx_frame_max : s_tx_frame_max;
+        ESP_LOGI(TAG, "CONFIG_HOME_WS_BUFFER_SIZE=%" PRIu32, buffer_recommended(largest_frame));
+        ESP_LOGI(TAG, "CONFIG_HOME_RX_MESSAGE_SIZE=%" PRIu32, buffer_recommended(s_rx_message_max));
+    }
+}
+
+#else
+
+int calibration_format(char *buffer, size_t len)
+{
+    return snprintf(buffer, len, "off");
+}
+
+void calibration_log(void)
+{
+}
+
+#endif // CONFIG_HOME_CALIBRATE
@@ -0,0 +1,83 @@
+/**
+ * @file calibration.h
+ * @brief Stack and buffer sizing from typical traffic, with CONFIG_HOME_CALIBRATE
+ *
+ * The tasks sample their own stack high water mark as they run and smart_home records the size
+ * of every frame it receives and sends. Once the device has seen typical traffic, e.g. a run of
+ * host_test/smart_home_server, the report gives what was used next to the smallest sizes that
+ * are still safe: the stack used plus a margin for paths the run did not take, and a buffer
+ * that holds the largest frame in one piece.
+ *
+ * The report answers a "calibration" request over the WebSocket and is printed every minute,
+ * followed by the recommended values as sdkconfig lines. Without CONFIG_HOME_CALIBRATE the
+ * probes compile to nothing and the report says that calibration is off.
+ */
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+typedef enum {
+    CALIBRATION_TASK_WEBSOCKET = 0,
+    CALIBRATION_TASK_TX,
+    CALIBRATION_TASK_SENSOR,
+    CALIBRATION_TASK_MAX
+} calibration_task_t;
+
+#define CALIBRATION_STACK_MARGIN_MIN 512    ///< Least headroom recommended above the used stack, in bytes
+#define CALIBRATION_BUFFER_MIN 128          ///< Smallest buffer recommended
+
+#if CONFIG_HOME_CALIBRATE
+
+/**
+ * @brief Stack size a task was created with, in bytes
+ */
+void calibration_set_stack(calibration_task_t task, uint32_t stack_size);
+
+/**
+ * @brief Sample the stack high water mark of the calling task, which has to be `task`
+ */
+void calibration_sample_stack(calibration_task_t task);
+
+/**
+ * @brief A data frame received, of `frame_len` payload bytes, and the message it completed
+ *
+ * @param message_len Length of the message once reassembled, 0 while incomplete
+ */
+void calibration_observe_rx(size_t frame_len, size_t message_len);
+
+/**
+ * @brief A data frame sent, of `len` payload bytes
+ */
+void calibration_observe_tx(size_t len);
+
+#else
+
+static inline void calibration_set_stack(calibration_task_t task, uint32_t stack_size) {}
+static inline void calibration_sample_stack(calibration_task_t task) {}
+static inline void calibration_observe_rx(size_t frame_len, size_t message_len) {}
+static inline void calibration_observe_tx(size_t len) {}
+
+#endif // CONFIG_HOME_CALIBRATE
+
+/**
+ * @brief Format the measured and recommended sizes
+ *
+ * Per sampled task `<task>_stack=bytes <task>_used=bytes <task>_min=bytes`, then
+ * `rx_frame_max=n rx_msg_max=n tx_frame_max=n buffer_min=n rx_msg_min=n`. The minimum stack is
+ * the used stack plus a quarter, at least CALIBRATION_STACK_MARGIN_MIN, rounded up to 256 bytes.
+ * The minimum buffer holds the largest frame seen in either direction rounded up to 64 bytes,
+ * at least CALIBRATION_BUFFER_MIN, and rx_msg_min does the same for reassembled messages.
+ *
+ * @return Length of the report, longer than len - 1 if it was truncated
+ */
+int calibration_format(char *buffer, size_t len);
+
+/**
+ * @brief Print the report and the recommended sdkconfig values to the serial console
+ */
+void calibration_log(void);
+
+#endif // CALIBRATION_H
@@ -25,8 +25,15 @@
  * SOFTWARE.
 */
 
+#include "sdkconfig.h"
 #include "esp_timer.h"
+#if CONFIG_IDF_TARGET_LINUX
+/* The simulated bus runs on virtual time, the busy waits advance it */
+#include "sim/gpio_sim.h"
+#define ets_delay_us gpio_sim_delay_us
+#else
 #include "rom/ets_sys.h"
+#endif
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -35,6 +42,7 @@
 static gpio_num_t dht_gpio;
 static int64_t last_read_time = -2000000;
 static struct dht11_reading last_read;
+static int64_t ready_time = 0;
 
 static int _waitOrTimeout(uint16_t microSeconds, int level) {
     int micros_ticks = 0;
@@ -85,31 +93,40 @@ static struct dht11_reading _crcError() {
 }
 
 void DHT11_init(gpio_num_t gpio_num) {
-    /* Wait 1 seconds to make the device pass its initial unstable status */
-    vTaskDelay(1000 / portTICK_PERIOD_MS);
+    /* The device needs 1 second to pass its initial unstable status, the first read waits
+       for what is left of it so the warm-up overlaps with the rest of the start-up */
+    ready_time = esp_timer_get_time() + 1000000;
     dht_gpio = gpio_num;
 }
 
 struct dht11_reading DHT11_read() {
+    int64_t warm_up = ready_time - esp_timer_get_time();
+    if(warm_up > 0) {
+        vTaskDelay(pdMS_TO_TICKS(warm_up / 1000) + 1);
+    }
+
     /* Tried to sense too son since last read (dht11 needs ~2 seconds to make a new read) */
     if(esp_timer_get_time() - 2000000 < last_read_time) {
         return last_read;
     }
 
     last_read_time = esp_timer_get_time();
+    return last_read = DHT11_read_now();
+}
 
+struct dht11_reading DHT11_read_now() {
     uint8_t data[5] = {0,0,0,0,0};
 
     _sendStartSignal();
 
     if(_checkResponse() == DHT11_TIMEOUT_ERROR)
-        return last_read = _timeoutError();
+        return _timeoutError();
 
     /* Read response */
     for(int i = 0; i < 40; i++) {
         /* Initial data */
         if(_waitOrTimeout(50, 0) == DHT11_TIMEOUT_ERROR)
-            return last_read = _timeoutError();
+            return _timeoutError();
 
         if(_waitOrTimeout(70, 1) > 28) {
             /* Bit received was a 1 */
@@ -118,11 +135,9 @@ struct dht11_reading DHT11_read() {
     }
 
     if(_checkCRC(data) != DHT11_CRC_ERROR) {
-        last_read.status = DHT11_OK;
-        last_read.temperature = data[2];
-        last_read.humidity = data[0];
-        return last_read;
+        struct dht11_reading reading = {DHT11_OK, data[2], data[0]};
+        return reading;
     } else {
-        return last_read = _crcError();
+        return _crcError();
     }
 }
\ No newline at end of file
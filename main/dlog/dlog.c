@@ -0,0 +1,137 @@
+/**
+ * @file dlog.c
+ * @brief Deferred logging for the hot path
+ */
+#include "dlog.h"
+#include <freertos/task.h>
+#include <freertos/ringbuf.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "DLOG";
+
+typedef struct {
+    const char *tag;
+    const char *format;
+    uint32_t timestamp;
+    uint8_t level;
+    uint8_t nargs;
+    uint8_t str_len;
+    bool has_str;
+    uint32_t args[DLOG_MAX_ARGS];
+    char str[];
+} dlog_record_t;
+
+static RingbufHandle_t s_ring = NULL;
+static atomic_uint_least32_t s_dropped;
+
+static void dlog_print(const dlog_record_t *record)
+{
+    char line[160];
+    const uint32_t *a = record->args;
+    int len = record->str_len;
+    const char *str = record->str;
+
+    // the arguments were stored as 32 bit words, pass as many as the format expects
+    if (record->has_str) {
+        switch (record->nargs) {
+        case 0: snprintf(line, sizeof(line), record->format, len, str); break;
+        case 1: snprintf(line, sizeof(line), record->format, a[0], len, str); break;
+        case 2: snprintf(line, sizeof(line), record->format, a[0], a[1], len, str); break;
+        case 3: snprintf(line, sizeof(line), record->format, a[0], a[1], a[2], len, str); break;
+        default: snprintf(line, sizeof(line), record->format, a[0], a[1], a[2], a[3], len, str); break;
+        }
+    } else {
+        snprintf(line, sizeof(line), record->format, a[0], a[1], a[2], a[3]);
+    }
+    ESP_LOG_LEVEL((esp_log_level_t)record->level, record->tag, "[%" PRIu32 "] %s", record->timestamp, line);
+}
+
+void dlog_write(esp_log_level_t level, const char *tag, const char *format,
+                const uint32_t *args, int nargs, const char *str, int str_len)
+{
+    _Alignas(dlog_record_t) char buffer[sizeof(dlog_record_t) + DLOG_MAX_STR_LEN];
+    dlog_record_t *record = (dlog_record_t *)buffer;
+
+    if (!args || nargs < 0) {
+        nargs = 0;
+    }
+    if (nargs > DLOG_MAX_ARGS) {
+        nargs = DLOG_MAX_ARGS;
+    }
+    if (str_len < 0 || !str) {
+        str_len = 0;
+    }
+    if (str_len > DLOG_MAX_STR_LEN) {
+        str_len = DLOG_MAX_STR_LEN;
+    }
+    record->tag = tag;
+    record->format = format;
+    record->timestamp = esp_log_timestamp();
+    record->level = level;
+    record->nargs = nargs;
+    record->str_len = str_len;
+    record->has_str = str != NULL;
+    memset(record->args, 0, sizeof(record->args));
+    if (nargs) {
+        memcpy(record->args, args, nargs * sizeof(uint32_t));
+    }
+    if (str_len) {
+        memcpy(record->str, str, str_len);
+    }
+
+    if (!s_ring) {
+        dlog_print(record);
+        return;
+    }
+    if (xRingbufferSend(s_ring, record, sizeof(dlog_record_t) + str_len, 0) != pdTRUE) {
+        atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+    }
+}
+
+static void dlog_task(void *arg)
+{
+    uint32_t reported_dropped = 0;
+    while (1) {
+        size_t size;
+        dlog_record_t *record = xRingbufferReceive(s_ring, &size, portMAX_DELAY);
+        if (record) {
+            dlog_print(record);
+            vRingbufferReturnItem(s_ring, record);
+        }
+        uint32_t dropped = dlog_dropped();
+        if (dropped != reported_dropped) {
+            ESP_LOGW(TAG, "%" PRIu32 " records dropped, the buffer is too small", dropped - reported_dropped);
+            reported_dropped = dropped;
+        }
+    }
+}
+
+esp_err_t dlog_init(const dlog_config_t *config)
+{
+    if (s_ring) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t buffer_size = config && config->buffer_size ? config->buffer_size : 2048;
+    UBaseType_t prio = config && config->task_prio ? config->task_prio : 1;
+    uint32_t stack = config && config->task_stack ? config->task_stack : 3072;
+
+    RingbufHandle_t ring = xRingbufferCreate(buffer_size, RINGBUF_TYPE_NOSPLIT);
+    if (!ring) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_ring = ring;
+    if (xTaskCreate(dlog_task, "dlog", stack, NULL, prio, NULL) != pdPASS) {
+        s_ring = NULL;
+        vRingbufferDelete(ring);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+uint32_t dlog_dropped(void)
+{
+    return atomic_load_explicit(&s_dropped, memory_order_relaxed);
+}
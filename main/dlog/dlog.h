@@ -0,0 +1,83 @@
+/**
+ * @file dlog.h
+ * @brief Deferred logging for the hot path
+ *
+ * A log site stores its format string pointer and raw arguments in a ring buffer, a low
+ * priority task formats and prints them later, so the caller pays neither vsnprintf nor
+ * the UART. The format string has to outlive the call, which a string literal does.
+ *
+ * Levels are gated at compile time per source file: define DLOG_LOCAL_LEVEL before
+ * including this header, it defaults to LOG_LOCAL_LEVEL like ESP_LOGx. Disabled sites
+ * compile to nothing. Enabled records are still filtered by esp_log_level_set() when printed.
+ */
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+
+#ifndef DLOG_LOCAL_LEVEL
+#define DLOG_LOCAL_LEVEL LOG_LOCAL_LEVEL
+#endif
+
+#define DLOG_MAX_ARGS     4   ///< Integer arguments of a record
+#define DLOG_MAX_STR_LEN  64  ///< Longer strings are truncated
+
+/**
+ * @brief Deferred logging configuration
+ */
+typedef struct {
+    size_t buffer_size;       ///< Ring buffer size in bytes, 2048 if 0
+    UBaseType_t task_prio;    ///< Priority of the formatting task, 1 if 0
+    uint32_t task_stack;      ///< Stack of the formatting task, 3072 if 0
+} dlog_config_t;
+
+/**
+ * @brief Start the formatting task, records written before are printed right away
+ */
+esp_err_t dlog_init(const dlog_config_t *config);
+
+/**
+ * @brief Store a record, use the DLOGx macros instead
+ *
+ * @param args  32 bit integer arguments, printed by the conversions of the format in order
+ * @param str   Printed by a trailing `%.*s` conversion, after the integer arguments, may be NULL
+ */
+void dlog_write(esp_log_level_t level, const char *tag, const char *format,
+                const uint32_t *args, int nargs, const char *str, int str_len);
+
+/**
+ * @brief Records dropped because the ring buffer was full
+ */
+uint32_t dlog_dropped(void);
+
+#define DLOG(level, tag, format, ...) do {                                                       \
+        if (DLOG_LOCAL_LEVEL >= level) {                                                         \
+            const uint32_t _dlog_args[] = { 0, ##__VA_ARGS__ };                                  \
+            _Static_assert(sizeof(_dlog_args) / sizeof(uint32_t) - 1 <= DLOG_MAX_ARGS, "too many arguments"); \
+            dlog_write(level, tag, format, &_dlog_args[1], sizeof(_dlog_args) / sizeof(uint32_t) - 1, NULL, 0); \
+        }                                                                                        \
+    } while (0)
+
+/* The format ends with a `%.*s` conversion for str, the integer arguments come before it */
+#define DLOG_STR(level, tag, format, str, str_len, ...) do {                                     \
+        if (DLOG_LOCAL_LEVEL >= level) {                                                         \
+            const uint32_t _dlog_args[] = { 0, ##__VA_ARGS__ };                                  \
+            _Static_assert(sizeof(_dlog_args) / sizeof(uint32_t) - 1 <= DLOG_MAX_ARGS, "too many arguments"); \
+            dlog_write(level, tag, format, &_dlog_args[1], sizeof(_dlog_args) / sizeof(uint32_t) - 1, str, str_len); \
+        }                                                                                        \
+    } while (0)
+
+#define DLOGE(tag, format, ...) DLOG(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define DLOGW(tag, format, ...) DLOG(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define DLOGI(tag, format, ...) DLOG(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define DLOGD(tag, format, ...) DLOG(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+
+#define DLOGW_STR(tag, format, str, str_len, ...) DLOG_STR(ESP_LOG_WARN, tag, format, str, str_len, ##__VA_ARGS__)
+#define DLOGI_STR(tag, format, str, str_len, ...) DLOG_STR(ESP_LOG_INFO, tag, format, str, str_len, ##__VA_ARGS__)
+#define DLOGD_STR(tag, format, str, str_len, ...) DLOG_STR(ESP_LOG_DEBUG, tag, format, str, str_len, ##__VA_ARGS__)
+
+#endif // DLOG_H
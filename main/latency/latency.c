@@ -0,0 +1,149 @@
+/**
+ * @file latency.c
+ * @brief Latency probes for the command and sensor report paths
+ */
+#include "latency.h"
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "util/format.h"
+
+static const char *TAG = "LATENCY";
+
+static const uint32_t s_bucket_bounds_us[LATENCY_BUCKETS - 1] = LATENCY_BUCKET_BOUNDS_US;
+
+static const char *const s_stage_names[LATENCY_STAGE_MAX] = {
+    [LATENCY_STAGE_TRANSPORT_READ] = "transport_read",
+    [LATENCY_STAGE_DISPATCH] = "dispatch",
+    [LATENCY_STAGE_PARSE] = "parse",
+    [LATENCY_STAGE_CALLBACK] = "callback",
+    [LATENCY_STAGE_COMMAND] = "command",
+    [LATENCY_STAGE_SENSOR_READ] = "sensor_read",
+    [LATENCY_STAGE_SEND_ENQUEUE] = "send_enqueue",
+    [LATENCY_STAGE_SOCKET_WRITE] = "socket_write",
+    [LATENCY_STAGE_REPORT] = "report",
+};
+
+static latency_stats_t s_stats[LATENCY_STAGE_MAX];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+// Read time of the command being handled, only touched by the WebSocket task
+static int64_t s_command_read_us;
+
+int64_t latency_now(void)
+{
+    return esp_timer_get_time();
+}
+
+void latency_record_us(latency_stage_t stage, uint32_t duration_us)
+{
+    if (stage >= LATENCY_STAGE_MAX) {
+        return;
+    }
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && duration_us >= s_bucket_bounds_us[bucket]) {
+        bucket++;
+    }
+
+    latency_stats_t *stats = &s_stats[stage];
+    portENTER_CRITICAL(&s_lock);
+    if (stats->count == 0 || duration_us < stats->min_us) {
+        stats->min_us = duration_us;
+    }
+    if (duration_us > stats->max_us) {
+        stats->max_us = duration_us;
+    }
+    stats->count++;
+    stats->total_us += duration_us;
+    stats->buckets[bucket]++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+int64_t latency_record(latency_stage_t stage, int64_t start_us)
+{
+    int64_t now = esp_timer_get_time();
+    latency_record_us(stage, now > start_us ? now - start_us : 0);
+    return now;
+}
+
+void latency_command_begin(int64_t read_time_us)
+{
+    s_command_read_us = read_time_us;
+}
+
+void latency_command_done(void)
+{
+    if (s_command_read_us) {
+        latency_record(LATENCY_STAGE_COMMAND, s_command_read_us);
+        s_command_read_us = 0;
+    }
+}
+
+esp_err_t latency_get_stats(latency_stage_t stage, latency_stats_t *stats)
+{
+    if (stage >= LATENCY_STAGE_MAX || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats[stage];
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+const char *latency_stage_name(latency_stage_t stage)
+{
+    return stage < LATENCY_STAGE_MAX ? s_stage_names[stage] : "unknown";
+}
+
+int latency_format_json(char *buffer, size_t len)
+{
+    int written = 0;
+    format_append(buffer, len, &written, "{\"bounds_us\":[");
+    for (int i = 0; i < LATENCY_BUCKETS - 1; i++) {
+        format_append(buffer, len, &written, "%s%" PRIu32, i ? "," : "", s_bucket_bounds_us[i]);
+    }
+    format_append(buffer, len, &written, "]");
+
+    for (int stage = 0; stage < LATENCY_STAGE_MAX; stage++) {
+        latency_stats_t stats;
+        latency_get_stats(stage, &stats);
+        if (stats.count == 0) {
+            continue;
+        }
+        format_append(buffer, len, &written, ",\"%s\":{\"n\":%" PRIu32 ",\"min\":%" PRIu32 ",\"avg\":%" PRIu32 ",\"max\":%" PRIu32 ",\"hist\":[",
+                    s_stage_names[stage], stats.count, stats.min_us, (uint32_t)(stats.total_us / stats.count), stats.max_us);
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            format_append(buffer, len, &written, "%s%" PRIu32, i ? "," : "", stats.buckets[i]);
+        }
+        format_append(buffer, len, &written, "]}");
+    }
+    format_append(buffer, len, &written, "}");
+    return written;
+}
+
+void latency_log(void)
+{
+    for (int stage = 0; stage < LATENCY_STAGE_MAX; stage++) {
+        latency_stats_t stats;
+        latency_get_stats(stage, &stats);
+        if (stats.count == 0) {
+            continue;
+        }
+        char hist[LATENCY_BUCKETS * 11];
+        int pos = 0;
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            pos += snprintf(hist + pos, sizeof(hist) - pos, "%s%" PRIu32, i ? " " : "", stats.buckets[i]);
+        }
+        ESP_LOGI(TAG, "%-14s n=%" PRIu32 " min=%" PRIu32 "us avg=%" PRIu32 "us max=%" PRIu32 "us hist=[%s]",
+                 s_stage_names[stage], stats.count, stats.min_us, (uint32_t)(stats.total_us / stats.count), stats.max_us, hist);
+    }
+}
+
+void latency_reset(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    memset(s_stats, 0, sizeof(s_stats));
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,107 @@
+/**
+ * @file latency.h
+ * @brief Latency probes for the command and sensor report paths
+ *
+ * Every stage keeps a fixed-bucket histogram of its durations, updating it costs a
+ * few instructions under a spinlock, so the probes can stay enabled in production.
+ */
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+/**
+ * @brief Measured stages
+ *
+ * Command path: frame read -> event handler -> parsed -> callback returned, and end to end
+ * until the application marks the output (e.g. GPIO) as set.
+ * Report path: sensor read -> bind frame handed to the client -> frame written to the socket,
+ * and end to end.
+ */
+typedef enum {
+    LATENCY_STAGE_TRANSPORT_READ = 0, ///< Reading the frame from the transport
+    LATENCY_STAGE_DISPATCH,           ///< Frame read -> WebSocket event handler
+    LATENCY_STAGE_PARSE,              ///< Event handler -> message parsed
+    LATENCY_STAGE_CALLBACK,           ///< Application callback
+    LATENCY_STAGE_COMMAND,            ///< Frame read -> output set, end to end
+    LATENCY_STAGE_SENSOR_READ,        ///< Sensor read
+    LATENCY_STAGE_SEND_ENQUEUE,       ///< Bind requested -> frame handed to the client
+    LATENCY_STAGE_SOCKET_WRITE,       ///< Frame written to the socket
+    LATENCY_STAGE_REPORT,             ///< Sensor read started -> bind frame written to the socket, end to end, per value
+    LATENCY_STAGE_MAX
+} latency_stage_t;
+
+/** Upper bounds of the histogram buckets in microseconds, the last bucket is open ended */
+#define LATENCY_BUCKET_BOUNDS_US { 50, 100, 200, 500, 1000, 2000, 5000, 10000, 50000 }
+#define LATENCY_BUCKETS 10
+
+/**
+ * @brief Statistics of one stage
+ */
+typedef struct {
+    uint32_t count;                      ///< Recorded durations
+    uint32_t min_us;                     ///< Shortest duration
+    uint32_t max_us;                     ///< Longest duration
+    uint64_t total_us;                   ///< Sum of the durations
+    uint32_t buckets[LATENCY_BUCKETS];   ///< Durations per bucket, see LATENCY_BUCKET_BOUNDS_US
+} latency_stats_t;
+
+/**
+ * @brief Current time for the probes, in microseconds
+ */
+int64_t latency_now(void);
+
+/**
+ * @brief Record the duration of a stage which started at start_us
+ *
+ * @return The current time, the start of the next stage
+ */
+int64_t latency_record(latency_stage_t stage, int64_t start_us);
+
+/**
+ * @brief Record a duration measured elsewhere
+ */
+void latency_record_us(latency_stage_t stage, uint32_t duration_us);
+
+/**
+ * @brief Start a command, the time its frame was read from the transport
+ *
+ * Commands are handled one at a time by the WebSocket task.
+ */
+void latency_command_begin(int64_t read_time_us);
+
+/**
+ * @brief Mark the output of the current command as set, records LATENCY_STAGE_COMMAND
+ */
+void latency_command_done(void);
+
+/**
+ * @brief Copy the statistics of a stage
+ */
+esp_err_t latency_get_stats(latency_stage_t stage, latency_stats_t *stats);
+
+/**
+ * @brief Name of a stage as used in the reports
+ */
+const char *latency_stage_name(latency_stage_t stage);
+
+/**
+ * @brief Format the statistics of all stages as JSON
+ *
+ * @return Length of the report, longer than len - 1 if it was truncated
+ */
+int latency_format_json(char *buffer, size_t len);
+
+/**
+ * @brief Write the statistics of all stages to the log
+ */
+void latency_log(void);
+
+/**
+ * @brief Clear the statistics of all stages
+ */
+void latency_reset(void);
+
+#endif // LATENCY_H
@@ -1,32 +1,84 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
 #include <esp_log.h>
 #include <esp_websocket_client.h>
 #include <driver/gpio.h>
 #include "wifi_control/wifi_control.h"
 #include "smart_home/smart_home.h"
 #include "dht11.h"
+#include "latency/latency.h"
+#include "metrics/metrics.h"
+#include "dlog/dlog.h"
+#include "boot_timeline/boot_timeline.h"
+#include "power/power.h"
+#include "telemetry/telemetry.h"
+#include "memprof/memprof.h"
+#include "calibration/calibration.h"
+#include "rpc/rpc.h"
 
 #define NETWORK_SSID "sanne"
 #define NETWORK_PASSWORD "sanne"
 #define AUTH_TOKEN "auth:PIgXssg1dhXIGpcJxiri7Py6J5wYfangki"
+#if CONFIG_IDF_TARGET_LINUX
+// Host build'de yerel sunucu kullanılır, WEBSOCKET_URI ortam değişkeniyle değiştirilebilir
+#define WEBSOCKET_URI (getenv("WEBSOCKET_URI") ? getenv("WEBSOCKET_URI") : "ws://127.0.0.1:8080/ws/esp32")
+#else
 #define WEBSOCKET_URI "ws://192.168.1.5:8080/ws/esp32"
+#endif
 #define RELAY_GPIO GPIO_NUM_19
+#define RELAY_DEVICE_ID 102
+#define SAMPLE_INTERVAL_MS 1000
+// Kconfig'de -1 seçilen görev iki çekirdekte de çalışabilir
+#define TASK_CORE(core) ((core) < 0 ? tskNO_AFFINITY : (core))
+
+// Telemetri kanalları ve sunucudaki cihaz ID'leri
+enum { TELEMETRY_HUMIDITY, TELEMETRY_TEMPERATURE, TELEMETRY_CHANNELS };
+static const int s_telemetry_device_ids[TELEMETRY_CHANNELS] = {
+    [TELEMETRY_HUMIDITY] = 155,
+    [TELEMETRY_TEMPERATURE] = 154,
+};
+
+// Sunucuya bildirilen son değerler, RPC_METHOD_DEVICE_GET ile toplu okunur. -1 henüz ölçülmedi
+static volatile int s_telemetry_values[TELEMETRY_CHANNELS] = { -1, -1 };
+static volatile char s_relay_value = '1';
+
+// TX görevinin gönderim sonuçları sensör görevine bu kuyrukla döner, kanal başına en fazla bir
+// değer gönderimde olduğundan kuyruk dolmaz
+typedef struct {
+    int channel;
+    bool sent;
+} telemetry_result_t;
+static QueueHandle_t s_telemetry_results = NULL;
+// Gönderimdeki değerin ölçümüne başlanan an, sensör görevi kuyruğa almadan önce yazar
+static int64_t s_report_start_us[TELEMETRY_CHANNELS];
+
+// Uygulamanın RPC metodları
+enum { RPC_METHOD_DEVICE_GET = RPC_METHOD_APP };
 
 static const char *TAG = "home_managment";
+static TaskHandle_t s_sensor_task = NULL;
 static void message_callback(int device_id, control_type_t control_type,
                            const char *value, esp_websocket_client_handle_t client,
                            void *user_context) {
-    ESP_LOGI(TAG, "Mesaj alındı: ID=%d, Tip=%d, Değer=%s", device_id, control_type, value);
+    DLOGI_STR(TAG, "Mesaj alındı: ID=%d, Tip=%d, Değer=%.*s", value, strlen(value), device_id, control_type);
 
     switch (control_type) {
         case CONTROL_TYPE_SWITCH:
-                if (device_id == 102) {
+                if (device_id == RELAY_DEVICE_ID) {
                     bool relay_state = (strcmp(value, "0") == 0);
                     gpio_set_level(RELAY_GPIO, relay_state);
-                    ESP_LOGI(TAG, "Röle (GPIO 19) %s", relay_state ? "AÇILDI" : "KAPATILDI");
+                    s_relay_value = relay_state ? '0' : '1';
+                    latency_command_done();
+                    DLOGI(TAG, relay_state ? "Röle (GPIO 19) AÇILDI" : "Röle (GPIO 19) KAPATILDI");
                     smart_home_bind_device(device_id, relay_state ? "0" : "1");
+                    // Radyo açıkken bekleyen telemetri de gönderilsin
+                    if (s_sensor_task) {
+                        xTaskNotifyGive(s_sensor_task);
+                    }
                 } else {
                     ESP_LOGW(TAG, "Bilinmeyen cihaz ID: %d", device_id);
                 }
@@ -46,8 +98,163 @@ static void message_callback(int device_id, control_type_t control_type,
     }
 }
 
+// Cihazların son değerlerini tek istekte döndürür, N cihaz için N ayrı mesaj gerekmez.
+// Argüman: cihaz ID'leri (u32, little endian). Sonuç her cihaz için: id u32, uzunluk u8, değer.
+// Bilinmeyen ya da henüz ölçülmemiş cihazın değeri boştur.
+static esp_err_t device_get_handler(const uint8_t *args, size_t args_len, uint8_t *result,
+                                    size_t result_size, size_t *result_len, void *ctx) {
+    if (args_len == 0 || args_len % 4 != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t len = 0;
+    for (size_t i = 0; i < args_len; i += 4) {
+        uint32_t device_id = args[i] | args[i + 1] << 8 | args[i + 2] << 16 | (uint32_t)args[i + 3] << 24;
+        char value[8] = "";
+        if (device_id == RELAY_DEVICE_ID) {
+            value[0] = s_relay_value;
+            value[1] = '\0';
+        }
+        for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+            int reading = s_telemetry_values[channel];
+            if (device_id == (uint32_t)s_telemetry_device_ids[channel] && reading >= 0) {
+                snprintf(value, sizeof(value), "%d", reading);
+            }
+        }
+        size_t value_len = strlen(value);
+        if (result_size - len < 5 + value_len) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memcpy(result + len, args + i, 4);
+        result[len + 4] = value_len;
+        memcpy(result + len + 5, value, value_len);
+        len += 5 + value_len;
+    }
+    *result_len = len;
+    return ESP_OK;
+}
+
+// WiFi olay görevinden çağrılır
+static void wifi_status_callback(wifi_connection_status_t status, void *user_context) {
+    if (status == WIFI_STATUS_FAILED) {
+        ESP_LOGE(TAG, "WiFi bağlantısı kurulamadı, arka planda deneniyor");
+    }
+    // WebSocket bağlantı yokken beklemeye alınır, IP alınınca hemen bağlanır
+    smart_home_set_network_available(status == WIFI_STATUS_CONNECTED);
+}
+
+// TX görevinde çağrılır, değer ancak sokete yazıldıysa gönderilmiş sayılır
+static void telemetry_sent_cb(esp_err_t result, void *arg) {
+    telemetry_result_t sent = { .channel = (int)(intptr_t)arg, .sent = result == ESP_OK };
+    if (sent.sent) {
+        latency_record(LATENCY_STAGE_REPORT, s_report_start_us[sent.channel]);
+    }
+    xQueueSend(s_telemetry_results, &sent, 0);
+}
+
+// Sensör okuma ve telemetri döngüsü
+static void sensor_task(void *arg) {
+    int retry_count = 0;
+    int loop_count = 0;
+    // Değişen ölçümler toplanıp 30 saniyede bir gönderilir, radyo her değişiklikte uyanmaz
+    telemetry_t telemetry;
+    telemetry_config_t telemetry_config = {
+        .report_interval_ms = 30000,
+        .urgent_delta = 2,
+    };
+    telemetry_init(&telemetry, &telemetry_config, TELEMETRY_CHANNELS);
+    bool boot_finished = false;
+
+    while (1) {
+
+        int64_t read_start_us = latency_now();
+        // Bit zamanlaması meşgul beklemeyle ölçülür, okuma sırasında frekans düşmemeli
+        power_hold_awake();
+        struct dht11_reading dht_data = DHT11_read();
+        power_release_awake();
+        latency_record(LATENCY_STAGE_SENSOR_READ, read_start_us);
+        metrics_inc(METRIC_DHT_READS);
+        boot_timeline_mark("first_sensor_read");
+
+        if (dht_data.status == DHT11_OK) {
+            DLOGI(TAG, "DHT11 Verileri - Nem: %d%%, Sıcaklık: %d°C",
+                  dht_data.humidity, dht_data.temperature);
+            telemetry_update(&telemetry, TELEMETRY_HUMIDITY, dht_data.humidity);
+            telemetry_update(&telemetry, TELEMETRY_TEMPERATURE, dht_data.temperature);
+            s_telemetry_values[TELEMETRY_HUMIDITY] = dht_data.humidity;
+            s_telemetry_values[TELEMETRY_TEMPERATURE] = dht_data.temperature;
+            retry_count = 0;
+        } else {
+            // Hata oranı görev yerleşimine göre karşılaştırılır, bkz. host_test/topology
+            if (dht_data.status == DHT11_CRC_ERROR) {
+                ESP_LOGW(TAG, "DHT11 CRC hatası!");
+                metrics_inc(METRIC_DHT_CRC_ERRORS);
+            } else if (dht_data.status == DHT11_TIMEOUT_ERROR) {
+                ESP_LOGW(TAG, "DHT11 zaman aşımı hatası!");
+                metrics_inc(METRIC_DHT_TIMEOUTS);
+            }
+            metrics_inc(METRIC_DHT_ERRORS);
+            retry_count++;
+            if (retry_count > 5) {
+                ESP_LOGE(TAG, "Sensör bağlantısını kontrol edin!");
+                retry_count = 0;
+            }
+        }
+
+        // Gönderilemeyen değerler bir sonraki toplu gönderimde tekrar denenir
+        telemetry_result_t result;
+        while (xQueueReceive(s_telemetry_results, &result, 0) == pdTRUE) {
+            telemetry_send_done(&telemetry, result.channel, result.sent);
+        }
+        uint32_t now_ms = (uint32_t)(latency_now() / 1000);
+        if (telemetry_due(&telemetry, now_ms, power_radio_awake())) {
+            bool sent = false;
+            for (int channel = 0; channel < TELEMETRY_CHANNELS; channel++) {
+                int value;
+                char value_str[8];
+                if (!telemetry_pending(&telemetry, channel, &value)) {
+                    continue;
+                }
+                sprintf(value_str, "%d", value);
+                // Kuyruğa alınan değer TX görevi gönderene kadar bekler, sonucu kuyruktan okunur
+                telemetry_sending(&telemetry, channel, value);
+                s_report_start_us[channel] = read_start_us;
+                if (smart_home_bind_device_notify(s_telemetry_device_ids[channel], value_str,
+                                                  telemetry_sent_cb, (void *)(intptr_t)channel) == ESP_OK) {
+                    sent = true;
+                } else {
+                    telemetry_send_done(&telemetry, channel, false);
+                }
+            }
+            telemetry_batch_done(&telemetry, now_ms);
+            if (!boot_finished && sent) {
+                boot_timeline_mark("first_telemetry");
+                boot_timeline_finish();
+                boot_finished = true;
+            }
+        }
+
+        metrics_sample_system(METRIC_SENSOR_STACK_FREE);
+        calibration_sample_stack(CALIBRATION_TASK_SENSOR);
+
+        // Gecikme, güç, (CONFIG_HOME_MEMPROF ile) bellek ve (CONFIG_HOME_CALIBRATE ile) boyut
+        // istatistiklerini dakikada bir yazdır
+        if (++loop_count % 60 == 0) {
+            latency_log();
+            power_log();
+            memprof_log();
+            calibration_log();
+        }
+
+        // Komut gelince radyo açıkken erken uyanılır, sensör en fazla 2 saniyede bir okunur
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SAMPLE_INTERVAL_MS));
+    }
+}
+
 void app_main(void) {
+    boot_timeline_mark("app_main");
     ESP_LOGI(TAG, "Starting... App.");
+    // Sıcak yoldaki loglar düşük öncelikli bir görevde biçimlendirilir
+    dlog_init(NULL);
     gpio_config_t io_conf = {
         .intr_type = GPIO_INTR_DISABLE,
         .mode = GPIO_MODE_OUTPUT,
@@ -61,13 +268,33 @@ void app_main(void) {
     ESP_LOGI(TAG, "DHT11 sensörü başlatılıyor (GPIO %d)...", dht_gpio);
     DHT11_init(dht_gpio);
 
+    // Bağlantı beklenmez: sensörün ısınması, WiFi bağlantısı ve WebSocket hazırlığı paralel yürür,
+    // WebSocket istemcisi IP alınınca hemen bağlanır
     wifi_config_params_t wifi_config = {
         .ssid = NETWORK_SSID,
         .password = NETWORK_PASSWORD,
         .max_retry = 5,
         .auto_reconnect = true,
-        .retry_interval_ms = 5000
+        .retry_interval_ms = 1000,
+        .retry_interval_max_ms = 60000,
+        .async_init = true,
+        .status_callback = wifi_status_callback,
+        // Yeniden başlatmalarda kayıtlı AP'ye taramasız bağlan ve son IP'yi kullan
+        .fast_connect = true,
+        .reuse_ip_lease = true,
+        // Her DTIM işaretçisinde uyanılır, gelen komutlar en fazla bir işaretçi aralığı gecikir
+        .power_save = WIFI_POWER_SAVE_MIN_MODEM,
+        // Aynı ağı yayınlayan birden çok AP varsa sinyal zayıflayınca daha güçlüsüne geçilir,
+        // örnekleme light sleep'i sık bölmesin diye 10 saniyede bir yapılır
+        .roam_rssi_threshold = -75,
+        .rssi_interval_ms = 10000
     };
+    // Örnekler arasında, bütün görevler beklerken light sleep'e girilir
+    power_config_t power_config = {
+        .light_sleep = true,
+    };
+    power_init(&power_config);
+
     esp_err_t ret = wifi_control_init(&wifi_config);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "WiFi başlatılamadı: %s", esp_err_to_name(ret));
@@ -77,53 +304,47 @@ void app_main(void) {
         .websocket_uri = WEBSOCKET_URI,
         .auth_token = AUTH_TOKEN,
         .auto_reconnect = true,
-        .reconnect_timeout_ms = 10000
+        .reconnect_timeout_ms = 1000,
+        .reconnect_backoff_max_ms = 60000,
+        // Komutlar lwIP ile aynı çekirdekte işlenir, gönderim ayrı bir görevden yapılır
+        .task_core = CONFIG_HOME_WS_TASK_CORE,
+        .task_prio = CONFIG_HOME_WS_TASK_PRIO,
+        // Boyutlar CONFIG_HOME_CALIBRATE ile ölçülen değerlere göre küçültülebilir
+        .task_stack = CONFIG_HOME_WS_TASK_STACK,
+        .buffer_size = CONFIG_HOME_WS_BUFFER_SIZE,
+        .rx_message_size = CONFIG_HOME_RX_MESSAGE_SIZE,
+#if CONFIG_HOME_TX_TASK
+        .tx_queue_len = CONFIG_HOME_TX_QUEUE_LEN,
+        .tx_task_core = CONFIG_HOME_TX_TASK_CORE,
+        .tx_task_prio = CONFIG_HOME_TX_TASK_PRIO,
+        .tx_task_stack = CONFIG_HOME_TX_TASK_STACK,
+#endif
     };
+    // RPC metodları bağlantı kurulmadan kaydedilir
+    rpc_register(RPC_METHOD_DEVICE_GET, "device_get", device_get_handler, NULL);
     ret = smart_home_init(&smart_home_config, message_callback, NULL);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Akıllı ev sistemi başlatılamadı: %s", esp_err_to_name(ret));
         return;
     }
-    smart_home_bind_device(102, "1");
-
-    ESP_LOGI(TAG, "Sistem başarıyla başlatıldı, komutlar bekleniyor...");
-
-    int retry_count = 0;
-    int lastTemperature = 0;
-    int lastHumidity = 0;
+    boot_timeline_mark("smart_home_started");
+    // Röle durumu her bağlantıda durum tablosuyla birlikte tek mesajda bildirilir
+    smart_home_set_state(RELAY_DEVICE_ID, "1");
 
-    while (1) {
-
-        struct dht11_reading dht_data = DHT11_read();
-
-        if (dht_data.status == DHT11_OK) {
-            ESP_LOGI(TAG, "DHT11 Verileri - Nem: %d%%, Sıcaklık: %d°C",
-                     dht_data.humidity, dht_data.temperature);
-            char value_str[8];
-            if (dht_data.humidity != lastHumidity) {
-                sprintf(value_str, "%d", dht_data.humidity);
-                smart_home_bind_device(155, value_str);
-                lastHumidity = dht_data.humidity;
-            }
-            if (dht_data.temperature != lastTemperature) {
-                sprintf(value_str, "%d", dht_data.temperature);
-                smart_home_bind_device(154, value_str);
-                lastTemperature = dht_data.temperature;
-            }
-            retry_count = 0;
-        } else {
-            if (dht_data.status == DHT11_CRC_ERROR) {
-                ESP_LOGW(TAG, "DHT11 CRC hatası!");
-            } else if (dht_data.status == DHT11_TIMEOUT_ERROR) {
-                ESP_LOGW(TAG, "DHT11 zaman aşımı hatası!");
-            }
-            retry_count++;
-            if (retry_count > 5) {
-                ESP_LOGE(TAG, "Sensör bağlantısını kontrol edin!");
-                retry_count = 0;
-            }
-        }
+    s_telemetry_results = xQueueCreate(TELEMETRY_CHANNELS, sizeof(telemetry_result_t));
+    if (!s_telemetry_results) {
+        ESP_LOGE(TAG, "Telemetri kuyruğu oluşturulamadı");
+        return;
+    }
 
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
+    // DHT11 okumaları kendi çekirdeğinde, ağ görevlerinden yüksek öncelikli bir görevde yapılır
+    calibration_set_stack(CALIBRATION_TASK_SENSOR, CONFIG_HOME_SENSOR_TASK_STACK);
+    if (xTaskCreatePinnedToCore(sensor_task, "sensor", CONFIG_HOME_SENSOR_TASK_STACK, NULL,
+                                CONFIG_HOME_SENSOR_TASK_PRIO, &s_sensor_task,
+                                TASK_CORE(CONFIG_HOME_SENSOR_TASK_CORE)) != pdPASS) {
+        ESP_LOGE(TAG, "Sensör görevi başlatılamadı");
+        return;
     }
-}
\ No newline at end of file
+
+    ESP_LOGI(TAG, "Sistem başarıyla başlatıldı, komutlar bekleniyor...");
+}
@@ -0,0 +1,234 @@
+/**
+ * @file memprof.c
+ * @brief Heap usage per subsystem and stack high water marks
+ */
+#include "memprof.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "util/format.h"
+
+#if CONFIG_HOME_MEMPROF
+
+static const char *TAG = "MEMPROF";
+
+#define REPORT_SIZE 1024
+#define MAX_BLOCKS CONFIG_HOME_MEMPROF_MAX_BLOCKS
+
+static const char *const s_tag_names[MEMPROF_TAG_MAX] = {
+    [MEMPROF_TAG_SMART_HOME] = "smart_home",
+    [MEMPROF_TAG_WIFI] = "wifi",
+    [MEMPROF_TAG_WEBSOCKET] = "websocket",
+};
+
+typedef struct {
+    void *ptr;          // NULL for a free slot
+    uint32_t size;
+    memprof_tag_t tag;
+} block_t;
+
+// Open addressing with linear probing, a removal shifts the following entries back
+static block_t s_blocks[MAX_BLOCKS];
+static int s_block_count = 0;
+static memprof_stats_t s_stats[MEMPROF_TAG_MAX];
+static uint32_t s_untracked = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int slot_of(const void *ptr)
+{
+    return (int)((((uintptr_t)ptr >> 3) * 2654435761u) % MAX_BLOCKS);
+}
+
+static int find(const void *ptr)
+{
+    for (int i = 0, slot = slot_of(ptr); i < MAX_BLOCKS; i++, slot = (slot + 1) % MAX_BLOCKS) {
+        if (s_blocks[slot].ptr == ptr) {
+            return slot;
+        }
+        if (s_blocks[slot].ptr == NULL) {
+            break;
+        }
+    }
+    return -1;
+}
+
+static void remove_slot(int slot)
+{
+    memprof_stats_t *stats = &s_stats[s_blocks[slot].tag];
+    stats->live_bytes -= s_blocks[slot].size;
+    stats->live_blocks--;
+    s_block_count--;
+    s_blocks[slot].ptr = NULL;
+
+    for (int next = (slot + 1) % MAX_BLOCKS; s_blocks[next].ptr; next = (next + 1) % MAX_BLOCKS) {
+        int home = slot_of(s_blocks[next].ptr);
+        // stays if its home lies cyclically within (slot, next]
+        bool stays = slot <= next ? (home > slot && home <= next) : (home > slot || home <= next);
+        if (!stays) {
+            s_blocks[slot] = s_blocks[next];
+            s_blocks[next].ptr = NULL;
+            slot = next;
+        }
+    }
+}
+
+static void insert(void *ptr, size_t size, memprof_tag_t tag)
+{
+    // a block of this address freed outside the wrappers is stale
+    int slot = find(ptr);
+    if (slot >= 0) {
+        remove_slot(slot);
+    }
+    memprof_stats_t *stats = &s_stats[tag];
+    stats->allocs++;
+    if (s_block_count >= MAX_BLOCKS - 1) {
+        s_untracked++;
+        return;
+    }
+    for (slot = slot_of(ptr); s_blocks[slot].ptr; slot = (slot + 1) % MAX_BLOCKS) {
+    }
+    s_blocks[slot] = (block_t) { .ptr = ptr, .size = size, .tag = tag };
+    s_block_count++;
+    stats->live_blocks++;
+    stats->live_bytes += size;
+    if (stats->live_bytes > stats->peak_bytes) {
+        stats->peak_bytes = stats->live_bytes;
+    }
+}
+
+static void *record(memprof_tag_t tag, void *ptr, size_t size)
+{
+    if (tag >= MEMPROF_TAG_MAX) {
+        return ptr;
+    }
+    portENTER_CRITICAL(&s_lock);
+    if (ptr) {
+        insert(ptr, size, tag);
+    } else if (size) {
+        s_stats[tag].failures++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return ptr;
+}
+
+void *memprof_malloc(memprof_tag_t tag, size_t size)
+{
+    return record(tag, malloc(size), size);
+}
+
+void *memprof_calloc(memprof_tag_t tag, size_t count, size_t size)
+{
+    return record(tag, calloc(count, size), count * size);
+}
+
+void *memprof_realloc(memprof_tag_t tag, void *ptr, size_t size)
+{
+    uintptr_t old = (uintptr_t)ptr;     // only the key of the table once reallocated
+    void *moved = realloc(ptr, size);
+    if (!moved && size) {
+        return record(tag, NULL, size);     // the old block is still allocated
+    }
+    portENTER_CRITICAL(&s_lock);
+    int slot = old ? find((const void *)old) : -1;
+    if (slot >= 0) {
+        remove_slot(slot);
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return moved ? record(tag, moved, size) : NULL;
+}
+
+char *memprof_strdup(memprof_tag_t tag, const char *str)
+{
+    char *copy = strdup(str);
+    return record(tag, copy, copy ? strlen(copy) + 1 : 1);
+}
+
+void memprof_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    int slot = find(ptr);
+    if (slot >= 0) {
+        remove_slot(slot);
+    }
+    portEXIT_CRITICAL(&s_lock);
+    free(ptr);
+}
+
+esp_err_t memprof_get(memprof_tag_t tag, memprof_stats_t *stats)
+{
+    if (tag >= MEMPROF_TAG_MAX || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats[tag];
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+int memprof_format(char *buffer, size_t len)
+{
+    int written = 0;
+    if (len > 0) {
+        buffer[0] = '\0';
+    }
+    for (int i = 0; i < MEMPROF_TAG_MAX; i++) {
+        memprof_stats_t stats;
+        memprof_get(i, &stats);
+        format_append(buffer, len, &written, "%s%s_live=%" PRIu32 " %s_peak=%" PRIu32 " %s_blocks=%" PRIu32
+                      " %s_allocs=%" PRIu32 " %s_fail=%" PRIu32, written ? " " : "",
+                      s_tag_names[i], stats.live_bytes, s_tag_names[i], stats.peak_bytes,
+                      s_tag_names[i], stats.live_blocks, s_tag_names[i], stats.allocs,
+                      s_tag_names[i], stats.failures);
+    }
+    format_append(buffer, len, &written, " untracked=%" PRIu32, s_untracked);
+
+    // the high water mark is in bytes on ESP-IDF
+    UBaseType_t count = uxTaskGetNumberOfTasks();
+    TaskStatus_t *tasks = malloc(count * sizeof(TaskStatus_t));
+    if (tasks) {
+        count = uxTaskGetSystemState(tasks, count, NULL);
+        for (UBaseType_t i = 0; i < count; i++) {
+            format_append(buffer, len, &written, " stack_%s=%" PRIu32, tasks[i].pcTaskName,
+                          (uint32_t)tasks[i].usStackHighWaterMark);
+        }
+        free(tasks);
+    }
+    return written;
+}
+
+void memprof_log(void)
+{
+    char *report = malloc(REPORT_SIZE);
+    if (!report) {
+        return;
+    }
+    memprof_format(report, REPORT_SIZE);
+    ESP_LOGI(TAG, "%s", report);
+    free(report);
+}
+
+#else
+
+esp_err_t memprof_get(memprof_tag_t tag, memprof_stats_t *stats)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+int memprof_format(char *buffer, size_t len)
+{
+    return snprintf(buffer, len, "off");
+}
+
+void memprof_log(void)
+{
+}
+
+#endif // CONFIG_HOME_MEMPROF
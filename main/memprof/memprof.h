@@ -0,0 +1,64 @@
+/**
+ * @file memprof.h
+ * @brief Heap usage per subsystem and stack high water marks, with CONFIG_HOME_MEMPROF
+ *
+ * The sources of a subsystem include memprof_wrap.h, which routes their malloc, calloc, realloc,
+ * strdup and free here, the WebSocket client gets it force-included by main/CMakeLists.txt.
+ * Every live block is kept in a table with its size and subsystem. Allocations made elsewhere,
+ * asprintf() within a subsystem included, are not attributed, freeing them here is harmless.
+ *
+ * The report goes to the serial console from the main loop and answers a "memprof" request
+ * over the WebSocket. Without CONFIG_HOME_MEMPROF only memprof_format() and memprof_log() exist
+ * and report that profiling is off.
+ */
+#ifndef MEMPROF_H
+#define MEMPROF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+typedef enum {
+    MEMPROF_TAG_SMART_HOME = 0,
+    MEMPROF_TAG_WIFI,
+    MEMPROF_TAG_WEBSOCKET,
+    MEMPROF_TAG_MAX
+} memprof_tag_t;
+
+typedef struct {
+    uint32_t live_bytes;
+    uint32_t peak_bytes;     ///< Highest live_bytes since boot
+    uint32_t live_blocks;
+    uint32_t allocs;         ///< Successful allocations since boot, a realloc counts as one
+    uint32_t failures;       ///< Allocations which returned NULL
+} memprof_stats_t;
+
+void *memprof_malloc(memprof_tag_t tag, size_t size);
+void *memprof_calloc(memprof_tag_t tag, size_t count, size_t size);
+void *memprof_realloc(memprof_tag_t tag, void *ptr, size_t size);
+char *memprof_strdup(memprof_tag_t tag, const char *str);
+void memprof_free(void *ptr);
+
+/**
+ * @brief Usage of one subsystem
+ *
+ * @return ESP_ERR_NOT_SUPPORTED without CONFIG_HOME_MEMPROF
+ */
+esp_err_t memprof_get(memprof_tag_t tag, memprof_stats_t *stats);
+
+/**
+ * @brief Format the usage of every subsystem and the stack high water mark of every task
+ *
+ * `name_live=bytes name_peak=bytes name_blocks=n name_allocs=n name_fail=n` per subsystem,
+ * `untracked=n` for blocks the full table could not take, then `stack_<task>=bytes` per task.
+ *
+ * @return Length of the report, longer than len - 1 if it was truncated
+ */
+int memprof_format(char *buffer, size_t len);
+
+/**
+ * @brief Print the report to the serial console
+ */
+void memprof_log(void);
+
+#endif // MEMPROF_H
@@ -0,0 +1,29 @@
+/**
+ * @file memprof_wrap.h
+ * @brief Routes the allocations of a source file through memprof, with CONFIG_HOME_MEMPROF
+ *
+ * MEMPROF_TAG names the subsystem and has to be defined before this is included. The C library
+ * headers are included first, so their declarations are not renamed by the macros.
+ */
+#ifndef MEMPROF_WRAP_H
+#define MEMPROF_WRAP_H
+
+#include <stdlib.h>
+#include <string.h>
+#include "sdkconfig.h"
+
+#if CONFIG_HOME_MEMPROF
+#include "memprof.h"
+
+#ifndef MEMPROF_TAG
+#error "Define MEMPROF_TAG to the subsystem before including memprof_wrap.h"
+#endif
+
+#define malloc(size)            memprof_malloc(MEMPROF_TAG, size)
+#define calloc(count, size)     memprof_calloc(MEMPROF_TAG, count, size)
+#define realloc(ptr, size)      memprof_realloc(MEMPROF_TAG, ptr, size)
+#define strdup(str)             memprof_strdup(MEMPROF_TAG, str)
+#define free(ptr)               memprof_free(ptr)
+#endif
+
+#endif // MEMPROF_WRAP_H
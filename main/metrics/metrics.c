@@ -0,0 +1,155 @@
+/**
+ * @file metrics.c
+ * @brief Runtime metrics registry
+ */
+#include "metrics.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_system.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "util/format.h"
+
+static const char *const s_counter_names[METRIC_COUNTER_MAX] = {
+    [METRIC_MESSAGES_IN] = "msg_in",
+    [METRIC_MESSAGES_OUT] = "msg_out",
+    [METRIC_SEND_FAILURES] = "send_fail",
+    [METRIC_PARSE_FAILURES] = "parse_fail",
+    [METRIC_CONNECTS] = "connects",
+    [METRIC_DISCONNECTS] = "disconnects",
+    [METRIC_DHT_ERRORS] = "dht_err",
+    [METRIC_WIFI_ROAM_SCANS] = "roam_scans",
+    [METRIC_WIFI_ROAMS] = "roams",
+    [METRIC_WIFI_ROAM_FAILURES] = "roam_fail",
+    [METRIC_DHT_READS] = "dht_reads",
+    [METRIC_DHT_TIMEOUTS] = "dht_timeout",
+    [METRIC_DHT_CRC_ERRORS] = "dht_crc",
+    [METRIC_TX_QUEUE_FULL] = "tx_full",
+    [METRIC_DUPLICATE_COMMANDS] = "dup_cmd",
+    [METRIC_STATE_SYNCS] = "state_sync",
+};
+
+static const char *const s_gauge_names[METRIC_GAUGE_MAX] = {
+    [METRIC_HEAP_FREE] = "heap_free",
+    [METRIC_HEAP_MIN_FREE] = "heap_min",
+    [METRIC_SENSOR_STACK_FREE] = "sensor_stack",
+    [METRIC_WS_STACK_FREE] = "ws_stack",
+    [METRIC_WIFI_RSSI] = "rssi",
+};
+
+static const char *const s_histogram_names[METRIC_HISTOGRAM_MAX] = {
+    [METRIC_MESSAGE_IN_BYTES] = "msg_in_bytes",
+    [METRIC_HANDLE_US] = "handle_us",
+    [METRIC_WIFI_ROAM_MS] = "roam_ms",
+};
+
+// Every core increments its own copy, so the cores never contend for a cache line or the atomic
+static atomic_uint_least32_t s_counters[portNUM_PROCESSORS][METRIC_COUNTER_MAX];
+static atomic_uint_least32_t s_gauges[METRIC_GAUGE_MAX];
+static atomic_uint_least32_t s_histograms[METRIC_HISTOGRAM_MAX][METRICS_HISTOGRAM_BUCKETS];
+
+void metrics_add(metric_counter_t counter, uint32_t value)
+{
+    // a task moved to the other core in between still adds atomically, to the other copy
+    atomic_fetch_add_explicit(&s_counters[xPortGetCoreID()][counter], value, memory_order_relaxed);
+}
+
+void metrics_inc(metric_counter_t counter)
+{
+    metrics_add(counter, 1);
+}
+
+uint32_t metrics_get(metric_counter_t counter)
+{
+    uint32_t sum = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        sum += atomic_load_explicit(&s_counters[core][counter], memory_order_relaxed);
+    }
+    return sum;
+}
+
+void metrics_set(metric_gauge_t gauge, uint32_t value)
+{
+    atomic_store_explicit(&s_gauges[gauge], value, memory_order_relaxed);
+}
+
+uint32_t metrics_get_gauge(metric_gauge_t gauge)
+{
+    return atomic_load_explicit(&s_gauges[gauge], memory_order_relaxed);
+}
+
+int metrics_histogram_bucket(uint32_t value)
+{
+    const int sub_buckets = 1 << METRICS_HISTOGRAM_SUB_BITS;
+    if (value < (uint32_t)sub_buckets) {
+        return (int)value;
+    }
+    int msb = 31 - __builtin_clz(value);
+    int bucket = (msb - METRICS_HISTOGRAM_SUB_BITS + 1) * sub_buckets +
+                 ((value >> (msb - METRICS_HISTOGRAM_SUB_BITS)) & (sub_buckets - 1));
+    return bucket < METRICS_HISTOGRAM_BUCKETS ? bucket : METRICS_HISTOGRAM_BUCKETS - 1;
+}
+
+uint32_t metrics_histogram_bucket_floor(int bucket)
+{
+    const int sub_buckets = 1 << METRICS_HISTOGRAM_SUB_BITS;
+    if (bucket < sub_buckets) {
+        return bucket;
+    }
+    int msb = bucket / sub_buckets + METRICS_HISTOGRAM_SUB_BITS - 1;
+    return (uint32_t)(sub_buckets + bucket % sub_buckets) << (msb - METRICS_HISTOGRAM_SUB_BITS);
+}
+
+void metrics_observe(metric_histogram_t histogram, uint32_t value)
+{
+    atomic_fetch_add_explicit(&s_histograms[histogram][metrics_histogram_bucket(value)], 1, memory_order_relaxed);
+}
+
+esp_err_t metrics_get_histogram(metric_histogram_t histogram, uint32_t buckets[METRICS_HISTOGRAM_BUCKETS])
+{
+    if (histogram >= METRIC_HISTOGRAM_MAX || !buckets) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        buckets[i] = atomic_load_explicit(&s_histograms[histogram][i], memory_order_relaxed);
+    }
+    return ESP_OK;
+}
+
+void metrics_sample_system(metric_gauge_t stack_gauge)
+{
+    metrics_set(METRIC_HEAP_FREE, esp_get_free_heap_size());
+    metrics_set(METRIC_HEAP_MIN_FREE, esp_get_minimum_free_heap_size());
+    // the high water mark is in bytes on ESP-IDF
+    metrics_set(stack_gauge, uxTaskGetStackHighWaterMark(NULL));
+}
+
+int metrics_format(char *buffer, size_t len)
+{
+    int written = 0;
+    if (len > 0) {
+        buffer[0] = '\0';
+    }
+    for (int i = 0; i < METRIC_COUNTER_MAX; i++) {
+        format_append(buffer, len, &written, "%s%s=%" PRIu32, written ? " " : "", s_counter_names[i], metrics_get(i));
+    }
+    for (int i = 0; i < METRIC_GAUGE_MAX; i++) {
+        format_append(buffer, len, &written, " %s=%" PRId32, s_gauge_names[i], (int32_t)metrics_get_gauge(i));
+    }
+    for (int i = 0; i < METRIC_HISTOGRAM_MAX; i++) {
+        uint32_t buckets[METRICS_HISTOGRAM_BUCKETS];
+        metrics_get_histogram(i, buckets);
+        format_append(buffer, len, &written, " %s=", s_histogram_names[i]);
+        bool first = true;
+        for (int b = 0; b < METRICS_HISTOGRAM_BUCKETS; b++) {
+            if (buckets[b]) {
+                format_append(buffer, len, &written, "%s%" PRIu32 ":%" PRIu32, first ? "" : ",",
+                              metrics_histogram_bucket_floor(b), buckets[b]);
+                first = false;
+            }
+        }
+    }
+    return written;
+}
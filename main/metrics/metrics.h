@@ -0,0 +1,129 @@
+/**
+ * @file metrics.h
+ * @brief Runtime metrics registry: counters, gauges and histograms
+ *
+ * Updates are lock-free: counters are kept per core and summed when read, gauges and
+ * histogram buckets are relaxed atomics. All metrics are statically registered here.
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+/**
+ * @brief Counters, only ever incremented
+ */
+typedef enum {
+    METRIC_MESSAGES_IN = 0,   ///< Data messages received from the server
+    METRIC_MESSAGES_OUT,      ///< Messages sent to the server
+    METRIC_SEND_FAILURES,     ///< Messages which could not be sent
+    METRIC_PARSE_FAILURES,    ///< Received messages which could not be processed
+    METRIC_CONNECTS,          ///< WebSocket connections established
+    METRIC_DISCONNECTS,       ///< WebSocket connections lost
+    METRIC_DHT_ERRORS,        ///< Failed DHT11 reads
+    METRIC_WIFI_ROAM_SCANS,   ///< Scans started because the signal of the AP got weak
+    METRIC_WIFI_ROAMS,        ///< Switches to a stronger AP
+    METRIC_WIFI_ROAM_FAILURES,///< Switches which did not reach the new AP
+    METRIC_DHT_READS,         ///< DHT11 reads, successful or not
+    METRIC_DHT_TIMEOUTS,      ///< Failed DHT11 reads which missed an edge, included in METRIC_DHT_ERRORS
+    METRIC_DHT_CRC_ERRORS,    ///< Failed DHT11 reads with a bad checksum, included in METRIC_DHT_ERRORS
+    METRIC_TX_QUEUE_FULL,     ///< Messages not queued because the TX task fell behind
+    METRIC_DUPLICATE_COMMANDS,///< Resent commands acknowledged without executing them again
+    METRIC_STATE_SYNCS,       ///< State messages sent after authentication or on request
+    METRIC_COUNTER_MAX
+} metric_counter_t;
+
+/**
+ * @brief Gauges, set to the latest value, printed as signed
+ */
+typedef enum {
+    METRIC_HEAP_FREE = 0,     ///< Free heap in bytes
+    METRIC_HEAP_MIN_FREE,     ///< Lowest free heap since boot
+    METRIC_SENSOR_STACK_FREE, ///< Stack high water mark of the sensor task, in bytes
+    METRIC_WS_STACK_FREE,     ///< Stack high water mark of the WebSocket task, in bytes
+    METRIC_WIFI_RSSI,         ///< Signal of the connected AP in dBm, stored as int32_t
+    METRIC_GAUGE_MAX
+} metric_gauge_t;
+
+/**
+ * @brief Histograms
+ */
+typedef enum {
+    METRIC_MESSAGE_IN_BYTES = 0, ///< Size of the received messages
+    METRIC_HANDLE_US,            ///< Time spent handling a received message
+    METRIC_WIFI_ROAM_MS,         ///< Time from leaving the old AP to associating with the new one
+    METRIC_HISTOGRAM_MAX
+} metric_histogram_t;
+
+/**
+ * Log-linear histogram: every power of two is split into 4 linear buckets, so a value
+ * lands in a bucket at most 25% wider than itself. Values from 114688 up share the last bucket.
+ */
+#define METRICS_HISTOGRAM_SUB_BITS 2
+#define METRICS_HISTOGRAM_BUCKETS  64
+
+/**
+ * @brief Increment a counter
+ */
+void metrics_inc(metric_counter_t counter);
+
+/**
+ * @brief Add to a counter
+ */
+void metrics_add(metric_counter_t counter, uint32_t value);
+
+/**
+ * @brief Sum of a counter over all cores
+ */
+uint32_t metrics_get(metric_counter_t counter);
+
+/**
+ * @brief Set a gauge
+ */
+void metrics_set(metric_gauge_t gauge, uint32_t value);
+
+/**
+ * @brief Latest value of a gauge
+ */
+uint32_t metrics_get_gauge(metric_gauge_t gauge);
+
+/**
+ * @brief Record a value in a histogram
+ */
+void metrics_observe(metric_histogram_t histogram, uint32_t value);
+
+/**
+ * @brief Bucket of a histogram a value is counted in
+ */
+int metrics_histogram_bucket(uint32_t value);
+
+/**
+ * @brief Smallest value counted in a histogram bucket
+ */
+uint32_t metrics_histogram_bucket_floor(int bucket);
+
+/**
+ * @brief Copy the bucket counts of a histogram
+ */
+esp_err_t metrics_get_histogram(metric_histogram_t histogram, uint32_t buckets[METRICS_HISTOGRAM_BUCKETS]);
+
+/**
+ * @brief Update the heap gauges and the stack gauge of the calling task
+ *
+ * @param stack_gauge METRIC_SENSOR_STACK_FREE or METRIC_WS_STACK_FREE, depending on the caller
+ */
+void metrics_sample_system(metric_gauge_t stack_gauge);
+
+/**
+ * @brief Format all metrics as compact text
+ *
+ * Counters and gauges as `name=value` separated by spaces, histograms as
+ * `name=floor:count,floor:count` listing the non-empty buckets only.
+ *
+ * @return Length of the snapshot, longer than len - 1 if it was truncated
+ */
+int metrics_format(char *buffer, size_t len);
+
+#endif // METRICS_H
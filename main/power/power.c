@@ -0,0 +1,149 @@
+/**
+ * @file power.c
+ * @brief Automatic light sleep and the radio-on time estimate
+ */
+#include "power.h"
+#include "radio_model.h"
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
+#include <inttypes.h>
+#if CONFIG_PM_ENABLE
+#include <esp_pm.h>
+#endif
+#include "wifi_control/wifi_control.h"
+
+static const char *TAG = "POWER";
+
+static radio_model_t s_model;
+static int64_t s_start_us = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t s_awake_lock = NULL;
+#endif
+
+// Beacon wake-up interval of the current WiFi power save mode, the DTIM period is assumed to be 1
+static uint32_t wake_interval_us(void)
+{
+    uint16_t listen_interval;
+    switch (wifi_control_get_power_save(&listen_interval)) {
+    case WIFI_POWER_SAVE_NONE:
+        return 0;
+    case WIFI_POWER_SAVE_MAX_MODEM:
+        return RADIO_MODEL_BEACON_INTERVAL_US * listen_interval;
+    default:
+        return RADIO_MODEL_BEACON_INTERVAL_US;
+    }
+}
+
+esp_err_t power_init(const power_config_t *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t wake_us = wake_interval_us();
+    portENTER_CRITICAL(&s_lock);
+    radio_model_init(&s_model, wake_us);
+    s_start_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&s_lock);
+
+#if CONFIG_PM_ENABLE
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = config->max_freq_mhz > 0 ? config->max_freq_mhz : CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = config->min_freq_mhz > 0 ? config->min_freq_mhz : CONFIG_XTAL_FREQ,
+        .light_sleep_enable = config->light_sleep,
+    };
+    esp_err_t ret = esp_pm_configure(&pm_config);
+    if (ret != ESP_OK) {
+        // light sleep also needs CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        ESP_LOGW(TAG, "Power management not configured: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    if (s_awake_lock == NULL) {
+        ret = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "power_awake", &s_awake_lock);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    ESP_LOGI(TAG, "CPU %d-%d MHz, light sleep %s", pm_config.min_freq_mhz, pm_config.max_freq_mhz,
+             config->light_sleep ? "on" : "off");
+    return ESP_OK;
+#else
+    if (config->light_sleep) {
+        ESP_LOGW(TAG, "Light sleep needs CONFIG_PM_ENABLE");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return ESP_OK;
+#endif
+}
+
+void power_hold_awake(void)
+{
+#if CONFIG_PM_ENABLE
+    if (s_awake_lock) {
+        esp_pm_lock_acquire(s_awake_lock);
+    }
+#endif
+}
+
+void power_release_awake(void)
+{
+#if CONFIG_PM_ENABLE
+    if (s_awake_lock) {
+        esp_pm_lock_release(s_awake_lock);
+    }
+#endif
+}
+
+void power_note_radio_traffic(void)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_lock);
+    radio_model_note_traffic(&s_model, now);
+    portEXIT_CRITICAL(&s_lock);
+}
+
+bool power_radio_awake(void)
+{
+    uint32_t wake_us = wake_interval_us();
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_lock);
+    s_model.wake_interval_us = wake_us;
+    bool awake = radio_model_awake(&s_model, now);
+    portEXIT_CRITICAL(&s_lock);
+    return awake;
+}
+
+esp_err_t power_get_radio_stats(power_radio_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t wake_us = wake_interval_us();
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_lock);
+    s_model.wake_interval_us = wake_us;
+    uint64_t elapsed_us = now - s_start_us;
+    uint64_t on_us = radio_model_on_us(&s_model, elapsed_us);
+    uint32_t bursts = s_model.bursts;
+    portEXIT_CRITICAL(&s_lock);
+
+    stats->elapsed_ms = elapsed_us / 1000;
+    stats->radio_on_ms = on_us / 1000;
+    stats->radio_on_permille = elapsed_us ? on_us * 1000 / elapsed_us : 0;
+    stats->bursts = bursts;
+    stats->wake_interval_ms = wake_us / 1000;
+    return ESP_OK;
+}
+
+void power_log(void)
+{
+    power_radio_stats_t stats;
+    power_get_radio_stats(&stats);
+    ESP_LOGI(TAG, "radio on ~%" PRIu32 " ms of %" PRIu32 " ms (%" PRIu32 ".%" PRIu32 "%%), %" PRIu32 " bursts, wake every %" PRIu32 " ms",
+             stats.radio_on_ms, stats.elapsed_ms, stats.radio_on_permille / 10, stats.radio_on_permille % 10,
+             stats.bursts, stats.wake_interval_ms);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file power.h
+ * @brief Automatic light sleep and the radio-on time estimate
+ *
+ * With light sleep enabled the chip sleeps whenever every task is blocked, e.g. between sensor
+ * samples, and WiFi keeps the association through modem sleep. The radio cannot be metered, its
+ * on time is estimated from the WiFi power save mode and the traffic, see radio_model.h.
+ */
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+/**
+ * @brief Power management configuration
+ */
+typedef struct {
+    bool light_sleep;            ///< Sleep while every task is blocked, needs CONFIG_PM_ENABLE and tickless idle
+    int max_freq_mhz;            ///< CPU frequency while busy, CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ if 0
+    int min_freq_mhz;            ///< CPU frequency while idle, CONFIG_XTAL_FREQ if 0
+} power_config_t;
+
+/**
+ * @brief Radio-on time estimate since power_init()
+ */
+typedef struct {
+    uint32_t elapsed_ms;         ///< Time covered by the estimate
+    uint32_t radio_on_ms;        ///< Estimated radio-on time
+    uint32_t radio_on_permille;  ///< radio_on_ms / elapsed_ms
+    uint32_t bursts;             ///< Traffic bursts, sends close together count once
+    uint32_t wake_interval_ms;   ///< Beacon wake-up interval of the current power save mode, 0 if always on
+} power_radio_stats_t;
+
+/**
+ * @brief Apply the power management configuration and start the radio-on estimate
+ *
+ * @return ESP_ERR_NOT_SUPPORTED if light sleep was requested but power management is not built in,
+ *         the estimate works anyway
+ */
+esp_err_t power_init(const power_config_t *config);
+
+/**
+ * @brief Keep the CPU at full speed and out of light sleep, e.g. around bit-banged timing
+ *
+ * Calls nest, each needs a power_release_awake().
+ */
+void power_hold_awake(void);
+
+/**
+ * @brief Undo power_hold_awake()
+ */
+void power_release_awake(void);
+
+/**
+ * @brief Count radio traffic, a sent or received message
+ */
+void power_note_radio_traffic(void);
+
+/**
+ * @brief Whether the radio is still on after the last traffic, sends now share its wake-up
+ */
+bool power_radio_awake(void);
+
+/**
+ * @brief Radio-on time estimate, assumes the current power save mode for the whole period
+ */
+esp_err_t power_get_radio_stats(power_radio_stats_t *stats);
+
+/**
+ * @brief Log the radio-on time estimate
+ */
+void power_log(void);
+
+#endif // POWER_H
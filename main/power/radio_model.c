@@ -0,0 +1,37 @@
+/**
+ * @file radio_model.c
+ * @brief Radio-on time estimate for the WiFi power save modes
+ */
+#include "radio_model.h"
+
+void radio_model_init(radio_model_t *model, uint32_t wake_interval_us)
+{
+    model->wake_interval_us = wake_interval_us;
+    model->beacon_rx_us = RADIO_MODEL_BEACON_RX_US;
+    model->burst_us = RADIO_MODEL_BURST_US;
+    model->bursts = 0;
+    model->burst_end_us = 0;
+}
+
+void radio_model_note_traffic(radio_model_t *model, uint64_t now_us)
+{
+    if (model->bursts == 0 || now_us >= model->burst_end_us) {
+        model->bursts++;
+        model->burst_end_us = now_us + model->burst_us;
+    }
+}
+
+bool radio_model_awake(const radio_model_t *model, uint64_t now_us)
+{
+    return model->wake_interval_us == 0 || (model->bursts > 0 && now_us < model->burst_end_us);
+}
+
+uint64_t radio_model_on_us(const radio_model_t *model, uint64_t elapsed_us)
+{
+    if (model->wake_interval_us == 0) {
+        return elapsed_us;
+    }
+    uint64_t on_us = elapsed_us / model->wake_interval_us * model->beacon_rx_us +
+                     (uint64_t)model->bursts * model->burst_us;
+    return on_us < elapsed_us ? on_us : elapsed_us;
+}
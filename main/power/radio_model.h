@@ -0,0 +1,53 @@
+/**
+ * @file radio_model.h
+ * @brief Radio-on time estimate for the WiFi power save modes
+ *
+ * The radio cannot be metered on the device, so its on time is estimated from the power save
+ * mode and the traffic: in modem sleep it wakes up for every beacon it listens to, and every
+ * burst of traffic keeps it on for a while. Sends closer together than one burst share it, which
+ * is what batching the telemetry buys. Plain C, the host simulation uses it too.
+ */
+#ifndef RADIO_MODEL_H
+#define RADIO_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RADIO_MODEL_BEACON_INTERVAL_US 102400  ///< 100 TU, the usual beacon interval
+#define RADIO_MODEL_BEACON_RX_US       3000    ///< On time per beacon wake-up
+#define RADIO_MODEL_BURST_US           20000   ///< On time per traffic burst, including the tail before it sleeps
+
+/**
+ * @brief Radio model and the traffic seen so far
+ */
+typedef struct {
+    uint32_t wake_interval_us;  ///< Time between beacon wake-ups, 0 if the radio never sleeps
+    uint32_t beacon_rx_us;      ///< On time per beacon wake-up
+    uint32_t burst_us;          ///< On time per traffic burst
+    uint32_t bursts;            ///< Traffic bursts so far
+    uint64_t burst_end_us;      ///< End of the current burst
+} radio_model_t;
+
+/**
+ * @brief Reset the model
+ *
+ * @param wake_interval_us Time between beacon wake-ups, 0 if the radio never sleeps
+ */
+void radio_model_init(radio_model_t *model, uint32_t wake_interval_us);
+
+/**
+ * @brief Count traffic, it joins the current burst if it starts before the burst ended
+ */
+void radio_model_note_traffic(radio_model_t *model, uint64_t now_us);
+
+/**
+ * @brief Whether the radio is still on after the last traffic
+ */
+bool radio_model_awake(const radio_model_t *model, uint64_t now_us);
+
+/**
+ * @brief Estimated radio-on time over the given period
+ */
+uint64_t radio_model_on_us(const radio_model_t *model, uint64_t elapsed_us);
+
+#endif // RADIO_MODEL_H
@@ -0,0 +1,163 @@
+/**
+ * @file rpc.c
+ * @brief Request/response calls over the smart_home WebSocket
+ */
+#include "rpc.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "smart_home/protocol.h"
+#include "latency/latency.h"
+#include "util/format.h"
+
+typedef struct {
+    const char *name;
+    rpc_handler_t handler;      // NULL for a free id
+    void *ctx;
+    uint32_t calls;
+    uint32_t failures;          // any status but RPC_STATUS_OK
+    uint64_t total_us;
+    uint32_t max_us;
+} method_t;
+
+static void put_le16(uint8_t *p, uint16_t value)
+{
+    p[0] = value & 0xff;
+    p[1] = value >> 8;
+}
+
+static esp_err_t ping_handler(const uint8_t *args, size_t args_len, uint8_t *result,
+                              size_t result_size, size_t *result_len, void *ctx)
+{
+    if (args_len > result_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (args_len) {
+        memcpy(result, args, args_len);
+    }
+    *result_len = args_len;
+    return ESP_OK;
+}
+
+static esp_err_t stats_handler(const uint8_t *args, size_t args_len, uint8_t *result,
+                               size_t result_size, size_t *result_len, void *ctx)
+{
+    int len = rpc_format_stats((char *)result, result_size);
+    if (len < 0 || (size_t)len >= result_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *result_len = len;
+    return ESP_OK;
+}
+
+// Written before the WebSocket starts, used by its task alone afterwards
+static method_t s_methods[RPC_MAX_METHODS] = {
+    [RPC_METHOD_PING] = { .name = "ping", .handler = ping_handler },
+    [RPC_METHOD_STATS] = { .name = "stats", .handler = stats_handler },
+};
+
+esp_err_t rpc_register(uint8_t method, const char *name, rpc_handler_t handler, void *ctx)
+{
+    if (method >= RPC_MAX_METHODS || !name || !handler) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_methods[method].handler) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_methods[method] = (method_t) { .name = name, .handler = handler, .ctx = ctx };
+    return ESP_OK;
+}
+
+static rpc_status_t status_of(esp_err_t err)
+{
+    switch (err) {
+        case ESP_OK:
+            return RPC_STATUS_OK;
+        case ESP_ERR_INVALID_ARG:
+            return RPC_STATUS_BAD_ARGS;
+        case ESP_ERR_INVALID_SIZE:
+            return RPC_STATUS_NO_SPACE;
+        default:
+            return RPC_STATUS_FAILED;
+    }
+}
+
+// Run one request, its response goes to `out` which has `space` bytes
+static size_t call(const protocol_rpc_request_t *request, uint8_t *out, size_t space)
+{
+    if (space < PROTOCOL_RPC_RESPONSE_HEADER) {
+        return 0;
+    }
+    size_t result_size = space - PROTOCOL_RPC_RESPONSE_HEADER;
+    if (result_size > UINT16_MAX) {
+        result_size = UINT16_MAX;
+    }
+    size_t result_len = 0;
+    rpc_status_t status = RPC_STATUS_UNKNOWN_METHOD;
+
+    method_t *method = request->method < RPC_MAX_METHODS ? &s_methods[request->method] : NULL;
+    if (method && method->handler) {
+        int64_t start_us = latency_now();
+        status = status_of(method->handler(request->args_len ? request->args : NULL, request->args_len,
+                                           out + PROTOCOL_RPC_RESPONSE_HEADER, result_size, &result_len,
+                                           method->ctx));
+        uint32_t elapsed_us = (uint32_t)(latency_now() - start_us);
+        method->calls++;
+        method->total_us += elapsed_us;
+        if (elapsed_us > method->max_us) {
+            method->max_us = elapsed_us;
+        }
+        if (status != RPC_STATUS_OK) {
+            method->failures++;
+        }
+    }
+    if (status != RPC_STATUS_OK || result_len > result_size) {
+        result_len = 0;     // a failed call returns nothing
+    }
+
+    put_le16(out, request->id);
+    out[2] = request->method;
+    out[3] = status;
+    put_le16(out + 4, (uint16_t)result_len);
+    return PROTOCOL_RPC_RESPONSE_HEADER + result_len;
+}
+
+size_t rpc_process(const uint8_t *frame, size_t length, uint8_t *response, size_t response_size)
+{
+    if (protocol_rpc_requests(frame, length) == 0 || response_size < PROTOCOL_RPC_FRAME_HEADER) {
+        return 0;
+    }
+    size_t out = PROTOCOL_RPC_FRAME_HEADER;
+    uint8_t answered = 0;
+    size_t offset = PROTOCOL_RPC_FRAME_HEADER;
+    protocol_rpc_request_t request;
+    while (protocol_rpc_next(frame, length, &offset, &request)) {
+        size_t written = call(&request, response + out, response_size - out);
+        if (written) {
+            out += written;
+            answered++;
+        }
+    }
+    response[0] = PROTOCOL_RPC_RESPONSE;
+    response[1] = answered;
+    return out;
+}
+
+int rpc_format_stats(char *buffer, size_t len)
+{
+    int written = 0;
+    if (len > 0) {
+        buffer[0] = '\0';
+    }
+    for (int i = 0; i < RPC_MAX_METHODS; i++) {
+        const method_t *method = &s_methods[i];
+        if (!method->handler || method->calls == 0) {
+            continue;
+        }
+        format_append(buffer, len, &written, "%s%s_calls=%" PRIu32 " %s_fail=%" PRIu32 " %s_avg_us=%" PRIu32
+                      " %s_max_us=%" PRIu32, written ? " " : "", method->name, method->calls,
+                      method->name, method->failures, method->name,
+                      (uint32_t)(method->total_us / method->calls), method->name, method->max_us);
+    }
+    return written;
+}
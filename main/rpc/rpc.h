@@ -0,0 +1,85 @@
+/**
+ * @file rpc.h
+ * @brief Request/response calls over the smart_home WebSocket
+ *
+ * The server sends BINARY frames of batched requests, see main/smart_home/protocol.h for the
+ * format. Each request names a method by its id, a dispatch table indexed by the id holds the
+ * registered handlers. The handlers run in the WebSocket task one after the other and write
+ * their result into the response frame, which answers the whole batch at once. The server may
+ * keep several frames in flight, it matches the responses by the request ids.
+ *
+ * Every method keeps call, failure and timing counts, returned by RPC_METHOD_STATS.
+ */
+#ifndef RPC_H
+#define RPC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#define RPC_MAX_METHODS 32      ///< Method ids are below this
+
+/**
+ * @brief Methods of the firmware, the application registers its own from RPC_METHOD_APP on
+ */
+typedef enum {
+    RPC_METHOD_PING = 0,        ///< Returns its arguments
+    RPC_METHOD_STATS,           ///< Call statistics of every method, as text
+    RPC_METHOD_METRICS,         ///< The "metrics" report
+    RPC_METHOD_LATENCY,         ///< The "latency" report
+    RPC_METHOD_MEMPROF,         ///< The "memprof" report
+    RPC_METHOD_CALIBRATION,     ///< The "calibration" report
+    RPC_METHOD_APP = 16,
+} rpc_method_t;
+
+/**
+ * @brief Status of a response
+ */
+typedef enum {
+    RPC_STATUS_OK = 0,
+    RPC_STATUS_UNKNOWN_METHOD,  ///< No handler is registered for the id
+    RPC_STATUS_BAD_ARGS,        ///< The handler returned ESP_ERR_INVALID_ARG
+    RPC_STATUS_NO_SPACE,        ///< The result did not fit into what is left of the response frame
+    RPC_STATUS_FAILED,          ///< The handler returned another error
+} rpc_status_t;
+
+/**
+ * @brief Method handler
+ *
+ * @param args        Arguments as sent, may be NULL if args_len is 0
+ * @param result      Where the result goes, at most result_size bytes
+ * @param result_len  Set to the length of the result
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for malformed arguments, ESP_ERR_INVALID_SIZE if the result
+ *         does not fit, any other error fails the call
+ */
+typedef esp_err_t (*rpc_handler_t)(const uint8_t *args, size_t args_len, uint8_t *result,
+                                   size_t result_size, size_t *result_len, void *ctx);
+
+/**
+ * @brief Register the handler of a method, before the WebSocket is started
+ *
+ * @param name Used in the statistics, has to stay valid
+ * @return ESP_ERR_INVALID_ARG for an id out of range, ESP_ERR_INVALID_STATE if it is taken
+ */
+esp_err_t rpc_register(uint8_t method, const char *name, rpc_handler_t handler, void *ctx);
+
+/**
+ * @brief Answer a request frame
+ *
+ * Runs the handler of every request in order and writes their responses into `response`.
+ * A request whose response does not fit even without its result is left unanswered.
+ *
+ * @return Length of the response frame, 0 if the request frame is malformed
+ */
+size_t rpc_process(const uint8_t *frame, size_t length, uint8_t *response, size_t response_size);
+
+/**
+ * @brief Format the statistics of the methods called so far
+ *
+ * `<name>_calls=n <name>_fail=n <name>_avg_us=n <name>_max_us=n` per method.
+ *
+ * @return Length of the text, longer than len - 1 if it was truncated
+ */
+int rpc_format_stats(char *buffer, size_t len);
+
+#endif // RPC_H
@@ -0,0 +1,281 @@
+/**
+ * @file gpio_sim.c
+ * @brief Simulated GPIO for the linux target
+ */
+#include "gpio_sim.h"
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "GPIO_SIM";
+
+#define START_SIGNAL_MIN_US 18000  // DHT11 needs the line low at least this long
+
+typedef struct {
+    uint16_t durations[GPIO_SIM_TRAIN_LEN];
+    int count;
+} pulse_train_t;
+
+typedef struct {
+    gpio_mode_t mode;
+    int level;
+    bool recorded;                // configured as output through gpio_config()
+    uint32_t changes;
+    int64_t low_since_us;         // bus time the pin was driven low
+    bool start_signal;            // low long enough, a switch to input starts a read
+} sim_pin_t;
+
+static sim_pin_t s_pins[GPIO_NUM_MAX];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Replay state, only touched by the task reading the sensor
+static pulse_train_t *s_trains = NULL;
+static int s_train_count = 0;
+static int s_next_train = 0;
+static const pulse_train_t *s_active = NULL;
+static gpio_num_t s_active_pin = GPIO_NUM_NC;
+static int64_t s_active_start_us = 0;
+static int64_t s_bus_us = 0;
+
+static FILE *s_trace = NULL;
+static bool s_env_loaded = false;
+
+// The environment is read on the first GPIO call, app_main starts with gpio_config()
+static void load_env(void)
+{
+    if (s_env_loaded) {
+        return;
+    }
+    s_env_loaded = true;
+    const char *pulses = getenv("GPIO_SIM_DHT11");
+    if (pulses) {
+        gpio_sim_load_pulses(pulses);
+    }
+    const char *trace = getenv("GPIO_SIM_TRACE");
+    if (trace) {
+        gpio_sim_record(trace);
+    }
+}
+
+static bool valid_pin(gpio_num_t gpio_num)
+{
+    return gpio_num >= 0 && gpio_num < GPIO_NUM_MAX;
+}
+
+// Ideal train: 80 us low and high response, per bit 50 us low and 26 or 70 us high, 50 us low end
+static void synthesize(pulse_train_t *train, int humidity, int temperature)
+{
+    uint8_t data[5] = { humidity, 0, temperature, 0, 0 };
+    data[4] = data[0] + data[1] + data[2] + data[3];
+    train->count = 0;
+    train->durations[train->count++] = 80;
+    train->durations[train->count++] = 80;
+    for (int i = 0; i < 40; i++) {
+        train->durations[train->count++] = 50;
+        train->durations[train->count++] = (data[i / 8] >> (7 - i % 8)) & 1 ? 70 : 26;
+    }
+    train->durations[train->count++] = 50;
+}
+
+static bool parse_line(char *line, pulse_train_t *train)
+{
+    char *comment = strchr(line, '#');
+    if (comment) {
+        *comment = '\0';
+    }
+    while (isspace((unsigned char)*line)) {
+        line++;
+    }
+    if (*line == '\0') {
+        return false;
+    }
+    if (strncmp(line, "timeout", 7) == 0) {
+        train->count = 0;
+        return true;
+    }
+
+    long values[GPIO_SIM_TRAIN_LEN];
+    int count = 0;
+    char *end;
+    for (long value = strtol(line, &end, 10); end != line; value = strtol(line, &end, 10)) {
+        if (count == GPIO_SIM_TRAIN_LEN || value < 0 || value > UINT16_MAX) {
+            return false;
+        }
+        values[count++] = value;
+        line = end;
+    }
+    if (count == 2) {
+        synthesize(train, values[0], values[1]);
+        return true;
+    }
+    train->count = count;
+    for (int i = 0; i < count; i++) {
+        train->durations[i] = values[i];
+    }
+    return count > 0;
+}
+
+esp_err_t gpio_sim_load_pulses(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        ESP_LOGE(TAG, "Cannot open %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    pulse_train_t *trains = calloc(GPIO_SIM_MAX_TRAINS, sizeof(pulse_train_t));
+    if (!trains) {
+        fclose(file);
+        return ESP_ERR_NO_MEM;
+    }
+
+    char line[512];
+    int count = 0;
+    int line_no = 0;
+    while (count < GPIO_SIM_MAX_TRAINS && fgets(line, sizeof(line), file)) {
+        line_no++;
+        char *content = line + strspn(line, " \t");
+        if (*content == '#' || *content == '\n' || *content == '\0') {
+            continue;
+        }
+        if (parse_line(line, &trains[count])) {
+            count++;
+        } else {
+            ESP_LOGW(TAG, "%s:%d: not a pulse train", path, line_no);
+        }
+    }
+    fclose(file);
+
+    free(s_trains);
+    s_trains = trains;
+    s_train_count = count;
+    s_next_train = 0;
+    s_active = NULL;
+    ESP_LOGI(TAG, "%d DHT11 pulse trains loaded from %s", count, path);
+    return count ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+esp_err_t gpio_sim_record(const char *path)
+{
+    if (s_trace) {
+        fclose(s_trace);
+        s_trace = NULL;
+    }
+    if (!path) {
+        return ESP_OK;
+    }
+    s_trace = fopen(path, "a");
+    if (!s_trace) {
+        ESP_LOGE(TAG, "Cannot open %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    setvbuf(s_trace, NULL, _IOLBF, 0);
+    return ESP_OK;
+}
+
+int gpio_sim_output_level(gpio_num_t gpio_num)
+{
+    return valid_pin(gpio_num) ? s_pins[gpio_num].level : 0;
+}
+
+uint32_t gpio_sim_output_changes(gpio_num_t gpio_num)
+{
+    return valid_pin(gpio_num) ? s_pins[gpio_num].changes : 0;
+}
+
+void gpio_sim_delay_us(uint32_t us)
+{
+    s_bus_us += us;
+}
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    load_env();
+    for (int pin = 0; pin < GPIO_NUM_MAX; pin++) {
+        if (config->pin_bit_mask & (1ULL << pin)) {
+            gpio_set_direction(pin, config->mode);
+            s_pins[pin].recorded = config->mode & GPIO_MODE_OUTPUT;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    if (!valid_pin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    load_env();
+    sim_pin_t *pin = &s_pins[gpio_num];
+    pin->mode = mode;
+    // Released after the start signal: the sensor answers with the next train
+    if (mode == GPIO_MODE_INPUT && pin->start_signal) {
+        pin->start_signal = false;
+        if (s_train_count) {
+            s_active = &s_trains[s_next_train];
+            s_next_train = (s_next_train + 1) % s_train_count;
+            s_active_pin = gpio_num;
+            s_active_start_us = s_bus_us;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (!valid_pin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim_pin_t *pin = &s_pins[gpio_num];
+    level = level ? 1 : 0;
+
+    portENTER_CRITICAL(&s_lock);
+    bool changed = pin->level != (int)level;
+    if (changed) {
+        pin->changes++;
+    }
+    pin->level = level;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (level == 0) {
+        pin->low_since_us = s_bus_us;
+        pin->start_signal = false;
+    } else {
+        pin->start_signal = s_bus_us - pin->low_since_us >= START_SIGNAL_MIN_US;
+    }
+    if (changed && pin->recorded && s_trace) {
+        fprintf(s_trace, "%" PRId64 " %d %" PRIu32 "\n", esp_timer_get_time() / 1000, gpio_num, level);
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (!valid_pin(gpio_num)) {
+        return 0;
+    }
+    if (s_pins[gpio_num].mode & GPIO_MODE_OUTPUT) {
+        return s_pins[gpio_num].level;
+    }
+    if (gpio_num != s_active_pin || !s_active) {
+        return 1;   // the pull-up holds an idle line high
+    }
+
+    int64_t elapsed = s_bus_us - s_active_start_us;
+    for (int i = 0; i < s_active->count; i++) {
+        if (elapsed < s_active->durations[i]) {
+            return i % 2;
+        }
+        elapsed -= s_active->durations[i];
+    }
+    s_active = NULL;
+    return 1;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file gpio_sim.h
+ * @brief Simulated GPIO for the linux target: recorded outputs and replayed DHT11 pulse trains
+ *
+ * Pins configured as outputs through gpio_config(), the relay, have every level change recorded.
+ * A pin driven low for at least 18 ms and then switched to input, the DHT11 start signal, replays
+ * the next pulse train from the loaded file. Time on the bus is virtual: it only advances in
+ * gpio_sim_delay_us(), which dht11.c uses instead of ets_delay_us() on this target, so the bit
+ * timing decodes the same however slow the host, perf or valgrind are.
+ *
+ * The environment configures it on the first GPIO call:
+ *   GPIO_SIM_DHT11  pulse train file, see gpio_sim_load_pulses()
+ *   GPIO_SIM_TRACE  file the output changes are appended to as `time_ms gpio level` lines
+ */
+#ifndef GPIO_SIM_H
+#define GPIO_SIM_H
+
+#include <stdint.h>
+#include <esp_err.h>
+#include <driver/gpio.h>
+
+#define GPIO_SIM_MAX_TRAINS 64   ///< Pulse trains kept from a file
+#define GPIO_SIM_TRAIN_LEN  84   ///< Durations of a train: response, 40 bits and the end pulse
+
+/**
+ * @brief Load the pulse trains replayed on DHT11 reads, they repeat when the file is exhausted
+ *
+ * One read per line, `#` starts a comment:
+ *   `H T`            an ideal train for humidity H and temperature T with a valid checksum
+ *   `timeout`        the sensor does not answer
+ *   `d0 d1 d2 ...`   raw durations in us after the host releases the line, alternating low and
+ *                    high starting low; the line idles high after the last one
+ */
+esp_err_t gpio_sim_load_pulses(const char *path);
+
+/**
+ * @brief Append the output changes to a file, NULL stops recording
+ */
+esp_err_t gpio_sim_record(const char *path);
+
+/**
+ * @brief Level last set on an output pin
+ */
+int gpio_sim_output_level(gpio_num_t gpio_num);
+
+/**
+ * @brief Number of level changes of an output pin
+ */
+uint32_t gpio_sim_output_changes(gpio_num_t gpio_num);
+
+/**
+ * @brief Busy wait replacement, advances the virtual bus time
+ */
+void gpio_sim_delay_us(uint32_t us);
+
+#endif // GPIO_SIM_H
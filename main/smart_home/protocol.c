@@ -0,0 +1,271 @@
+/**
+ * @file protocol.c
+ * @brief Parser of the messages the smart_home server sends
+ */
+#include "protocol.h"
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+#define COMMAND_PREFIX "datasend:"
+#define SEQ_PREFIX "seq="
+#define SYNCED_PREFIX "synced:"
+
+static const struct {
+    const char *name;
+    size_t len;
+    control_type_t type;
+} s_control_types[] = {
+    {"SWITCH", sizeof("SWITCH") - 1, CONTROL_TYPE_SWITCH},
+    {"SLIDER", sizeof("SLIDER") - 1, CONTROL_TYPE_SLIDER},
+    {"RGB_PICKER", sizeof("RGB_PICKER") - 1, CONTROL_TYPE_RGB_PICKER},
+    {"BUTTON_GROUP", sizeof("BUTTON_GROUP") - 1, CONTROL_TYPE_BUTTON_GROUP},
+    {"NUMERIC_INPUT", sizeof("NUMERIC_INPUT") - 1, CONTROL_TYPE_NUMERIC_INPUT},
+    {"TEXT_DISPLAY", sizeof("TEXT_DISPLAY") - 1, CONTROL_TYPE_TEXT_DISPLAY},
+    {"DROPDOWN", sizeof("DROPDOWN") - 1, CONTROL_TYPE_DROPDOWN},
+    {"SCHEDULE", sizeof("SCHEDULE") - 1, CONTROL_TYPE_SCHEDULE},
+};
+
+static bool equals(const char *message, size_t length, const char *literal, size_t literal_len)
+{
+    return length == literal_len && memcmp(message, literal, length) == 0;
+}
+
+control_type_t protocol_control_type(const char *name, size_t length)
+{
+    for (size_t i = 0; i < sizeof(s_control_types) / sizeof(s_control_types[0]); i++) {
+        if (equals(name, length, s_control_types[i].name, s_control_types[i].len)) {
+            return s_control_types[i].type;
+        }
+    }
+    return CONTROL_TYPE_UNKNOWN;
+}
+
+// Field from `*pos` up to the next ':' or the end, `*pos` is left after the ':'
+static const char *next_field(const char *message, size_t length, size_t *pos, size_t *field_len)
+{
+    const char *field = message + *pos;
+    const char *colon = memchr(field, ':', length - *pos);
+    *field_len = colon ? (size_t)(colon - field) : length - *pos;
+    *pos += *field_len + (colon ? 1 : 0);
+    return field;
+}
+
+// Non-empty decimal digits of a number no larger than `max`
+static bool parse_decimal(const char *field, size_t len, uint32_t max, uint32_t *value)
+{
+    if (len == 0) {
+        return false;
+    }
+    uint32_t number = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (field[i] < '0' || field[i] > '9') {
+            return false;
+        }
+        uint32_t digit = field[i] - '0';
+        if (number > (max - digit) / 10) {
+            return false;
+        }
+        number = number * 10 + digit;
+    }
+    *value = number;
+    return true;
+}
+
+static bool parse_device_id(const char *field, size_t len, int *device_id)
+{
+    uint32_t id;
+    if (!parse_decimal(field, len, INT_MAX, &id)) {
+        return false;
+    }
+    *device_id = (int)id;
+    return true;
+}
+
+static protocol_message_t parse_command(const char *message, size_t length, protocol_command_t *command)
+{
+    size_t pos = sizeof(COMMAND_PREFIX) - 1;
+    size_t len;
+
+    const char *field = next_field(message, length, &pos, &len);
+    if (pos == length || !parse_device_id(field, len, &command->device_id)) {
+        return PROTOCOL_MSG_INVALID;
+    }
+
+    field = next_field(message, length, &pos, &len);
+    if (len == 0 || pos == length) {
+        return PROTOCOL_MSG_INVALID;
+    }
+    command->control_type = protocol_control_type(field, len);
+
+    field = next_field(message, length, &pos, &len);
+    if (len == 0 || len > PROTOCOL_VALUE_MAX || memchr(field, '\0', len)) {
+        return PROTOCOL_MSG_INVALID;
+    }
+    memcpy(command->value, field, len);
+    command->value[len] = '\0';
+    command->value_len = len;
+
+    // A fifth field may number the command, other fifth fields are padding and ignored
+    command->seq = 0;
+    if (pos < length) {
+        field = next_field(message, length, &pos, &len);
+        if (len >= sizeof(SEQ_PREFIX) - 1 && memcmp(field, SEQ_PREFIX, sizeof(SEQ_PREFIX) - 1) == 0 &&
+            (!parse_decimal(field + sizeof(SEQ_PREFIX) - 1, len - (sizeof(SEQ_PREFIX) - 1), UINT32_MAX, &command->seq) ||
+             command->seq == 0)) {
+            return PROTOCOL_MSG_INVALID;
+        }
+    }
+    return PROTOCOL_MSG_COMMAND;
+}
+
+protocol_message_t protocol_parse(const char *message, size_t length, protocol_command_t *command)
+{
+    if (message == NULL || length == 0) {
+        return PROTOCOL_MSG_INVALID;
+    }
+    // Commands are by far the most frequent
+    if (length > sizeof(COMMAND_PREFIX) - 1 && memcmp(message, COMMAND_PREFIX, sizeof(COMMAND_PREFIX) - 1) == 0) {
+        return command ? parse_command(message, length, command) : PROTOCOL_MSG_INVALID;
+    }
+    if (equals(message, length, "Successfully connected", sizeof("Successfully connected") - 1)) {
+        return PROTOCOL_MSG_AUTHENTICATED;
+    }
+    if (equals(message, length, "latency", sizeof("latency") - 1)) {
+        return PROTOCOL_MSG_LATENCY;
+    }
+    if (equals(message, length, "metrics", sizeof("metrics") - 1)) {
+        return PROTOCOL_MSG_METRICS;
+    }
+    if (equals(message, length, "memprof", sizeof("memprof") - 1)) {
+        return PROTOCOL_MSG_MEMPROF;
+    }
+    if (equals(message, length, "calibration", sizeof("calibration") - 1)) {
+        return PROTOCOL_MSG_CALIBRATION;
+    }
+    if (equals(message, length, "snapshot", sizeof("snapshot") - 1)) {
+        return PROTOCOL_MSG_SNAPSHOT;
+    }
+    if (length > sizeof(SYNCED_PREFIX) - 1 && memcmp(message, SYNCED_PREFIX, sizeof(SYNCED_PREFIX) - 1) == 0) {
+        if (!command || !parse_decimal(message + sizeof(SYNCED_PREFIX) - 1, length - (sizeof(SYNCED_PREFIX) - 1),
+                                       UINT32_MAX, &command->version) || command->version == 0) {
+            return PROTOCOL_MSG_INVALID;
+        }
+        return PROTOCOL_MSG_SYNCED;
+    }
+    return PROTOCOL_MSG_INVALID;
+}
+
+void protocol_dedup_init(protocol_dedup_t *dedup)
+{
+    memset(dedup, 0, sizeof(*dedup));
+}
+
+bool protocol_dedup_check(protocol_dedup_t *dedup, uint32_t seq)
+{
+    if (seq == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < PROTOCOL_DEDUP_WINDOW; i++) {
+        if (dedup->ids[i] == seq) {
+            return true;
+        }
+    }
+    dedup->ids[dedup->next] = seq;
+    dedup->next = (dedup->next + 1) % PROTOCOL_DEDUP_WINDOW;
+    return false;
+}
+
+static uint16_t get_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+int protocol_rpc_requests(const uint8_t *frame, size_t length)
+{
+    if (frame == NULL || length < PROTOCOL_RPC_FRAME_HEADER || frame[0] != PROTOCOL_RPC_REQUEST || frame[1] == 0) {
+        return 0;
+    }
+    size_t offset = PROTOCOL_RPC_FRAME_HEADER;
+    for (int i = 0; i < frame[1]; i++) {
+        if (length - offset < PROTOCOL_RPC_REQUEST_HEADER) {
+            return 0;
+        }
+        size_t args_len = get_le16(frame + offset + 3);
+        offset += PROTOCOL_RPC_REQUEST_HEADER;
+        if (length - offset < args_len) {
+            return 0;
+        }
+        offset += args_len;
+    }
+    return offset == length ? frame[1] : 0;
+}
+
+bool protocol_rpc_next(const uint8_t *frame, size_t length, size_t *offset, protocol_rpc_request_t *request)
+{
+    if (length < *offset + PROTOCOL_RPC_REQUEST_HEADER) {
+        return false;
+    }
+    const uint8_t *p = frame + *offset;
+    request->args_len = get_le16(p + 3);
+    if (length - *offset - PROTOCOL_RPC_REQUEST_HEADER < request->args_len) {
+        return false;
+    }
+    request->id = get_le16(p);
+    request->method = p[2];
+    request->args = p + PROTOCOL_RPC_REQUEST_HEADER;
+    *offset += PROTOCOL_RPC_REQUEST_HEADER + request->args_len;
+    return true;
+}
+
+void protocol_assembler_init(protocol_assembler_t *assembler, char *buffer, size_t size)
+{
+    memset(assembler, 0, sizeof(*assembler));
+    assembler->buffer = buffer;
+    assembler->size = size;
+}
+
+const char *protocol_assemble(protocol_assembler_t *assembler, const char *data, int data_len,
+                              int payload_offset, int payload_len, bool first, bool fin, size_t *length)
+{
+    if (data_len < 0 || (data_len > 0 && data == NULL)) {
+        return NULL;
+    }
+    bool last = fin && (int64_t)payload_offset + data_len >= payload_len;
+
+    if (first) {
+        assembler->len = 0;
+        assembler->overflow = false;
+        assembler->active = !last;
+        // The usual case, a message in one event is used where it is
+        if (last) {
+            *length = data_len;
+            return data;
+        }
+    } else if (!assembler->active) {
+        return NULL;    // continuation of a message whose start was not seen
+    }
+
+    if (!assembler->overflow) {
+        if ((size_t)data_len > assembler->size - assembler->len) {
+            assembler->overflow = true;
+        } else if (data_len > 0) {
+            memcpy(assembler->buffer + assembler->len, data, data_len);
+            assembler->len += data_len;
+        }
+    }
+    if (!last) {
+        return NULL;
+    }
+    assembler->active = false;
+    if (assembler->overflow) {
+        return NULL;
+    }
+    *length = assembler->len;
+    return assembler->buffer;
+}
+
+bool protocol_assembler_overflowed(const protocol_assembler_t *assembler)
+{
+    return assembler->overflow;
+}
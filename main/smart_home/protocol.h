@@ -0,0 +1,155 @@
+/**
+ * @file protocol.h
+ * @brief Parser of the messages the smart_home server sends, free of ESP-IDF so it can be fuzzed on the host
+ *
+ * Messages are taken as (pointer, length) straight from the receive buffer, they need not be NUL
+ * terminated and the parser neither allocates nor writes to them. Anything malformed is rejected
+ * as a whole, host_test/fuzz exercises this with libFuzzer and AFL.
+ */
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "control_types.h"
+
+#define PROTOCOL_VALUE_MAX 64   ///< Longest command value, longer ones are rejected
+#define PROTOCOL_DEDUP_WINDOW 16    ///< Sequence numbers remembered to drop resent commands
+
+typedef enum {
+    PROTOCOL_MSG_INVALID,
+    PROTOCOL_MSG_AUTHENTICATED,  ///< "Successfully connected", the reply to the auth token
+    PROTOCOL_MSG_LATENCY,        ///< "latency" report request
+    PROTOCOL_MSG_METRICS,        ///< "metrics" report request
+    PROTOCOL_MSG_MEMPROF,        ///< "memprof" report request
+    PROTOCOL_MSG_CALIBRATION,    ///< "calibration" report request
+    PROTOCOL_MSG_COMMAND,        ///< datasend:<id>:<TYPE>:<value>[:seq=<n>], further fields are ignored
+    PROTOCOL_MSG_SYNCED,         ///< synced:<version>, the server applied the state message of that version
+    PROTOCOL_MSG_SNAPSHOT,       ///< "snapshot", the server asks for the full state table
+} protocol_message_t;
+
+typedef struct {
+    int device_id;
+    control_type_t control_type;                ///< CONTROL_TYPE_UNKNOWN for a type this firmware lacks
+    char value[PROTOCOL_VALUE_MAX + 1];         ///< NUL terminated
+    size_t value_len;
+    uint32_t seq;                               ///< Sequence number of the command, 0 if it has none
+    uint32_t version;                           ///< State version of a synced message
+} protocol_command_t;
+
+/**
+ * @brief Classify a message, commands and the version of a synced message are decoded into `command`
+ *
+ * A command needs a decimal device id that fits an int, a non-empty type and a non-empty value of
+ * at most PROTOCOL_VALUE_MAX bytes without NUL bytes. A fifth field starting with "seq=" has to
+ * carry a decimal sequence number from 1 to UINT32_MAX, any other fifth field is ignored. A synced
+ * message needs a decimal version from 1 to UINT32_MAX. The fixed messages have to match exactly.
+ */
+protocol_message_t protocol_parse(const char *message, size_t length, protocol_command_t *command);
+
+/**
+ * @brief Control type named by `name`, CONTROL_TYPE_UNKNOWN if none
+ */
+control_type_t protocol_control_type(const char *name, size_t length);
+
+/**
+ * @brief Recently seen sequence numbers, a command the server resends because its ack was late
+ * must not be executed twice
+ *
+ * A ring of the last PROTOCOL_DEDUP_WINDOW numbers of one session. smart_home starts it over
+ * when the connection is authenticated, so a server may number from 1 again on every connection.
+ * Within a session the server must not reuse a number within that many commands, and a command
+ * whose ack was lost to a disconnect may run again if it is resent on the next connection.
+ */
+typedef struct {
+    uint32_t ids[PROTOCOL_DEDUP_WINDOW];    ///< 0 for a free entry
+    size_t next;                            ///< Entry the next number replaces
+} protocol_dedup_t;
+
+void protocol_dedup_init(protocol_dedup_t *dedup);
+
+/**
+ * @brief true if `seq` is in the window, a duplicate, otherwise it is added
+ *
+ * Commands without a sequence number, `seq` 0, are never duplicates.
+ */
+bool protocol_dedup_check(protocol_dedup_t *dedup, uint32_t seq);
+
+/**
+ * @brief Remote procedure calls, carried in BINARY messages
+ *
+ * A request frame batches requests, the device answers all of them in one response frame:
+ *
+ *     frame    = type:u8 count:u8 entry*count      type PROTOCOL_RPC_REQUEST or _RESPONSE
+ *     request  = id:u16 method:u8 args_len:u16 args
+ *     response = id:u16 method:u8 status:u8 result_len:u16 result
+ *
+ * Multi-byte fields are little endian. Ids are chosen by the server to match the responses of
+ * requests in flight, the device copies them. A BINARY message that is not a well-formed request
+ * frame is handled like a TEXT one.
+ */
+#define PROTOCOL_RPC_REQUEST 0x01
+#define PROTOCOL_RPC_RESPONSE 0x02
+#define PROTOCOL_RPC_FRAME_HEADER 2
+#define PROTOCOL_RPC_REQUEST_HEADER 5
+#define PROTOCOL_RPC_RESPONSE_HEADER 6
+
+typedef struct {
+    uint16_t id;
+    uint8_t method;
+    const uint8_t *args;        ///< Points into the frame
+    size_t args_len;
+} protocol_rpc_request_t;
+
+/**
+ * @brief Number of requests of a request frame, 0 if it is malformed
+ *
+ * The frame has to be exactly its requests, none may be cut short or followed by extra bytes.
+ */
+int protocol_rpc_requests(const uint8_t *frame, size_t length);
+
+/**
+ * @brief Decode the request at `*offset` of a frame protocol_rpc_requests() accepted
+ *
+ * `*offset` starts at PROTOCOL_RPC_FRAME_HEADER and is advanced past the request.
+ *
+ * @return false at the end of the frame
+ */
+bool protocol_rpc_next(const uint8_t *frame, size_t length, size_t *offset, protocol_rpc_request_t *request);
+
+/**
+ * @brief Reassembly of a message the client delivers in several WEBSOCKET_EVENT_DATA events
+ *
+ * A message larger than the client buffer arrives in chunks at increasing payload_offset, one
+ * sent in fragments as a frame per fragment. The chunks are collected in a caller provided
+ * buffer, a message that does not fit is dropped as a whole rather than parsed truncated.
+ */
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t len;
+    bool active;        ///< a message has started and is not complete yet
+    bool overflow;      ///< the message in progress did not fit
+} protocol_assembler_t;
+
+void protocol_assembler_init(protocol_assembler_t *assembler, char *buffer, size_t size);
+
+/**
+ * @brief Add the data of one event, the fields are those of esp_websocket_event_data_t
+ *
+ * @param first  true for the first chunk of a message: a TEXT or BINARY frame at payload_offset 0
+ * @param fin    FIN flag of the frame
+ * @param length Set to the message length once complete
+ * @return The complete message, which is `data` itself if it came in one piece, NULL while
+ *         incomplete or if it was dropped
+ */
+const char *protocol_assemble(protocol_assembler_t *assembler, const char *data, int data_len,
+                              int payload_offset, int payload_len, bool first, bool fin, size_t *length);
+
+/**
+ * @brief true if the last completed message had to be dropped for its size
+ */
+bool protocol_assembler_overflowed(const protocol_assembler_t *assembler);
+
+#endif // PROTOCOL_H
@@ -4,17 +4,57 @@
 
 #include "smart_home.h"
 #include "control_types.h"
+#include "smart_home_priv.h"
+#include "protocol.h"
+#include "state_table.h"
 #include <esp_websocket_client.h>
 #include <stdbool.h>
-#include <driver/gpio.h>
 #include "esp_log.h"
 #include "string.h"
 #include "stdlib.h"
 #include <esp_err.h>
-#include <esp_http_server.h>
+#include <inttypes.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#if !CONFIG_IDF_TARGET_LINUX
+#include <esp_netif.h>
+#endif
+#include "latency/latency.h"
+#include "metrics/metrics.h"
+#include "dlog/dlog.h"
+#include "boot_timeline/boot_timeline.h"
+#include "power/power.h"
+#include "memprof/memprof.h"
+#include "calibration/calibration.h"
+#include "rpc/rpc.h"
+// Allocations of this file are attributed to smart_home with CONFIG_HOME_MEMPROF
+#define MEMPROF_TAG MEMPROF_TAG_SMART_HOME
+#include "memprof/memprof_wrap.h"
 
 static const char *TAG = "SMART_HOME";
 
+#define LATENCY_REPORT_SIZE 1024
+#define METRICS_REPORT_SIZE 1024
+#define MEMPROF_REPORT_SIZE 1024
+#define CALIBRATION_REPORT_SIZE 512
+#define RPC_RESPONSE_SIZE 2048      // answers a whole batch of requests
+#define STATE_MESSAGE_SIZE 768      // the full table of STATE_TABLE_MAX devices
+#define WS_TASK_STACK 4096
+#define WS_BUFFER_SIZE 1024
+#define RX_MESSAGE_SIZE 1024    // largest message reassembled from several events
+#define TX_MESSAGE_SIZE 64      // a bind or ack message
+#define TX_TASK_STACK 4096
+#define TX_TASK_PRIORITY 4
+
+// A message queued for the TX task
+typedef struct {
+    char message[TX_MESSAGE_SIZE];  // empty to stop the task
+    smart_home_sent_cb_t sent_cb;   // told the outcome of the send, may be NULL
+    void *sent_arg;
+} tx_item_t;
+
 // WebSocket client and associated data
 typedef struct {
     esp_websocket_client_handle_t client;
@@ -23,34 +63,20 @@ typedef struct {
     char *auth_token;
     bool is_authenticated;
     bool is_connected;
+    esp_event_handler_instance_t got_ip_instance;
+    protocol_assembler_t assembler;
+    char *rx_message;               // reassembly buffer of the assembler
+    bool rx_binary;                 // the message being received came in a BINARY frame
+    protocol_dedup_t dedup;         // sequence numbers of the last commands of this session
+    state_table_t state;            // values reported so far, resent as one message after a reconnect
+    SemaphoreHandle_t state_lock;   // bind callers and the WebSocket task share the table
+    QueueHandle_t tx_queue;         // NULL when sending from the calling task
+    TaskHandle_t tx_task;
+    SemaphoreHandle_t tx_stopped;   // given by the TX task before it exits
 } smart_home_context_t;
 
 static smart_home_context_t s_context = {0};
 
-// Function to convert control type to string
-static control_type_t string_to_control_type(const char *type_str) {
-    static const struct {
-        const char *str;
-        control_type_t type;
-    } type_map[] = {
-        {"SWITCH", CONTROL_TYPE_SWITCH},
-        {"SLIDER", CONTROL_TYPE_SLIDER},
-        {"RGB_PICKER", CONTROL_TYPE_RGB_PICKER},
-        {"BUTTON_GROUP", CONTROL_TYPE_BUTTON_GROUP},
-        {"NUMERIC_INPUT", CONTROL_TYPE_NUMERIC_INPUT},
-        {"TEXT_DISPLAY", CONTROL_TYPE_TEXT_DISPLAY},
-        {"DROPDOWN", CONTROL_TYPE_DROPDOWN},
-        {"SCHEDULE", CONTROL_TYPE_SCHEDULE},
-    };
-
-    for (int i = 0; i < sizeof(type_map) / sizeof(type_map[0]); i++) {
-        if (strcmp(type_str, type_map[i].str) == 0) {
-            return type_map[i].type;
-        }
-    }
-    return CONTROL_TYPE_UNKNOWN;
-}
-
 // Log error code if non-zero
 static void log_error_if_nonzero(const char *message, int error_code) {
     if (error_code != 0) {
@@ -58,75 +84,207 @@ static void log_error_if_nonzero(const char *message, int error_code) {
     }
 }
 
-// Parse WebSocket messages
-static bool parse_websocket_message(const char *message, size_t length) {
-    if (message == NULL || length == 0) {
-        return false;
+// Reply to a "latency" request with the probe statistics
+static void send_latency_report(void) {
+    char *report = malloc(LATENCY_REPORT_SIZE);
+    if (!report) {
+        ESP_LOGE(TAG, "Memory allocation error");
+        return;
     }
+    int len = snprintf(report, LATENCY_REPORT_SIZE, "latency:");
+    latency_format_json(report + len, LATENCY_REPORT_SIZE - len);
+    esp_websocket_client_send_text(s_context.client, report, strlen(report), portMAX_DELAY);
+    free(report);
+}
 
-    // Check for successful connection message
-    if (strncmp(message, "Successfully connected", length) == 0) {
-        ESP_LOGI(TAG, "Connection successfully authenticated!");
-        s_context.is_authenticated = true;
-        return true;
+// Reply to a "metrics" request with a snapshot of the registry
+static void send_metrics_report(void) {
+    char *report = malloc(METRICS_REPORT_SIZE);
+    if (!report) {
+        ESP_LOGE(TAG, "Memory allocation error");
+        return;
     }
+    metrics_sample_system(METRIC_WS_STACK_FREE);
+    int len = snprintf(report, METRICS_REPORT_SIZE, "metrics:");
+    metrics_format(report + len, METRICS_REPORT_SIZE - len);
+    esp_websocket_client_send_text(s_context.client, report, strlen(report), portMAX_DELAY);
+    free(report);
+}
 
-    // Check for "datasend:" prefix
-    const char *prefix = "datasend:";
-    size_t prefix_len = strlen(prefix);
-    if (strncmp(message, prefix, prefix_len) != 0) {
-        return false;
+// Reply to a "memprof" request with the heap usage per subsystem and the stack high water marks
+static void send_memprof_report(void) {
+    char *report = malloc(MEMPROF_REPORT_SIZE);
+    if (!report) {
+        ESP_LOGE(TAG, "Memory allocation error");
+        return;
     }
+    int len = snprintf(report, MEMPROF_REPORT_SIZE, "memprof:");
+    memprof_format(report + len, MEMPROF_REPORT_SIZE - len);
+    esp_websocket_client_send_text(s_context.client, report, strlen(report), portMAX_DELAY);
+    free(report);
+}
 
-    // Create a safe copy of the message (for strtok_r usage)
-    char *msg_copy = malloc(length + 1);
-    if (!msg_copy) {
+// Reply to a "calibration" request with the measured and recommended stack and buffer sizes
+static void send_calibration_report(void) {
+    char *report = malloc(CALIBRATION_REPORT_SIZE);
+    if (!report) {
         ESP_LOGE(TAG, "Memory allocation error");
-        return false;
+        return;
     }
+    int len = snprintf(report, CALIBRATION_REPORT_SIZE, "calibration:");
+    calibration_format(report + len, CALIBRATION_REPORT_SIZE - len);
+    esp_websocket_client_send_text(s_context.client, report, strlen(report), portMAX_DELAY);
+    free(report);
+}
 
-    memcpy(msg_copy, message, length);
-    msg_copy[length] = '\0';
-
-    bool success = false;
-    char *token;
-    char *rest = msg_copy;
-
-    // Skip "datasend:" part
-    token = strtok_r(rest, ":", &rest);
-    if (!token || strcmp(token, "datasend") != 0) {
-        goto cleanup;
+// Answer an RPC request frame, every request of the batch in one response frame
+static bool handle_rpc(const uint8_t *frame, size_t length) {
+    uint8_t *response = malloc(RPC_RESPONSE_SIZE);
+    if (!response) {
+        return false;
     }
-
-    // Get device ID
-    token = strtok_r(NULL, ":", &rest);
-    if (!token) {
-        goto cleanup;
+    size_t len = rpc_process(frame, length, response, RPC_RESPONSE_SIZE);
+    if (len > 0) {
+        int64_t write_start_us = latency_now();
+        int sent = esp_websocket_client_send_bin(s_context.client, (const char *)response, len, portMAX_DELAY);
+        latency_record(LATENCY_STAGE_SOCKET_WRITE, write_start_us);
+        calibration_observe_tx(len);
+        if (sent < 0) {
+            metrics_inc(METRIC_SEND_FAILURES);
+        } else {
+            metrics_inc(METRIC_MESSAGES_OUT);
+        }
     }
-    int device_id = atoi(token);
+    free(response);
+    return len > 0;
+}
 
-    // Get control type
-    token = strtok_r(NULL, ":", &rest);
-    if (!token) {
-        goto cleanup;
+// RPC method returning one of the text reports, ctx is its format function
+typedef struct {
+    uint8_t method;
+    const char *name;
+    int (*format)(char *buffer, size_t len);
+} report_method_t;
+
+static const report_method_t s_report_methods[] = {
+    { RPC_METHOD_METRICS, "metrics", metrics_format },
+    { RPC_METHOD_LATENCY, "latency", latency_format_json },
+    { RPC_METHOD_MEMPROF, "memprof", memprof_format },
+    { RPC_METHOD_CALIBRATION, "calibration", calibration_format },
+};
+
+static esp_err_t report_handler(const uint8_t *args, size_t args_len, uint8_t *result,
+                                size_t result_size, size_t *result_len, void *ctx) {
+    const report_method_t *report = ctx;
+    int len = report->format((char *)result, result_size);
+    if (len < 0 || (size_t)len >= result_size) {
+        return ESP_ERR_INVALID_SIZE;
     }
-    control_type_t control_type = string_to_control_type(token);
+    *result_len = len;
+    return ESP_OK;
+}
 
-    // Get value
-    token = strtok_r(NULL, ":", &rest);
-    if (!token) {
-        goto cleanup;
+static void register_rpc_methods(void) {
+    for (size_t i = 0; i < sizeof(s_report_methods) / sizeof(s_report_methods[0]); i++) {
+        const report_method_t *report = &s_report_methods[i];
+        esp_err_t err = rpc_register(report->method, report->name, report_handler, (void *)report);
+        // already registered by an earlier init
+        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+            ESP_LOGW(TAG, "Failed to register the %s RPC method: %s", report->name, esp_err_to_name(err));
+        }
     }
+}
 
-    // Call callback function
-    if (s_context.callback) {
-        s_context.callback(device_id, control_type, token, s_context.client, s_context.user_context);
-        success = true;
+static esp_err_t send_ack(uint32_t seq);
+static esp_err_t send_message(const char *message);
+
+// Send the values changed since the version the server confirmed last, all of them if `full`.
+// A delta is skipped when the server confirmed every change, a server which lost the table asks
+// for it with `snapshot`.
+static void send_state(bool full) {
+    char *message = malloc(STATE_MESSAGE_SIZE);
+    if (!message) {
+        return;
+    }
+    xSemaphoreTake(s_context.state_lock, portMAX_DELAY);
+    if (!full && s_context.state.version == s_context.state.acked) {
+        xSemaphoreGive(s_context.state_lock);
+        free(message);
+        return;
     }
+    int len = state_table_format(&s_context.state, full ? 0 : s_context.state.acked, message, STATE_MESSAGE_SIZE);
+    xSemaphoreGive(s_context.state_lock);
+    if (len >= STATE_MESSAGE_SIZE) {
+        ESP_LOGW(TAG, "State message longer than %d bytes not sent", STATE_MESSAGE_SIZE);
+    } else if (send_message(message) == ESP_OK) {
+        metrics_inc(METRIC_STATE_SYNCS);
+    }
+    free(message);
+}
 
-cleanup:
-    free(msg_copy);
-    return success;
+// Parse WebSocket messages, start_us is the time the event handler was entered
+bool smart_home_parse_message(const char *message, size_t length, int64_t start_us) {
+    protocol_command_t command;
+
+    switch (protocol_parse(message, length, &command)) {
+        case PROTOCOL_MSG_LATENCY:
+            send_latency_report();
+            return true;
+
+        case PROTOCOL_MSG_METRICS:
+            send_metrics_report();
+            return true;
+
+        case PROTOCOL_MSG_MEMPROF:
+            send_memprof_report();
+            return true;
+
+        case PROTOCOL_MSG_CALIBRATION:
+            send_calibration_report();
+            return true;
+
+        case PROTOCOL_MSG_AUTHENTICATED:
+            ESP_LOGI(TAG, "Connection successfully authenticated!");
+            s_context.is_authenticated = true;
+            boot_timeline_mark("ws_authenticated");
+            // Sequence numbers are scoped to a session, a restarted server numbers from 1 again
+            protocol_dedup_init(&s_context.dedup);
+            // One message resynchronises every device, however many there are
+            send_state(false);
+            return true;
+
+        case PROTOCOL_MSG_SNAPSHOT:
+            send_state(true);
+            return true;
+
+        case PROTOCOL_MSG_SYNCED:
+            xSemaphoreTake(s_context.state_lock, portMAX_DELAY);
+            state_table_acked(&s_context.state, command.version);
+            xSemaphoreGive(s_context.state_lock);
+            return true;
+
+        case PROTOCOL_MSG_COMMAND:
+            if (!s_context.callback) {
+                return false;
+            }
+            // A command resent after the link flapped is acknowledged again but not executed
+            if (protocol_dedup_check(&s_context.dedup, command.seq)) {
+                metrics_inc(METRIC_DUPLICATE_COMMANDS);
+                send_ack(command.seq);
+                return true;
+            }
+            int64_t parsed_us = latency_record(LATENCY_STAGE_PARSE, start_us);
+            s_context.callback(command.device_id, command.control_type, command.value,
+                               s_context.client, s_context.user_context);
+            latency_record(LATENCY_STAGE_CALLBACK, parsed_us);
+            if (command.seq) {
+                send_ack(command.seq);
+            }
+            return true;
+
+        default:
+            return false;
+    }
 }
 
 // WebSocket event handler
@@ -138,20 +296,24 @@ static void websocket_event_handler(void *handler_args, esp_event_base_t base,
         case WEBSOCKET_EVENT_CONNECTED:
             ESP_LOGI(TAG, "WebSocket connection established");
             s_context.is_connected = true;
+            boot_timeline_mark("ws_connected");
+            metrics_inc(METRIC_CONNECTS);
+            metrics_sample_system(METRIC_WS_STACK_FREE);
 
             // Send token
             if (s_context.auth_token && strlen(s_context.auth_token) > 0) {
                 vTaskDelay(pdMS_TO_TICKS(1000)); // Short delay for connection stability
 
-                esp_err_t err = esp_websocket_client_send_bin(
+                int sent = esp_websocket_client_send_bin(
                     s_context.client,
                     s_context.auth_token,
                     strlen(s_context.auth_token),
                     portMAX_DELAY
                 );
 
-                if (err != ESP_OK) {
-                    ESP_LOGE(TAG, "Token sending error: %s", esp_err_to_name(err));
+                calibration_observe_tx(strlen(s_context.auth_token));
+                if (sent < 0) {
+                    ESP_LOGE(TAG, "Token sending error: %d", sent);
                 } else {
                     ESP_LOGI(TAG, "Authentication token sent, waiting for validation...");
                 }
@@ -161,6 +323,7 @@ static void websocket_event_handler(void *handler_args, esp_event_base_t base,
         case WEBSOCKET_EVENT_DISCONNECTED:
             ESP_LOGI(TAG, "WebSocket connection lost");
             s_context.is_connected = false;
+            metrics_inc(METRIC_DISCONNECTS);
             s_context.is_authenticated = false;
 
             log_error_if_nonzero("HTTP status code", data->error_handle.esp_ws_handshake_status_code);
@@ -173,14 +336,51 @@ static void websocket_event_handler(void *handler_args, esp_event_base_t base,
             break;
 
         case WEBSOCKET_EVENT_DATA:
-            if (data && data->data_ptr && data->data_len > 0) {
-                ESP_LOGI(TAG, "Message received from server: %.*s", data->data_len, (char *)data->data_ptr);
+            // PING/PONG payloads are handled by the client
+            if (!data || data->op_code >= WS_TRANSPORT_OPCODES_CLOSE) {
+                break;
+            }
+            if (data->data_len > 0 || data->payload_len > 0) {
+                // Messages larger than the client buffer and fragmented ones come in several events
+                size_t length;
+                bool first = data->op_code != WS_TRANSPORT_OPCODES_CONT && data->payload_offset == 0;
+                if (first) {
+                    s_context.rx_binary = data->op_code == WS_TRANSPORT_OPCODES_BINARY;
+                }
+                const char *message = protocol_assemble(&s_context.assembler, data->data_ptr, data->data_len,
+                                                        data->payload_offset, data->payload_len, first, data->fin, &length);
+                calibration_observe_rx(data->payload_len, message ? length : 0);
+                if (!message) {
+                    if (protocol_assembler_overflowed(&s_context.assembler) && !s_context.assembler.active) {
+                        metrics_inc(METRIC_PARSE_FAILURES);
+                        ESP_LOGW(TAG, "Message larger than %d bytes dropped", (int)s_context.assembler.size);
+                    }
+                    break;
+                }
 
-                if (parse_websocket_message((char *)data->data_ptr, data->data_len)) {
-                    ESP_LOGI(TAG, "Message processed successfully");
+                int64_t start_us = latency_now();
+                latency_record_us(LATENCY_STAGE_TRANSPORT_READ, data->read_duration_us);
+                latency_record_us(LATENCY_STAGE_DISPATCH, start_us - data->read_time_us);
+                latency_command_begin(data->read_time_us);
+                metrics_inc(METRIC_MESSAGES_IN);
+                power_note_radio_traffic();
+                metrics_observe(METRIC_MESSAGE_IN_BYTES, length);
+
+                bool processed;
+                // Only well-formed request frames are RPC, any other BINARY frame is parsed as before
+                if (s_context.rx_binary && protocol_rpc_requests((const uint8_t *)message, length) > 0) {
+                    processed = handle_rpc((const uint8_t *)message, length);
                 } else {
-                    ESP_LOGW(TAG, "Message could not be processed or unsupported format");
+                    DLOGI_STR(TAG, "Message received from server: %.*s", message, length);
+                    processed = smart_home_parse_message(message, length, start_us);
                 }
+                if (processed) {
+                    DLOGI(TAG, "Message processed successfully");
+                } else {
+                    metrics_inc(METRIC_PARSE_FAILURES);
+                    DLOGW(TAG, "Message could not be processed or unsupported format");
+                }
+                metrics_observe(METRIC_HANDLE_US, latency_now() - start_us);
             }
             break;
 
@@ -198,13 +398,128 @@ static void websocket_event_handler(void *handler_args, esp_event_base_t base,
         default:
             break;
     }
+    calibration_sample_stack(CALIBRATION_TASK_WEBSOCKET);
+}
+
+#if !CONFIG_IDF_TARGET_LINUX
+// Retry right away when WiFi is back instead of waiting out the reconnect backoff
+static void got_ip_event_handler(void *handler_args, esp_event_base_t base,
+                                 int32_t event_id, void *event_data) {
+    if (s_context.client && !s_context.is_connected) {
+        ESP_LOGI(TAG, "Got IP, reconnecting WebSocket immediately");
+        esp_websocket_client_reconnect_now(s_context.client);
+    }
+}
+#endif
+
+static void unregister_got_ip(void) {
+#if !CONFIG_IDF_TARGET_LINUX
+    if (s_context.got_ip_instance) {
+        esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, s_context.got_ip_instance);
+        s_context.got_ip_instance = NULL;
+    }
+#endif
+}
+
+// Free the token copy, the receive buffer and the state lock
+static void free_buffers(void) {
+    free(s_context.auth_token);
+    s_context.auth_token = NULL;
+    free(s_context.rx_message);
+    s_context.rx_message = NULL;
+    if (s_context.state_lock) {
+        vSemaphoreDelete(s_context.state_lock);
+        s_context.state_lock = NULL;
+    }
+}
+
+// General helper function to send messages
+static esp_err_t send_message(const char *message) {
+    if (!s_context.client || !s_context.is_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t write_start_us = latency_now();
+    // Returns the number of bytes sent, negative on failure
+    int sent = esp_websocket_client_send_bin(
+        s_context.client,
+        message,
+        strlen(message),
+        portMAX_DELAY
+    );
+    latency_record(LATENCY_STAGE_SOCKET_WRITE, write_start_us);
+    power_note_radio_traffic();
+    calibration_observe_tx(strlen(message));
+
+    if (sent < 0) {
+        metrics_inc(METRIC_SEND_FAILURES);
+        ESP_LOGE(TAG, "Message sending error: %d", sent);
+        return ESP_FAIL;
+    }
+    metrics_inc(METRIC_MESSAGES_OUT);
+    DLOGI_STR(TAG, "Message sent: %.*s", message, strlen(message));
+    return ESP_OK;
+}
+
+// Sends the queued messages, their senders do not wait for the socket
+static void tx_task(void *arg) {
+    tx_item_t item;
+    while (xQueueReceive(s_context.tx_queue, &item, portMAX_DELAY) == pdTRUE && item.message[0]) {
+        esp_err_t err = send_message(item.message);
+        if (err == ESP_ERR_INVALID_STATE) {
+            // disconnected after it was queued
+            metrics_inc(METRIC_SEND_FAILURES);
+        }
+        if (item.sent_cb) {
+            item.sent_cb(err, item.sent_arg);
+        }
+        calibration_sample_stack(CALIBRATION_TASK_TX);
+    }
+    xSemaphoreGive(s_context.tx_stopped);
+    vTaskDelete(NULL);
+}
+
+// Stops the TX task after the messages queued before, then frees the queue
+static void stop_tx_task(void) {
+    if (s_context.tx_task) {
+        const tx_item_t stop = { .message = "" };
+        xQueueSend(s_context.tx_queue, &stop, portMAX_DELAY);
+        xSemaphoreTake(s_context.tx_stopped, portMAX_DELAY);
+        s_context.tx_task = NULL;
+    }
+    if (s_context.tx_queue) {
+        vQueueDelete(s_context.tx_queue);
+        s_context.tx_queue = NULL;
+    }
+    if (s_context.tx_stopped) {
+        vSemaphoreDelete(s_context.tx_stopped);
+        s_context.tx_stopped = NULL;
+    }
+}
+
+static esp_err_t start_tx_task(const smart_home_config_t *config) {
+    int stack = config->tx_task_stack > 0 ? config->tx_task_stack : TX_TASK_STACK;
+    calibration_set_stack(CALIBRATION_TASK_TX, stack);
+    s_context.tx_queue = xQueueCreate(config->tx_queue_len, sizeof(tx_item_t));
+    s_context.tx_stopped = xSemaphoreCreateBinary();
+    if (!s_context.tx_queue || !s_context.tx_stopped ||
+        xTaskCreatePinnedToCore(tx_task, "smart_home_tx", stack, NULL,
+                                config->tx_task_prio > 0 ? config->tx_task_prio : TX_TASK_PRIORITY,
+                                &s_context.tx_task,
+                                config->tx_task_core >= 0 ? config->tx_task_core : tskNO_AFFINITY) != pdPASS) {
+        s_context.tx_task = NULL;
+        stop_tx_task();
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
 }
 
 // Initialize the smart home system
 esp_err_t smart_home_init(const smart_home_config_t *config,
                           message_callback_t callback,
                           void *user_context) {
-    if (!config || !config->websocket_uri) {
+    if (!config || !config->websocket_uri ||
+        config->task_core >= portNUM_PROCESSORS || config->tx_task_core >= portNUM_PROCESSORS) {
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -217,11 +532,30 @@ esp_err_t smart_home_init(const smart_home_config_t *config,
     // Clear context
     memset(&s_context, 0, sizeof(s_context));
 
+    // Messages larger than the client buffer are reassembled here
+    size_t rx_message_size = config->rx_message_size > 0 ? config->rx_message_size : RX_MESSAGE_SIZE;
+    s_context.rx_message = malloc(rx_message_size);
+    if (!s_context.rx_message) {
+        ESP_LOGE(TAG, "Memory allocation failed for the receive buffer");
+        return ESP_ERR_NO_MEM;
+    }
+    protocol_assembler_init(&s_context.assembler, s_context.rx_message, rx_message_size);
+    protocol_dedup_init(&s_context.dedup);
+    state_table_init(&s_context.state);
+    s_context.state_lock = xSemaphoreCreateMutex();
+    if (!s_context.state_lock) {
+        ESP_LOGE(TAG, "Memory allocation failed for the state lock");
+        free_buffers();
+        return ESP_ERR_NO_MEM;
+    }
+    register_rpc_methods();
+
     // Create token copy
     if (config->auth_token && strlen(config->auth_token) > 0) {
         s_context.auth_token = strdup(config->auth_token);
         if (!s_context.auth_token) {
             ESP_LOGE(TAG, "Memory allocation failed for token");
+            free_buffers();
             return ESP_ERR_NO_MEM;
         }
     }
@@ -231,16 +565,40 @@ esp_err_t smart_home_init(const smart_home_config_t *config,
         .uri = config->websocket_uri,
         .reconnect_timeout_ms = config->reconnect_timeout_ms > 0 ?
                                config->reconnect_timeout_ms : 10000,
+        .reconnect_backoff_max_ms = config->reconnect_backoff_max_ms,
+        .reconnect_backoff_jitter = true,
+        // Pings less often while the link is healthy, the device is mostly idle
+        .ping_adaptive_enable = true,
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        // Skips the full TLS handshake on reconnect, only applies to wss:// URIs
+        .tls_session_resumption = true,
+#endif
         .disable_auto_reconnect = !config->auto_reconnect,
+        .task_prio = config->task_prio,
+        .task_stack = config->task_stack > 0 ? config->task_stack : WS_TASK_STACK,
+        .buffer_size = config->buffer_size > 0 ? config->buffer_size : WS_BUFFER_SIZE,
+        .task_pinned = config->task_core >= 0,
+        .task_core_id = config->task_core,
     };
 
     s_context.client = esp_websocket_client_init(&ws_cfg);
     if (!s_context.client) {
         ESP_LOGE(TAG, "WebSocket client initialization failed");
-        free(s_context.auth_token);
-        s_context.auth_token = NULL;
+        free_buffers();
         return ESP_FAIL;
     }
+    calibration_set_stack(CALIBRATION_TASK_WEBSOCKET, ws_cfg.task_stack);
+
+    if (config->tx_queue_len > 0) {
+        esp_err_t err = start_tx_task(config);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start the TX task: %s", esp_err_to_name(err));
+            esp_websocket_client_destroy(s_context.client);
+            s_context.client = NULL;
+            free_buffers();
+            return err;
+        }
+    }
 
     // Register callback and user context
     s_context.callback = callback;
@@ -256,21 +614,36 @@ esp_err_t smart_home_init(const smart_home_config_t *config,
 
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to register WebSocket events: %s", esp_err_to_name(err));
+        stop_tx_task();
         esp_websocket_client_destroy(s_context.client);
-        free(s_context.auth_token);
         s_context.client = NULL;
-        s_context.auth_token = NULL;
+        free_buffers();
         return err;
     }
 
+#if !CONFIG_IDF_TARGET_LINUX
+    // The host network of the linux target never goes away, there is no IP event
+    if (config->auto_reconnect) {
+        err = esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP,
+                                                  got_ip_event_handler, NULL,
+                                                  &s_context.got_ip_instance);
+        if (err != ESP_OK) {
+            // Not fatal, reconnecting just waits for the backoff
+            ESP_LOGW(TAG, "Failed to register IP event handler: %s", esp_err_to_name(err));
+            s_context.got_ip_instance = NULL;
+        }
+    }
+#endif
+
     // Start WebSocket client
     err = esp_websocket_client_start(s_context.client);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start WebSocket client: %s", esp_err_to_name(err));
+        unregister_got_ip();
+        stop_tx_task();
         esp_websocket_client_destroy(s_context.client);
-        free(s_context.auth_token);
         s_context.client = NULL;
-        s_context.auth_token = NULL;
+        free_buffers();
         return err;
     }
 
@@ -278,39 +651,89 @@ esp_err_t smart_home_init(const smart_home_config_t *config,
     return ESP_OK;
 }
 
-// General helper function to send messages
-static esp_err_t send_message(const char *message) {
-    if (!s_context.client || !s_context.is_connected) {
-        return ESP_ERR_INVALID_STATE;
+// Hand a message to the TX task, or send it from the calling task without one
+static esp_err_t submit_message(const tx_item_t *item, int64_t start_us) {
+    if (!s_context.tx_queue) {
+        latency_record(LATENCY_STAGE_SEND_ENQUEUE, start_us);
+        esp_err_t err = send_message(item->message);
+        if (err == ESP_OK && item->sent_cb) {
+            item->sent_cb(err, item->sent_arg);
+        }
+        return err;
     }
 
-    esp_err_t err = esp_websocket_client_send_bin(
-        s_context.client,
-        message,
-        strlen(message),
-        portMAX_DELAY
-    );
-
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Message sending error: %s", esp_err_to_name(err));
-    } else {
-        ESP_LOGI(TAG, "Message sent: %s", message);
+    // Queued only while connected, so callers retry as they would after a failed send
+    if (!s_context.is_connected) {
+        return ESP_ERR_INVALID_STATE;
     }
-
-    return err;
+    if (xQueueSend(s_context.tx_queue, item, 0) != pdTRUE) {
+        metrics_inc(METRIC_TX_QUEUE_FULL);
+        return ESP_ERR_TIMEOUT;
+    }
+    latency_record(LATENCY_STAGE_SEND_ENQUEUE, start_us);
+    return ESP_OK;
 }
 
+int smart_home_format_bind(char *buffer, size_t len, int device_id, const char *bind_value) {
+    return snprintf(buffer, len, "bind:%d:%s", device_id, bind_value);
+}
 
+// Record a device value for the resync after a reconnect, without sending it
+esp_err_t smart_home_set_state(int device_id, const char *value) {
+    if (!value) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_context.state_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_context.state_lock, portMAX_DELAY);
+    bool stored = state_table_set(&s_context.state, device_id, value);
+    xSemaphoreGive(s_context.state_lock);
+    return stored ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
 
 // Bind device to server
 esp_err_t smart_home_bind_device(int device_id, const char *bind_value) {
+    return smart_home_bind_device_notify(device_id, bind_value, NULL, NULL);
+}
+
+esp_err_t smart_home_bind_device_notify(int device_id, const char *bind_value,
+                                        smart_home_sent_cb_t sent_cb, void *sent_arg) {
     if (!bind_value) {
         return ESP_ERR_INVALID_ARG;
     }
+    // Kept even when the send fails, the state message after the reconnect carries it
+    if (smart_home_set_state(device_id, bind_value) == ESP_ERR_INVALID_SIZE) {
+        DLOGW(TAG, "Device %d not kept in the state table", device_id);
+    }
+
+    int64_t start_us = latency_now();
+    tx_item_t item = { .sent_cb = sent_cb, .sent_arg = sent_arg };
+    smart_home_format_bind(item.message, sizeof(item.message), device_id, bind_value);
+    return submit_message(&item, start_us);
+}
+
+// Acknowledge a numbered command, the server may then send the next without waiting for the echo
+static esp_err_t send_ack(uint32_t seq) {
+    int64_t start_us = latency_now();
+    tx_item_t item = { 0 };
+    snprintf(item.message, sizeof(item.message), "ack:%" PRIu32, seq);
+    return submit_message(&item, start_us);
+}
+
+// Pause the WebSocket while WiFi is down, resume without backoff once it is back
+esp_err_t smart_home_set_network_available(bool available) {
+    if (!s_context.client) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    char bind_message[64];
-    snprintf(bind_message, sizeof(bind_message), "bind:%d:%s", device_id, bind_value);
-    return send_message(bind_message);
+    bool paused = esp_websocket_client_is_paused(s_context.client);
+    if (available == !paused) {
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "%s", available ? "Network is back, resuming WebSocket" : "Network lost, pausing WebSocket");
+    return available ? esp_websocket_client_resume(s_context.client) :
+                       esp_websocket_client_pause(s_context.client);
 }
 
 // Deinitialize smart home system
@@ -319,16 +742,19 @@ esp_err_t smart_home_deinit(void) {
         return ESP_ERR_INVALID_STATE;
     }
 
+    unregister_got_ip();
+
     esp_err_t err = esp_websocket_client_stop(s_context.client);
     if (err != ESP_OK) {
         ESP_LOGW(TAG, "WebSocket client stop failed: %s", esp_err_to_name(err));
     }
+    // Whatever is still queued fails fast now that the client is stopped
+    stop_tx_task();
 
     esp_websocket_client_destroy(s_context.client);
-    free(s_context.auth_token);
+    free_buffers();
 
     s_context.client = NULL;
-    s_context.auth_token = NULL;
     s_context.callback = NULL;
     s_context.user_context = NULL;
     s_context.is_connected = false;
@@ -17,12 +17,28 @@ typedef struct {
     const char *websocket_uri;   // WebSocket server address
     const char *auth_token;      // Authentication token
     bool auto_reconnect;         // Automatic reconnection when the connection is lost
-    int reconnect_timeout_ms;    // Reconnection wait time
+    int reconnect_timeout_ms;    // Reconnection wait time, 10000 if 0. With a backoff maximum it is the initial wait
+                                 // and doubled after every failed attempt, without one every attempt waits this long.
+                                 // The actual wait is drawn at random between 0 and the current value
+    int reconnect_backoff_max_ms; // Upper bound of the doubled reconnection wait time, 0 disables the doubling
+    int task_core;               // Core the WebSocket task is pinned to, -1 lets it run on either core
+    int task_prio;               // Priority of the WebSocket task, 0 keeps the client default of 5
+    int task_stack;              // Stack of the WebSocket task in bytes, 4096 if 0
+    int buffer_size;             // Frames are received and sent in chunks of this size, 1024 if 0
+    int rx_message_size;         // Largest message reassembled from chunks, longer ones are dropped, 1024 if 0
+    int tx_queue_len;            // Messages queued for the TX task, 0 sends from the calling task instead
+    int tx_task_core;            // Core the TX task is pinned to, -1 lets it run on either core
+    int tx_task_prio;            // Priority of the TX task, 4 if 0
+    int tx_task_stack;           // Stack of the TX task in bytes, 4096 if 0
 } smart_home_config_t;
 
 /**
  * @brief Callback type called when a message is received from the server
  *
+ * A command the server numbered with a sequence field is acknowledged with `ack:<seq>` once the
+ * callback returns. The same command resent within the dedup window of the connection is
+ * acknowledged again without calling the callback, the window starts over on every connection.
+ *
  * @param device_id Device ID
  * @param control_type Control type
  * @param value Control value
@@ -48,12 +64,70 @@ esp_err_t smart_home_init(const smart_home_config_t *config,
 /**
  * @brief Send bind command for a specific device
  *
+ * With a TX task the message is only queued, so the caller does not wait for the socket.
+ * ESP_OK then means it was queued while connected, a later send failure is counted in the
+ * send_fail metric. Use smart_home_bind_device_notify() to learn the outcome.
+ *
  * @param device_id Device ID
  * @param bind_value Binding value
- * @return esp_err_t Success status
+ * @return esp_err_t Success status, ESP_ERR_INVALID_STATE while not connected and
+ *         ESP_ERR_TIMEOUT if the TX queue is full
  */
 esp_err_t smart_home_bind_device(int device_id, const char *bind_value);
 
+/**
+ * @brief Outcome of a send handed to smart_home_bind_device_notify()
+ *
+ * Called from the TX task once the message was written to the socket or failed, or from the
+ * caller before smart_home_bind_device_notify() returns when there is no TX task.
+ *
+ * @param result ESP_OK if the message was written, ESP_ERR_INVALID_STATE if the connection was
+ *               lost while it was queued, ESP_FAIL if writing it failed
+ * @param arg The argument given with the send
+ */
+typedef void (*smart_home_sent_cb_t)(esp_err_t result, void *arg);
+
+/**
+ * @brief Send bind command for a specific device and learn whether it was written
+ *
+ * Like smart_home_bind_device(), `sent_cb` is called exactly once if ESP_OK is returned and
+ * never otherwise, the caller then already knows the send failed. It must not block.
+ *
+ * @param device_id Device ID
+ * @param bind_value Binding value
+ * @param sent_cb Called with the outcome, may be NULL
+ * @param sent_arg Passed to sent_cb
+ * @return esp_err_t As smart_home_bind_device()
+ */
+esp_err_t smart_home_bind_device_notify(int device_id, const char *bind_value,
+                                        smart_home_sent_cb_t sent_cb, void *sent_arg);
+
+/**
+ * @brief Record the value of a device without sending it
+ *
+ * smart_home_bind_device() records the values it sends as well. Once authenticated after a
+ * (re)connect, the device sends the values changed since the version the server confirmed last
+ * in one `state:<version>:<base>:<id>=<value>,...` message instead of a bind per device, and
+ * nothing if there are none, see state_table.h. The table holds STATE_TABLE_MAX devices.
+ *
+ * @param device_id Device ID
+ * @param value Value of the device, at most STATE_VALUE_MAX bytes without ','
+ * @return esp_err_t ESP_ERR_INVALID_STATE before smart_home_init(), ESP_ERR_INVALID_SIZE if the
+ *         value does not fit or the table is full
+ */
+esp_err_t smart_home_set_state(int device_id, const char *value);
+
+/**
+ * @brief Tell the Smart Home system whether the network is usable
+ *
+ * While unavailable the WebSocket connection is dropped right away instead of waiting for
+ * the PING timeout, and no reconnect is attempted. It reconnects as soon as the network is back.
+ *
+ * @param available Whether the station has a link and an IP address
+ * @return esp_err_t Success status
+ */
+esp_err_t smart_home_set_network_available(bool available);
+
 /**
  * @brief Stop and clean up the Smart Home system WebSocket client
  *
@@ -0,0 +1,27 @@
+/**
+ * @file smart_home_priv.h
+ * @brief Internal entry points of smart_home, shared with the benchmarks in host_test/benchmark
+ */
+#ifndef SMART_HOME_PRIV_H
+#define SMART_HOME_PRIV_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Handle one message from the server, as the WebSocket event handler does
+ *
+ * @param start_us Time the event handler was entered, the parse and callback latency start there
+ * @return true if the message was understood and handled
+ */
+bool smart_home_parse_message(const char *message, size_t length, int64_t start_us);
+
+/**
+ * @brief Format the bind message reporting a device value
+ *
+ * @return Length of the message, as snprintf
+ */
+int smart_home_format_bind(char *buffer, size_t len, int device_id, const char *bind_value);
+
+#endif // SMART_HOME_PRIV_H
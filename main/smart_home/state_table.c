@@ -0,0 +1,73 @@
+/**
+ * @file state_table.c
+ * @brief Versioned table of the device values reported to the server
+ */
+#include "state_table.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "util/format.h"
+
+void state_table_init(state_table_t *table)
+{
+    memset(table, 0, sizeof(*table));
+}
+
+static state_entry_t *find(state_table_t *table, int device_id)
+{
+    for (size_t i = 0; i < table->count; i++) {
+        if (table->entries[i].device_id == device_id) {
+            return &table->entries[i];
+        }
+    }
+    return NULL;
+}
+
+bool state_table_set(state_table_t *table, int device_id, const char *value)
+{
+    size_t len = strlen(value);
+    if (len > STATE_VALUE_MAX || memchr(value, ',', len)) {
+        return false;
+    }
+    state_entry_t *entry = find(table, device_id);
+    if (!entry) {
+        if (table->count == STATE_TABLE_MAX) {
+            return false;
+        }
+        entry = &table->entries[table->count++];
+        entry->device_id = device_id;
+    } else if (strcmp(entry->value, value) == 0) {
+        return true;
+    }
+    memcpy(entry->value, value, len + 1);
+    entry->version = ++table->version;
+    return true;
+}
+
+int state_table_format(const state_table_t *table, uint32_t base, char *buffer, size_t len)
+{
+    if (base > table->version) {
+        base = 0;
+    }
+    int written = 0;
+    if (len > 0) {
+        buffer[0] = '\0';
+    }
+    format_append(buffer, len, &written, "state:%" PRIu32 ":%" PRIu32 ":", table->version, base);
+    bool first = true;
+    for (size_t i = 0; i < table->count; i++) {
+        const state_entry_t *entry = &table->entries[i];
+        if (entry->version > base) {
+            format_append(buffer, len, &written, "%s%d=%s", first ? "" : ",", entry->device_id, entry->value);
+            first = false;
+        }
+    }
+    return written;
+}
+
+void state_table_acked(state_table_t *table, uint32_t version)
+{
+    if (version <= table->version && version > table->acked) {
+        table->acked = version;
+    }
+}
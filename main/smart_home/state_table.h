@@ -0,0 +1,64 @@
+/**
+ * @file state_table.h
+ * @brief Versioned table of the device values reported to the server, free of ESP-IDF
+ *
+ * Every change of a value bumps the table version and stamps the entry with it. After a
+ * reconnect the device sends one `state:` message with the entries changed since the version
+ * the server confirmed last, or all of them if it never confirmed one, instead of a bind per
+ * device, and nothing if the server confirmed every change. The server confirms with `synced:<version>` and asks for the full table with
+ * `snapshot` when it cannot apply a delta:
+ *
+ *     state:<version>:<base>:<id>=<value>,<id>=<value>,...
+ *
+ * `base` is the version the delta builds on, 0 for a full snapshot. Plain C without locking,
+ * smart_home serialises the callers.
+ */
+#ifndef STATE_TABLE_H
+#define STATE_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define STATE_TABLE_MAX 16      ///< Devices the table holds
+#define STATE_VALUE_MAX 32      ///< Longest value
+
+typedef struct {
+    int device_id;
+    uint32_t version;                   ///< Table version of the last change
+    char value[STATE_VALUE_MAX + 1];    ///< NUL terminated
+} state_entry_t;
+
+typedef struct {
+    state_entry_t entries[STATE_TABLE_MAX];
+    size_t count;
+    uint32_t version;                   ///< Version of the last change, 0 while empty
+    uint32_t acked;                     ///< Last version the server confirmed, 0 if none
+} state_table_t;
+
+void state_table_init(state_table_t *table);
+
+/**
+ * @brief Record the value of a device, the version only changes if the value does
+ *
+ * @return false if the value is longer than STATE_VALUE_MAX, contains a ',' or the table is full
+ */
+bool state_table_set(state_table_t *table, int device_id, const char *value);
+
+/**
+ * @brief Format the `state:` message of the entries changed since `base`
+ *
+ * A base of 0, or one the table does not know, gives the full snapshot with base 0.
+ *
+ * @return Length of the message, longer than len - 1 if it was truncated
+ */
+int state_table_format(const state_table_t *table, uint32_t base, char *buffer, size_t len);
+
+/**
+ * @brief The server confirmed `version`, later deltas build on it
+ *
+ * Versions the table has not reached yet and ones older than the last confirmed are ignored.
+ */
+void state_table_acked(state_table_t *table, uint32_t version);
+
+#endif // STATE_TABLE_H
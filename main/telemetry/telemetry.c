@@ -0,0 +1,91 @@
+/**
+ * @file telemetry.c
+ * @brief Batches sensor reports so the radio wakes up once per batch
+ */
+#include "telemetry.h"
+#include <stdlib.h>
+#include <string.h>
+
+void telemetry_init(telemetry_t *telemetry, const telemetry_config_t *config, int channel_count)
+{
+    memset(telemetry, 0, sizeof(*telemetry));
+    telemetry->config = *config;
+    telemetry->channel_count = channel_count < TELEMETRY_MAX_CHANNELS ? channel_count : TELEMETRY_MAX_CHANNELS;
+}
+
+void telemetry_update(telemetry_t *telemetry, int channel, int value)
+{
+    if (channel < 0 || channel >= telemetry->channel_count) {
+        return;
+    }
+    telemetry->channels[channel].value = value;
+    telemetry->channels[channel].has_value = true;
+}
+
+bool telemetry_pending(const telemetry_t *telemetry, int channel, int *value)
+{
+    if (channel < 0 || channel >= telemetry->channel_count) {
+        return false;
+    }
+    const telemetry_channel_t *ch = &telemetry->channels[channel];
+    if (!ch->has_value || ch->has_sending || (ch->has_reported && ch->value == ch->reported)) {
+        return false;
+    }
+    if (value) {
+        *value = ch->value;
+    }
+    return true;
+}
+
+bool telemetry_due(const telemetry_t *telemetry, uint32_t now_ms, bool radio_awake)
+{
+    bool pending = false;
+    for (int i = 0; i < telemetry->channel_count; i++) {
+        const telemetry_channel_t *ch = &telemetry->channels[i];
+        if (!telemetry_pending(telemetry, i, NULL)) {
+            continue;
+        }
+        // the first value of a channel and large changes do not wait for the batch
+        if (!ch->has_reported ||
+            (telemetry->config.urgent_delta > 0 && abs(ch->value - ch->reported) >= telemetry->config.urgent_delta)) {
+            return true;
+        }
+        pending = true;
+    }
+    return pending && (radio_awake ||
+                       now_ms - telemetry->last_batch_ms >= telemetry->config.report_interval_ms);
+}
+
+void telemetry_sent(telemetry_t *telemetry, int channel, int value)
+{
+    if (channel < 0 || channel >= telemetry->channel_count) {
+        return;
+    }
+    telemetry->channels[channel].reported = value;
+    telemetry->channels[channel].has_reported = true;
+}
+
+void telemetry_sending(telemetry_t *telemetry, int channel, int value)
+{
+    if (channel < 0 || channel >= telemetry->channel_count) {
+        return;
+    }
+    telemetry->channels[channel].sending = value;
+    telemetry->channels[channel].has_sending = true;
+}
+
+void telemetry_send_done(telemetry_t *telemetry, int channel, bool sent)
+{
+    if (channel < 0 || channel >= telemetry->channel_count || !telemetry->channels[channel].has_sending) {
+        return;
+    }
+    telemetry->channels[channel].has_sending = false;
+    if (sent) {
+        telemetry_sent(telemetry, channel, telemetry->channels[channel].sending);
+    }
+}
+
+void telemetry_batch_done(telemetry_t *telemetry, uint32_t now_ms)
+{
+    telemetry->last_batch_ms = now_ms;
+}
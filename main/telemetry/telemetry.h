@@ -0,0 +1,89 @@
+/**
+ * @file telemetry.h
+ * @brief Batches sensor reports so the radio wakes up once per batch
+ *
+ * Samples are taken often, but a changed value is only reported when the batch is due: when
+ * the report interval passed since the last batch, when the change is large, when the channel
+ * was never reported, or when the radio is awake for other traffic anyway. Only the latest
+ * value of a channel is sent. Plain C without locking, owned by the task that samples.
+ */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TELEMETRY_MAX_CHANNELS 4
+
+/**
+ * @brief Telemetry batching configuration
+ */
+typedef struct {
+    uint32_t report_interval_ms; ///< Changes are sent at most this often, 0 sends every change right away
+    int urgent_delta;            ///< A change at least this large is sent right away, 0 disables
+} telemetry_config_t;
+
+typedef struct {
+    int value;                   ///< Latest sample
+    int reported;                ///< Last value sent
+    int sending;                 ///< Value handed to the transport, not confirmed yet
+    bool has_value;
+    bool has_reported;
+    bool has_sending;
+} telemetry_channel_t;
+
+typedef struct {
+    telemetry_config_t config;
+    telemetry_channel_t channels[TELEMETRY_MAX_CHANNELS];
+    int channel_count;
+    uint32_t last_batch_ms;
+} telemetry_t;
+
+/**
+ * @brief Reset the batching state
+ */
+void telemetry_init(telemetry_t *telemetry, const telemetry_config_t *config, int channel_count);
+
+/**
+ * @brief Record the latest sample of a channel
+ */
+void telemetry_update(telemetry_t *telemetry, int channel, int value);
+
+/**
+ * @brief Whether a batch should be sent now
+ *
+ * @param radio_awake The radio is awake for other traffic, pending changes may ride along
+ */
+bool telemetry_due(const telemetry_t *telemetry, uint32_t now_ms, bool radio_awake);
+
+/**
+ * @brief Whether a channel has a value which was not sent yet
+ *
+ * A channel whose value is being sent has nothing pending until the send is done.
+ *
+ * @param value Set to the value to send
+ */
+bool telemetry_pending(const telemetry_t *telemetry, int channel, int *value);
+
+/**
+ * @brief A value of a channel was sent
+ */
+void telemetry_sent(telemetry_t *telemetry, int channel, int value);
+
+/**
+ * @brief A value of a channel was handed to a transport which confirms the send later
+ */
+void telemetry_sending(telemetry_t *telemetry, int channel, int value);
+
+/**
+ * @brief The transport confirmed the value handed over with telemetry_sending(), or failed
+ *        to send it, it is then pending again
+ */
+void telemetry_send_done(telemetry_t *telemetry, int channel, bool sent);
+
+/**
+ * @brief The batch is done, values which could not be sent wait for the next one
+ */
+void telemetry_batch_done(telemetry_t *telemetry, uint32_t now_ms);
+
+#endif // TELEMETRY_H
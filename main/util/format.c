@@ -0,0 +1,16 @@
+/**
+ * @file format.c
+ * @brief Building text reports into a fixed buffer
+ */
+#include "format.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+void format_append(char *buffer, size_t len, int *written, const char *format, ...)
+{
+    size_t offset = (size_t)*written < len ? (size_t)*written : len;
+    va_list args;
+    va_start(args, format);
+    *written += vsnprintf(buffer + offset, len - offset, format, args);
+    va_end(args);
+}
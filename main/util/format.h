@@ -0,0 +1,19 @@
+/**
+ * @file format.h
+ * @brief Building text reports into a fixed buffer, free of ESP-IDF
+ */
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stddef.h>
+
+/**
+ * @brief snprintf at the end of what was written so far, keeps counting once the buffer is full
+ *
+ * `*written` starts at 0 and ends up as the length of the whole text, longer than len - 1 if it
+ * was truncated, so a report function can return it as snprintf would.
+ */
+void format_append(char *buffer, size_t len, int *written, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+#endif // FORMAT_H
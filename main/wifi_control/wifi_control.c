@@ -4,11 +4,20 @@
  */
 #include "wifi_control.h"
 #include <esp_log.h>
+#include <esp_random.h>
 #include <esp_wifi.h>
 #include <esp_event.h>
+#include <esp_timer.h>
 #include <nvs_flash.h>
+#include <nvs.h>
 #include <freertos/event_groups.h>
+#include <stdlib.h>
 #include <string.h>
+#include "boot_timeline/boot_timeline.h"
+#include "metrics/metrics.h"
+// CONFIG_HOME_MEMPROF ile bu dosyanın bellek ayırmaları "wifi" altında sayılır
+#define MEMPROF_TAG MEMPROF_TAG_WIFI
+#include "memprof/memprof_wrap.h"
 
 static const char *TAG = "WIFI_CONTROL";
 
@@ -16,6 +25,52 @@ static const char *TAG = "WIFI_CONTROL";
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT      BIT1
 
+// Zamanlayıcılar ve uygulama görevi bağlantı durumunu kendileri değiştirmez, işi bu olaylarla
+// varsayılan olay döngüsüne, WiFi olaylarının işlendiği göreve gönderir
+static ESP_EVENT_DEFINE_BASE(WIFI_CONTROL_EVENT);
+enum {
+    WIFI_CONTROL_EVENT_RETRY,     // Yeniden bağlantı zamanı geldi
+    WIFI_CONTROL_EVENT_RSSI,      // RSSI örneklenecek
+    WIFI_CONTROL_EVENT_RECONNECT, // wifi_control_reconnect()
+};
+#define RETRY_POST_DELAY_US     (100 * 1000)       // Olay kuyruğu doluysa deneme bu kadar ertelenir
+
+// Son bağlanılan AP'nin NVS kaydı
+#define AP_CACHE_NAMESPACE "wifi_ctrl"
+#define AP_CACHE_KEY       "ap_cache"
+#define AP_CACHE_VERSION   1
+
+typedef struct {
+    uint8_t version;
+    uint8_t channel;
+    uint8_t bssid[6];
+    char ssid[33];                ///< Kaydın ait olduğu ağ, SSID değişirse kayıt kullanılmaz
+    esp_netif_ip_info_t ip_info;  ///< DHCP'den alınan son adres
+    esp_ip4_addr_t dns;
+} wifi_ap_cache_t;
+
+// Dolaşım
+#define SCAN_MAX_RECORDS        16
+#define RSSI_AVERAGE_SAMPLES    3                  // Tek bir zayıf örnek dolaşım başlatmaz
+#define ROAM_SCAN_COOLDOWN_US   (60 * 1000000LL)   // Daha iyi AP bulunamazsa tarama tekrarlanmadan önce
+
+typedef struct {
+    char ssid[33];
+    char password[65];
+} wifi_network_entry_t;
+
+typedef enum {
+    SCAN_NONE = 0,
+    SCAN_SELECT,                  // Bağlanmadan önce en güçlü aday AP seçilir
+    SCAN_ROAM,                    // Bağlıyken daha güçlü bir AP aranır
+} scan_purpose_t;
+
+typedef enum {
+    ROAM_IDLE = 0,
+    ROAM_LEAVING,                 // Eski AP'den ayrılınıyor
+    ROAM_JOINING,                 // Yeni AP'ye bağlanılıyor
+} roam_state_t;
+
 // Statik değişkenler
 static EventGroupHandle_t s_wifi_event_group = NULL;
 static esp_netif_t *s_sta_netif = NULL;
@@ -26,28 +81,617 @@ static bool s_is_initialized = false;
 static bool s_auto_reconnect = true;
 static esp_event_handler_instance_t s_instance_any_id = NULL;
 static esp_event_handler_instance_t s_instance_got_ip = NULL;
+static esp_event_handler_instance_t s_instance_control = NULL;
+static wifi_status_callback_t s_status_callback = NULL;
+static esp_timer_handle_t s_retry_timer = NULL;
+static uint32_t s_retry_interval_ms = 1000;
+static uint32_t s_retry_interval_max_ms = 60000;
+static bool s_user_disconnect = false;  // wifi_control_disconnect() sonrası yeniden bağlanma
+static wifi_power_save_t s_power_save = WIFI_POWER_SAVE_DEFAULT;
+static uint16_t s_listen_interval = 3;
+static bool s_config_dirty = false;     // s_wifi_config bir sonraki bağlantıdan önce uygulanacak
+static void *s_user_context = NULL;
+
+// Aday ağlar ve dolaşım durumu
+static wifi_network_entry_t s_networks[WIFI_CONTROL_MAX_NETWORKS];
+static int s_network_count = 0;
+static int s_network_index = 0;
+static volatile scan_purpose_t s_scan_purpose = SCAN_NONE;
+static volatile roam_state_t s_roam_state = ROAM_IDLE;
+static int s_roam_threshold = 0;
+static int s_roam_hysteresis = 8;
+static int64_t s_last_roam_scan_us = 0;
+static int64_t s_roam_start_us = 0;
+static bool s_roam_ip_pending = false;  // Dolaşımdan sonraki IP olayı bağlantı süresi sayılmaz
+static esp_timer_handle_t s_rssi_timer = NULL;
+static int8_t s_rssi_history[WIFI_CONTROL_RSSI_HISTORY];
+static int s_rssi_count = 0;
+static int s_rssi_next = 0;
+static portMUX_TYPE s_rssi_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Hızlı bağlantı durumu, yalnızca olay döngüsü görevinde değişir, bkz. WIFI_CONTROL_EVENT
+static wifi_config_t s_wifi_config;
+static wifi_ap_cache_t s_ap_cache;
+static bool s_ap_cache_valid = false;
+static bool s_fast_connect = false;
+static bool s_reuse_ip_lease = false;
+static bool s_directed = false;       // Kayıtlı BSSID ve kanal ile bağlanılıyor
+static bool s_dhcp_stopped = false;   // Kayıtlı veya statik IP uygulandı
+static bool s_has_static_ip = false;
+static esp_netif_ip_info_t s_static_ip;
+static esp_ip4_addr_t s_static_dns;
+
+// Bağlantı aşama süreleri
+static int64_t s_attempt_start_us = 0;  // Son esp_wifi_connect() çağrısı
+static int64_t s_first_attempt_us = 0;  // Bağlantı kurulana kadarki ilk deneme
+static int64_t s_associated_us = 0;
+static bool s_fell_back = false;
+static wifi_connect_timings_t s_timings;
+static bool s_timings_valid = false;
+static portMUX_TYPE s_timings_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Durumu güncelle ve değiştiyse bildir
+static void set_status(wifi_connection_status_t status)
+{
+    bool changed = s_wifi_status != status;
+    s_wifi_status = status;
+    if (changed && s_status_callback) {
+        s_status_callback(status, s_user_context);
+    }
+}
+
+// Aday ağlar arasında SSID'yi ara
+static int find_network(const char *ssid)
+{
+    for (int i = 0; i < s_network_count; i++) {
+        if (strncmp(s_networks[i].ssid, ssid, sizeof(s_networks[i].ssid)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Kayıtlı AP bilgisini oku, aday ağlardan birine ait değilse kullanma
+static bool load_ap_cache(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(AP_CACHE_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+    size_t size = sizeof(s_ap_cache);
+    esp_err_t ret = nvs_get_blob(handle, AP_CACHE_KEY, &s_ap_cache, &size);
+    nvs_close(handle);
+
+    return ret == ESP_OK && size == sizeof(s_ap_cache) &&
+           s_ap_cache.version == AP_CACHE_VERSION &&
+           s_ap_cache.channel != 0 &&
+           find_network(s_ap_cache.ssid) >= 0;
+}
+
+// Bağlanılan AP'yi kaydet, flash yıpranmasın diye yalnızca değiştiyse yazılır
+static void save_ap_cache(const esp_netif_ip_info_t *ip_info)
+{
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+        return;
+    }
+
+    wifi_ap_cache_t cache = {
+        .version = AP_CACHE_VERSION,
+        .channel = ap_info.primary,
+        .ip_info = *ip_info,
+    };
+    memcpy(cache.bssid, ap_info.bssid, sizeof(cache.bssid));
+    strlcpy(cache.ssid, (const char *)s_wifi_config.sta.ssid, sizeof(cache.ssid));
+    esp_netif_dns_info_t dns;
+    if (esp_netif_get_dns_info(s_sta_netif, ESP_NETIF_DNS_MAIN, &dns) == ESP_OK) {
+        cache.dns = dns.ip.u_addr.ip4;
+    }
+
+    if (s_ap_cache_valid && memcmp(&cache, &s_ap_cache, sizeof(cache)) == 0) {
+        return;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(AP_CACHE_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, AP_CACHE_KEY, &cache, sizeof(cache));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "AP bilgisi kaydedilemedi: %s", esp_err_to_name(ret));
+        return;
+    }
+    s_ap_cache = cache;
+    s_ap_cache_valid = true;
+    ESP_LOGI(TAG, "AP bilgisi kaydedildi, kanal %d", cache.channel);
+}
+
+static void erase_ap_cache(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(AP_CACHE_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK) {
+        nvs_erase_key(handle, AP_CACHE_KEY);
+        nvs_commit(handle);
+        nvs_close(handle);
+    }
+    s_ap_cache_valid = false;
+}
+
+// Bağlantı süresi ölçümünü başlat
+static void mark_attempt_start(void)
+{
+    s_attempt_start_us = esp_timer_get_time();
+    if (s_first_attempt_us == 0) {
+        s_first_attempt_us = s_attempt_start_us;
+    }
+}
+
+// Bağlantı denemesini başlat ve süre ölçümünü güncelle
+static esp_err_t start_connect(void)
+{
+    mark_attempt_start();
+    return esp_wifi_connect();
+}
+
+// Aday ağı seç, ap verilirse taramadan doğrudan o BSSID'ye bağlanılır
+static void use_network(int index, const wifi_ap_record_t *ap)
+{
+    s_network_index = index;
+    strlcpy((char *)s_wifi_config.sta.ssid, s_networks[index].ssid, sizeof(s_wifi_config.sta.ssid));
+    strlcpy((char *)s_wifi_config.sta.password, s_networks[index].password, sizeof(s_wifi_config.sta.password));
+    s_wifi_config.sta.bssid_set = ap != NULL;
+    if (ap != NULL) {
+        memcpy(s_wifi_config.sta.bssid, ap->bssid, sizeof(s_wifi_config.sta.bssid));
+    }
+    s_wifi_config.sta.channel = ap != NULL ? ap->primary : 0;
+    s_wifi_config.sta.scan_method = ap != NULL ? WIFI_FAST_SCAN : WIFI_ALL_CHANNEL_SCAN;
+    esp_wifi_set_config(WIFI_IF_STA, &s_wifi_config);
+    s_config_dirty = false;
+}
+
+// Tarama sonucunu oku, aday ağlardan en güçlü AP'yi bul
+static int find_best_ap(wifi_ap_record_t *best)
+{
+    uint16_t count = 0;
+    esp_wifi_scan_get_ap_num(&count);
+    if (count > SCAN_MAX_RECORDS) {
+        count = SCAN_MAX_RECORDS;
+    }
+    wifi_ap_record_t *records = count ? malloc(count * sizeof(wifi_ap_record_t)) : NULL;
+    if (records == NULL) {
+        esp_wifi_clear_ap_list();
+        return -1;
+    }
+    esp_wifi_scan_get_ap_records(&count, records);
+
+    int best_index = -1;
+    for (int i = 0; i < count; i++) {
+        int index = find_network((const char *)records[i].ssid);
+        if (index < 0 || (records[i].authmode == WIFI_AUTH_OPEN && s_networks[index].password[0])) {
+            continue;
+        }
+        if (best_index < 0 || records[i].rssi > best->rssi) {
+            *best = records[i];
+            best_index = index;
+        }
+    }
+    free(records);
+    return best_index;
+}
+
+// Taramayı başlat, sonucu WIFI_EVENT_SCAN_DONE ile gelir
+static esp_err_t start_scan(scan_purpose_t purpose)
+{
+    s_scan_purpose = purpose;
+    esp_err_t ret = esp_wifi_scan_start(NULL, false);
+    if (ret != ESP_OK) {
+        s_scan_purpose = SCAN_NONE;
+        ESP_LOGW(TAG, "Tarama başlatılamadı: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+// Tek ağda ESP-IDF kendisi tarar, birden çok aday varsa önce taranıp en güçlü AP seçilir
+static esp_err_t begin_connect(void)
+{
+    if (s_network_count > 1) {
+        mark_attempt_start();
+        if (start_scan(SCAN_SELECT) == ESP_OK) {
+            return ESP_OK;
+        }
+        // Taranamıyorsa sıradaki ağ denenir
+        use_network((s_network_index + 1) % s_network_count, NULL);
+    }
+    return start_connect();
+}
+
+// Dolaşımda veya taramayla seçilen AP'ye kilitli kalınmaz, o AP kaybolursa sonraki denemeler
+// tüm kanalları tarar. Kayıtlı AP kilidi fall_back_to_full_scan ile kalkar.
+static void release_ap_pin(void)
+{
+    if (!s_directed && s_wifi_config.sta.bssid_set) {
+        s_wifi_config.sta.bssid_set = false;
+        s_wifi_config.sta.channel = 0;
+        s_wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        s_config_dirty = true;
+    }
+}
+
+// Kayıtlı AP'ye bağlanılamadı, BSSID ve kanal kısıtlamasını kaldırıp tam taramaya geç
+static void fall_back_to_full_scan(void)
+{
+    ESP_LOGW(TAG, "Kayıtlı AP'ye bağlanılamadı, tam tarama yapılıyor");
+    s_directed = false;
+    s_fell_back = true;
+    s_wifi_config.sta.bssid_set = false;
+    s_wifi_config.sta.channel = 0;
+    s_wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+    esp_wifi_set_config(WIFI_IF_STA, &s_wifi_config);
+    s_config_dirty = false;
+
+    // Kayıtlı IP de artık güvenilir değil, DHCP'ye dön
+    if (s_dhcp_stopped && !s_has_static_ip) {
+        esp_netif_dhcpc_start(s_sta_netif);
+        s_dhcp_stopped = false;
+    }
+    erase_ap_cache();
+}
+
+// AP'ye bağlanınca DHCP'yi atlayıp statik veya kayıtlı IP'yi uygula
+static void apply_static_ip(void)
+{
+    const esp_netif_ip_info_t *ip_info;
+    esp_ip4_addr_t dns;
+    if (s_has_static_ip) {
+        ip_info = &s_static_ip;
+        dns = s_static_dns;
+    } else if (s_reuse_ip_lease && s_directed && s_ap_cache_valid && s_ap_cache.ip_info.ip.addr != 0) {
+        ip_info = &s_ap_cache.ip_info;
+        dns = s_ap_cache.dns;
+    } else {
+        return;
+    }
+
+    esp_err_t ret = esp_netif_dhcpc_stop(s_sta_netif);
+    if (ret != ESP_OK && ret != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED) {
+        ESP_LOGW(TAG, "DHCP durdurulamadı: %s", esp_err_to_name(ret));
+        return;
+    }
+    s_dhcp_stopped = true;
+    if (dns.addr != 0) {
+        esp_netif_dns_info_t dns_info = { .ip.type = ESP_IPADDR_TYPE_V4, .ip.u_addr.ip4 = dns };
+        esp_netif_set_dns_info(s_sta_netif, ESP_NETIF_DNS_MAIN, &dns_info);
+    }
+    // IP_EVENT_STA_GOT_IP adres ayarlanınca gelir
+    ret = esp_netif_set_ip_info(s_sta_netif, ip_info);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "IP ayarlanamadı, DHCP kullanılıyor: %s", esp_err_to_name(ret));
+        esp_netif_dhcpc_start(s_sta_netif);
+        s_dhcp_stopped = false;
+    }
+}
+
+// Bağlantı kurulunca aşama sürelerini kaydet
+static void record_timings(int64_t now)
+{
+    wifi_connect_timings_t timings = {
+        .associate_ms = (uint32_t)((s_associated_us - s_attempt_start_us) / 1000),
+        .ip_ms = (uint32_t)((now - s_associated_us) / 1000),
+        .total_ms = (uint32_t)((now - s_first_attempt_us) / 1000),
+        .used_cache = s_directed,
+        .reused_ip = s_dhcp_stopped,
+        .fell_back = s_fell_back,
+    };
+    portENTER_CRITICAL(&s_timings_lock);
+    s_timings = timings;
+    s_timings_valid = true;
+    portEXIT_CRITICAL(&s_timings_lock);
+
+    ESP_LOGI(TAG, "Bağlantı süreleri: bağlanma %lu ms, IP %lu ms, toplam %lu ms%s%s%s",
+             (unsigned long)timings.associate_ms, (unsigned long)timings.ip_ms, (unsigned long)timings.total_ms,
+             timings.used_cache ? ", kayıtlı AP" : "", timings.reused_ip ? ", DHCP atlandı" : "",
+             timings.fell_back ? ", tam taramaya geçildi" : "");
+    s_first_attempt_us = 0;
+    s_fell_back = false;
+}
+
+static wifi_ps_type_t to_wifi_ps_type(wifi_power_save_t mode)
+{
+    switch (mode) {
+    case WIFI_POWER_SAVE_NONE:
+        return WIFI_PS_NONE;
+    case WIFI_POWER_SAVE_MAX_MODEM:
+        return WIFI_PS_MAX_MODEM;
+    default:
+        return WIFI_PS_MIN_MODEM;
+    }
+}
+
+// Bekleme süresi her denemede ikiye katlanır ve rastgele yarısına kadar kısaltılır,
+// aynı kesintiden etkilenen cihazlar AP'ye aynı anda yüklenmez
+static uint32_t next_retry_delay_ms(void)
+{
+    // Kesintinin ilk denemesi beklemeden yapılır, kısa kopmalar hemen toparlanır
+    if (s_retry_num <= 1) {
+        return 0;
+    }
+    uint32_t backoff = s_retry_interval_ms;
+    for (int i = 2; i < s_retry_num && backoff < s_retry_interval_max_ms; i++) {
+        backoff *= 2;
+    }
+    if (backoff > s_retry_interval_max_ms) {
+        backoff = s_retry_interval_max_ms;
+    }
+    return backoff / 2 + esp_random() % (backoff / 2 + 1);
+}
+
+// esp_timer görevinde çalışır, denemeyi olay döngüsüne bırakır
+static void retry_timer_callback(void *arg)
+{
+    if (esp_event_post(WIFI_CONTROL_EVENT, WIFI_CONTROL_EVENT_RETRY, NULL, 0, 0) != ESP_OK) {
+        // Kuyruk dolu, deneme kaybolmasın
+        esp_timer_start_once(s_retry_timer, RETRY_POST_DELAY_US);
+    }
+}
+
+static void retry_connect(void)
+{
+    // Zamanlayıcı durdurulmadan önce gönderilmiş olabilir
+    if (s_user_disconnect) {
+        return;
+    }
+    esp_err_t ret = begin_connect();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Yeniden bağlantı başlatılamadı: %s", esp_err_to_name(ret));
+    }
+}
+
+// Sonraki denemeyi zamanlayıcıya kur, olay görevi beklemez
+static void schedule_retry(void)
+{
+    s_retry_num++;
+    uint32_t delay_ms = next_retry_delay_ms();
+    esp_timer_stop(s_retry_timer);
+    if (esp_timer_start_once(s_retry_timer, (uint64_t)delay_ms * 1000) != ESP_OK) {
+        ESP_LOGE(TAG, "Yeniden bağlantı zamanlayıcısı kurulamadı");
+        return;
+    }
+    ESP_LOGI(TAG, "WiFi'ye %lu ms sonra yeniden bağlanılacak, deneme %d",
+             (unsigned long)delay_ms, s_retry_num);
+}
+
+// Bağlantı denemesi başarısız oldu: bekleyip yeniden dene veya vazgeç
+static void handle_connect_failure(void)
+{
+    if (s_directed && s_auto_reconnect) {
+        // Tam taramaya geçiş deneme sayısından düşülmez
+        fall_back_to_full_scan();
+        set_status(WIFI_STATUS_CONNECTING);
+        begin_connect();
+    } else if (s_auto_reconnect) {
+        if (s_retry_num >= s_max_retry) {
+            // Bekleyenlere bildir, denemeler arka planda en uzun aralıkla sürer
+            if (s_wifi_status != WIFI_STATUS_FAILED) {
+                ESP_LOGW(TAG, "WiFi'ye %d denemede bağlanılamadı, arka planda deneniyor", s_retry_num);
+            }
+            xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
+            set_status(WIFI_STATUS_FAILED);
+        } else {
+            set_status(WIFI_STATUS_CONNECTING);
+        }
+        schedule_retry();
+    } else {
+        xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
+        set_status(WIFI_STATUS_FAILED);
+        ESP_LOGI(TAG, "WiFi bağlantısı başarısız oldu");
+    }
+}
+
+static void record_rssi(int8_t rssi)
+{
+    portENTER_CRITICAL(&s_rssi_lock);
+    s_rssi_history[s_rssi_next] = rssi;
+    s_rssi_next = (s_rssi_next + 1) % WIFI_CONTROL_RSSI_HISTORY;
+    if (s_rssi_count < WIFI_CONTROL_RSSI_HISTORY) {
+        s_rssi_count++;
+    }
+    portEXIT_CRITICAL(&s_rssi_lock);
+    metrics_set(METRIC_WIFI_RSSI, (uint32_t)(int32_t)rssi);
+}
+
+// Son örneklerin ortalaması, tek bir düşük örnek dolaşım başlatmaz
+static int average_rssi(int samples)
+{
+    int sum = 0;
+    portENTER_CRITICAL(&s_rssi_lock);
+    if (samples > s_rssi_count) {
+        samples = s_rssi_count;
+    }
+    for (int i = 1; i <= samples; i++) {
+        sum += s_rssi_history[(s_rssi_next - i + WIFI_CONTROL_RSSI_HISTORY) % WIFI_CONTROL_RSSI_HISTORY];
+    }
+    portEXIT_CRITICAL(&s_rssi_lock);
+    return samples ? sum / samples : 0;
+}
+
+// esp_timer görevinde çalışır, kuyruk doluysa bu örnek atlanır
+static void rssi_timer_callback(void *arg)
+{
+    esp_event_post(WIFI_CONTROL_EVENT, WIFI_CONTROL_EVENT_RSSI, NULL, 0, 0);
+}
+
+// RSSI'yi örnekle, sinyal zayıfsa daha güçlü AP aramaya başla
+static void check_rssi(void)
+{
+    if (s_wifi_status != WIFI_STATUS_CONNECTED || s_roam_state != ROAM_IDLE) {
+        return;
+    }
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) {
+        return;
+    }
+    record_rssi(ap.rssi);
+
+    if (s_roam_threshold == 0 || s_scan_purpose != SCAN_NONE) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    int rssi = average_rssi(RSSI_AVERAGE_SAMPLES);
+    if (rssi < s_roam_threshold && now - s_last_roam_scan_us >= ROAM_SCAN_COOLDOWN_US) {
+        ESP_LOGI(TAG, "Sinyal zayıf (%d dBm), daha güçlü AP aranıyor", rssi);
+        s_last_roam_scan_us = now;
+        if (start_scan(SCAN_ROAM) == ESP_OK) {
+            metrics_inc(METRIC_WIFI_ROAM_SCANS);
+        }
+    }
+}
+
+// Bulunan AP yeterince güçlüyse ona geç, bağlantı durumu değişmez ve WebSocket açık kalır
+static void roam_to(int index, const wifi_ap_record_t *best)
+{
+    wifi_ap_record_t current;
+    if (s_wifi_status != WIFI_STATUS_CONNECTED || esp_wifi_sta_get_ap_info(&current) != ESP_OK) {
+        return;
+    }
+    if (index < 0 || memcmp(best->bssid, current.bssid, sizeof(current.bssid)) == 0 ||
+        best->rssi < current.rssi + s_roam_hysteresis) {
+        ESP_LOGI(TAG, "Daha güçlü AP bulunamadı (%d dBm)", current.rssi);
+        return;
+    }
+
+    ESP_LOGI(TAG, "\"%s\" ağında dolaşım: %d dBm -> %d dBm, kanal %d",
+             s_networks[index].ssid, current.rssi, best->rssi, best->primary);
+    s_roam_state = ROAM_LEAVING;
+    s_roam_start_us = esp_timer_get_time();
+    // Kayıtlı AP artık geçerli değil, yeni AP bağlanınca kaydedilir
+    s_directed = false;
+    use_network(index, best);
+    if (esp_wifi_disconnect() != ESP_OK) {
+        s_roam_state = ROAM_IDLE;
+    }
+}
+
+// Dolaşım tamamlandı
+static void roam_done(void)
+{
+    uint32_t roam_ms = (esp_timer_get_time() - s_roam_start_us) / 1000;
+    s_roam_state = ROAM_IDLE;
+    s_roam_ip_pending = true;
+    metrics_inc(METRIC_WIFI_ROAMS);
+    metrics_observe(METRIC_WIFI_ROAM_MS, roam_ms);
+    ESP_LOGI(TAG, "Dolaşım %lu ms'de tamamlandı", (unsigned long)roam_ms);
+
+    esp_netif_ip_info_t ip_info;
+    if (s_fast_connect && esp_netif_get_ip_info(s_sta_netif, &ip_info) == ESP_OK && ip_info.ip.addr != 0) {
+        save_ap_cache(&ip_info);
+    }
+}
+
+// wifi_control_reconnect() isteği, bağlantı parametreleri sıfırlanıp beklemeden bağlanılır
+static void reconnect(void)
+{
+    esp_timer_stop(s_retry_timer);
+    s_user_disconnect = false;
+    s_retry_num = 0;
+    s_roam_state = ROAM_IDLE;
+
+    // Bağlantı zaten varsa kes, kopma olayı beklemeden yeniden bağlanır
+    if (s_wifi_status == WIFI_STATUS_CONNECTED) {
+        esp_err_t ret = esp_wifi_disconnect();
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "WiFi bağlantısı kesilemedi: %s", esp_err_to_name(ret));
+        }
+        return;
+    }
+    set_status(WIFI_STATUS_CONNECTING);
+
+    esp_err_t ret = begin_connect();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Yeniden bağlantı başlatılamadı: %s", esp_err_to_name(ret));
+        set_status(WIFI_STATUS_FAILED);
+    } else {
+        ESP_LOGI(TAG, "Yeniden bağlantı başlatıldı");
+    }
+}
 
 // WiFi olay işleyicisi
 static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                               int32_t event_id, void *event_data)
 {
-    if (event_base == WIFI_EVENT) {
+    if (event_base == WIFI_CONTROL_EVENT) {
+        if (event_id == WIFI_CONTROL_EVENT_RETRY) {
+            retry_connect();
+        } else if (event_id == WIFI_CONTROL_EVENT_RSSI) {
+            check_rssi();
+        } else if (event_id == WIFI_CONTROL_EVENT_RECONNECT) {
+            reconnect();
+        }
+    }
+    else if (event_base == WIFI_EVENT) {
         if (event_id == WIFI_EVENT_STA_START) {
             ESP_LOGI(TAG, "WiFi başlatıldı, bağlanmaya çalışılıyor...");
-            s_wifi_status = WIFI_STATUS_CONNECTING;
-            esp_wifi_connect();
+            set_status(WIFI_STATUS_CONNECTING);
+            // Kayıtlı AP varsa taramadan doğrudan ona bağlanılır
+            if (s_directed) {
+                start_connect();
+            } else {
+                begin_connect();
+            }
+        }
+        else if (event_id == WIFI_EVENT_SCAN_DONE) {
+            scan_purpose_t purpose = s_scan_purpose;
+            s_scan_purpose = SCAN_NONE;
+            wifi_ap_record_t best;
+            int index = find_best_ap(&best);
+            if (purpose == SCAN_SELECT) {
+                if (index < 0) {
+                    ESP_LOGW(TAG, "Aday ağlardan hiçbiri bulunamadı");
+                    handle_connect_failure();
+                } else {
+                    ESP_LOGI(TAG, "\"%s\" ağına bağlanılıyor, %d dBm, kanal %d",
+                             s_networks[index].ssid, best.rssi, best.primary);
+                    use_network(index, &best);
+                    esp_wifi_connect();
+                }
+            } else if (purpose == SCAN_ROAM) {
+                roam_to(index, &best);
+            }
+        }
+        else if (event_id == WIFI_EVENT_STA_CONNECTED) {
+            s_associated_us = esp_timer_get_time();
+            apply_static_ip();
+            if (s_roam_state == ROAM_JOINING) {
+                roam_done();
+            }
         }
         else if (event_id == WIFI_EVENT_STA_DISCONNECTED) {
-            if (s_auto_reconnect && s_retry_num < s_max_retry) {
+            if (s_roam_state == ROAM_LEAVING) {
+                // Eski AP'den ayrılındı, durum bildirilmeden yeni AP'ye bağlanılır. Süresi
+                // METRIC_WIFI_ROAM_MS'e yazılır, bağlantı süreleri ölçümü başlatılmaz
+                s_roam_state = ROAM_JOINING;
                 esp_wifi_connect();
-                s_retry_num++;
-                s_wifi_status = WIFI_STATUS_CONNECTING;
-                ESP_LOGI(TAG, "Yeniden WiFi'ye bağlanılıyor... Deneme %d/%d",
-                        s_retry_num, s_max_retry);
+                return;
+            }
+            if (s_roam_state == ROAM_JOINING) {
+                ESP_LOGW(TAG, "Dolaşım başarısız oldu, yeniden bağlanılıyor");
+                s_roam_state = ROAM_IDLE;
+                metrics_inc(METRIC_WIFI_ROAM_FAILURES);
+            }
+            xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+            s_roam_ip_pending = false;
+            release_ap_pin();
+            if (s_config_dirty) {
+                esp_wifi_set_config(WIFI_IF_STA, &s_wifi_config);
+                s_config_dirty = false;
+            }
+            if (s_user_disconnect) {
+                set_status(WIFI_STATUS_DISCONNECTED);
             } else {
-                xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
-                s_wifi_status = WIFI_STATUS_FAILED;
-                ESP_LOGI(TAG, "WiFi bağlantısı başarısız oldu");
+                handle_connect_failure();
             }
         }
     }
@@ -56,8 +700,19 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
         ESP_LOGI(TAG, "WiFi bağlantısı başarılı. IP adresi: " IPSTR,
                 IP2STR(&event->ip_info.ip));
         s_retry_num = 0;
-        s_wifi_status = WIFI_STATUS_CONNECTED;
+        // Dolaşım ilk bağlantının sürelerinin üzerine yazmaz
+        if (s_roam_ip_pending) {
+            s_roam_ip_pending = false;
+        } else {
+            record_timings(esp_timer_get_time());
+        }
+        if (s_fast_connect) {
+            save_ap_cache(&event->ip_info);
+        }
+        boot_timeline_mark("wifi_got_ip");
+        xEventGroupClearBits(s_wifi_event_group, WIFI_FAIL_BIT);
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        set_status(WIFI_STATUS_CONNECTED);
     }
 }
 
@@ -97,6 +752,33 @@ esp_err_t wifi_control_init(const wifi_config_params_t *config)
         return ESP_ERR_NO_MEM;
     }
 
+    // Yeniden bağlantı denemeleri olay görevini bekletmeden zamanlayıcıdan başlatılır
+    const esp_timer_create_args_t retry_timer_args = {
+        .callback = retry_timer_callback,
+        .name = "wifi_retry",
+    };
+    ret = esp_timer_create(&retry_timer_args, &s_retry_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Yeniden bağlantı zamanlayıcısı oluşturulamadı: %s", esp_err_to_name(ret));
+        vEventGroupDelete(s_wifi_event_group);
+        s_wifi_event_group = NULL;
+        return ret;
+    }
+
+    const esp_timer_create_args_t rssi_timer_args = {
+        .callback = rssi_timer_callback,
+        .name = "wifi_rssi",
+    };
+    ret = esp_timer_create(&rssi_timer_args, &s_rssi_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "RSSI zamanlayıcısı oluşturulamadı: %s", esp_err_to_name(ret));
+        esp_timer_delete(s_retry_timer);
+        s_retry_timer = NULL;
+        vEventGroupDelete(s_wifi_event_group);
+        s_wifi_event_group = NULL;
+        return ret;
+    }
+
     // TCP/IP yığını ve WiFi istasyonu başlat
     ESP_LOGI(TAG, "WiFi başlatılıyor...");
     ESP_ERROR_CHECK(esp_netif_init());
@@ -117,6 +799,11 @@ esp_err_t wifi_control_init(const wifi_config_params_t *config)
                                                       &wifi_event_handler,
                                                       NULL,
                                                       &s_instance_got_ip));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_CONTROL_EVENT,
+                                                      ESP_EVENT_ANY_ID,
+                                                      &wifi_event_handler,
+                                                      NULL,
+                                                      &s_instance_control));
 
     // WiFi yapılandırmasını ayarla
     wifi_config_t wifi_config = {
@@ -125,47 +812,135 @@ esp_err_t wifi_control_init(const wifi_config_params_t *config)
         },
     };
 
+    // Aday ağları kopyala, networks verilmediyse tek ağ ssid ve password'dür
+    wifi_network_t single = { .ssid = config->ssid, .password = config->password };
+    const wifi_network_t *networks = config->networks ? config->networks : &single;
+    int network_count = config->networks ? config->network_count : 1;
+    if (network_count > WIFI_CONTROL_MAX_NETWORKS) {
+        ESP_LOGW(TAG, "İlk %d ağ kullanılıyor", WIFI_CONTROL_MAX_NETWORKS);
+        network_count = WIFI_CONTROL_MAX_NETWORKS;
+    }
+    memset(s_networks, 0, sizeof(s_networks));
+    for (int i = 0; i < network_count; i++) {
+        if (networks[i].ssid != NULL) {
+            strlcpy(s_networks[i].ssid, networks[i].ssid, sizeof(s_networks[i].ssid));
+        }
+        if (networks[i].password != NULL) {
+            strlcpy(s_networks[i].password, networks[i].password, sizeof(s_networks[i].password));
+        }
+    }
+    s_network_count = network_count > 0 ? network_count : 1;
+
+    // Kayıtlı AP varsa taramadan doğrudan ona bağlan
+    s_fast_connect = config->fast_connect;
+    s_reuse_ip_lease = config->reuse_ip_lease;
+    s_ap_cache_valid = s_fast_connect && load_ap_cache();
+    s_directed = s_ap_cache_valid;
+    s_network_index = s_directed ? find_network(s_ap_cache.ssid) : 0;
+
     // SSID ve şifreyi güvenli bir şekilde kopyala
-    if (config->ssid != NULL) {
-        strlcpy((char *)wifi_config.sta.ssid, config->ssid, sizeof(wifi_config.sta.ssid));
+    strlcpy((char *)wifi_config.sta.ssid, s_networks[s_network_index].ssid, sizeof(wifi_config.sta.ssid));
+    strlcpy((char *)wifi_config.sta.password, s_networks[s_network_index].password, sizeof(wifi_config.sta.password));
+
+    if (s_directed) {
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, s_ap_cache.bssid, sizeof(wifi_config.sta.bssid));
+        wifi_config.sta.channel = s_ap_cache.channel;
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+        ESP_LOGI(TAG, "Kayıtlı AP ile bağlanılıyor, kanal %d", s_ap_cache.channel);
+    }
+    // MAX_MODEM'de AP, istasyon için gelen veriyi bu kadar işaretçi boyunca tutar
+    s_power_save = config->power_save;
+    s_listen_interval = config->listen_interval > 0 ? config->listen_interval : 3;
+    wifi_config.sta.listen_interval = s_listen_interval;
+
+    // Dolaşım ayarları, 802.11k/v ile AP de istasyonu daha uygun bir AP'ye yönlendirebilir
+    s_roam_threshold = config->roam_rssi_threshold;
+    s_roam_hysteresis = config->roam_rssi_hysteresis > 0 ? config->roam_rssi_hysteresis : 8;
+    s_roam_state = ROAM_IDLE;
+    s_scan_purpose = SCAN_NONE;
+    s_last_roam_scan_us = 0;
+    s_rssi_count = 0;
+    s_rssi_next = 0;
+    if (s_roam_threshold != 0) {
+        wifi_config.sta.rm_enabled = 1;
+        wifi_config.sta.btm_enabled = 1;
     }
+    s_wifi_config = wifi_config;
+    s_config_dirty = false;
 
-    if (config->password != NULL) {
-        strlcpy((char *)wifi_config.sta.password, config->password, sizeof(wifi_config.sta.password));
+    s_has_static_ip = config->static_ip != NULL;
+    if (s_has_static_ip) {
+        s_static_ip = *config->static_ip;
+        s_static_dns = config->static_dns;
     }
+    s_dhcp_stopped = false;
+    s_first_attempt_us = 0;
+    s_fell_back = false;
 
     // Konfigurasyon değerlerini kaydet
     s_max_retry = (config->max_retry > 0) ? config->max_retry : 5;
     s_auto_reconnect = config->auto_reconnect;
     s_retry_num = 0;
+    s_retry_interval_ms = (config->retry_interval_ms > 0) ? config->retry_interval_ms : 1000;
+    s_retry_interval_max_ms = (config->retry_interval_max_ms > 0) ? config->retry_interval_max_ms : 60000;
+    if (s_retry_interval_max_ms < s_retry_interval_ms) {
+        s_retry_interval_max_ms = s_retry_interval_ms;
+    }
+    s_user_disconnect = false;
+    s_status_callback = config->status_callback;
+    s_user_context = config->user_context;
 
     // WiFi modunu ayarla ve başlat
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config));
+    ret = esp_wifi_set_ps(to_wifi_ps_type(s_power_save));
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Güç tasarrufu modu ayarlanamadı: %s", esp_err_to_name(ret));
+    }
     ESP_ERROR_CHECK(esp_wifi_start());
+    int rssi_interval_ms = config->rssi_interval_ms > 0 ? config->rssi_interval_ms : 5000;
+    esp_timer_start_periodic(s_rssi_timer, (uint64_t)rssi_interval_ms * 1000);
 
-    ESP_LOGI(TAG, "WiFi başlatıldı, \"%s\" ağına bağlanmaya çalışılıyor", config->ssid);
-    s_wifi_status = WIFI_STATUS_CONNECTING;
+    ESP_LOGI(TAG, "WiFi başlatıldı, \"%s\" ağına bağlanmaya çalışılıyor", s_networks[s_network_index].ssid);
+    boot_timeline_mark("wifi_started");
+    set_status(WIFI_STATUS_CONNECTING);
     s_is_initialized = true;
 
+    // Asenkron modda sonuç status_callback ile bildirilir
+    if (config->async_init) {
+        return ESP_OK;
+    }
+
     // Bağlantının tamamlanmasını bekle
+    ret = wifi_control_wait_connected(-1);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "WiFi ağına bağlandı: %s", s_networks[s_network_index].ssid);
+    } else {
+        ESP_LOGE(TAG, "WiFi ağına bağlanılamadı: %s", s_networks[s_network_index].ssid);
+    }
+    return ret;
+}
+
+esp_err_t wifi_control_wait_connected(int timeout_ms)
+{
+    if (s_wifi_event_group == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
     EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
                                          WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
                                          pdFALSE, // Bitleri temizleme
                                          pdFALSE, // Her iki biti beklemiyoruz
-                                         portMAX_DELAY);
+                                         timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
 
     // Bağlantı durumunu kontrol et
     if (bits & WIFI_CONNECTED_BIT) {
-        ESP_LOGI(TAG, "WiFi ağına bağlandı: %s", config->ssid);
         return ESP_OK;
     } else if (bits & WIFI_FAIL_BIT) {
-        ESP_LOGE(TAG, "WiFi ağına bağlanılamadı: %s", config->ssid);
         return ESP_FAIL;
-    } else {
-        ESP_LOGE(TAG, "Beklenmeyen durum");
-        return ESP_ERR_INVALID_STATE;
     }
+    return ESP_ERR_TIMEOUT;
 }
 
 esp_err_t wifi_control_disconnect(void)
@@ -174,9 +949,14 @@ esp_err_t wifi_control_disconnect(void)
         return ESP_ERR_INVALID_STATE;
     }
 
+    // Bekleyen deneme iptal edilir, wifi_control_reconnect() çağrılana kadar bağlanılmaz
+    s_user_disconnect = true;
+    esp_timer_stop(s_retry_timer);
+    s_roam_state = ROAM_IDLE;
+
     esp_err_t ret = esp_wifi_disconnect();
     if (ret == ESP_OK) {
-        s_wifi_status = WIFI_STATUS_DISCONNECTED;
+        set_status(WIFI_STATUS_DISCONNECTED);
         ESP_LOGI(TAG, "WiFi bağlantısı kesildi");
     } else {
         ESP_LOGE(TAG, "WiFi bağlantısı kesilemedi: %s", esp_err_to_name(ret));
@@ -205,6 +985,11 @@ esp_err_t wifi_control_deinit(void)
         s_instance_got_ip = NULL;
     }
 
+    if (s_instance_control != NULL) {
+        esp_event_handler_instance_unregister(WIFI_CONTROL_EVENT, ESP_EVENT_ANY_ID, s_instance_control);
+        s_instance_control = NULL;
+    }
+
     // WiFi'yi durdur
     esp_err_t ret = esp_wifi_stop();
     if (ret != ESP_OK) {
@@ -219,6 +1004,18 @@ esp_err_t wifi_control_deinit(void)
         return ret;
     }
 
+    if (s_retry_timer != NULL) {
+        esp_timer_stop(s_retry_timer);
+        esp_timer_delete(s_retry_timer);
+        s_retry_timer = NULL;
+    }
+
+    if (s_rssi_timer != NULL) {
+        esp_timer_stop(s_rssi_timer);
+        esp_timer_delete(s_rssi_timer);
+        s_rssi_timer = NULL;
+    }
+
     // Olay grubunu temizle
     if (s_wifi_event_group != NULL) {
         vEventGroupDelete(s_wifi_event_group);
@@ -228,6 +1025,10 @@ esp_err_t wifi_control_deinit(void)
     s_sta_netif = NULL;
     s_is_initialized = false;
     s_wifi_status = WIFI_STATUS_DISCONNECTED;
+    s_status_callback = NULL;
+    s_user_context = NULL;
+    s_directed = false;
+    s_dhcp_stopped = false;
 
     ESP_LOGI(TAG, "WiFi kaynakları temizlendi");
     return ESP_OK;
@@ -253,23 +1054,75 @@ esp_err_t wifi_control_reconnect(void)
         return ESP_ERR_INVALID_STATE;
     }
 
-    // Bağlantı zaten varsa, önce mevcut bağlantıyı kes
-    if (s_wifi_status == WIFI_STATUS_CONNECTED) {
-        wifi_control_disconnect();
-    }
+    // Bağlantı durumu olay döngüsü görevinde değişir, deneme orada başlatılır
+    return esp_event_post(WIFI_CONTROL_EVENT, WIFI_CONTROL_EVENT_RECONNECT, NULL, 0, portMAX_DELAY);
+}
 
-    // Bağlantı parametrelerini sıfırla
-    s_retry_num = 0;
-    s_wifi_status = WIFI_STATUS_CONNECTING;
+esp_err_t wifi_control_set_power_save(wifi_power_save_t mode, uint16_t listen_interval)
+{
+    if (!s_is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    // Yeniden bağlan
-    esp_err_t ret = esp_wifi_connect();
+    esp_err_t ret = esp_wifi_set_ps(to_wifi_ps_type(mode));
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Yeniden bağlantı başlatılamadı: %s", esp_err_to_name(ret));
-        s_wifi_status = WIFI_STATUS_FAILED;
-    } else {
-        ESP_LOGI(TAG, "Yeniden bağlantı başlatıldı");
+        ESP_LOGE(TAG, "Güç tasarrufu modu ayarlanamadı: %s", esp_err_to_name(ret));
+        return ret;
     }
+    s_power_save = mode;
 
-    return ret;
-}
\ No newline at end of file
+    // Bağlıyken yapılandırmayı değiştirmek bağlantıyı koparır, bir sonraki bağlantıda uygulanır
+    if (listen_interval > 0 && listen_interval != s_listen_interval) {
+        s_listen_interval = listen_interval;
+        s_wifi_config.sta.listen_interval = listen_interval;
+        s_config_dirty = true;
+    }
+    return ESP_OK;
+}
+
+wifi_power_save_t wifi_control_get_power_save(uint16_t *listen_interval)
+{
+    if (listen_interval != NULL) {
+        *listen_interval = s_listen_interval;
+    }
+    return s_power_save == WIFI_POWER_SAVE_DEFAULT ? WIFI_POWER_SAVE_MIN_MODEM : s_power_save;
+}
+
+int wifi_control_get_rssi_history(int8_t *rssi, int max_samples)
+{
+    if (rssi == NULL || max_samples <= 0) {
+        return 0;
+    }
+
+    portENTER_CRITICAL(&s_rssi_lock);
+    int count = s_rssi_count < max_samples ? s_rssi_count : max_samples;
+    for (int i = 0; i < count; i++) {
+        rssi[i] = s_rssi_history[(s_rssi_next - count + i + WIFI_CONTROL_RSSI_HISTORY) % WIFI_CONTROL_RSSI_HISTORY];
+    }
+    portEXIT_CRITICAL(&s_rssi_lock);
+    return count;
+}
+
+esp_err_t wifi_control_get_connect_timings(wifi_connect_timings_t *timings)
+{
+    if (timings == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_timings_lock);
+    bool valid = s_timings_valid;
+    *timings = s_timings;
+    portEXIT_CRITICAL(&s_timings_lock);
+
+    return valid ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t wifi_control_forget_ap(void)
+{
+    if (!s_is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    erase_ap_cache();
+    return ESP_OK;
+}
@@ -8,6 +8,10 @@
 #include <esp_err.h>
 #include <esp_netif.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#define WIFI_CONTROL_MAX_NETWORKS 4   ///< En fazla aday ağ sayısı
+#define WIFI_CONTROL_RSSI_HISTORY 32  ///< Saklanan RSSI örneği sayısı
 
 /**
  * @brief WiFi bağlantı durumları
@@ -19,22 +23,86 @@ typedef enum {
     WIFI_STATUS_FAILED            ///< WiFi bağlantısı başarısız oldu
 } wifi_connection_status_t;
 
+/**
+ * @brief Aday WiFi ağı
+ */
+typedef struct {
+    const char *ssid;             ///< WiFi SSID
+    const char *password;         ///< WiFi Şifresi
+} wifi_network_t;
+
+/**
+ * @brief WiFi güç tasarrufu modları
+ */
+typedef enum {
+    WIFI_POWER_SAVE_DEFAULT = 0,  ///< ESP-IDF varsayılanı, MIN_MODEM ile aynı
+    WIFI_POWER_SAVE_NONE,         ///< Radyo sürekli açık, en düşük gecikme, light sleep ile kullanılamaz
+    WIFI_POWER_SAVE_MIN_MODEM,    ///< Her DTIM işaretçisinde uyanır
+    WIFI_POWER_SAVE_MAX_MODEM,    ///< listen_interval işaretçide bir uyanır, gelen veri o kadar gecikebilir
+} wifi_power_save_t;
+
+/**
+ * @brief WiFi durumu değiştiğinde çağrılır, WiFi olay görevinde çalışır
+ */
+typedef void (*wifi_status_callback_t)(wifi_connection_status_t status, void *user_context);
+
 /**
  * @brief WiFi yapılandırma parametreleri
  */
 typedef struct {
     const char *ssid;             ///< WiFi SSID
     const char *password;         ///< WiFi Şifresi
-    int max_retry;                ///< Maksimum yeniden bağlantı denemesi
-    bool auto_reconnect;          ///< Otomatik yeniden bağlantı
-    int retry_interval_ms;        ///< Yeniden bağlantı aralığı (ms)
+    const wifi_network_t *networks; ///< Aday ağlar, NULL değilse ssid ve password yerine kullanılır
+    int network_count;            ///< networks dizisindeki ağ sayısı, en fazla WIFI_CONTROL_MAX_NETWORKS
+    int max_retry;                ///< Bağlantı başarısız sayılmadan önceki deneme sayısı
+    bool auto_reconnect;          ///< Otomatik yeniden bağlantı, başarısız sayıldıktan sonra da arka planda sürer
+    int retry_interval_ms;        ///< İlk yeniden bağlantı bekleme süresi (ms), her denemede ikiye katlanır
+    int retry_interval_max_ms;    ///< Bekleme süresinin üst sınırı (ms), 0 ise 60000
+    bool async_init;              ///< wifi_control_init() bağlantıyı beklemeden döner
+    wifi_status_callback_t status_callback; ///< Durum değişikliği bildirimi, NULL olabilir
+    void *user_context;           ///< status_callback'e verilen bağlam
+    bool fast_connect;            ///< Son AP'nin BSSID ve kanalını NVS'de saklar, önce taramasız ona bağlanır
+    bool reuse_ip_lease;          ///< fast_connect ile bağlanınca DHCP yerine son alınan IP kullanılır
+    const esp_netif_ip_info_t *static_ip; ///< NULL değilse DHCP yerine bu adres kullanılır
+    esp_ip4_addr_t static_dns;    ///< static_ip ile kullanılacak DNS sunucusu, 0 ise ayarlanmaz
+    wifi_power_save_t power_save; ///< Modem uyku modu
+    uint16_t listen_interval;     ///< MAX_MODEM'de kaç işaretçide bir uyanılacağı, 0 ise 3
+    int roam_rssi_threshold;      ///< Sinyal bu değerin altına düşünce daha güçlü AP aranır (dBm), 0 ise dolaşım kapalı
+    int roam_rssi_hysteresis;     ///< Yeni AP'nin mevcut AP'den en az bu kadar güçlü olması gerekir (dB), 0 ise 8
+    int rssi_interval_ms;         ///< RSSI örnekleme aralığı (ms), 0 ise 5000
 } wifi_config_params_t;
 
+/**
+ * @brief Son bağlantının aşama süreleri
+ *
+ * Süreler esp_wifi_connect() çağrısından itibaren ölçülür. Kayıtlı AP ile bağlanılamayıp
+ * tam taramaya geçildiyse total_ms başarısız denemeyi de kapsar.
+ */
+typedef struct {
+    uint32_t associate_ms;        ///< Tarama, kimlik doğrulama ve AP'ye bağlanma
+    uint32_t ip_ms;               ///< AP'ye bağlandıktan IP alınana kadar (DHCP)
+    uint32_t total_ms;            ///< İlk denemeden IP alınana kadar
+    bool used_cache;              ///< Kayıtlı BSSID ve kanal ile taramasız bağlanıldı
+    bool reused_ip;               ///< DHCP atlanıp kayıtlı veya statik IP kullanıldı
+    bool fell_back;               ///< Kayıtlı AP ile bağlanılamadı, tam taramaya geçildi
+} wifi_connect_timings_t;
+
 /**
  * @brief WiFi modülünü başlatır ve bağlantı kurar
+ *
+ * async_init ayarlıysa bağlantıyı başlatıp hemen döner, sonuç status_callback ile
+ * bildirilir veya wifi_control_wait_connected() ile beklenir.
  */
 esp_err_t wifi_control_init(const wifi_config_params_t *config);
 
+/**
+ * @brief Bağlantının kurulmasını veya başarısız olmasını bekler
+ *
+ * @param timeout_ms Bekleme süresi, negatifse süresiz
+ * @return ESP_OK bağlandı, ESP_FAIL bağlanamadı, ESP_ERR_TIMEOUT süre doldu
+ */
+esp_err_t wifi_control_wait_connected(int timeout_ms);
+
 /**
  * @brief Mevcut bir WiFi bağlantısını keser
  */
@@ -57,7 +125,48 @@ esp_err_t wifi_control_get_ip_info(esp_netif_ip_info_t *ip_info);
 
 /**
  * @brief Bağlantı yeniden kurulumu için bir deneme başlatır
+ *
+ * Deneme olay döngüsü görevinde başlar, başarısı durum geri çağrısıyla bildirilir.
+ *
+ * @return ESP_OK istek olay döngüsüne iletildiyse
  */
 esp_err_t wifi_control_reconnect(void);
 
+/**
+ * @brief Modem uyku modunu değiştirir
+ *
+ * listen_interval AP'ye bildirildiği için yeni değer bir sonraki bağlantıda geçerli olur.
+ *
+ * @param listen_interval MAX_MODEM'de kaç işaretçide bir uyanılacağı, 0 ise değişmez
+ */
+esp_err_t wifi_control_set_power_save(wifi_power_save_t mode, uint16_t listen_interval);
+
+/**
+ * @brief Geçerli modem uyku modunu döndürür
+ *
+ * @param listen_interval NULL değilse listen_interval yazılır
+ */
+wifi_power_save_t wifi_control_get_power_save(uint16_t *listen_interval);
+
+/**
+ * @brief Bağlı olunan AP'nin son RSSI örneklerini döndürür
+ *
+ * @param rssi En eskisinden başlayarak örnekler (dBm)
+ * @param max_samples rssi dizisinin uzunluğu
+ * @return Yazılan örnek sayısı
+ */
+int wifi_control_get_rssi_history(int8_t *rssi, int max_samples);
+
+/**
+ * @brief Son başarılı bağlantının aşama sürelerini döndürür
+ *
+ * @return ESP_ERR_NOT_FOUND henüz bağlanılmadıysa
+ */
+esp_err_t wifi_control_get_connect_timings(wifi_connect_timings_t *timings);
+
+/**
+ * @brief NVS'de saklanan AP ve IP bilgisini siler, sonraki bağlantı tam tarama ile yapılır
+ */
+esp_err_t wifi_control_forget_ap(void);
+
 #endif // WIFI_CONTROL_H
\ No newline at end of file
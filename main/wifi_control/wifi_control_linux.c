@@ -0,0 +1,155 @@
+/**
+ * @file wifi_control_linux.c
+ * @brief Linux hedefi için WiFi kontrol modülü
+ *
+ * Host'ta radyo yoktur, ağ her zaman hazırdır: init bağlandı olarak bildirir, disconnect ve
+ * reconnect yalnızca durumu değiştirir. Böylece WebSocket'in bekletilip sürdürülmesi de
+ * host'ta denenebilir.
+ */
+#include "wifi_control.h"
+#include <esp_log.h>
+#include <string.h>
+
+static const char *TAG = "WIFI_CONTROL";
+
+static bool s_is_initialized = false;
+static wifi_connection_status_t s_wifi_status = WIFI_STATUS_DISCONNECTED;
+static wifi_status_callback_t s_status_callback = NULL;
+static void *s_user_context = NULL;
+static wifi_power_save_t s_power_save = WIFI_POWER_SAVE_DEFAULT;
+static uint16_t s_listen_interval = 3;
+
+static void set_status(wifi_connection_status_t status)
+{
+    if (s_wifi_status == status) {
+        return;
+    }
+    s_wifi_status = status;
+    if (s_status_callback) {
+        s_status_callback(status, s_user_context);
+    }
+}
+
+esp_err_t wifi_control_init(const wifi_config_params_t *config)
+{
+    if (s_is_initialized) {
+        ESP_LOGW(TAG, "WiFi zaten başlatılmış");
+        return ESP_OK;
+    }
+    if (config == NULL) {
+        ESP_LOGE(TAG, "Geçersiz yapılandırma parametresi");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_status_callback = config->status_callback;
+    s_user_context = config->user_context;
+    s_power_save = config->power_save;
+    s_listen_interval = config->listen_interval ? config->listen_interval : 3;
+    s_is_initialized = true;
+
+    ESP_LOGI(TAG, "Linux hedefi, host ağı kullanılıyor");
+    set_status(WIFI_STATUS_CONNECTING);
+    set_status(WIFI_STATUS_CONNECTED);
+    return ESP_OK;
+}
+
+esp_err_t wifi_control_wait_connected(int timeout_ms)
+{
+    if (!s_is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return s_wifi_status == WIFI_STATUS_CONNECTED ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t wifi_control_disconnect(void)
+{
+    if (!s_is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    set_status(WIFI_STATUS_DISCONNECTED);
+    return ESP_OK;
+}
+
+esp_err_t wifi_control_deinit(void)
+{
+    if (!s_is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    set_status(WIFI_STATUS_DISCONNECTED);
+    s_status_callback = NULL;
+    s_user_context = NULL;
+    s_is_initialized = false;
+    return ESP_OK;
+}
+
+wifi_connection_status_t wifi_control_get_status(void)
+{
+    return s_wifi_status;
+}
+
+esp_err_t wifi_control_get_ip_info(esp_netif_ip_info_t *ip_info)
+{
+    if (ip_info == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_wifi_status != WIFI_STATUS_CONNECTED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Geri döngü adresi, host'un gerçek adresleri burada önemli değil
+    memset(ip_info, 0, sizeof(*ip_info));
+    ip_info->ip.addr = ESP_IP4TOADDR(127, 0, 0, 1);
+    ip_info->netmask.addr = ESP_IP4TOADDR(255, 0, 0, 0);
+    return ESP_OK;
+}
+
+esp_err_t wifi_control_reconnect(void)
+{
+    if (!s_is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    set_status(WIFI_STATUS_CONNECTING);
+    set_status(WIFI_STATUS_CONNECTED);
+    return ESP_OK;
+}
+
+esp_err_t wifi_control_set_power_save(wifi_power_save_t mode, uint16_t listen_interval)
+{
+    if (!s_is_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_power_save = mode;
+    if (listen_interval) {
+        s_listen_interval = listen_interval;
+    }
+    return ESP_OK;
+}
+
+wifi_power_save_t wifi_control_get_power_save(uint16_t *listen_interval)
+{
+    if (listen_interval) {
+        *listen_interval = s_listen_interval;
+    }
+    return s_power_save == WIFI_POWER_SAVE_DEFAULT ? WIFI_POWER_SAVE_MIN_MODEM : s_power_save;
+}
+
+int wifi_control_get_rssi_history(int8_t *rssi, int max_samples)
+{
+    return 0;
+}
+
+esp_err_t wifi_control_get_connect_timings(wifi_connect_timings_t *timings)
+{
+    if (timings == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_is_initialized) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    memset(timings, 0, sizeof(*timings));
+    return ESP_OK;
+}
+
+esp_err_t wifi_control_forget_ap(void)
+{
+    return s_is_initialized ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
@@ -0,0 +1,196 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/queue.h>
+#include "esp_websocket_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "websocket_pool";
+
+#define POOL_MIN_CLASS_SIZE         (256)
+#define POOL_SIZE_CLASSES           (8)     /* 256 B up to 32 KB, bigger leases are allocated on their own */
+#define POOL_OVERSIZE_CLASS         (POOL_SIZE_CLASSES)
+#define POOL_MAX_FREE_PER_CLASS     (2)
+#define POOL_IDLE_TIMEOUT_MS        (5000)
+
+/* Placed in front of every buffer, its size keeps the payload aligned to 8 bytes */
+typedef struct pool_buffer {
+    SLIST_ENTRY(pool_buffer)    next;
+    uint64_t                    returned_ms;
+    uint32_t                    size;
+    uint32_t                    size_class;
+} pool_buffer_t;
+
+struct esp_websocket_buffer_pool {
+    SemaphoreHandle_t           lock;
+    int                         max_free_per_class;
+    int                         idle_timeout_ms;
+    SLIST_HEAD(, pool_buffer)   free_list[POOL_SIZE_CLASSES];
+    int                         free_count[POOL_SIZE_CLASSES];
+    esp_websocket_buffer_pool_stats_t stats;
+};
+
+static uint64_t _tick_get_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+static uint32_t pool_size_class(size_t size)
+{
+    uint32_t size_class = 0;
+    while (size_class < POOL_SIZE_CLASSES && size > (POOL_MIN_CLASS_SIZE << size_class)) {
+        size_class++;
+    }
+    return size_class;
+}
+
+static void pool_update_peak(esp_websocket_buffer_pool_handle_t pool)
+{
+    size_t held = pool->stats.leased_bytes + pool->stats.cached_bytes;
+    if (held > pool->stats.peak_bytes) {
+        pool->stats.peak_bytes = held;
+    }
+}
+
+/* Must be called with the pool locked */
+static void pool_trim(esp_websocket_buffer_pool_handle_t pool, bool all)
+{
+    uint64_t now = _tick_get_ms();
+    for (int i = 0; i < POOL_SIZE_CLASSES; i++) {
+        pool_buffer_t *buf = SLIST_FIRST(&pool->free_list[i]);
+        while (buf) {
+            pool_buffer_t *next = SLIST_NEXT(buf, next);
+            if (all || now - buf->returned_ms >= (uint64_t)pool->idle_timeout_ms) {
+                SLIST_REMOVE(&pool->free_list[i], buf, pool_buffer, next);
+                pool->free_count[i]--;
+                pool->stats.cached_bytes -= buf->size;
+                pool->stats.frees++;
+                free(buf);
+            }
+            buf = next;
+        }
+    }
+}
+
+esp_websocket_buffer_pool_handle_t esp_websocket_buffer_pool_create(const esp_websocket_buffer_pool_config_t *config)
+{
+    esp_websocket_buffer_pool_handle_t pool = calloc(1, sizeof(struct esp_websocket_buffer_pool));
+    if (pool == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate the buffer pool");
+        return NULL;
+    }
+    pool->lock = xSemaphoreCreateMutex();
+    if (pool->lock == NULL) {
+        ESP_LOGE(TAG, "Failed to create the buffer pool lock");
+        free(pool);
+        return NULL;
+    }
+    pool->max_free_per_class = (config && config->max_free_per_class > 0) ? config->max_free_per_class : POOL_MAX_FREE_PER_CLASS;
+    pool->idle_timeout_ms = (config && config->idle_timeout_ms) ? config->idle_timeout_ms : POOL_IDLE_TIMEOUT_MS;
+    for (int i = 0; i < POOL_SIZE_CLASSES; i++) {
+        SLIST_INIT(&pool->free_list[i]);
+    }
+    return pool;
+}
+
+esp_err_t esp_websocket_buffer_pool_destroy(esp_websocket_buffer_pool_handle_t pool)
+{
+    if (pool == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(pool->lock, portMAX_DELAY);
+    if (pool->stats.leased_bytes) {
+        xSemaphoreGive(pool->lock);
+        ESP_LOGE(TAG, "%zu bytes are still leased", pool->stats.leased_bytes);
+        return ESP_ERR_INVALID_STATE;
+    }
+    pool_trim(pool, true);
+    xSemaphoreGive(pool->lock);
+    vSemaphoreDelete(pool->lock);
+    free(pool);
+    return ESP_OK;
+}
+
+void *esp_websocket_buffer_pool_lease(esp_websocket_buffer_pool_handle_t pool, size_t size)
+{
+    uint32_t size_class = pool_size_class(size);
+    pool_buffer_t *buf = NULL;
+
+    xSemaphoreTake(pool->lock, portMAX_DELAY);
+    if (size_class != POOL_OVERSIZE_CLASS) {
+        buf = SLIST_FIRST(&pool->free_list[size_class]);
+    }
+    if (buf) {
+        SLIST_REMOVE_HEAD(&pool->free_list[size_class], next);
+        pool->free_count[size_class]--;
+        pool->stats.cached_bytes -= buf->size;
+        pool->stats.reuses++;
+    } else {
+        size_t buf_size = size_class == POOL_OVERSIZE_CLASS ? size : POOL_MIN_CLASS_SIZE << size_class;
+        // allocating under the lock keeps the statistics consistent, leases are short and rare enough
+        buf = malloc(sizeof(pool_buffer_t) + buf_size);
+        if (buf == NULL) {
+            xSemaphoreGive(pool->lock);
+            ESP_LOGE(TAG, "Failed to allocate a buffer of %zu bytes", buf_size);
+            return NULL;
+        }
+        buf->size = buf_size;
+        buf->size_class = size_class;
+        pool->stats.allocs++;
+    }
+    pool->stats.leases++;
+    pool->stats.leased_bytes += buf->size;
+    pool_update_peak(pool);
+    xSemaphoreGive(pool->lock);
+    return buf + 1;
+}
+
+void esp_websocket_buffer_pool_return(esp_websocket_buffer_pool_handle_t pool, void *buffer)
+{
+    if (buffer == NULL) {
+        return;
+    }
+    pool_buffer_t *buf = (pool_buffer_t *)buffer - 1;
+
+    xSemaphoreTake(pool->lock, portMAX_DELAY);
+    pool->stats.leased_bytes -= buf->size;
+    if (buf->size_class == POOL_OVERSIZE_CLASS || pool->free_count[buf->size_class] >= pool->max_free_per_class) {
+        pool->stats.frees++;
+        free(buf);
+    } else {
+        buf->returned_ms = _tick_get_ms();
+        SLIST_INSERT_HEAD(&pool->free_list[buf->size_class], buf, next);
+        pool->free_count[buf->size_class]++;
+        pool->stats.cached_bytes += buf->size;
+    }
+    xSemaphoreGive(pool->lock);
+}
+
+void esp_websocket_buffer_pool_trim(esp_websocket_buffer_pool_handle_t pool)
+{
+    if (pool == NULL || pool->idle_timeout_ms < 0) {
+        return;
+    }
+    xSemaphoreTake(pool->lock, portMAX_DELAY);
+    pool_trim(pool, false);
+    xSemaphoreGive(pool->lock);
+}
+
+esp_err_t esp_websocket_buffer_pool_get_stats(esp_websocket_buffer_pool_handle_t pool, esp_websocket_buffer_pool_stats_t *stats)
+{
+    if (pool == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(pool->lock, portMAX_DELAY);
+    *stats = pool->stats;
+    xSemaphoreGive(pool->lock);
+    return ESP_OK;
+}
@@ -20,8 +20,21 @@
 #include "esp_timer.h"
 #include "esp_tls_crypto.h"
 #include "esp_system.h"
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_random.h"
+#endif
 #include <errno.h>
 #include <arpa/inet.h>
+#include <sys/queue.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+#include "esp_websocket_deflate.h"
+#include "esp_websocket_transport_response.h"
+#endif
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+#include "esp_websocket_transport_tls.h"
+#endif
 
 static const char *TAG = "websocket_client";
 
@@ -29,15 +42,28 @@ static const char *TAG = "websocket_client";
 #define WEBSOCKET_SSL_DEFAULT_PORT      (443)
 #define WEBSOCKET_BUFFER_SIZE_BYTE      (1024)
 #define WEBSOCKET_RECONNECT_TIMEOUT_MS  (10*1000)
+#define WEBSOCKET_BACKOFF_MULTIPLIER    (2.0f)
 #define WEBSOCKET_TASK_PRIORITY         (5)
 #define WEBSOCKET_TASK_STACK            (4*1024)
 #define WEBSOCKET_NETWORK_TIMEOUT_MS    (10*1000)
 #define WEBSOCKET_PING_INTERVAL_SEC     (10)
+#define WEBSOCKET_PING_INTERVAL_MIN_SEC (1)
+#define WEBSOCKET_CONTROL_FRAME_MAX     (125)   // maximum payload of a control frame, RFC 6455 section 5.5
+#define WEBSOCKET_RTT_WINDOW            (32)    // RTT samples kept for the statistics
+#define WEBSOCKET_RTT_SPIKE_FACTOR      (3)     // an RTT above this multiple of the recent average tightens the ping interval
 #define WEBSOCKET_EVENT_QUEUE_SIZE      (1)
 #define WEBSOCKET_PINGPONG_TIMEOUT_SEC  (120)
 #define WEBSOCKET_KEEP_ALIVE_IDLE       (5)
 #define WEBSOCKET_KEEP_ALIVE_INTERVAL   (5)
 #define WEBSOCKET_KEEP_ALIVE_COUNT      (3)
+#define WEBSOCKET_MANAGER_POLL_MS       (1000)
+#define WEBSOCKET_MANAGER_STEP_MS       (1000)
+#define WEBSOCKET_CLOSE_WAIT_MS         (1000)
+#define WEBSOCKET_DEFLATE_SERVER_BITS   (15)
+#define WEBSOCKET_DEFLATE_CLIENT_BITS   (10)
+#define WEBSOCKET_DEFLATE_OFFER_LEN     (160)
+#define WEBSOCKET_DEFLATE_ANSWER_LEN    (160)   // longest Sec-WebSocket-Extensions answer the client parses
+#define WEBSOCKET_OPCODE_RSV1           (0x40)  // Marks the first frame of a compressed message
 
 #define ESP_WS_CLIENT_MEM_CHECK(TAG, a, action) if (!(a)) {                                         \
         ESP_LOGE(TAG,"%s(%d): %s", __FUNCTION__, __LINE__, "Memory exhausted");                     \
@@ -63,6 +89,8 @@ static const char *TAG = "websocket_client";
 
 const static int STOPPED_BIT = BIT0;
 const static int CLOSE_FRAME_SENT_BIT = BIT1;   // Indicates that a close frame was sent by the client
+const static int RECONNECT_NOW_BIT = BIT2;      // Cuts the reconnect wait short, also wakes the waiting task on stop
+const static int PAUSED_BIT = BIT3;             // Keeps the client disconnected until resumed, survives a restart
 // and we are waiting for the server to continue with clean close
 
 ESP_EVENT_DEFINE_BASE(WEBSOCKET_EVENTS);
@@ -71,6 +99,7 @@ typedef struct {
     const char                 *task_name;
     int                         task_stack;
     int                         task_prio;
+    BaseType_t                  task_core_id;
     char                        *uri;
     char                        *host;
     char                        *path;
@@ -80,6 +109,9 @@ typedef struct {
     char                        *auth;
     int                         port;
     bool                        auto_reconnect;
+    int                         reconnect_backoff_max_ms;
+    float                       reconnect_backoff_multiplier;
+    bool                        reconnect_backoff_jitter;
     void                        *user_context;
     int                         network_timeout_ms;
     char                        *subprotocol;
@@ -87,6 +119,9 @@ typedef struct {
     char                        *headers;
     int                         pingpong_timeout_sec;
     size_t                      ping_interval_sec;
+    bool                        ping_adaptive;
+    size_t                      ping_interval_min_sec;
+    size_t                      ping_interval_max_sec;
     const char                  *cert;
     size_t                      cert_len;
     const char                  *client_cert;
@@ -101,6 +136,7 @@ typedef struct {
     const char                  *cert_common_name;
     esp_err_t                   (*crt_bundle_attach)(void *conf);
     esp_transport_handle_t      ext_transport;
+    bool                        tls_session_resumption;
 } websocket_config_storage_t;
 
 typedef enum {
@@ -124,7 +160,18 @@ struct esp_websocket_client {
     uint64_t                    reconnect_tick_ms;
     uint64_t                    ping_tick_ms;
     uint64_t                    pingpong_tick_ms;
+    uint32_t                    ping_interval_ms;       // current interval, adapted with ping_adaptive_enable
+    int64_t                     ping_sent_us;           // timestamp carried by the PING awaiting its PONG, 0 if none
+    uint32_t                    rtt_window[WEBSOCKET_RTT_WINDOW];
+    uint32_t                    rtt_samples;
+    uint32_t                    rtt_spikes;
+    uint32_t                    pings_sent;
     int                         wait_timeout_ms;
+    int                         reconnect_backoff_ms;   // upper bound of the next reconnect delay
+    int                         reconnect_delay_ms;     // delay of the current wait
+    uint64_t                    disconnect_tick_ms;     // start of the outage, 0 while connected
+    esp_websocket_reconnect_stats_t reconnect_stats;
+    esp_websocket_tls_stats_t   tls_stats;
     bool                        run;
     bool                        wait_for_pong_resp;
     bool                        selected_for_destroying;
@@ -139,8 +186,48 @@ struct esp_websocket_client {
     ws_transport_opcodes_t      last_opcode;
     int                         payload_len;
     int                         payload_offset;
+    int64_t                     read_time_us;
+    uint32_t                    read_duration_us;
+    char                        control_buffer[WEBSOCKET_CONTROL_FRAME_MAX];  // payload of the control frame being received, independent of buffer_size
     esp_transport_keep_alive_t  keep_alive_cfg;
     struct ifreq                *if_name;
+    esp_websocket_client_manager_handle_t manager;
+    bool                        manager_begin_pending;
+    bool                        manager_active;
+    int                         manager_read_select;
+    uint64_t                    close_tick_ms;
+    esp_websocket_buffer_pool_handle_t buffer_pool;
+    bool                        own_buffer_pool;
+    STAILQ_ENTRY(esp_websocket_client) manager_entry;
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+    esp_websocket_deflate_handle_t deflate;
+    esp_websocket_inflate_handle_t inflate;
+    char                        *inflate_buffer;
+    esp_transport_handle_t      response_transport; // between the websocket transport and its parent, sees the answer to the offer
+    bool                        deflate_active;     // the server accepted the offer on this connection
+    int                         deflate_client_bits;
+    int                         deflate_server_bits;
+    bool                        deflate_offer_client_no_context_takeover;
+    bool                        deflate_offer_server_no_context_takeover;
+    bool                        deflate_client_no_context_takeover; // as negotiated on this connection
+    bool                        deflate_server_no_context_takeover;
+    bool                        inflate_message;
+    int                         inflate_offset;
+    size_t                      inflate_pending;
+    bool                        inflate_failed;     // explained once, the server rarely changes between reconnects
+#endif
+};
+
+struct esp_websocket_client_manager {
+    TaskHandle_t                task_handle;
+    SemaphoreHandle_t           lock;
+    EventGroupHandle_t          status_bits;
+    char                        *rx_buffer;
+    int                         buffer_size;
+    int                         poll_interval_ms;
+    int                         step_timeout_ms;
+    bool                        run;
+    STAILQ_HEAD(, esp_websocket_client) clients;
 };
 
 static uint64_t _tick_get_ms(void)
@@ -148,22 +235,28 @@ static uint64_t _tick_get_ms(void)
     return esp_timer_get_time() / 1000;
 }
 
+/* Managed clients share the manager task, one of them must not hold it for network_timeout_ms */
+static int esp_websocket_client_io_timeout_ms(esp_websocket_client_handle_t client)
+{
+    if (client->manager && client->manager->step_timeout_ms < client->config->network_timeout_ms) {
+        return client->manager->step_timeout_ms;
+    }
+    return client->config->network_timeout_ms;
+}
+
 static esp_err_t esp_websocket_new_buf(esp_websocket_client_handle_t client, bool is_tx)
 {
 #ifdef CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER
-    if (is_tx) {
-        if (client->tx_buffer) {
-            free(client->tx_buffer);
-        }
-
-        client->tx_buffer = calloc(1, client->buffer_size);
+    if (!is_tx && client->manager) {
+        // managed clients are read one at a time by the manager task, they share its rx buffer
+        client->rx_buffer = client->manager->rx_buffer;
+    } else if (is_tx) {
+        esp_websocket_buffer_pool_return(client->buffer_pool, client->tx_buffer);
+        client->tx_buffer = esp_websocket_buffer_pool_lease(client->buffer_pool, client->buffer_size);
         ESP_WS_CLIENT_MEM_CHECK(TAG, client->tx_buffer, return ESP_ERR_NO_MEM);
     } else {
-        if (client->rx_buffer) {
-            free(client->rx_buffer);
-        }
-
-        client->rx_buffer = calloc(1, client->buffer_size);
+        esp_websocket_buffer_pool_return(client->buffer_pool, client->rx_buffer);
+        client->rx_buffer = esp_websocket_buffer_pool_lease(client->buffer_pool, client->buffer_size);
         ESP_WS_CLIENT_MEM_CHECK(TAG, client->rx_buffer, return ESP_ERR_NO_MEM);
     }
 #endif
@@ -173,16 +266,14 @@ static esp_err_t esp_websocket_new_buf(esp_websocket_client_handle_t client, boo
 static void esp_websocket_free_buf(esp_websocket_client_handle_t client, bool is_tx)
 {
 #ifdef CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER
-    if (is_tx) {
-        if (client->tx_buffer) {
-            free(client->tx_buffer);
-            client->tx_buffer = NULL;
-        }
+    if (!is_tx && client->manager) {
+        client->rx_buffer = NULL;
+    } else if (is_tx) {
+        esp_websocket_buffer_pool_return(client->buffer_pool, client->tx_buffer);
+        client->tx_buffer = NULL;
     } else {
-        if (client->rx_buffer) {
-            free(client->rx_buffer);
-            client->rx_buffer = NULL;
-        }
+        esp_websocket_buffer_pool_return(client->buffer_pool, client->rx_buffer);
+        client->rx_buffer = NULL;
     }
 #endif
 }
@@ -203,6 +294,8 @@ static esp_err_t esp_websocket_client_dispatch_event(esp_websocket_client_handle
     event_data.op_code = client->last_opcode;
     event_data.payload_len = client->payload_len;
     event_data.payload_offset = client->payload_offset;
+    event_data.read_time_us = event == WEBSOCKET_EVENT_DATA ? client->read_time_us : 0;
+    event_data.read_duration_us = event == WEBSOCKET_EVENT_DATA ? client->read_duration_us : 0;
 
     if (client->error_handle.error_type == WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT) {
         event_data.error_handle.esp_tls_last_esp_err = esp_tls_get_and_clear_last_error(esp_transport_get_error_handle(client->transport),
@@ -226,6 +319,33 @@ static esp_err_t esp_websocket_client_dispatch_event(esp_websocket_client_handle
     return esp_event_loop_run(client->event_handle, 0);
 }
 
+static uint32_t esp_websocket_client_random(void)
+{
+#if CONFIG_IDF_TARGET_LINUX
+    return (uint32_t)random();
+#else
+    return esp_random();
+#endif
+}
+
+/*
+ * Picks the delay of the next reconnect and grows the backoff. With jitter the delay is drawn from
+ * [0, backoff] ("full jitter"), so that clients disconnected by the same outage do not retry in lockstep.
+ */
+static int esp_websocket_client_next_reconnect_delay(esp_websocket_client_handle_t client)
+{
+    int delay_ms = client->reconnect_backoff_ms;
+    if (client->config->reconnect_backoff_jitter) {
+        delay_ms = esp_websocket_client_random() % ((uint32_t)delay_ms + 1);
+    }
+    if (client->config->reconnect_backoff_max_ms > 0) {
+        float next_ms = client->reconnect_backoff_ms * client->config->reconnect_backoff_multiplier;
+        client->reconnect_backoff_ms = next_ms > client->config->reconnect_backoff_max_ms ?
+                                       client->config->reconnect_backoff_max_ms : (int)next_ms;
+    }
+    return delay_ms;
+}
+
 static esp_err_t esp_websocket_client_abort_connection(esp_websocket_client_handle_t client, esp_websocket_error_type_t error_type)
 {
     ESP_WS_CLIENT_STATE_CHECK(TAG, client, return ESP_FAIL);
@@ -236,7 +356,11 @@ static esp_err_t esp_websocket_client_abort_connection(esp_websocket_client_hand
         client->state = WEBSOCKET_STATE_UNKNOW;
     } else {
         client->reconnect_tick_ms = _tick_get_ms();
-        ESP_LOGI(TAG, "Reconnect after %d ms", client->wait_timeout_ms);
+        if (client->disconnect_tick_ms == 0) {
+            client->disconnect_tick_ms = client->reconnect_tick_ms;
+        }
+        client->reconnect_delay_ms = esp_websocket_client_next_reconnect_delay(client);
+        ESP_LOGI(TAG, "Reconnect after %d ms", client->reconnect_delay_ms);
         client->state = WEBSOCKET_STATE_WAIT_TIMEOUT;
     }
     client->error_handle.error_type = error_type;
@@ -317,6 +441,15 @@ static esp_err_t esp_websocket_client_set_config(esp_websocket_client_handle_t c
         cfg->task_stack = WEBSOCKET_TASK_STACK;
     }
 
+    cfg->task_core_id = tskNO_AFFINITY;
+    if (config->task_pinned) {
+        if (config->task_core_id < 0 || config->task_core_id >= portNUM_PROCESSORS) {
+            ESP_LOGE(TAG, "Invalid task core %d", config->task_core_id);
+            return ESP_ERR_INVALID_ARG;
+        }
+        cfg->task_core_id = config->task_core_id;
+    }
+
     if (config->host) {
         cfg->host = strdup(config->host);
         ESP_WS_CLIENT_MEM_CHECK(TAG, cfg->host, return ESP_ERR_NO_MEM);
@@ -376,6 +509,26 @@ static esp_err_t esp_websocket_client_set_config(esp_websocket_client_handle_t c
     if (config->disable_auto_reconnect) {
         cfg->auto_reconnect = false;
     }
+    if (config->reconnect_backoff_max_ms < 0) {
+        ESP_LOGE(TAG, "Invalid reconnect backoff limit %d", config->reconnect_backoff_max_ms);
+        return ESP_ERR_INVALID_ARG;
+    }
+    cfg->reconnect_backoff_max_ms = config->reconnect_backoff_max_ms;
+    cfg->reconnect_backoff_multiplier = config->reconnect_backoff_multiplier > 1.0f ? config->reconnect_backoff_multiplier : WEBSOCKET_BACKOFF_MULTIPLIER;
+    cfg->reconnect_backoff_jitter = config->reconnect_backoff_jitter;
+    if (config->tls_session_resumption) {
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        if (config->manager) {
+            // the manager selects on the socket, which the resuming TLS transport does not expose
+            ESP_LOGE(TAG, "TLS session resumption is not supported by the connection manager");
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+#else
+        ESP_LOGE(TAG, "TLS session resumption requires CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS");
+        return ESP_ERR_NOT_SUPPORTED;
+#endif
+    }
+    cfg->tls_session_resumption = config->tls_session_resumption;
 
     if (config->disable_pingpong_discon) {
         cfg->pingpong_timeout_sec = 0;
@@ -398,6 +551,15 @@ static esp_err_t esp_websocket_client_set_config(esp_websocket_client_handle_t c
         cfg->ping_interval_sec = config->ping_interval_sec;
     }
 
+    cfg->ping_adaptive = config->ping_adaptive_enable;
+    cfg->ping_interval_min_sec = config->ping_interval_min_sec ? config->ping_interval_min_sec : WEBSOCKET_PING_INTERVAL_MIN_SEC;
+    cfg->ping_interval_max_sec = config->ping_interval_max_sec ? config->ping_interval_max_sec : 4 * cfg->ping_interval_sec;
+    if (cfg->ping_adaptive && (cfg->ping_interval_min_sec > cfg->ping_interval_sec || cfg->ping_interval_max_sec < cfg->ping_interval_sec)) {
+        ESP_LOGE(TAG, "ping_interval_sec %zu is outside of the adaptive range %zu..%zu", cfg->ping_interval_sec,
+                 cfg->ping_interval_min_sec, cfg->ping_interval_max_sec);
+        return ESP_ERR_INVALID_ARG;
+    }
+
     return ESP_OK;
 }
 
@@ -426,8 +588,22 @@ static esp_err_t esp_websocket_client_destroy_config(esp_websocket_client_handle
     return ESP_OK;
 }
 
+static void esp_websocket_client_manager_detach(esp_websocket_client_handle_t client)
+{
+    esp_websocket_client_manager_handle_t manager = client->manager;
+    xSemaphoreTakeRecursive(manager->lock, portMAX_DELAY);
+    STAILQ_REMOVE(&manager->clients, client, esp_websocket_client, manager_entry);
+    xSemaphoreGiveRecursive(manager->lock);
+    // the rx buffer belongs to the manager
+    client->rx_buffer = NULL;
+    client->manager = NULL;
+}
+
 static void destroy_and_free_resources(esp_websocket_client_handle_t client)
 {
+    if (client->manager) {
+        esp_websocket_client_manager_detach(client);
+    }
     if (client->event_handle) {
         esp_event_loop_delete(client->event_handle);
     }
@@ -439,9 +615,22 @@ static void destroy_and_free_resources(esp_websocket_client_handle_t client)
         esp_transport_list_destroy(client->transport_list);
     }
     vSemaphoreDelete(client->lock);
+#ifdef CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER
+    esp_websocket_free_buf(client, true);
+    esp_websocket_free_buf(client, false);
+    if (client->own_buffer_pool) {
+        esp_websocket_buffer_pool_destroy(client->buffer_pool);
+    }
+#else
     free(client->tx_buffer);
     free(client->rx_buffer);
+#endif
     free(client->errormsg_buffer);
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+    esp_websocket_deflate_destroy(client->deflate);
+    esp_websocket_inflate_destroy(client->inflate);
+    free(client->inflate_buffer);
+#endif
     if (client->status_bits) {
         vEventGroupDelete(client->status_bits);
     }
@@ -459,6 +648,7 @@ static esp_err_t stop_wait_task(esp_websocket_client_handle_t client)
     }
 
     client->run = false;
+    xEventGroupSetBits(client->status_bits, RECONNECT_NOW_BIT);
     xEventGroupWaitBits(client->status_bits, STOPPED_BIT, false, true, portMAX_DELAY);
     client->state = WEBSOCKET_STATE_UNKNOW;
     return ESP_OK;
@@ -481,6 +671,122 @@ static esp_err_t set_websocket_transport_optional_settings(esp_websocket_client_
     return ESP_ERR_INVALID_ARG;
 }
 
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+/* Same settings as the esp_transport_ssl branch below, applied to the esp_tls configuration directly */
+static esp_transport_handle_t esp_websocket_client_create_resuming_tls(esp_websocket_client_handle_t client)
+{
+    websocket_config_storage_t *cfg = client->config;
+    esp_tls_cfg_t tls_cfg = {
+        .use_global_ca_store = cfg->use_global_ca_store,
+        .skip_common_name = cfg->skip_cert_common_name_check,
+        .common_name = cfg->cert_common_name,
+        .if_name = client->if_name,
+        .crt_bundle_attach = cfg->crt_bundle_attach,
+    };
+    if (client->keep_alive_cfg.keep_alive_enable) {
+        tls_cfg.keep_alive_cfg = (tls_keep_alive_cfg_t *)&client->keep_alive_cfg;
+    }
+    // PEM data has to be passed including its null terminator
+    if (!cfg->use_global_ca_store && cfg->cert) {
+        tls_cfg.cacert_buf = (const unsigned char *)cfg->cert;
+        tls_cfg.cacert_bytes = cfg->cert_len ? cfg->cert_len : strlen(cfg->cert) + 1;
+    }
+    if (cfg->client_cert) {
+        tls_cfg.clientcert_buf = (const unsigned char *)cfg->client_cert;
+        tls_cfg.clientcert_bytes = cfg->client_cert_len ? cfg->client_cert_len : strlen(cfg->client_cert) + 1;
+    }
+    if (cfg->client_key) {
+        tls_cfg.clientkey_buf = (const unsigned char *)cfg->client_key;
+        tls_cfg.clientkey_bytes = cfg->client_key_len ? cfg->client_key_len : strlen(cfg->client_key) + 1;
+#if CONFIG_ESP_TLS_USE_DS_PERIPHERAL
+    } else if (cfg->client_ds_data) {
+        tls_cfg.ds_data = cfg->client_ds_data;
+#endif
+    }
+    return esp_websocket_transport_tls_init(&tls_cfg);
+}
+
+/* Must be called with the client locked, after a successful connect */
+static void esp_websocket_client_update_tls_stats(esp_websocket_client_handle_t client)
+{
+    esp_transport_handle_t tls = esp_transport_list_get_transport(client->transport_list, "_ssl");
+    if (tls == NULL) {
+        return;
+    }
+    uint32_t connect_ms = esp_websocket_transport_tls_connect_time_ms(tls);
+    client->tls_stats.handshakes++;
+    client->tls_stats.last_handshake_ms = connect_ms;
+    client->tls_stats.total_handshake_ms += connect_ms;
+    if (esp_websocket_transport_tls_session_offered(tls)) {
+        client->tls_stats.session_offers++;
+        client->tls_stats.total_offer_handshake_ms += connect_ms;
+    }
+}
+#endif
+
+/* Transport below esp_transport_ws, with permessage-deflate the one that reads the answer to the offer */
+static esp_transport_handle_t esp_websocket_client_ws_parent(esp_websocket_client_handle_t client, esp_transport_handle_t parent)
+{
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+    client->response_transport = NULL;
+    if (client->deflate) {
+        client->response_transport = esp_websocket_transport_response_init(parent, "Sec-WebSocket-Extensions", WEBSOCKET_DEFLATE_ANSWER_LEN);
+        ESP_WS_CLIENT_MEM_CHECK(TAG, client->response_transport, return NULL);
+        esp_transport_list_add(client->transport_list, client->response_transport, "_response"); // need to save to transport list, for cleanup
+        return client->response_transport;
+    }
+#endif
+    return parent;
+}
+
+/* esp_transport_get_socket() does not reach through the response transport, these two do */
+static int esp_websocket_client_get_socket(esp_websocket_client_handle_t client)
+{
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+    if (client->response_transport) {
+        return esp_websocket_transport_response_get_socket(client->response_transport);
+    }
+#endif
+    return esp_transport_get_socket(client->transport);
+}
+
+/* Same as esp_transport_ws_poll_connection_closed(), on the socket esp_websocket_client_get_socket() returns */
+static int esp_websocket_client_poll_connection_closed(esp_websocket_client_handle_t client, int timeout_ms)
+{
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+    if (client->response_transport) {
+        int sock = esp_websocket_client_get_socket(client);
+        if (sock < 0) {
+            return -1;
+        }
+        fd_set readset;
+        fd_set errset;
+        FD_ZERO(&readset);
+        FD_ZERO(&errset);
+        FD_SET(sock, &readset);
+        FD_SET(sock, &errset);
+        struct timeval timeout = {
+            .tv_sec = timeout_ms / 1000,
+            .tv_usec = (timeout_ms % 1000) * 1000,
+        };
+        int ret = select(sock + 1, &readset, NULL, &errset, &timeout);
+        if (ret > 0) {
+            if (FD_ISSET(sock, &readset)) {
+                uint8_t buffer;
+                if (recv(sock, &buffer, 1, MSG_PEEK) <= 0) {
+                    // readable but nothing to read, the server closed the connection
+                    return 1;
+                }
+                ESP_LOGW(TAG, "Unexpected data readable on socket=%d while waiting for the close", sock);
+            }
+            return -1;
+        }
+        return ret;
+    }
+#endif
+    return esp_transport_ws_poll_connection_closed(client->transport, timeout_ms);
+}
+
 static esp_err_t esp_websocket_client_create_transport(esp_websocket_client_handle_t client)
 {
     if (!client->config->scheme) {
@@ -508,12 +814,32 @@ static esp_err_t esp_websocket_client_create_transport(esp_websocket_client_hand
             esp_transport_tcp_set_interface_name(tcp, client->if_name);
         }
 
-        esp_transport_handle_t ws = esp_transport_ws_init(tcp);
+        esp_transport_handle_t ws_parent = esp_websocket_client_ws_parent(client, tcp);
+        ESP_WS_CLIENT_MEM_CHECK(TAG, ws_parent, return ESP_ERR_NO_MEM);
+        esp_transport_handle_t ws = esp_transport_ws_init(ws_parent);
         ESP_WS_CLIENT_MEM_CHECK(TAG, ws, return ESP_ERR_NO_MEM);
 
         esp_transport_set_default_port(ws, WEBSOCKET_TCP_DEFAULT_PORT);
         esp_transport_list_add(client->transport_list, ws, WS_OVER_TCP_SCHEME);
         ESP_WS_CLIENT_ERR_OK_CHECK(TAG, set_websocket_transport_optional_settings(client, WS_OVER_TCP_SCHEME), return ESP_FAIL;)
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    } else if (strcasecmp(client->config->scheme, WS_OVER_TLS_SCHEME) == 0 && client->config->tls_session_resumption) {
+        esp_transport_handle_t tls = esp_websocket_client_create_resuming_tls(client);
+        ESP_WS_CLIENT_MEM_CHECK(TAG, tls, return ESP_ERR_NO_MEM);
+
+        esp_transport_set_default_port(tls, WEBSOCKET_SSL_DEFAULT_PORT);
+        esp_transport_list_add(client->transport_list, tls, "_ssl"); // need to save to transport list, for cleanup
+
+        esp_transport_handle_t ws_parent = esp_websocket_client_ws_parent(client, tls);
+        ESP_WS_CLIENT_MEM_CHECK(TAG, ws_parent, return ESP_ERR_NO_MEM);
+        esp_transport_handle_t wss = esp_transport_ws_init(ws_parent);
+        ESP_WS_CLIENT_MEM_CHECK(TAG, wss, return ESP_ERR_NO_MEM);
+
+        esp_transport_set_default_port(wss, WEBSOCKET_SSL_DEFAULT_PORT);
+
+        esp_transport_list_add(client->transport_list, wss, WS_OVER_TLS_SCHEME);
+        ESP_WS_CLIENT_ERR_OK_CHECK(TAG, set_websocket_transport_optional_settings(client, WS_OVER_TLS_SCHEME), return ESP_FAIL;)
+#endif
     } else if (strcasecmp(client->config->scheme, WS_OVER_TLS_SCHEME) == 0) {
         esp_transport_handle_t ssl = esp_transport_ssl_init();
         ESP_WS_CLIENT_MEM_CHECK(TAG, ssl, return ESP_ERR_NO_MEM);
@@ -572,7 +898,9 @@ static esp_err_t esp_websocket_client_create_transport(esp_websocket_client_hand
 #endif
         }
 
-        esp_transport_handle_t wss = esp_transport_ws_init(ssl);
+        esp_transport_handle_t ws_parent = esp_websocket_client_ws_parent(client, ssl);
+        ESP_WS_CLIENT_MEM_CHECK(TAG, ws_parent, return ESP_ERR_NO_MEM);
+        esp_transport_handle_t wss = esp_transport_ws_init(ws_parent);
         ESP_WS_CLIENT_MEM_CHECK(TAG, wss, return ESP_ERR_NO_MEM);
 
         esp_transport_set_default_port(wss, WEBSOCKET_SSL_DEFAULT_PORT);
@@ -586,6 +914,315 @@ static esp_err_t esp_websocket_client_create_transport(esp_websocket_client_hand
     return ESP_OK;
 }
 
+static void esp_websocket_client_write_error(esp_websocket_client_handle_t client, int ret)
+{
+    esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(client->transport);
+    if (error_handle) {
+        esp_websocket_client_error(client, "esp_transport_write() returned %d, transport_error=%s, tls_error_code=%i, tls_flags=%i, errno=%d",
+                                   ret, esp_err_to_name(error_handle->last_error), error_handle->esp_tls_error_code,
+                                   error_handle->esp_tls_flags, errno);
+    } else {
+        esp_websocket_client_error(client, "esp_transport_write() returned %d, errno=%d", ret, errno);
+    }
+    esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT);
+}
+
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+static esp_err_t esp_websocket_client_deflate_init(esp_websocket_client_handle_t client, const esp_websocket_client_config_t *config)
+{
+    int server_bits = config->permessage_deflate_server_window_bits ? config->permessage_deflate_server_window_bits : WEBSOCKET_DEFLATE_SERVER_BITS;
+    int client_bits = config->permessage_deflate_client_window_bits ? config->permessage_deflate_client_window_bits : WEBSOCKET_DEFLATE_CLIENT_BITS;
+    if (server_bits < ESP_WEBSOCKET_DEFLATE_MIN_WINDOW_BITS || server_bits > ESP_WEBSOCKET_DEFLATE_MAX_WINDOW_BITS ||
+            client_bits < ESP_WEBSOCKET_DEFLATE_MIN_WINDOW_BITS || client_bits > ESP_WEBSOCKET_DEFLATE_MAX_WINDOW_BITS) {
+        ESP_LOGE(TAG, "permessage-deflate window bits must be within %d and %d",
+                 ESP_WEBSOCKET_DEFLATE_MIN_WINDOW_BITS, ESP_WEBSOCKET_DEFLATE_MAX_WINDOW_BITS);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->ext_transport) {
+        ESP_LOGW(TAG, "permessage_deflate_enable is ignored with ext_transport, the client does not see its upgrade response");
+        return ESP_OK;
+    }
+    client->deflate_client_bits = client_bits;
+    client->deflate_server_bits = server_bits;
+    client->deflate_offer_client_no_context_takeover = config->permessage_deflate_client_no_context_takeover;
+    client->deflate_offer_server_no_context_takeover = config->permessage_deflate_server_no_context_takeover;
+
+    client->deflate = esp_websocket_deflate_init(client_bits);
+    ESP_WS_CLIENT_MEM_CHECK(TAG, client->deflate, return ESP_ERR_NO_MEM);
+    client->inflate = esp_websocket_inflate_init(server_bits);
+    ESP_WS_CLIENT_MEM_CHECK(TAG, client->inflate, return ESP_ERR_NO_MEM);
+    client->inflate_buffer = malloc(client->buffer_size);
+    ESP_WS_CLIENT_MEM_CHECK(TAG, client->inflate_buffer, return ESP_ERR_NO_MEM);
+
+    // the answer is read from the upgrade response by the transport esp_websocket_client_ws_parent() adds
+    char offer[WEBSOCKET_DEFLATE_OFFER_LEN];
+    int len = snprintf(offer, sizeof(offer), "permessage-deflate; client_max_window_bits=%d", client_bits);
+    if (server_bits != WEBSOCKET_DEFLATE_SERVER_BITS) {
+        len += snprintf(offer + len, sizeof(offer) - len, "; server_max_window_bits=%d", server_bits);
+    }
+    if (client->deflate_offer_server_no_context_takeover) {
+        len += snprintf(offer + len, sizeof(offer) - len, "; server_no_context_takeover");
+    }
+    if (client->deflate_offer_client_no_context_takeover) {
+        snprintf(offer + len, sizeof(offer) - len, "; client_no_context_takeover");
+    }
+    return esp_websocket_client_append_header(client, "Sec-WebSocket-Extensions", offer);
+}
+
+/* Copies the next parameter of an extension, up to `;`, `,` or the end, without the whitespace around it */
+static const char *esp_websocket_client_deflate_param(const char *p, char *param, size_t size)
+{
+    size_t len = 0;
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    for (; *p && *p != ';' && *p != ','; p++) {
+        if (len + 1 < size) {
+            param[len++] = *p;
+        }
+    }
+    while (len && (param[len - 1] == ' ' || param[len - 1] == '\t')) {
+        len--;
+    }
+    param[len] = '\0';
+    return p;
+}
+
+/* Window bits of a parameter value, which may be quoted, or 0 if it is not a number from 8 to 15 */
+static int esp_websocket_client_deflate_bits(const char *value)
+{
+    while (*value == ' ' || *value == '\t') {
+        value++;
+    }
+    size_t len = strlen(value);
+    if (len >= 2 && value[0] == '"' && value[len - 1] == '"') {
+        value++;
+        len -= 2;
+    }
+    int bits = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (value[i] < '0' || value[i] > '9' || bits > 15) {
+            return 0;
+        }
+        bits = bits * 10 + value[i] - '0';
+    }
+    return bits >= 8 && bits <= 15 ? bits : 0;
+}
+
+/*
+ * Applies the server's answer to the offer (RFC 7692, section 7), the Sec-WebSocket-Extensions value of the
+ * upgrade response. Without an answer the connection is not compressed. An answer the client cannot honour,
+ * or one it did not ask for, fails the connection.
+ */
+static esp_err_t esp_websocket_client_deflate_negotiate(esp_websocket_client_handle_t client)
+{
+    client->deflate_active = false;
+    if (client->deflate == NULL || client->response_transport == NULL) {
+        return ESP_OK;
+    }
+    const char *answer;
+    esp_err_t err = esp_websocket_transport_response_get_header(client->response_transport, &answer);
+    if (err != ESP_OK) {
+        esp_websocket_client_error(client, "Could not read the permessage-deflate answer: %s", esp_err_to_name(err));
+        return err;
+    }
+    if (answer == NULL) {
+        ESP_LOGD(TAG, "The server declined permessage-deflate, the connection is not compressed");
+        return ESP_OK;
+    }
+
+    char param[40];
+    const char *p = esp_websocket_client_deflate_param(answer, param, sizeof(param));
+    if (strcasecmp(param, "permessage-deflate") != 0) {
+        esp_websocket_client_error(client, "The server answered with an extension that was not offered: %s", answer);
+        return ESP_FAIL;
+    }
+    bool server_no_context_takeover = false;
+    bool client_no_context_takeover = false;
+    int server_bits = 0;
+    int client_bits = 0;
+    while (*p == ';') {
+        p = esp_websocket_client_deflate_param(p + 1, param, sizeof(param));
+        char *value = strchr(param, '=');
+        if (value) {
+            *value++ = '\0';
+            esp_websocket_client_deflate_param(param, param, sizeof(param));
+        }
+        if (strcasecmp(param, "server_no_context_takeover") == 0 && !value && !server_no_context_takeover) {
+            server_no_context_takeover = true;
+        } else if (strcasecmp(param, "client_no_context_takeover") == 0 && !value && !client_no_context_takeover) {
+            client_no_context_takeover = true;
+        } else if (strcasecmp(param, "server_max_window_bits") == 0 && value && !server_bits) {
+            // the server compresses within a window no larger than the one the inflater has
+            server_bits = esp_websocket_client_deflate_bits(value);
+            if (server_bits == 0 || server_bits > client->deflate_server_bits) {
+                esp_websocket_client_error(client, "Invalid permessage-deflate answer: %s", answer);
+                return ESP_FAIL;
+            }
+        } else if (strcasecmp(param, "client_max_window_bits") == 0 && value && !client_bits) {
+            client_bits = esp_websocket_client_deflate_bits(value);
+            if (client_bits < ESP_WEBSOCKET_DEFLATE_MIN_WINDOW_BITS) {
+                esp_websocket_client_error(client, "Cannot compress with the window of the permessage-deflate answer: %s", answer);
+                return ESP_FAIL;
+            }
+        } else {
+            esp_websocket_client_error(client, "Invalid permessage-deflate answer: %s", answer);
+            return ESP_FAIL;
+        }
+    }
+    if (*p != '\0') {
+        esp_websocket_client_error(client, "The server answered with an extension that was not offered: %s", answer);
+        return ESP_FAIL;
+    }
+
+    if (client_bits && client_bits < client->deflate_client_bits) {
+        // a smaller window also suits the following connections, the offer stays the same
+        esp_websocket_deflate_handle_t deflate = esp_websocket_deflate_init(client_bits);
+        ESP_WS_CLIENT_MEM_CHECK(TAG, deflate, return ESP_ERR_NO_MEM);
+        esp_websocket_deflate_destroy(client->deflate);
+        client->deflate = deflate;
+        client->deflate_client_bits = client_bits;
+    }
+    // the client may always drop its context, also when it offered to and the server did not ask for it
+    client->deflate_client_no_context_takeover = client_no_context_takeover || client->deflate_offer_client_no_context_takeover;
+    client->deflate_server_no_context_takeover = server_no_context_takeover;
+    client->deflate_active = true;
+    ESP_LOGD(TAG, "permessage-deflate accepted: %s", answer);
+    return ESP_OK;
+}
+
+/* A new connection starts a new compression context in both directions */
+static void esp_websocket_client_deflate_reset(esp_websocket_client_handle_t client)
+{
+    if (client->deflate) {
+        esp_websocket_deflate_reset(client->deflate);
+        esp_websocket_inflate_reset(client->inflate);
+        client->inflate_message = false;
+    }
+}
+
+/* Compresses a complete message straight into the tx buffer, every filled buffer goes out as one frame */
+static int esp_websocket_client_send_deflated(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode, const uint8_t *data, int len, TickType_t timeout)
+{
+    const uint8_t *in = data;
+    size_t in_len = len;
+    bool done = false;
+    int frame_opcode = (opcode & ~WS_TRANSPORT_OPCODES_FIN) | WEBSOCKET_OPCODE_RSV1;
+
+    if (client->deflate_client_no_context_takeover) {
+        esp_websocket_deflate_reset(client->deflate);
+    }
+    while (!done) {
+        size_t need_write = esp_websocket_deflate_message(client->deflate, &in, &in_len, (uint8_t *)client->tx_buffer, client->buffer_size, &done);
+        if (done) {
+            frame_opcode |= WS_TRANSPORT_OPCODES_FIN;
+        }
+        int wlen = esp_transport_ws_send_raw(client->transport, frame_opcode, client->tx_buffer, need_write,
+                                             (timeout == portMAX_DELAY) ? -1 : timeout * portTICK_PERIOD_MS);
+        if (wlen < 0 || (wlen == 0 && need_write != 0)) {
+            return wlen < 0 ? wlen : -1;
+        }
+        frame_opcode = WS_TRANSPORT_OPCODES_CONT;
+    }
+    return len;
+}
+
+/* Posts the inflated bytes collected so far, only the last event of a message carries the fin flag */
+static void esp_websocket_client_dispatch_inflated(esp_websocket_client_handle_t client, bool fin)
+{
+    int payload_len = client->payload_len;
+    int payload_offset = client->payload_offset;
+    bool last_fin = client->last_fin;
+
+    client->payload_offset = client->inflate_offset;
+    client->payload_len = client->inflate_offset + client->inflate_pending;
+    client->last_fin = fin;
+    esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_DATA, client->inflate_buffer, client->inflate_pending);
+    client->inflate_offset += client->inflate_pending;
+    client->inflate_pending = 0;
+
+    client->payload_len = payload_len;
+    client->payload_offset = payload_offset;
+    client->last_fin = last_fin;
+}
+
+/*
+ * Once the server accepted the offer every data message is treated as compressed, the transport does not
+ * report the RSV1 bit.
+ * Received chunks are inflated into inflate_buffer, which is posted whenever it fills up.
+ */
+static esp_err_t esp_websocket_client_inflate_data(esp_websocket_client_handle_t client, const char *data, int len)
+{
+    size_t offset = 0;
+    bool full = false;
+    esp_err_t err = ESP_OK;
+
+    do {
+        size_t used = 0;
+        size_t produced = 0;
+        err = esp_websocket_inflate(client->inflate, (const uint8_t *)data + offset, len - offset, &used,
+                                    (uint8_t *)client->inflate_buffer + client->inflate_pending,
+                                    client->buffer_size - client->inflate_pending, &produced);
+        if (err != ESP_OK) {
+            break;
+        }
+        offset += used;
+        client->inflate_pending += produced;
+        full = client->inflate_pending == client->buffer_size;
+        if (full) {
+            esp_websocket_client_dispatch_inflated(client, false);
+        }
+    } while (offset < (size_t)len || full);
+    return err;
+}
+
+static bool esp_websocket_client_is_inflated(esp_websocket_client_handle_t client)
+{
+    // control frames may be interleaved with the fragments of a message and are never compressed
+    return client->inflate_message && (client->last_opcode == WS_TRANSPORT_OPCODES_TEXT ||
+                                       client->last_opcode == WS_TRANSPORT_OPCODES_BINARY ||
+                                       client->last_opcode == WS_TRANSPORT_OPCODES_CONT);
+}
+
+static esp_err_t esp_websocket_client_dispatch_data(esp_websocket_client_handle_t client, int rlen)
+{
+    if (client->deflate_active && client->payload_offset == 0 &&
+            (client->last_opcode == WS_TRANSPORT_OPCODES_TEXT || client->last_opcode == WS_TRANSPORT_OPCODES_BINARY)) {
+        client->inflate_message = true;
+        client->inflate_offset = 0;
+        client->inflate_pending = 0;
+    }
+    if (esp_websocket_client_is_inflated(client)) {
+        return esp_websocket_client_inflate_data(client, client->rx_buffer, rlen);
+    }
+    esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_DATA, client->rx_buffer, rlen);
+    return ESP_OK;
+}
+
+/* A server that accepted the offer but sends a message uncompressed is only noticed here, see RSV1 above */
+static void esp_websocket_client_inflate_error(esp_websocket_client_handle_t client)
+{
+    if (!client->inflate_failed) {
+        client->inflate_failed = true;
+        ESP_LOGE(TAG, "Received data message is not valid permessage-deflate data. Once the server accepted "
+                 "permessage-deflate it has to compress every data message");
+    }
+    esp_websocket_client_error(client, "Failed to inflate a compressed message");
+}
+
+static esp_err_t esp_websocket_client_inflate_end(esp_websocket_client_handle_t client)
+{
+    static const char tail[] = { 0x00, 0x00, 0xff, 0xff };
+    client->inflate_message = false;
+    esp_err_t err = esp_websocket_client_inflate_data(client, tail, sizeof(tail));
+    esp_websocket_inflate_end_message(client->inflate, !client->deflate_server_no_context_takeover);
+    if (err == ESP_OK) {
+        esp_websocket_client_dispatch_inflated(client, true);
+    }
+    return err;
+}
+#endif // CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+
 static int esp_websocket_client_send_with_exact_opcode(esp_websocket_client_handle_t client, ws_transport_opcodes_t opcode, const uint8_t *data, int len, TickType_t timeout)
 {
     int ret = -1;
@@ -618,6 +1255,19 @@ static int esp_websocket_client_send_with_exact_opcode(esp_websocket_client_hand
         goto unlock_and_return;
     }
 
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+    ws_transport_opcodes_t data_opcode = opcode & ~WS_TRANSPORT_OPCODES_FIN;
+    if (client->deflate_active && contained_fin &&
+            (data_opcode == WS_TRANSPORT_OPCODES_TEXT || data_opcode == WS_TRANSPORT_OPCODES_BINARY)) {
+        ret = esp_websocket_client_send_deflated(client, opcode, data, len, timeout);
+        esp_websocket_free_buf(client, true);
+        if (ret < 0) {
+            esp_websocket_client_write_error(client, ret);
+        }
+        goto unlock_and_return;
+    }
+#endif
+
     while (widx < len || opcode) {  // allow for sending "current_opcode" only message with len==0
         if (need_write > client->buffer_size) {
             need_write = client->buffer_size;
@@ -632,15 +1282,7 @@ static int esp_websocket_client_send_with_exact_opcode(esp_websocket_client_hand
         if (wlen < 0 || (wlen == 0 && need_write != 0)) {
             ret = wlen;
             esp_websocket_free_buf(client, true);
-            esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(client->transport);
-            if (error_handle) {
-                esp_websocket_client_error(client, "esp_transport_write() returned %d, transport_error=%s, tls_error_code=%i, tls_flags=%i, errno=%d",
-                                           ret, esp_err_to_name(error_handle->last_error), error_handle->esp_tls_error_code,
-                                           error_handle->esp_tls_flags, errno);
-            } else {
-                esp_websocket_client_error(client, "esp_transport_write() returned %d, errno=%d", ret, errno);
-            }
-            esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT);
+            esp_websocket_client_write_error(client, ret);
             goto unlock_and_return;
         }
         opcode = 0;
@@ -704,6 +1346,7 @@ esp_websocket_client_handle_t esp_websocket_client_init(const esp_websocket_clie
     } else {
         client->wait_timeout_ms = config->reconnect_timeout_ms;
     }
+    client->reconnect_backoff_ms = client->wait_timeout_ms;
 
     // configure ssl related parameters
     if (config->cert_common_name != NULL && config->skip_cert_common_name_check) {
@@ -755,11 +1398,24 @@ esp_websocket_client_handle_t esp_websocket_client_init(const esp_websocket_clie
     }
     client->errormsg_buffer = NULL;
     client->errormsg_size = 0;
-#ifndef CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER
-    client->rx_buffer = malloc(buffer_size);
-    ESP_WS_CLIENT_MEM_CHECK(TAG, client->rx_buffer, {
+    if (config->manager && buffer_size > config->manager->buffer_size) {
+        ESP_LOGE(TAG, "buffer_size %d exceeds the shared buffer of the manager (%d)", buffer_size, config->manager->buffer_size);
         goto _websocket_init_fail;
-    });
+    }
+#ifdef CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER
+    client->buffer_pool = config->buffer_pool;
+    if (!client->buffer_pool) {
+        client->buffer_pool = esp_websocket_buffer_pool_create(NULL);
+        ESP_WS_CLIENT_MEM_CHECK(TAG, client->buffer_pool, goto _websocket_init_fail);
+        client->own_buffer_pool = true;
+    }
+#else
+    if (!config->manager) {
+        client->rx_buffer = malloc(buffer_size);
+        ESP_WS_CLIENT_MEM_CHECK(TAG, client->rx_buffer, {
+            goto _websocket_init_fail;
+        });
+    }
     client->tx_buffer = malloc(buffer_size);
     ESP_WS_CLIENT_MEM_CHECK(TAG, client->tx_buffer, {
         goto _websocket_init_fail;
@@ -772,6 +1428,28 @@ esp_websocket_client_handle_t esp_websocket_client_init(const esp_websocket_clie
     xEventGroupSetBits(client->status_bits, STOPPED_BIT);
 
     client->buffer_size = buffer_size;
+
+    if (config->permessage_deflate_enable) {
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+        if (esp_websocket_client_deflate_init(client, config) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to set up permessage-deflate");
+            goto _websocket_init_fail;
+        }
+#else
+        ESP_LOGE(TAG, "permessage-deflate requires CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE");
+        goto _websocket_init_fail;
+#endif
+    }
+
+    if (config->manager) {
+        client->manager = config->manager;
+#ifndef CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER
+        client->rx_buffer = client->manager->rx_buffer;
+#endif
+        xSemaphoreTakeRecursive(client->manager->lock, portMAX_DELAY);
+        STAILQ_INSERT_TAIL(&client->manager->clients, client, manager_entry);
+        xSemaphoreGiveRecursive(client->manager->lock);
+    }
     return client;
 
 _websocket_init_fail:
@@ -924,6 +1602,69 @@ esp_err_t esp_websocket_client_append_header(esp_websocket_client_handle_t clien
     return ESP_OK;
 }
 
+static void esp_websocket_client_send_ping(esp_websocket_client_handle_t client)
+{
+    // the server echoes the payload in its PONG, which yields the round trip time
+    client->ping_sent_us = esp_timer_get_time();
+    client->pings_sent++;
+    esp_transport_ws_send_raw(client->transport, WS_TRANSPORT_OPCODES_PING | WS_TRANSPORT_OPCODES_FIN, (const char *)&client->ping_sent_us,
+                              sizeof(client->ping_sent_us), esp_websocket_client_io_timeout_ms(client));
+}
+
+static uint32_t esp_websocket_client_rtt_avg_us(esp_websocket_client_handle_t client)
+{
+    uint32_t count = client->rtt_samples < WEBSOCKET_RTT_WINDOW ? client->rtt_samples : WEBSOCKET_RTT_WINDOW;
+    uint64_t sum = 0;
+    for (int i = 0; i < count; i++) {
+        sum += client->rtt_window[i];
+    }
+    return count ? sum / count : 0;
+}
+
+/* Records the RTT of a PONG answering our last PING, and adapts the ping interval to it */
+static void esp_websocket_client_pong_received(esp_websocket_client_handle_t client, const char *data, int len)
+{
+    if (client->ping_sent_us == 0 || len != sizeof(client->ping_sent_us) || memcmp(data, &client->ping_sent_us, len) != 0) {
+        // unsolicited, or answering an earlier PING
+        return;
+    }
+    uint32_t rtt_us = esp_timer_get_time() - client->ping_sent_us;
+    client->ping_sent_us = 0;
+
+    // compare with the samples before this one, a spike must not raise its own threshold
+    uint32_t avg_us = esp_websocket_client_rtt_avg_us(client);
+    bool spike = client->rtt_samples >= 4 && rtt_us > WEBSOCKET_RTT_SPIKE_FACTOR * avg_us;
+    client->rtt_window[client->rtt_samples % WEBSOCKET_RTT_WINDOW] = rtt_us;
+    client->rtt_samples++;
+    if (spike) {
+        client->rtt_spikes++;
+        ESP_LOGW(TAG, "RTT spike: %" PRIu32 " us, recent average %" PRIu32 " us", rtt_us, avg_us);
+    }
+    ESP_LOGD(TAG, "PONG received, RTT %" PRIu32 " us", rtt_us);
+
+    if (!client->config->ping_adaptive) {
+        return;
+    }
+    if (spike) {
+        // probe a degrading link often, so that it is noticed before the PONG timeout
+        client->ping_interval_ms = client->config->ping_interval_min_sec * 1000;
+    } else {
+        // a healthy link does not need to be probed as often
+        uint32_t max_ms = client->config->ping_interval_max_sec * 1000;
+        client->ping_interval_ms = 2 * client->ping_interval_ms < max_ms ? 2 * client->ping_interval_ms : max_ms;
+    }
+}
+
+static bool esp_websocket_client_is_control_frame(ws_transport_opcodes_t opcode)
+{
+    return opcode == WS_TRANSPORT_OPCODES_CLOSE || opcode == WS_TRANSPORT_OPCODES_PING || opcode == WS_TRANSPORT_OPCODES_PONG;
+}
+
+/*
+ * Control frames may arrive between the fragments of a data message. Their payload is collected in
+ * control_buffer, so it is complete even with a buffer_size below 125 bytes, and they bypass the
+ * inflater, so the data message in progress continues with its next fragment.
+ */
 static esp_err_t esp_websocket_client_recv(esp_websocket_client_handle_t client)
 {
     int rlen;
@@ -933,7 +1674,17 @@ static esp_err_t esp_websocket_client_recv(esp_websocket_client_handle_t client)
         return ESP_FAIL;
     }
     do {
-        rlen = esp_transport_read(client->transport, client->rx_buffer, client->buffer_size, client->config->network_timeout_ms);
+        // the frame header is only known after the first read, the rest of a control frame goes to its own buffer
+        char *buffer = client->rx_buffer;
+        int len = client->buffer_size;
+        if (client->payload_offset > 0 && esp_websocket_client_is_control_frame(client->last_opcode)) {
+            buffer = client->control_buffer + client->payload_offset;
+            len = client->payload_len - client->payload_offset;
+        }
+        int64_t read_start_us = esp_timer_get_time();
+        rlen = esp_transport_read(client->transport, buffer, len, esp_websocket_client_io_timeout_ms(client));
+        client->read_time_us = esp_timer_get_time();
+        client->read_duration_us = client->read_time_us - read_start_us;
         if (rlen < 0) {
             esp_websocket_free_buf(client, false);
             esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(client->transport);
@@ -955,20 +1706,62 @@ static esp_err_t esp_websocket_client_recv(esp_websocket_client_handle_t client)
             esp_websocket_free_buf(client, false);
             return ESP_OK;
         }
+        if (rlen == 0 && client->payload_offset < client->payload_len) {
+            // esp_transport_ws forgets the frame when its payload read times out, the next read would take payload for a header
+            esp_websocket_free_buf(client, false);
+            esp_websocket_client_error(client, "Timed out within a frame, %d of %d bytes read", client->payload_offset, client->payload_len);
+            return ESP_FAIL;
+        }
 
-        esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_DATA, client->rx_buffer, rlen);
-
-        client->payload_offset += rlen;
-    } while (client->payload_offset < client->payload_len);
+        if (esp_websocket_client_is_control_frame(client->last_opcode)) {
+            if (client->payload_len > WEBSOCKET_CONTROL_FRAME_MAX) {
+                esp_websocket_free_buf(client, false);
+                esp_websocket_client_error(client, "Control frame with a payload of %d bytes", client->payload_len);
+                return ESP_FAIL;
+            }
+            if (buffer == client->rx_buffer) {
+                memcpy(client->control_buffer, client->rx_buffer, rlen);
+            }
+            client->payload_offset += rlen;
+            continue;
+        }
 
-    // if a PING message received -> send out the PONG, this will not work for PING messages with payload longer than buffer len
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+        if (esp_websocket_client_dispatch_data(client, rlen) != ESP_OK) {
+            esp_websocket_free_buf(client, false);
+            esp_websocket_client_inflate_error(client);
+            return ESP_FAIL;
+        }
+#else
+        esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_DATA, client->rx_buffer, rlen);
+#endif
+
+        client->payload_offset += rlen;
+    } while (client->payload_offset < client->payload_len);
+
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+    if (esp_websocket_client_is_inflated(client) && client->last_fin && esp_websocket_client_inflate_end(client) != ESP_OK) {
+        esp_websocket_free_buf(client, false);
+        esp_websocket_client_inflate_error(client);
+        return ESP_FAIL;
+    }
+#endif
+
+    if (esp_websocket_client_is_control_frame(client->last_opcode)) {
+        // posted once with the complete payload
+        client->payload_offset = 0;
+        esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_DATA, client->control_buffer, client->payload_len);
+    }
+
+    // if a PING message received -> send out the PONG
     if (client->last_opcode == WS_TRANSPORT_OPCODES_PING) {
-        const char *data = (client->payload_len == 0) ? NULL : client->rx_buffer;
+        const char *data = (client->payload_len == 0) ? NULL : client->control_buffer;
         ESP_LOGD(TAG, "Sending PONG with payload len=%d", client->payload_len);
         esp_transport_ws_send_raw(client->transport, WS_TRANSPORT_OPCODES_PONG | WS_TRANSPORT_OPCODES_FIN, data, client->payload_len,
-                                  client->config->network_timeout_ms);
+                                  esp_websocket_client_io_timeout_ms(client));
     } else if (client->last_opcode == WS_TRANSPORT_OPCODES_PONG) {
         client->wait_for_pong_resp = false;
+        esp_websocket_client_pong_received(client, client->control_buffer, client->payload_len);
     } else if (client->last_opcode == WS_TRANSPORT_OPCODES_CLOSE) {
         ESP_LOGD(TAG, "Received close frame");
         client->state = WEBSOCKET_STATE_CLOSING;
@@ -979,10 +1772,8 @@ static esp_err_t esp_websocket_client_recv(esp_websocket_client_handle_t client)
 
 static int esp_websocket_client_send_close(esp_websocket_client_handle_t client, int code, const char *additional_data, int total_len, TickType_t timeout);
 
-static void esp_websocket_client_task(void *pv)
+static void esp_websocket_client_run_begin(esp_websocket_client_handle_t client)
 {
-    const int lock_timeout = portMAX_DELAY;
-    esp_websocket_client_handle_t client = (esp_websocket_client_handle_t) pv;
     client->run = true;
 
     //get transport by scheme
@@ -1000,147 +1791,406 @@ static void esp_websocket_client_task(void *pv)
     }
 
     client->state = WEBSOCKET_STATE_INIT;
-    xEventGroupClearBits(client->status_bits, STOPPED_BIT | CLOSE_FRAME_SENT_BIT);
+    client->disconnect_tick_ms = 0;
+    client->reconnect_backoff_ms = client->wait_timeout_ms;
+    xEventGroupClearBits(client->status_bits, STOPPED_BIT | CLOSE_FRAME_SENT_BIT | RECONNECT_NOW_BIT);
     esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_BEGIN, NULL, 0);
-    int read_select = 0;
-    while (client->run) {
-        if (xSemaphoreTakeRecursive(client->lock, lock_timeout) != pdPASS) {
-            ESP_LOGE(TAG, "Failed to lock ws-client tasks, exiting the task...");
+}
+
+static int esp_websocket_client_reconnect_remaining_ms(esp_websocket_client_handle_t client)
+{
+    uint64_t elapsed_ms = _tick_get_ms() - client->reconnect_tick_ms;
+    return elapsed_ms >= client->reconnect_delay_ms ? 0 : client->reconnect_delay_ms - (int)elapsed_ms;
+}
+
+/* Runs one iteration of the client state machine, must be called with the client locked */
+static void esp_websocket_client_run_step(esp_websocket_client_handle_t client, int read_select)
+{
+#ifdef CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER
+    esp_websocket_buffer_pool_trim(client->buffer_pool);
+#endif
+    bool paused = PAUSED_BIT & xEventGroupGetBits(client->status_bits);
+    switch ((int)client->state) {
+    case WEBSOCKET_STATE_INIT:
+        if (paused && client->config->auto_reconnect) {
+            // wait for esp_websocket_client_resume() instead of attempting without a network
+            client->reconnect_tick_ms = _tick_get_ms();
+            client->reconnect_delay_ms = 0;
+            client->state = WEBSOCKET_STATE_WAIT_TIMEOUT;
+            break;
+        }
+        if (client->transport == NULL) {
+            ESP_LOGE(TAG, "There are no transport");
+            client->run = false;
             break;
         }
-        switch ((int)client->state) {
-        case WEBSOCKET_STATE_INIT:
-            if (client->transport == NULL) {
-                ESP_LOGE(TAG, "There are no transport");
-                client->run = false;
-                break;
+        esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_BEFORE_CONNECT, NULL, 0);
+        if (client->disconnect_tick_ms) {
+            client->reconnect_stats.attempts++;
+        }
+        int result = esp_transport_connect(client->transport,
+                                           client->config->host,
+                                           client->config->port,
+                                           esp_websocket_client_io_timeout_ms(client));
+        if (result < 0) {
+            esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(client->transport);
+            client->error_handle.esp_ws_handshake_status_code  = esp_transport_ws_get_upgrade_request_status(client->transport);
+            if (error_handle) {
+                esp_websocket_client_error(client, "esp_transport_connect() failed with %d, "
+                                           "transport_error=%s, tls_error_code=%i, tls_flags=%i, esp_ws_handshake_status_code=%d, errno=%d",
+                                           result, esp_err_to_name(error_handle->last_error), error_handle->esp_tls_error_code,
+                                           error_handle->esp_tls_flags, client->error_handle.esp_ws_handshake_status_code, errno);
+            } else {
+                esp_websocket_client_error(client, "esp_transport_connect() failed with %d, esp_ws_handshake_status_code=%d, errno=%d",
+                                           result, client->error_handle.esp_ws_handshake_status_code, errno);
             }
-            esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_BEFORE_CONNECT, NULL, 0);
-            int result = esp_transport_connect(client->transport,
-                                               client->config->host,
-                                               client->config->port,
-                                               client->config->network_timeout_ms);
-            if (result < 0) {
-                esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(client->transport);
-                client->error_handle.esp_ws_handshake_status_code  = esp_transport_ws_get_upgrade_request_status(client->transport);
-                if (error_handle) {
-                    esp_websocket_client_error(client, "esp_transport_connect() failed with %d, "
-                                               "transport_error=%s, tls_error_code=%i, tls_flags=%i, esp_ws_handshake_status_code=%d, errno=%d",
-                                               result, esp_err_to_name(error_handle->last_error), error_handle->esp_tls_error_code,
-                                               error_handle->esp_tls_flags, client->error_handle.esp_ws_handshake_status_code, errno);
-                } else {
-                    esp_websocket_client_error(client, "esp_transport_connect() failed with %d, esp_ws_handshake_status_code=%d, errno=%d",
-                                               result, client->error_handle.esp_ws_handshake_status_code, errno);
-                }
-                esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT);
-                break;
+            if (client->disconnect_tick_ms) {
+                client->reconnect_stats.failures++;
+            }
+            esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT);
+            break;
+        }
+        ESP_LOGD(TAG, "Transport connected to %s://%s:%d", client->config->scheme, client->config->host, client->config->port);
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+        if (esp_websocket_client_deflate_negotiate(client) != ESP_OK) {
+            if (client->disconnect_tick_ms) {
+                client->reconnect_stats.failures++;
             }
-            ESP_LOGD(TAG, "Transport connected to %s://%s:%d", client->config->scheme, client->config->host, client->config->port);
+            esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_HANDSHAKE);
+            break;
+        }
+#endif
+
+        if (client->disconnect_tick_ms) {
+            uint32_t outage_ms = _tick_get_ms() - client->disconnect_tick_ms;
+            client->reconnect_stats.reconnects++;
+            client->reconnect_stats.last_reconnect_ms = outage_ms;
+            client->reconnect_stats.total_reconnect_ms += outage_ms;
+            if (outage_ms > client->reconnect_stats.max_reconnect_ms) {
+                client->reconnect_stats.max_reconnect_ms = outage_ms;
+            }
+            client->disconnect_tick_ms = 0;
+        }
+        client->reconnect_backoff_ms = client->wait_timeout_ms;
+        xEventGroupClearBits(client->status_bits, RECONNECT_NOW_BIT);
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        if (client->config->tls_session_resumption && client->transport != client->config->ext_transport) {
+            esp_websocket_client_update_tls_stats(client);
+        }
+#endif
 
-            client->state = WEBSOCKET_STATE_CONNECTED;
-            client->wait_for_pong_resp = false;
-            client->error_handle.error_type = WEBSOCKET_ERROR_TYPE_NONE;
-            esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_CONNECTED, NULL, 0);
+        client->state = WEBSOCKET_STATE_CONNECTED;
+        client->wait_for_pong_resp = false;
+        client->ping_sent_us = 0;
+        client->ping_interval_ms = client->config->ping_interval_sec * 1000;
+        client->error_handle.error_type = WEBSOCKET_ERROR_TYPE_NONE;
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+        esp_websocket_client_deflate_reset(client);
+#endif
+        esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_CONNECTED, NULL, 0);
+        break;
+    case WEBSOCKET_STATE_CONNECTED:
+        if (paused && (CLOSE_FRAME_SENT_BIT & xEventGroupGetBits(client->status_bits)) == 0) {
+            // the link is known to be gone, do not wait for the PONG timeout to notice
+            ESP_LOGI(TAG, "Client paused, dropping the connection");
+            esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_NONE);
             break;
-        case WEBSOCKET_STATE_CONNECTED:
-            if ((CLOSE_FRAME_SENT_BIT & xEventGroupGetBits(client->status_bits)) == 0) { // only send and check for PING
-                // if closing hasn't been initiated
-                if (_tick_get_ms() - client->ping_tick_ms > client->config->ping_interval_sec * 1000) {
-                    client->ping_tick_ms = _tick_get_ms();
-                    ESP_LOGD(TAG, "Sending PING...");
-                    esp_transport_ws_send_raw(client->transport, WS_TRANSPORT_OPCODES_PING | WS_TRANSPORT_OPCODES_FIN, NULL, 0, client->config->network_timeout_ms);
-
-                    if (!client->wait_for_pong_resp && client->config->pingpong_timeout_sec) {
-                        client->pingpong_tick_ms = _tick_get_ms();
-                        client->wait_for_pong_resp = true;
-                    }
+        }
+        if ((CLOSE_FRAME_SENT_BIT & xEventGroupGetBits(client->status_bits)) == 0) { // only send and check for PING
+            // if closing hasn't been initiated
+            // with adaptive pings received traffic proves liveness and postpones the PING, see below
+            if (_tick_get_ms() - client->ping_tick_ms > client->ping_interval_ms) {
+                client->ping_tick_ms = _tick_get_ms();
+                ESP_LOGD(TAG, "Sending PING...");
+                esp_websocket_client_send_ping(client);
+
+                if (!client->wait_for_pong_resp && client->config->pingpong_timeout_sec) {
+                    client->pingpong_tick_ms = _tick_get_ms();
+                    client->wait_for_pong_resp = true;
                 }
+            }
 
-                if ( _tick_get_ms() - client->pingpong_tick_ms > client->config->pingpong_timeout_sec * 1000 ) {
-                    if (client->wait_for_pong_resp) {
-                        esp_websocket_client_error(client, "Error, no PONG received for more than %d seconds after PING", client->config->pingpong_timeout_sec);
-                        esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_PONG_TIMEOUT);
-                        break;
-                    }
+            if ( _tick_get_ms() - client->pingpong_tick_ms > client->config->pingpong_timeout_sec * 1000 ) {
+                if (client->wait_for_pong_resp) {
+                    esp_websocket_client_error(client, "Error, no PONG received for more than %d seconds after PING", client->config->pingpong_timeout_sec);
+                    esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_PONG_TIMEOUT);
+                    break;
                 }
             }
+        }
 
 
-            if (read_select == 0) {
-                ESP_LOGV(TAG, "Read poll timeout: skipping esp_transport_read()...");
-                break;
-            }
-            client->ping_tick_ms = _tick_get_ms();
-
-            if (esp_websocket_client_recv(client) == ESP_FAIL) {
-                ESP_LOGE(TAG, "Error receive data");
-                esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT);
-                break;
-            }
+        if (read_select == 0) {
+            ESP_LOGV(TAG, "Read poll timeout: skipping esp_transport_read()...");
             break;
-        case WEBSOCKET_STATE_WAIT_TIMEOUT:
+        }
+        if (client->config->ping_adaptive) {
+            client->ping_tick_ms = _tick_get_ms();
+        }
 
-            if (_tick_get_ms() - client->reconnect_tick_ms > client->wait_timeout_ms) {
-                client->state = WEBSOCKET_STATE_INIT;
-                client->reconnect_tick_ms = _tick_get_ms();
-                ESP_LOGD(TAG, "Reconnecting...");
-            }
+        if (esp_websocket_client_recv(client) == ESP_FAIL) {
+            ESP_LOGE(TAG, "Error receive data");
+            esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT);
             break;
-        case WEBSOCKET_STATE_CLOSING:
-            // if closing not initiated by the client echo the close message back
-            if ((CLOSE_FRAME_SENT_BIT & xEventGroupGetBits(client->status_bits)) == 0) {
-                ESP_LOGD(TAG, "Closing initiated by the server, sending close frame");
-                esp_transport_ws_send_raw(client->transport, WS_TRANSPORT_OPCODES_CLOSE | WS_TRANSPORT_OPCODES_FIN, NULL, 0, client->config->network_timeout_ms);
-                xEventGroupSetBits(client->status_bits, CLOSE_FRAME_SENT_BIT);
+        }
+        break;
+    case WEBSOCKET_STATE_WAIT_TIMEOUT:
+        if (paused) {
+            // a reconnect request is moot while paused, resuming requests one again
+            xEventGroupClearBits(client->status_bits, RECONNECT_NOW_BIT);
+            if ((PAUSED_BIT & xEventGroupGetBits(client->status_bits)) == 0) {
+                // resumed in between, keep its request
+                xEventGroupSetBits(client->status_bits, RECONNECT_NOW_BIT);
             }
             break;
-        default:
-            ESP_LOGD(TAG, "Client run iteration in a default state: %d", client->state);
+        }
+        if (xEventGroupClearBits(client->status_bits, RECONNECT_NOW_BIT) & RECONNECT_NOW_BIT) {
+            // the network came back, a new outage starts over with the initial delay
+            ESP_LOGD(TAG, "Reconnect requested, skipping the remaining %d ms",
+                     esp_websocket_client_reconnect_remaining_ms(client));
+            client->reconnect_delay_ms = 0;
+            client->reconnect_backoff_ms = client->wait_timeout_ms;
+        }
+        if (_tick_get_ms() - client->reconnect_tick_ms >= client->reconnect_delay_ms) {
+            client->state = WEBSOCKET_STATE_INIT;
+            client->reconnect_tick_ms = _tick_get_ms();
+            ESP_LOGD(TAG, "Reconnecting...");
+        }
+        break;
+    case WEBSOCKET_STATE_CLOSING:
+        // if closing not initiated by the client echo the close message back
+        if ((CLOSE_FRAME_SENT_BIT & xEventGroupGetBits(client->status_bits)) == 0) {
+            ESP_LOGD(TAG, "Closing initiated by the server, sending close frame");
+            esp_transport_ws_send_raw(client->transport, WS_TRANSPORT_OPCODES_CLOSE | WS_TRANSPORT_OPCODES_FIN, NULL, 0, esp_websocket_client_io_timeout_ms(client));
+            xEventGroupSetBits(client->status_bits, CLOSE_FRAME_SENT_BIT);
+        }
+        break;
+    default:
+        ESP_LOGD(TAG, "Client run iteration in a default state: %d", client->state);
+        break;
+    }
+}
+
+static void esp_websocket_client_poll_error(esp_websocket_client_handle_t client, int read_select)
+{
+    esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(client->transport);
+    if (error_handle) {
+        esp_websocket_client_error(client, "esp_transport_poll_read() returned %d, transport_error=%s, tls_error_code=%i, tls_flags=%i, errno=%d",
+                                   read_select, esp_err_to_name(error_handle->last_error), error_handle->esp_tls_error_code,
+                                   error_handle->esp_tls_flags, errno);
+    } else {
+        esp_websocket_client_error(client, "esp_transport_poll_read() returned %d, errno=%d", read_select, errno);
+    }
+    xSemaphoreTakeRecursive(client->lock, portMAX_DELAY);
+    esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT);
+    xSemaphoreGiveRecursive(client->lock);
+}
+
+/* Completes the clean close once the server closed the TCP connection (or the wait expired) */
+static void esp_websocket_client_closed(esp_websocket_client_handle_t client, int poll_result)
+{
+    if (poll_result == 0) {
+        ESP_LOGW(TAG, "Did not get TCP close within expected delay");
+
+    } else if (poll_result < 0) {
+        ESP_LOGW(TAG, "Connection terminated while waiting for clean TCP close");
+    }
+    client->run = false;
+    client->state = WEBSOCKET_STATE_UNKNOW;
+    esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_CLOSED, NULL, 0);
+}
+
+static void esp_websocket_client_run_end(esp_websocket_client_handle_t client)
+{
+    esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_FINISH, NULL, 0);
+    esp_transport_close(client->transport);
+    xEventGroupSetBits(client->status_bits, STOPPED_BIT);
+    client->state = WEBSOCKET_STATE_UNKNOW;
+    if (client->selected_for_destroying == true) {
+        destroy_and_free_resources(client);
+    }
+}
+
+static void esp_websocket_client_task(void *pv)
+{
+    const int lock_timeout = portMAX_DELAY;
+    esp_websocket_client_handle_t client = (esp_websocket_client_handle_t) pv;
+
+    esp_websocket_client_run_begin(client);
+    int read_select = 0;
+    while (client->run) {
+        if (xSemaphoreTakeRecursive(client->lock, lock_timeout) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to lock ws-client tasks, exiting the task...");
             break;
         }
+        esp_websocket_client_run_step(client, read_select);
         xSemaphoreGiveRecursive(client->lock);
         if (WEBSOCKET_STATE_CONNECTED == client->state) {
             read_select = esp_transport_poll_read(client->transport, 1000); //Poll every 1000ms
             if (read_select < 0) {
-                esp_tls_error_handle_t error_handle = esp_transport_get_error_handle(client->transport);
-                if (error_handle) {
-                    esp_websocket_client_error(client, "esp_transport_poll_read() returned %d, transport_error=%s, tls_error_code=%i, tls_flags=%i, errno=%d",
-                                               read_select, esp_err_to_name(error_handle->last_error), error_handle->esp_tls_error_code,
-                                               error_handle->esp_tls_flags, errno);
-                } else {
-                    esp_websocket_client_error(client, "esp_transport_poll_read() returned %d, errno=%d", read_select, errno);
-                }
-                xSemaphoreTakeRecursive(client->lock, lock_timeout);
-                esp_websocket_client_abort_connection(client, WEBSOCKET_ERROR_TYPE_TCP_TRANSPORT);
-                xSemaphoreGiveRecursive(client->lock);
+                esp_websocket_client_poll_error(client, read_select);
             }
         } else if (WEBSOCKET_STATE_WAIT_TIMEOUT == client->state) {
-            // waiting for reconnecting...
-            vTaskDelay(client->wait_timeout_ms / 2 / portTICK_PERIOD_MS);
+            // waiting for reconnecting, or for esp_websocket_client_reconnect_now() / resume()
+            bool paused = PAUSED_BIT & xEventGroupGetBits(client->status_bits);
+            xEventGroupWaitBits(client->status_bits, RECONNECT_NOW_BIT, false, false,
+                                paused ? portMAX_DELAY : pdMS_TO_TICKS(esp_websocket_client_reconnect_remaining_ms(client)) + 1);
         } else if (WEBSOCKET_STATE_CLOSING == client->state &&
                    (CLOSE_FRAME_SENT_BIT & xEventGroupGetBits(client->status_bits))) {
             ESP_LOGD(TAG, " Waiting for TCP connection to be closed by the server");
-            int ret = esp_transport_ws_poll_connection_closed(client->transport, 1000);
-            if (ret == 0) {
-                ESP_LOGW(TAG, "Did not get TCP close within expected delay");
-
-            } else if (ret < 0) {
-                ESP_LOGW(TAG, "Connection terminated while waiting for clean TCP close");
-            }
-            client->run = false;
-            client->state = WEBSOCKET_STATE_UNKNOW;
-            esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_CLOSED, NULL, 0);
+            esp_websocket_client_closed(client, esp_websocket_client_poll_connection_closed(client, WEBSOCKET_CLOSE_WAIT_MS));
             break;
         }
     }
 
-    esp_websocket_client_dispatch_event(client, WEBSOCKET_EVENT_FINISH, NULL, 0);
-    esp_transport_close(client->transport);
-    xEventGroupSetBits(client->status_bits, STOPPED_BIT);
-    client->state = WEBSOCKET_STATE_UNKNOW;
-    if (client->selected_for_destroying == true) {
-        destroy_and_free_resources(client);
+    esp_websocket_client_run_end(client);
+    vTaskDelete(NULL);
+}
+
+/*
+ * Services one managed client before the manager waits in select(). Adds the socket of a connected
+ * client to `readset` and shortens `timeout_ms` if the client has to run again before the poll interval.
+ * Returns false once the client stopped running.
+ */
+static bool esp_websocket_client_manager_run_client(esp_websocket_client_handle_t client, fd_set *readset, int *maxfd, int *timeout_ms)
+{
+    if (xSemaphoreTakeRecursive(client->lock, portMAX_DELAY) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to lock ws-client, stopping the client...");
+        client->run = false;
+        return false;
+    }
+    esp_websocket_client_run_step(client, client->manager_read_select);
+    xSemaphoreGiveRecursive(client->lock);
+    client->manager_read_select = 0;
+    if (!client->run) {
+        return false;
+    }
+
+    if (WEBSOCKET_STATE_CONNECTED == client->state) {
+        int sock = esp_websocket_client_get_socket(client);
+        if (sock < 0) {
+            esp_websocket_client_poll_error(client, sock);
+            *timeout_ms = 0;
+            return client->run;
+        }
+        // TLS records may already be decrypted and buffered, select() would not report those
+        if (strcasecmp(client->config->scheme, WS_OVER_TLS_SCHEME) == 0 && esp_transport_poll_read(client->transport, 0) > 0) {
+            client->manager_read_select = 1;
+            *timeout_ms = 0;
+        }
+        FD_SET(sock, readset);
+        if (sock > *maxfd) {
+            *maxfd = sock;
+        }
+    } else if (WEBSOCKET_STATE_WAIT_TIMEOUT == client->state) {
+        EventBits_t bits = xEventGroupGetBits(client->status_bits);
+        if (bits & PAUSED_BIT) {
+            // no deadline, resuming is noticed within the poll interval
+            return true;
+        }
+        int remaining_ms = esp_websocket_client_reconnect_remaining_ms(client);
+        if (RECONNECT_NOW_BIT & bits) {
+            remaining_ms = 0;
+        }
+        if (remaining_ms < *timeout_ms) {
+            *timeout_ms = remaining_ms;
+        }
+    } else if (WEBSOCKET_STATE_CLOSING == client->state &&
+               (CLOSE_FRAME_SENT_BIT & xEventGroupGetBits(client->status_bits))) {
+        // the manager must not block on a single connection, so poll and keep the deadline instead
+        if (client->close_tick_ms == 0) {
+            ESP_LOGD(TAG, " Waiting for TCP connection to be closed by the server");
+            client->close_tick_ms = _tick_get_ms();
+        }
+        int ret = esp_websocket_client_poll_connection_closed(client, 0);
+        if (ret != 0 || _tick_get_ms() - client->close_tick_ms > WEBSOCKET_CLOSE_WAIT_MS) {
+            client->close_tick_ms = 0;
+            esp_websocket_client_closed(client, ret);
+            return false;
+        }
+        if (*timeout_ms > 100) {
+            *timeout_ms = 100;
+        }
+    } else {
+        *timeout_ms = 0;
     }
+    return true;
+}
+
+static void esp_websocket_client_manager_task(void *pv)
+{
+    esp_websocket_client_manager_handle_t manager = (esp_websocket_client_manager_handle_t) pv;
+    esp_websocket_client_handle_t client, next;
+
+    while (manager->run) {
+        fd_set readset;
+        int maxfd = -1;
+        int timeout_ms = manager->poll_interval_ms;
+        FD_ZERO(&readset);
+
+        xSemaphoreTakeRecursive(manager->lock, portMAX_DELAY);
+        for (client = STAILQ_FIRST(&manager->clients); client != NULL; client = next) {
+            // the client might be destroyed at the end of its run
+            next = STAILQ_NEXT(client, manager_entry);
+            if (client->manager_begin_pending) {
+                client->manager_begin_pending = false;
+                if (!client->run) {
+                    // stopped before it ever ran
+                    xEventGroupSetBits(client->status_bits, STOPPED_BIT);
+                    continue;
+                }
+                client->manager_active = true;
+                client->manager_read_select = 0;
+                client->close_tick_ms = 0;
+                esp_websocket_client_run_begin(client);
+            }
+            if (!client->manager_active) {
+                continue;
+            }
+            if (!client->run || !esp_websocket_client_manager_run_client(client, &readset, &maxfd, &timeout_ms)) {
+                client->manager_active = false;
+                esp_websocket_client_run_end(client);
+            }
+        }
+        xSemaphoreGiveRecursive(manager->lock);
+
+        if (maxfd < 0) {
+            vTaskDelay(timeout_ms / portTICK_PERIOD_MS);
+            continue;
+        }
+        struct timeval timeout = {
+            .tv_sec = timeout_ms / 1000,
+            .tv_usec = (timeout_ms % 1000) * 1000,
+        };
+        int ret = select(maxfd + 1, &readset, NULL, NULL, &timeout);
+        if (ret == 0) {
+            continue;
+        }
+
+        xSemaphoreTakeRecursive(manager->lock, portMAX_DELAY);
+        STAILQ_FOREACH(client, &manager->clients, manager_entry) {
+            if (!client->manager_active || client->state != WEBSOCKET_STATE_CONNECTED) {
+                continue;
+            }
+            if (ret > 0) {
+                int sock = esp_websocket_client_get_socket(client);
+                if (sock >= 0 && FD_ISSET(sock, &readset)) {
+                    client->manager_read_select = 1;
+                }
+            } else {
+                // select() failed on the whole set, find out which of the connections is broken
+                int read_select = esp_transport_poll_read(client->transport, 0);
+                if (read_select < 0) {
+                    esp_websocket_client_poll_error(client, read_select);
+                } else {
+                    client->manager_read_select = read_select;
+                }
+            }
+        }
+        xSemaphoreGiveRecursive(manager->lock);
+    }
+
+    xEventGroupSetBits(manager->status_bits, STOPPED_BIT);
     vTaskDelete(NULL);
 }
 
@@ -1162,8 +2212,25 @@ esp_err_t esp_websocket_client_start(esp_websocket_client_handle_t client)
         }
     }
 
-    if (xTaskCreate(esp_websocket_client_task, client->config->task_name ? client->config->task_name : "websocket_task",
-                    client->config->task_stack, client, client->config->task_prio, &client->task_handle) != pdTRUE) {
+    if (client->manager) {
+        xSemaphoreTakeRecursive(client->manager->lock, portMAX_DELAY);
+        if (client->manager_active || client->manager_begin_pending) {
+            xSemaphoreGiveRecursive(client->manager->lock);
+            ESP_LOGE(TAG, "The client has started");
+            return ESP_FAIL;
+        }
+        client->task_handle = client->manager->task_handle;
+        client->run = true;
+        client->manager_begin_pending = true;
+        xEventGroupClearBits(client->status_bits, STOPPED_BIT | CLOSE_FRAME_SENT_BIT);
+        xSemaphoreGiveRecursive(client->manager->lock);
+        ESP_LOGI(TAG, "Started on connection manager");
+        return ESP_OK;
+    }
+
+    if (xTaskCreatePinnedToCore(esp_websocket_client_task, client->config->task_name ? client->config->task_name : "websocket_task",
+                                client->config->task_stack, client, client->config->task_prio, &client->task_handle,
+                                client->config->task_core_id) != pdTRUE) {
         ESP_LOGE(TAG, "Error create websocket task");
         return ESP_FAIL;
     }
@@ -1322,6 +2389,7 @@ esp_err_t esp_websocket_client_set_ping_interval_sec(esp_websocket_client_handle
     }
 
     client->config->ping_interval_sec = ping_interval_sec == 0 ? WEBSOCKET_PING_INTERVAL_SEC : ping_interval_sec;
+    client->ping_interval_ms = client->config->ping_interval_sec * 1000;
 
     return ESP_OK;
 }
@@ -1338,7 +2406,7 @@ int esp_websocket_client_get_reconnect_timeout(esp_websocket_client_handle_t cli
         return -1;
     }
 
-    return client->wait_timeout_ms;
+    return client->reconnect_backoff_ms;
 }
 
 esp_err_t esp_websocket_client_set_reconnect_timeout(esp_websocket_client_handle_t client, int reconnect_timeout_ms)
@@ -1359,7 +2427,126 @@ esp_err_t esp_websocket_client_set_reconnect_timeout(esp_websocket_client_handle
     }
 
     client->wait_timeout_ms = reconnect_timeout_ms;
+    client->reconnect_backoff_ms = reconnect_timeout_ms;
+
+    return ESP_OK;
+}
 
+esp_err_t esp_websocket_client_reconnect_now(esp_websocket_client_handle_t client)
+{
+    if (client == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!client->config->auto_reconnect) {
+        ESP_LOGW(TAG, "Automatic reconnect is disabled");
+        return ESP_ERR_INVALID_STATE;
+    }
+    // the bit is consumed by the next reconnect wait, or dropped once the client is connected
+    xEventGroupSetBits(client->status_bits, RECONNECT_NOW_BIT);
+    return ESP_OK;
+}
+
+esp_err_t esp_websocket_client_pause(esp_websocket_client_handle_t client)
+{
+    if (client == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!client->config->auto_reconnect) {
+        ESP_LOGW(TAG, "Automatic reconnect is disabled");
+        return ESP_ERR_INVALID_STATE;
+    }
+    xEventGroupSetBits(client->status_bits, PAUSED_BIT);
+    return ESP_OK;
+}
+
+esp_err_t esp_websocket_client_resume(esp_websocket_client_handle_t client)
+{
+    if (client == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!client->config->auto_reconnect) {
+        ESP_LOGW(TAG, "Automatic reconnect is disabled");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xEventGroupClearBits(client->status_bits, PAUSED_BIT) & PAUSED_BIT) {
+        xEventGroupSetBits(client->status_bits, RECONNECT_NOW_BIT);
+    }
+    return ESP_OK;
+}
+
+bool esp_websocket_client_is_paused(esp_websocket_client_handle_t client)
+{
+    return client && (PAUSED_BIT & xEventGroupGetBits(client->status_bits));
+}
+
+esp_err_t esp_websocket_client_get_tls_stats(esp_websocket_client_handle_t client, esp_websocket_tls_stats_t *stats)
+{
+    if (client == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!client->config->tls_session_resumption) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    xSemaphoreTakeRecursive(client->lock, portMAX_DELAY);
+    *stats = client->tls_stats;
+    xSemaphoreGiveRecursive(client->lock);
+    return ESP_OK;
+}
+
+static int esp_websocket_client_rtt_compare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+esp_err_t esp_websocket_client_get_rtt_stats(esp_websocket_client_handle_t client, esp_websocket_rtt_stats_t *stats)
+{
+    if (client == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t sorted[WEBSOCKET_RTT_WINDOW];
+    memset(stats, 0, sizeof(*stats));
+
+    xSemaphoreTakeRecursive(client->lock, portMAX_DELAY);
+    uint32_t count = client->rtt_samples < WEBSOCKET_RTT_WINDOW ? client->rtt_samples : WEBSOCKET_RTT_WINDOW;
+    memcpy(sorted, client->rtt_window, count * sizeof(uint32_t));
+    if (count) {
+        stats->last_us = client->rtt_window[(client->rtt_samples - 1) % WEBSOCKET_RTT_WINDOW];
+    }
+    stats->avg_us = esp_websocket_client_rtt_avg_us(client);
+    stats->pings_sent = client->pings_sent;
+    stats->pongs_received = client->rtt_samples;
+    stats->spikes = client->rtt_spikes;
+    stats->ping_interval_ms = client->ping_interval_ms ? client->ping_interval_ms : client->config->ping_interval_sec * 1000;
+    xSemaphoreGiveRecursive(client->lock);
+
+    stats->samples = count;
+    if (count == 0) {
+        return ESP_OK;
+    }
+    qsort(sorted, count, sizeof(uint32_t), esp_websocket_client_rtt_compare);
+    stats->min_us = sorted[0];
+    stats->max_us = sorted[count - 1];
+    stats->p99_us = sorted[(count * 99 + 99) / 100 - 1];
+    for (int i = 0; i < count; i++) {
+        int bucket = 0;
+        while (bucket < ESP_WEBSOCKET_RTT_HISTOGRAM_BUCKETS - 1 && sorted[i] >= (1000U << bucket)) {
+            bucket++;
+        }
+        stats->histogram[bucket]++;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_websocket_client_get_reconnect_stats(esp_websocket_client_handle_t client, esp_websocket_reconnect_stats_t *stats)
+{
+    if (client == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTakeRecursive(client->lock, portMAX_DELAY);
+    *stats = client->reconnect_stats;
+    xSemaphoreGiveRecursive(client->lock);
     return ESP_OK;
 }
 
@@ -1373,3 +2560,92 @@ esp_err_t esp_websocket_register_events(esp_websocket_client_handle_t client,
     }
     return esp_event_handler_register_with(client->event_handle, WEBSOCKET_EVENTS, event, event_handler, event_handler_arg);
 }
+
+esp_err_t esp_websocket_client_get_buffer_stats(esp_websocket_client_handle_t client, esp_websocket_buffer_pool_stats_t *stats)
+{
+    if (client == NULL || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#ifdef CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER
+    return esp_websocket_buffer_pool_get_stats(client->buffer_pool, stats);
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_websocket_client_manager_handle_t esp_websocket_client_manager_init(const esp_websocket_client_manager_config_t *config)
+{
+    const esp_websocket_client_manager_config_t default_config = { 0 };
+    if (config == NULL) {
+        config = &default_config;
+    }
+    if (config->task_pinned && (config->task_core_id < 0 || config->task_core_id >= portNUM_PROCESSORS)) {
+        ESP_LOGE(TAG, "Invalid manager task core %d", config->task_core_id);
+        return NULL;
+    }
+
+    esp_websocket_client_manager_handle_t manager = calloc(1, sizeof(struct esp_websocket_client_manager));
+    ESP_WS_CLIENT_MEM_CHECK(TAG, manager, return NULL);
+    STAILQ_INIT(&manager->clients);
+
+    manager->buffer_size = config->buffer_size > 0 ? config->buffer_size : WEBSOCKET_BUFFER_SIZE_BYTE;
+    manager->poll_interval_ms = config->poll_interval_ms > 0 ? config->poll_interval_ms : WEBSOCKET_MANAGER_POLL_MS;
+    manager->step_timeout_ms = config->step_timeout_ms > 0 ? config->step_timeout_ms : WEBSOCKET_MANAGER_STEP_MS;
+
+    manager->lock = xSemaphoreCreateRecursiveMutex();
+    ESP_WS_CLIENT_MEM_CHECK(TAG, manager->lock, goto _manager_init_fail);
+    manager->status_bits = xEventGroupCreate();
+    ESP_WS_CLIENT_MEM_CHECK(TAG, manager->status_bits, goto _manager_init_fail);
+    manager->rx_buffer = malloc(manager->buffer_size);
+    ESP_WS_CLIENT_MEM_CHECK(TAG, manager->rx_buffer, goto _manager_init_fail);
+
+    manager->run = true;
+    if (xTaskCreatePinnedToCore(esp_websocket_client_manager_task, config->task_name ? config->task_name : "websocket_mgr",
+                                config->task_stack > 0 ? config->task_stack : WEBSOCKET_TASK_STACK, manager,
+                                config->task_prio > 0 ? config->task_prio : WEBSOCKET_TASK_PRIORITY, &manager->task_handle,
+                                config->task_pinned ? config->task_core_id : tskNO_AFFINITY) != pdTRUE) {
+        ESP_LOGE(TAG, "Error create websocket manager task");
+        goto _manager_init_fail;
+    }
+    return manager;
+
+_manager_init_fail:
+    if (manager->lock) {
+        vSemaphoreDelete(manager->lock);
+    }
+    if (manager->status_bits) {
+        vEventGroupDelete(manager->status_bits);
+    }
+    free(manager->rx_buffer);
+    free(manager);
+    return NULL;
+}
+
+esp_err_t esp_websocket_client_manager_destroy(esp_websocket_client_manager_handle_t manager)
+{
+    if (manager == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (xTaskGetCurrentTaskHandle() == manager->task_handle) {
+        ESP_LOGE(TAG, "Manager cannot be destroyed from its own task");
+        return ESP_FAIL;
+    }
+
+    xSemaphoreTakeRecursive(manager->lock, portMAX_DELAY);
+    bool has_clients = !STAILQ_EMPTY(&manager->clients);
+    if (!has_clients) {
+        manager->run = false;
+    }
+    xSemaphoreGiveRecursive(manager->lock);
+    if (has_clients) {
+        ESP_LOGE(TAG, "Destroy all clients of the manager first");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xEventGroupWaitBits(manager->status_bits, STOPPED_BIT, false, true, portMAX_DELAY);
+    vSemaphoreDelete(manager->lock);
+    vEventGroupDelete(manager->status_bits);
+    free(manager->rx_buffer);
+    free(manager);
+    return ESP_OK;
+}
@@ -0,0 +1,685 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_websocket_deflate.h"
+
+#define DEFLATE_MIN_MATCH       (3)
+#define DEFLATE_MAX_MATCH       (258)
+#define DEFLATE_MAX_CHAIN       (8)
+#define DEFLATE_NICE_MATCH      (64)
+#define DEFLATE_MAX_BITS        (15)
+#define DEFLATE_MAX_HASH_BITS   (12)
+#define DEFLATE_END_OF_BLOCK    (256)
+#define DEFLATE_TOKEN_BYTES     (5)     /* Longest token is 31 bits, plus up to 7 pending bits */
+
+static const uint16_t s_length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t s_length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t s_dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t s_dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t s_codelen_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static int clamp_window_bits(int window_bits)
+{
+    if (window_bits < ESP_WEBSOCKET_DEFLATE_MIN_WINDOW_BITS) {
+        return ESP_WEBSOCKET_DEFLATE_MIN_WINDOW_BITS;
+    }
+    if (window_bits > ESP_WEBSOCKET_DEFLATE_MAX_WINDOW_BITS) {
+        return ESP_WEBSOCKET_DEFLATE_MAX_WINDOW_BITS;
+    }
+    return window_bits;
+}
+
+/* Compressor */
+
+typedef enum {
+    DEFLATE_STATE_START = 0,
+    DEFLATE_STATE_DATA,
+    DEFLATE_STATE_DONE,
+} deflate_state_t;
+
+struct esp_websocket_deflate {
+    uint8_t         *window;        /* 2 * wsize bytes: history followed by lookahead */
+    uint16_t        *head;          /* Most recent window position per hash */
+    uint16_t        *prev;          /* Previous position with the same hash, indexed by position modulo wsize */
+    uint32_t        wsize;
+    uint32_t        hash_mask;
+    uint32_t        pos;            /* Next byte to encode */
+    uint32_t        end;            /* Valid bytes in the window */
+    uint64_t        bitbuf;
+    int             bitcnt;
+    deflate_state_t state;
+};
+
+static inline uint32_t deflate_hash(const esp_websocket_deflate_handle_t d, uint32_t pos)
+{
+    const uint8_t *p = d->window + pos;
+    return (((uint32_t)p[0] << 10) ^ ((uint32_t)p[1] << 5) ^ p[2]) & d->hash_mask;
+}
+
+static inline void deflate_put_bits(esp_websocket_deflate_handle_t d, uint32_t value, int bits)
+{
+    d->bitbuf |= (uint64_t)value << d->bitcnt;
+    d->bitcnt += bits;
+}
+
+/* Huffman codes are packed starting from their most significant bit */
+static inline void deflate_put_code(esp_websocket_deflate_handle_t d, uint32_t code, int bits)
+{
+    uint32_t reversed = 0;
+    for (int i = 0; i < bits; i++) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    deflate_put_bits(d, reversed, bits);
+}
+
+static size_t deflate_flush_bytes(esp_websocket_deflate_handle_t d, uint8_t *out, size_t out_len)
+{
+    size_t written = 0;
+    while (d->bitcnt >= 8 && written < out_len) {
+        out[written++] = (uint8_t)d->bitbuf;
+        d->bitbuf >>= 8;
+        d->bitcnt -= 8;
+    }
+    return written;
+}
+
+static void deflate_put_literal_length(esp_websocket_deflate_handle_t d, int symbol)
+{
+    if (symbol < 144) {
+        deflate_put_code(d, 0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        deflate_put_code(d, 0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        deflate_put_code(d, symbol - 256, 7);
+    } else {
+        deflate_put_code(d, 0xc0 + symbol - 280, 8);
+    }
+}
+
+static void deflate_put_match(esp_websocket_deflate_handle_t d, uint32_t length, uint32_t dist)
+{
+    int code = 0;
+    while (code < 28 && s_length_base[code + 1] <= length) {
+        code++;
+    }
+    deflate_put_literal_length(d, 257 + code);
+    deflate_put_bits(d, length - s_length_base[code], s_length_extra[code]);
+
+    code = 0;
+    while (code < 29 && s_dist_base[code + 1] <= dist) {
+        code++;
+    }
+    deflate_put_code(d, code, 5);
+    deflate_put_bits(d, dist - s_dist_base[code], s_dist_extra[code]);
+}
+
+static void deflate_insert(esp_websocket_deflate_handle_t d, uint32_t pos)
+{
+    if (pos + DEFLATE_MIN_MATCH > d->end) {
+        return;
+    }
+    uint32_t h = deflate_hash(d, pos);
+    d->prev[pos & (d->wsize - 1)] = d->head[h];
+    d->head[h] = (uint16_t)pos;
+}
+
+static uint32_t deflate_longest_match(esp_websocket_deflate_handle_t d, uint32_t *match_dist)
+{
+    uint32_t pos = d->pos;
+    uint32_t max_len = d->end - pos;
+    if (max_len < DEFLATE_MIN_MATCH) {
+        return 0;
+    }
+    if (max_len > DEFLATE_MAX_MATCH) {
+        max_len = DEFLATE_MAX_MATCH;
+    }
+    const uint8_t *cur = d->window + pos;
+    uint32_t best_len = 0;
+    uint32_t cand = d->head[deflate_hash(d, pos)];
+    /* Positions are validated against the current one, stale entries just fail the byte comparison */
+    for (int chain = 0; chain < DEFLATE_MAX_CHAIN && cand < pos && pos - cand < d->wsize; chain++) {
+        const uint8_t *m = d->window + cand;
+        if (m[best_len] == cur[best_len] && m[0] == cur[0]) {
+            uint32_t len = 0;
+            while (len < max_len && m[len] == cur[len]) {
+                len++;
+            }
+            if (len > best_len) {
+                best_len = len;
+                *match_dist = pos - cand;
+                if (len >= DEFLATE_NICE_MATCH || len == max_len) {
+                    break;
+                }
+            }
+        }
+        uint32_t next = d->prev[cand & (d->wsize - 1)];
+        if (next >= cand) {
+            break;
+        }
+        cand = next;
+    }
+    return best_len >= DEFLATE_MIN_MATCH ? best_len : 0;
+}
+
+static void deflate_slide(esp_websocket_deflate_handle_t d)
+{
+    memmove(d->window, d->window + d->wsize, d->end - d->wsize);
+    d->pos -= d->wsize;
+    d->end -= d->wsize;
+    for (uint32_t i = 0; i <= d->hash_mask; i++) {
+        d->head[i] = d->head[i] >= d->wsize ? d->head[i] - d->wsize : 0;
+    }
+    for (uint32_t i = 0; i < d->wsize; i++) {
+        d->prev[i] = d->prev[i] >= d->wsize ? d->prev[i] - d->wsize : 0;
+    }
+}
+
+esp_websocket_deflate_handle_t esp_websocket_deflate_init(int window_bits)
+{
+    window_bits = clamp_window_bits(window_bits);
+    esp_websocket_deflate_handle_t d = calloc(1, sizeof(struct esp_websocket_deflate));
+    if (d == NULL) {
+        return NULL;
+    }
+    d->wsize = 1U << window_bits;
+    d->hash_mask = (1U << (window_bits < DEFLATE_MAX_HASH_BITS ? window_bits : DEFLATE_MAX_HASH_BITS)) - 1;
+    d->window = malloc(2 * d->wsize);
+    d->head = calloc(d->hash_mask + 1, sizeof(uint16_t));
+    d->prev = calloc(d->wsize, sizeof(uint16_t));
+    if (d->window == NULL || d->head == NULL || d->prev == NULL) {
+        esp_websocket_deflate_destroy(d);
+        return NULL;
+    }
+    return d;
+}
+
+void esp_websocket_deflate_reset(esp_websocket_deflate_handle_t d)
+{
+    d->pos = 0;
+    d->end = 0;
+    d->bitbuf = 0;
+    d->bitcnt = 0;
+    d->state = DEFLATE_STATE_START;
+    memset(d->head, 0, (d->hash_mask + 1) * sizeof(uint16_t));
+}
+
+void esp_websocket_deflate_destroy(esp_websocket_deflate_handle_t d)
+{
+    if (d == NULL) {
+        return;
+    }
+    free(d->window);
+    free(d->head);
+    free(d->prev);
+    free(d);
+}
+
+size_t esp_websocket_deflate_message(esp_websocket_deflate_handle_t d, const uint8_t **in, size_t *in_len,
+                                     uint8_t *out, size_t out_len, bool *done)
+{
+    size_t written = 0;
+    *done = false;
+    if (d->state == DEFLATE_STATE_DONE) {
+        d->state = DEFLATE_STATE_START;
+    }
+    if (d->state == DEFLATE_STATE_START) {
+        /* BFINAL = 0, BTYPE = 01 (fixed Huffman codes) */
+        deflate_put_bits(d, 0x2, 3);
+        d->state = DEFLATE_STATE_DATA;
+    }
+
+    for (;;) {
+        written += deflate_flush_bytes(d, out + written, out_len - written);
+        if (out_len - written < DEFLATE_TOKEN_BYTES) {
+            return written;
+        }
+        if (d->end - d->pos < DEFLATE_MAX_MATCH && *in_len > 0) {
+            if (d->end == 2 * d->wsize) {
+                deflate_slide(d);
+            }
+            size_t room = 2 * d->wsize - d->end;
+            size_t chunk = *in_len < room ? *in_len : room;
+            memcpy(d->window + d->end, *in, chunk);
+            d->end += chunk;
+            *in += chunk;
+            *in_len -= chunk;
+        }
+        if (d->pos == d->end) {
+            break;
+        }
+        uint32_t dist = 0;
+        uint32_t len = deflate_longest_match(d, &dist);
+        if (len) {
+            deflate_put_match(d, len, dist);
+            for (uint32_t i = 0; i < len; i++) {
+                deflate_insert(d, d->pos + i);
+            }
+            d->pos += len;
+        } else {
+            deflate_put_literal_length(d, d->window[d->pos]);
+            deflate_insert(d, d->pos);
+            d->pos++;
+        }
+    }
+
+    /* Sync flush: end the block and start an empty stored one, whose 00 00 ff ff tail is never sent */
+    deflate_put_literal_length(d, DEFLATE_END_OF_BLOCK);
+    deflate_put_bits(d, 0, 3);
+    deflate_put_bits(d, 0, (8 - (d->bitcnt & 7)) & 7);
+    written += deflate_flush_bytes(d, out + written, out_len - written);
+    *done = true;
+    d->state = DEFLATE_STATE_DONE;
+    return written;
+}
+
+/* Inflater */
+
+typedef enum {
+    INFLATE_STATE_HEADER = 0,
+    INFLATE_STATE_STORED_LEN,
+    INFLATE_STATE_STORED,
+    INFLATE_STATE_TABLE_SIZES,
+    INFLATE_STATE_CODELENS,
+    INFLATE_STATE_LENGTHS,
+    INFLATE_STATE_DATA,
+    INFLATE_STATE_COPY,
+    INFLATE_STATE_END,
+} inflate_state_t;
+
+typedef struct {
+    uint16_t count[DEFLATE_MAX_BITS + 1];
+    uint16_t *symbol;
+} inflate_huffman_t;
+
+struct esp_websocket_inflate {
+    uint8_t             *window;
+    uint32_t            wsize;
+    uint32_t            wpos;
+    uint32_t            whave;
+    uint64_t            bitbuf;
+    int                 bitcnt;
+    inflate_state_t     state;
+    bool                last_block;
+    uint32_t            stored_len;
+    uint16_t            nlen;
+    uint16_t            ndist;
+    uint16_t            ncode;
+    uint16_t            index;
+    uint8_t             lengths[288 + 32];
+    uint32_t            copy_len;
+    uint32_t            copy_dist;
+    inflate_huffman_t   lencode;
+    inflate_huffman_t   distcode;
+    uint16_t            lensym[288];
+    uint16_t            distsym[32];
+};
+
+/*
+ * Builds canonical decoding tables. Incomplete codes are only valid for the fixed distance code
+ * and for dynamic codes with a single symbol
+ */
+static esp_err_t inflate_build(inflate_huffman_t *h, const uint8_t *length, int n, bool allow_incomplete)
+{
+    uint16_t offs[DEFLATE_MAX_BITS + 1];
+    memset(h->count, 0, sizeof(h->count));
+    for (int symbol = 0; symbol < n; symbol++) {
+        h->count[length[symbol]]++;
+    }
+    if (h->count[0] == n) {
+        return ESP_OK;
+    }
+    int left = 1;
+    for (int len = 1; len <= DEFLATE_MAX_BITS; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+    if (left > 0 && !allow_incomplete && n - h->count[0] != 1) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    offs[1] = 0;
+    for (int len = 1; len < DEFLATE_MAX_BITS; len++) {
+        offs[len + 1] = offs[len] + h->count[len];
+    }
+    for (int symbol = 0; symbol < n; symbol++) {
+        if (length[symbol] != 0) {
+            h->symbol[offs[length[symbol]]++] = symbol;
+        }
+    }
+    return ESP_OK;
+}
+
+/* Decodes a symbol from `bits` without consuming it, -1 if more input is needed, -2 on an invalid code */
+static int inflate_decode(const inflate_huffman_t *h, uint64_t bits, int avail, int *used)
+{
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int len = 1; len <= DEFLATE_MAX_BITS; len++) {
+        if (len > avail) {
+            return -1;
+        }
+        code |= bits & 1;
+        bits >>= 1;
+        int count = h->count[len];
+        if (code - count < first) {
+            *used = len;
+            return h->symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -2;
+}
+
+static inline void inflate_consume(esp_websocket_inflate_handle_t s, int bits)
+{
+    s->bitbuf >>= bits;
+    s->bitcnt -= bits;
+}
+
+static inline void inflate_output(esp_websocket_inflate_handle_t s, uint8_t c, uint8_t *out, size_t *written)
+{
+    s->window[s->wpos] = c;
+    s->wpos = (s->wpos + 1) & (s->wsize - 1);
+    if (s->whave < s->wsize) {
+        s->whave++;
+    }
+    out[(*written)++] = c;
+}
+
+static void inflate_fixed_tables(esp_websocket_inflate_handle_t s)
+{
+    int symbol = 0;
+    for (; symbol < 144; symbol++) {
+        s->lengths[symbol] = 8;
+    }
+    for (; symbol < 256; symbol++) {
+        s->lengths[symbol] = 9;
+    }
+    for (; symbol < 280; symbol++) {
+        s->lengths[symbol] = 7;
+    }
+    for (; symbol < 288; symbol++) {
+        s->lengths[symbol] = 8;
+    }
+    inflate_build(&s->lencode, s->lengths, 288, false);
+    memset(s->lengths, 5, 30);
+    inflate_build(&s->distcode, s->lengths, 30, true);
+}
+
+esp_websocket_inflate_handle_t esp_websocket_inflate_init(int window_bits)
+{
+    window_bits = clamp_window_bits(window_bits);
+    esp_websocket_inflate_handle_t s = calloc(1, sizeof(struct esp_websocket_inflate));
+    if (s == NULL) {
+        return NULL;
+    }
+    s->wsize = 1U << window_bits;
+    s->window = malloc(s->wsize);
+    if (s->window == NULL) {
+        free(s);
+        return NULL;
+    }
+    s->lencode.symbol = s->lensym;
+    s->distcode.symbol = s->distsym;
+    return s;
+}
+
+void esp_websocket_inflate_reset(esp_websocket_inflate_handle_t s)
+{
+    esp_websocket_inflate_end_message(s, false);
+}
+
+void esp_websocket_inflate_end_message(esp_websocket_inflate_handle_t s, bool keep_window)
+{
+    s->bitbuf = 0;
+    s->bitcnt = 0;
+    s->copy_len = 0;
+    s->last_block = false;
+    s->state = INFLATE_STATE_HEADER;
+    if (!keep_window) {
+        s->wpos = 0;
+        s->whave = 0;
+    }
+}
+
+void esp_websocket_inflate_destroy(esp_websocket_inflate_handle_t s)
+{
+    if (s == NULL) {
+        return;
+    }
+    free(s->window);
+    free(s);
+}
+
+esp_err_t esp_websocket_inflate(esp_websocket_inflate_handle_t s, const uint8_t *in, size_t in_len, size_t *in_used,
+                                uint8_t *out, size_t out_len, size_t *out_written)
+{
+    size_t used = 0;
+    size_t written = 0;
+    esp_err_t err = ESP_OK;
+
+    for (;;) {
+        while (s->bitcnt <= 56 && used < in_len) {
+            s->bitbuf |= (uint64_t)in[used++] << s->bitcnt;
+            s->bitcnt += 8;
+        }
+        if (s->state == INFLATE_STATE_HEADER) {
+            if (s->bitcnt < 3) {
+                break;
+            }
+            s->last_block = s->bitbuf & 1;
+            int type = (s->bitbuf >> 1) & 3;
+            inflate_consume(s, 3);
+            if (type == 0) {
+                inflate_consume(s, s->bitcnt & 7);
+                s->state = INFLATE_STATE_STORED_LEN;
+            } else if (type == 1) {
+                inflate_fixed_tables(s);
+                s->state = INFLATE_STATE_DATA;
+            } else if (type == 2) {
+                s->state = INFLATE_STATE_TABLE_SIZES;
+            } else {
+                err = ESP_ERR_INVALID_RESPONSE;
+                break;
+            }
+        } else if (s->state == INFLATE_STATE_STORED_LEN) {
+            if (s->bitcnt < 32) {
+                break;
+            }
+            uint32_t len = s->bitbuf & 0xffff;
+            uint32_t nlen = (s->bitbuf >> 16) & 0xffff;
+            if (len != (~nlen & 0xffff)) {
+                err = ESP_ERR_INVALID_RESPONSE;
+                break;
+            }
+            inflate_consume(s, 32);
+            s->stored_len = len;
+            s->state = INFLATE_STATE_STORED;
+        } else if (s->state == INFLATE_STATE_STORED) {
+            if (s->stored_len == 0) {
+                s->state = s->last_block ? INFLATE_STATE_END : INFLATE_STATE_HEADER;
+                continue;
+            }
+            if (written == out_len || s->bitcnt < 8) {
+                break;
+            }
+            inflate_output(s, (uint8_t)s->bitbuf, out, &written);
+            inflate_consume(s, 8);
+            s->stored_len--;
+        } else if (s->state == INFLATE_STATE_TABLE_SIZES) {
+            if (s->bitcnt < 14) {
+                break;
+            }
+            s->nlen = (s->bitbuf & 0x1f) + 257;
+            s->ndist = ((s->bitbuf >> 5) & 0x1f) + 1;
+            s->ncode = ((s->bitbuf >> 10) & 0xf) + 4;
+            inflate_consume(s, 14);
+            if (s->nlen > 286 || s->ndist > 30) {
+                err = ESP_ERR_INVALID_RESPONSE;
+                break;
+            }
+            memset(s->lengths, 0, 19);
+            s->index = 0;
+            s->state = INFLATE_STATE_CODELENS;
+        } else if (s->state == INFLATE_STATE_CODELENS) {
+            if (s->index == s->ncode) {
+                /* The code length code is kept in the distance table until the lengths are read */
+                if (inflate_build(&s->distcode, s->lengths, 19, false) != ESP_OK) {
+                    err = ESP_ERR_INVALID_RESPONSE;
+                    break;
+                }
+                s->index = 0;
+                s->state = INFLATE_STATE_LENGTHS;
+                continue;
+            }
+            if (s->bitcnt < 3) {
+                break;
+            }
+            s->lengths[s_codelen_order[s->index++]] = s->bitbuf & 7;
+            inflate_consume(s, 3);
+        } else if (s->state == INFLATE_STATE_LENGTHS) {
+            int total = s->nlen + s->ndist;
+            if (s->index == total) {
+                if (s->lengths[DEFLATE_END_OF_BLOCK] == 0 ||
+                        inflate_build(&s->lencode, s->lengths, s->nlen, false) != ESP_OK ||
+                        inflate_build(&s->distcode, s->lengths + s->nlen, s->ndist, false) != ESP_OK) {
+                    err = ESP_ERR_INVALID_RESPONSE;
+                    break;
+                }
+                s->state = INFLATE_STATE_DATA;
+                continue;
+            }
+            int bits = 0;
+            int symbol = inflate_decode(&s->distcode, s->bitbuf, s->bitcnt, &bits);
+            if (symbol == -1) {
+                break;
+            } else if (symbol < 0) {
+                err = ESP_ERR_INVALID_RESPONSE;
+                break;
+            }
+            if (symbol < 16) {
+                inflate_consume(s, bits);
+                s->lengths[s->index++] = symbol;
+                continue;
+            }
+            static const uint8_t repeat_extra[3] = { 2, 3, 7 };
+            static const uint8_t repeat_base[3] = { 3, 3, 11 };
+            int extra = repeat_extra[symbol - 16];
+            if (s->bitcnt < bits + extra) {
+                break;
+            }
+            int repeat = repeat_base[symbol - 16] + ((s->bitbuf >> bits) & ((1 << extra) - 1));
+            uint8_t len = 0;
+            if (symbol == 16) {
+                if (s->index == 0) {
+                    err = ESP_ERR_INVALID_RESPONSE;
+                    break;
+                }
+                len = s->lengths[s->index - 1];
+            }
+            if (s->index + repeat > total) {
+                err = ESP_ERR_INVALID_RESPONSE;
+                break;
+            }
+            inflate_consume(s, bits + extra);
+            while (repeat--) {
+                s->lengths[s->index++] = len;
+            }
+        } else if (s->state == INFLATE_STATE_DATA) {
+            if (written == out_len) {
+                break;
+            }
+            /* A literal or a whole length/distance pair is consumed at once so that decoding can resume on any byte */
+            int bits = 0;
+            int symbol = inflate_decode(&s->lencode, s->bitbuf, s->bitcnt, &bits);
+            if (symbol == -1) {
+                break;
+            } else if (symbol < 0 || symbol > 285) {
+                err = ESP_ERR_INVALID_RESPONSE;
+                break;
+            }
+            if (symbol < 256) {
+                inflate_consume(s, bits);
+                inflate_output(s, symbol, out, &written);
+                continue;
+            }
+            if (symbol == DEFLATE_END_OF_BLOCK) {
+                inflate_consume(s, bits);
+                s->state = s->last_block ? INFLATE_STATE_END : INFLATE_STATE_HEADER;
+                continue;
+            }
+            symbol -= 257;
+            int used_bits = bits + s_length_extra[symbol];
+            if (s->bitcnt < used_bits) {
+                break;
+            }
+            uint32_t len = s_length_base[symbol] + ((s->bitbuf >> bits) & ((1U << s_length_extra[symbol]) - 1));
+            int dist_symbol = inflate_decode(&s->distcode, s->bitbuf >> used_bits, s->bitcnt - used_bits, &bits);
+            if (dist_symbol == -1) {
+                break;
+            } else if (dist_symbol < 0 || dist_symbol > 29) {
+                err = ESP_ERR_INVALID_RESPONSE;
+                break;
+            }
+            used_bits += bits;
+            if (s->bitcnt < used_bits + s_dist_extra[dist_symbol]) {
+                break;
+            }
+            uint32_t dist = s_dist_base[dist_symbol] +
+                            ((s->bitbuf >> used_bits) & ((1U << s_dist_extra[dist_symbol]) - 1));
+            if (dist > s->whave) {
+                err = ESP_ERR_INVALID_RESPONSE;
+                break;
+            }
+            inflate_consume(s, used_bits + s_dist_extra[dist_symbol]);
+            s->copy_len = len;
+            s->copy_dist = dist;
+            s->state = INFLATE_STATE_COPY;
+        } else if (s->state == INFLATE_STATE_COPY) {
+            while (s->copy_len && written < out_len) {
+                inflate_output(s, s->window[(s->wpos - s->copy_dist) & (s->wsize - 1)], out, &written);
+                s->copy_len--;
+            }
+            if (s->copy_len) {
+                break;
+            }
+            s->state = INFLATE_STATE_DATA;
+        } else {
+            /* Data after a final block is ignored, RFC 7692 permits ending a message with BFINAL set */
+            s->bitbuf = 0;
+            s->bitcnt = 0;
+            used = in_len;
+            break;
+        }
+    }
+
+    *in_used = used;
+    *out_written = written;
+    return err;
+}
@@ -0,0 +1,221 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "esp_websocket_transport_response.h"
+
+typedef enum {
+    RESPONSE_STATUS_LINE = 0,   // HTTP/1.1 101 Switching Protocols
+    RESPONSE_LINE_START,
+    RESPONSE_NAME,              // matching the name of the kept header
+    RESPONSE_VALUE,             // copying the value of the kept header
+    RESPONSE_SKIP,              // another header
+    RESPONSE_END,               // the empty line ending the response
+    RESPONSE_DONE,              // everything after it are frames
+} response_state_t;
+
+typedef struct {
+    esp_transport_handle_t  parent;
+    const char              *header;
+    size_t                  header_len;
+    response_state_t        state;
+    size_t                  matched;
+    char                    *value;
+    size_t                  value_size;
+    size_t                  value_len;
+    bool                    found;
+    bool                    truncated;
+} transport_response_t;
+
+static void response_append(transport_response_t *ctx, char c)
+{
+    if (ctx->value_len + 1 < ctx->value_size) {
+        ctx->value[ctx->value_len++] = c;
+        ctx->value[ctx->value_len] = '\0';
+    } else {
+        ctx->truncated = true;
+    }
+}
+
+/* Scans the response byte by byte, the reads of esp_transport_ws may split it anywhere */
+static void response_scan(transport_response_t *ctx, const char *data, int len)
+{
+    for (int i = 0; i < len && ctx->state != RESPONSE_DONE; i++) {
+        char c = data[i];
+        switch (ctx->state) {
+        case RESPONSE_STATUS_LINE:
+        case RESPONSE_SKIP:
+            if (c == '\n') {
+                ctx->state = RESPONSE_LINE_START;
+            }
+            break;
+        case RESPONSE_LINE_START:
+            if (c == '\r') {
+                ctx->state = RESPONSE_END;
+            } else if (c == '\n') {
+                ctx->state = RESPONSE_DONE;
+            } else if (tolower((unsigned char)c) == tolower((unsigned char)ctx->header[0])) {
+                ctx->matched = 1;
+                ctx->state = RESPONSE_NAME;
+            } else {
+                ctx->state = RESPONSE_SKIP;
+            }
+            break;
+        case RESPONSE_NAME:
+            if (ctx->matched == ctx->header_len && c == ':') {
+                if (ctx->found) {
+                    response_append(ctx, ',');
+                    response_append(ctx, ' ');
+                }
+                ctx->found = true;
+                ctx->state = RESPONSE_VALUE;
+            } else if (ctx->matched < ctx->header_len &&
+                       tolower((unsigned char)c) == tolower((unsigned char)ctx->header[ctx->matched])) {
+                ctx->matched++;
+            } else {
+                ctx->state = c == '\n' ? RESPONSE_LINE_START : RESPONSE_SKIP;
+            }
+            break;
+        case RESPONSE_VALUE:
+            if (c == '\n') {
+                ctx->state = RESPONSE_LINE_START;
+            } else if (c != '\r') {
+                response_append(ctx, c);
+            }
+            break;
+        case RESPONSE_END:
+            ctx->state = RESPONSE_DONE;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void response_set_error(esp_transport_handle_t t, transport_response_t *ctx)
+{
+    esp_tls_error_handle_t error = esp_transport_get_error_handle(t);
+    esp_tls_error_handle_t parent_error = esp_transport_get_error_handle(ctx->parent);
+    if (error && parent_error && error != parent_error) {
+        *error = *parent_error;
+    }
+}
+
+static int response_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    transport_response_t *ctx = esp_transport_get_context_data(t);
+    ctx->state = RESPONSE_STATUS_LINE;
+    ctx->matched = 0;
+    ctx->value_len = 0;
+    ctx->value[0] = '\0';
+    ctx->found = false;
+    ctx->truncated = false;
+    int ret = esp_transport_connect(ctx->parent, host, port, timeout_ms);
+    if (ret < 0) {
+        response_set_error(t, ctx);
+    }
+    return ret;
+}
+
+static int response_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
+{
+    transport_response_t *ctx = esp_transport_get_context_data(t);
+    int ret = esp_transport_read(ctx->parent, buffer, len, timeout_ms);
+    if (ret > 0) {
+        response_scan(ctx, buffer, ret);
+    } else if (ret < 0) {
+        response_set_error(t, ctx);
+    }
+    return ret;
+}
+
+static int response_write(esp_transport_handle_t t, const char *buffer, int len, int timeout_ms)
+{
+    transport_response_t *ctx = esp_transport_get_context_data(t);
+    int ret = esp_transport_write(ctx->parent, buffer, len, timeout_ms);
+    if (ret < 0) {
+        response_set_error(t, ctx);
+    }
+    return ret;
+}
+
+static int response_poll_read(esp_transport_handle_t t, int timeout_ms)
+{
+    transport_response_t *ctx = esp_transport_get_context_data(t);
+    return esp_transport_poll_read(ctx->parent, timeout_ms);
+}
+
+static int response_poll_write(esp_transport_handle_t t, int timeout_ms)
+{
+    transport_response_t *ctx = esp_transport_get_context_data(t);
+    return esp_transport_poll_write(ctx->parent, timeout_ms);
+}
+
+static int response_close(esp_transport_handle_t t)
+{
+    transport_response_t *ctx = esp_transport_get_context_data(t);
+    return esp_transport_close(ctx->parent);
+}
+
+static int response_destroy(esp_transport_handle_t t)
+{
+    transport_response_t *ctx = esp_transport_get_context_data(t);
+    free(ctx->value);
+    free(ctx);
+    return 0;
+}
+
+esp_transport_handle_t esp_websocket_transport_response_init(esp_transport_handle_t parent, const char *header, size_t value_size)
+{
+    if (parent == NULL || header == NULL || header[0] == '\0' || value_size == 0) {
+        return NULL;
+    }
+    esp_transport_handle_t t = esp_transport_init();
+    if (t == NULL) {
+        return NULL;
+    }
+    transport_response_t *ctx = calloc(1, sizeof(transport_response_t));
+    char *value = calloc(1, value_size);
+    if (ctx == NULL || value == NULL) {
+        free(ctx);
+        free(value);
+        esp_transport_destroy(t);
+        return NULL;
+    }
+    ctx->parent = parent;
+    ctx->header = header;
+    ctx->header_len = strlen(header);
+    ctx->value = value;
+    ctx->value_size = value_size;
+    esp_transport_set_context_data(t, ctx);
+    esp_transport_set_func(t, response_connect, response_read, response_write, response_close,
+                           response_poll_read, response_poll_write, response_destroy);
+    return t;
+}
+
+esp_err_t esp_websocket_transport_response_get_header(esp_transport_handle_t t, const char **value)
+{
+    transport_response_t *ctx = esp_transport_get_context_data(t);
+    *value = NULL;
+    if (ctx->state != RESPONSE_DONE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (ctx->truncated) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (ctx->found) {
+        *value = ctx->value;
+    }
+    return ESP_OK;
+}
+
+int esp_websocket_transport_response_get_socket(esp_transport_handle_t t)
+{
+    transport_response_t *ctx = esp_transport_get_context_data(t);
+    return esp_transport_get_socket(ctx->parent);
+}
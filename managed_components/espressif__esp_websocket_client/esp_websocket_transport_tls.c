@@ -0,0 +1,220 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <sys/select.h>
+#include "esp_websocket_transport_tls.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "websocket_tls";
+
+typedef struct {
+    esp_tls_cfg_t               cfg;
+    esp_tls_t                   *tls;
+    esp_tls_client_session_t    *session;
+    bool                        session_offered;
+    uint32_t                    connect_time_ms;
+} transport_tls_t;
+
+static void tls_clear_session(transport_tls_t *ctx)
+{
+    if (ctx->session) {
+        esp_tls_free_client_session(ctx->session);
+        ctx->session = NULL;
+    }
+}
+
+/* Keeps the newest session, TLS 1.3 servers send their tickets after the handshake so it is also taken on close */
+static void tls_save_session(transport_tls_t *ctx)
+{
+    esp_tls_client_session_t *session = esp_tls_get_client_session(ctx->tls);
+    if (session) {
+        tls_clear_session(ctx);
+        ctx->session = session;
+    }
+}
+
+static void tls_set_error(esp_transport_handle_t t, transport_tls_t *ctx)
+{
+    esp_tls_error_handle_t tls_error = NULL;
+    esp_tls_error_handle_t error = esp_transport_get_error_handle(t);
+    if (error && ctx->tls && esp_tls_get_error_handle(ctx->tls, &tls_error) == ESP_OK && tls_error) {
+        *error = *tls_error;
+    }
+}
+
+static int tls_close(esp_transport_handle_t t)
+{
+    transport_tls_t *ctx = esp_transport_get_context_data(t);
+    if (ctx->tls == NULL) {
+        return 0;
+    }
+    tls_save_session(ctx);
+    int ret = esp_tls_conn_destroy(ctx->tls);
+    ctx->tls = NULL;
+    return ret;
+}
+
+static int tls_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    transport_tls_t *ctx = esp_transport_get_context_data(t);
+    tls_close(t);
+
+    ctx->tls = esp_tls_init();
+    if (ctx->tls == NULL) {
+        return ERR_TCP_TRANSPORT_NO_MEM;
+    }
+    ctx->cfg.timeout_ms = timeout_ms;
+    ctx->cfg.client_session = ctx->session;
+    ctx->session_offered = ctx->session != NULL;
+
+    int64_t start = esp_timer_get_time();
+    if (esp_tls_conn_new_sync(host, strlen(host), port, &ctx->cfg, ctx->tls) <= 0) {
+        ESP_LOGE(TAG, "Failed to open a new connection");
+        tls_set_error(t, ctx);
+        esp_tls_conn_destroy(ctx->tls);
+        ctx->tls = NULL;
+        // in case the server chokes on the kept session, the next attempt goes without it
+        tls_clear_session(ctx);
+        return -1;
+    }
+    ctx->connect_time_ms = (esp_timer_get_time() - start) / 1000;
+    ESP_LOGD(TAG, "Connected in %" PRIu32 " ms, %s", ctx->connect_time_ms,
+             ctx->session_offered ? "offered the kept session" : "full handshake");
+    tls_save_session(ctx);
+    return 0;
+}
+
+static int tls_poll(esp_transport_handle_t t, int timeout_ms, bool for_read)
+{
+    transport_tls_t *ctx = esp_transport_get_context_data(t);
+    int sock = -1;
+    if (ctx->tls == NULL || esp_tls_get_conn_sockfd(ctx->tls, &sock) != ESP_OK || sock < 0) {
+        return -1;
+    }
+    // decrypted data may be waiting in the TLS layer already
+    if (for_read && esp_tls_get_bytes_avail(ctx->tls) > 0) {
+        return 1;
+    }
+    fd_set fds;
+    fd_set errset;
+    FD_ZERO(&fds);
+    FD_ZERO(&errset);
+    FD_SET(sock, &fds);
+    FD_SET(sock, &errset);
+    struct timeval timeout = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+    int ret = select(sock + 1, for_read ? &fds : NULL, for_read ? NULL : &fds, &errset, timeout_ms < 0 ? NULL : &timeout);
+    if (ret > 0 && FD_ISSET(sock, &errset)) {
+        ESP_LOGE(TAG, "Socket error on poll, errno=%d", errno);
+        return -1;
+    }
+    return ret;
+}
+
+static int tls_poll_read(esp_transport_handle_t t, int timeout_ms)
+{
+    return tls_poll(t, timeout_ms, true);
+}
+
+static int tls_poll_write(esp_transport_handle_t t, int timeout_ms)
+{
+    return tls_poll(t, timeout_ms, false);
+}
+
+static int tls_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
+{
+    transport_tls_t *ctx = esp_transport_get_context_data(t);
+    int poll = tls_poll_read(t, timeout_ms);
+    if (poll < 0) {
+        return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+    }
+    if (poll == 0) {
+        return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    }
+    int ret = esp_tls_conn_read(ctx->tls, buffer, len);
+    if (ret == ESP_TLS_ERR_SSL_WANT_READ || ret == ESP_TLS_ERR_SSL_TIMEOUT) {
+        return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    }
+    if (ret < 0) {
+        ESP_LOGE(TAG, "esp_tls_conn_read error, errno=%d", errno);
+        tls_set_error(t, ctx);
+        return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+    }
+    if (ret == 0) {
+        ESP_LOGD(TAG, "Connection closed by the server");
+        return ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN;
+    }
+    return ret;
+}
+
+static int tls_write(esp_transport_handle_t t, const char *buffer, int len, int timeout_ms)
+{
+    transport_tls_t *ctx = esp_transport_get_context_data(t);
+    int poll = tls_poll_write(t, timeout_ms);
+    if (poll <= 0) {
+        ESP_LOGW(TAG, "Poll timeout or error, errno=%d, timeout_ms=%d", errno, timeout_ms);
+        return poll;
+    }
+    int ret = esp_tls_conn_write(ctx->tls, buffer, len);
+    if (ret == ESP_TLS_ERR_SSL_WANT_WRITE || ret == ESP_TLS_ERR_SSL_WANT_READ) {
+        return 0;
+    }
+    if (ret < 0) {
+        ESP_LOGE(TAG, "esp_tls_conn_write error, errno=%d", errno);
+        tls_set_error(t, ctx);
+    }
+    return ret;
+}
+
+static int tls_destroy(esp_transport_handle_t t)
+{
+    transport_tls_t *ctx = esp_transport_get_context_data(t);
+    tls_close(t);
+    tls_clear_session(ctx);
+    free(ctx);
+    return 0;
+}
+
+esp_transport_handle_t esp_websocket_transport_tls_init(const esp_tls_cfg_t *cfg)
+{
+    esp_transport_handle_t t = esp_transport_init();
+    if (t == NULL) {
+        return NULL;
+    }
+    transport_tls_t *ctx = calloc(1, sizeof(transport_tls_t));
+    if (ctx == NULL) {
+        esp_transport_destroy(t);
+        return NULL;
+    }
+    ctx->cfg = *cfg;
+    esp_transport_set_context_data(t, ctx);
+    esp_transport_set_func(t, tls_connect, tls_read, tls_write, tls_close, tls_poll_read, tls_poll_write, tls_destroy);
+    return t;
+}
+
+void esp_websocket_transport_tls_clear_session(esp_transport_handle_t t)
+{
+    tls_clear_session(esp_transport_get_context_data(t));
+}
+
+bool esp_websocket_transport_tls_session_offered(esp_transport_handle_t t)
+{
+    transport_tls_t *ctx = esp_transport_get_context_data(t);
+    return ctx->session_offered;
+}
+
+uint32_t esp_websocket_transport_tls_connect_time_ms(esp_transport_handle_t t)
+{
+    transport_tls_t *ctx = esp_transport_get_context_data(t);
+    return ctx->connect_time_ms;
+}
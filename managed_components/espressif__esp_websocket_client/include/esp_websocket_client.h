@@ -22,6 +22,8 @@ extern "C" {
 #endif
 
 typedef struct esp_websocket_client *esp_websocket_client_handle_t;
+typedef struct esp_websocket_client_manager *esp_websocket_client_manager_handle_t;
+typedef struct esp_websocket_buffer_pool *esp_websocket_buffer_pool_handle_t;
 
 ESP_EVENT_DECLARE_BASE(WEBSOCKET_EVENTS);         // declaration of the task events family
 
@@ -76,9 +78,11 @@ typedef struct {
     uint8_t op_code;                        /*!< Received opcode */
     esp_websocket_client_handle_t client;   /*!< esp_websocket_client_handle_t context */
     void *user_context;                     /*!< user_data context, from esp_websocket_client_config_t user_data */
-    int payload_len;                        /*!< Total payload length, payloads exceeding buffer will be posted through multiple events */
+    int payload_len;                        /*!< Total payload length, payloads exceeding buffer will be posted through multiple events. For compressed messages (permessage-deflate) the decompressed length is not known in advance, it is then payload_offset + data_len and only the last event of the message has `fin` set */
     int payload_offset;                     /*!< Actual offset for the data associated with this event */
     esp_websocket_error_codes_t error_handle; /*!< esp-websocket error handle including esp-tls errors as well as internal websocket errors */
+    int64_t read_time_us;                   /*!< For WEBSOCKET_EVENT_DATA, esp_timer_get_time() when the last chunk of data was read from the transport */
+    uint32_t read_duration_us;              /*!< For WEBSOCKET_EVENT_DATA, time spent in the transport reading that chunk */
 } esp_websocket_event_data_t;
 
 /**
@@ -105,7 +109,9 @@ typedef struct {
     int                         task_prio;                  /*!< Websocket task priority */
     const char                 *task_name;                  /*!< Websocket task name */
     int                         task_stack;                 /*!< Websocket task stack */
-    int                         buffer_size;                /*!< Websocket buffer size */
+    bool                        task_pinned;                /*!< Pin the websocket task to `task_core_id`, it runs on either core otherwise */
+    int                         task_core_id;               /*!< Core of the websocket task if `task_pinned` is set */
+    int                         buffer_size;                /*!< Websocket buffer size, data frames are received and sent in chunks of this size. Control frames (PING, PONG, CLOSE) are received into a separate 125 byte buffer */
     const char                  *cert_pem;                  /*!< Pointer to certificate data in PEM or DER format for server verify (with SSL), default is NULL, not required to verify the server. PEM-format must have a terminating NULL-character. DER-format requires the length to be passed in cert_len. */
     size_t                      cert_len;                   /*!< Length of the buffer pointed to by cert_pem. May be 0 for null-terminated pem */
     const char                  *client_cert;               /*!< Pointer to certificate data in PEM or DER format for SSL mutual authentication, default is NULL, not required if mutual authentication is not needed. If it is not NULL, also `client_key` or `client_ds_data` (if supported) has to be provided. PEM-format must have a terminating NULL-character. DER-format requires the length to be passed in client_cert_len. */
@@ -129,13 +135,117 @@ typedef struct {
     int                         keep_alive_idle;            /*!< Keep-alive idle time. Default is 5 (second) */
     int                         keep_alive_interval;        /*!< Keep-alive interval time. Default is 5 (second) */
     int                         keep_alive_count;           /*!< Keep-alive packet retry send count. Default is 3 counts */
-    int                         reconnect_timeout_ms;       /*!< Reconnect after this value in miliseconds if disable_auto_reconnect is not enabled (defaults to 10s) */
+    int                         reconnect_timeout_ms;       /*!< Reconnect after this value in miliseconds if disable_auto_reconnect is not enabled (defaults to 10s). With a backoff limit this is the initial delay */
     int                         network_timeout_ms;         /*!< Abort network operation if it is not completed after this value, in milliseconds (defaults to 10s) */
     size_t                      ping_interval_sec;          /*!< Websocket ping interval, defaults to 10 seconds if not set */
+    bool                        ping_adaptive_enable;       /*!< Adapt the ping interval: doubled after every PONG with a normal round trip time, dropped to ping_interval_min_sec when the round trip time spikes. Received data then also postpones the PING, without it a PING goes out every ping_interval_sec however busy the link is */
+    size_t                      ping_interval_min_sec;      /*!< Shortest adaptive ping interval, defaults to 1 second */
+    size_t                      ping_interval_max_sec;      /*!< Longest adaptive ping interval, defaults to 4 times ping_interval_sec. Keep it below pingpong_timeout_sec */
     struct ifreq                *if_name;                   /*!< The name of interface for data to go through. Use the default interface without setting */
     esp_transport_handle_t      ext_transport;              /*!< External WebSocket tcp_transport handle to the client; or if null, the client will create its own transport handle. */
+    esp_websocket_client_manager_handle_t manager;          /*!< Connection manager servicing this client from its shared task; or if null, the client creates its own task on start */
+    bool                        permessage_deflate_enable;  /*!< Offer the permessage-deflate extension (RFC 7692), requires CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE. Messages are compressed only if the server accepts, and the server then has to compress every data message it sends. Ignored with ext_transport. Messages sent by the partial/continuation API are not compressed */
+    int                         permessage_deflate_server_window_bits;  /*!< server_max_window_bits requested from the server (9 to 15), the receive window takes 1 << bits bytes. A server answering with a larger window fails the connection. Default is 15 */
+    int                         permessage_deflate_client_window_bits;  /*!< Window used to compress sent messages (9 to 15), the compressor takes up to 6 << bits bytes. A smaller client_max_window_bits from the server is used instead. Default is 10 */
+    bool                        permessage_deflate_server_no_context_takeover; /*!< Ask the server to compress every message on its own, the receive window is then only used within a message */
+    bool                        permessage_deflate_client_no_context_takeover; /*!< Compress every sent message on its own */
+    int                         reconnect_backoff_max_ms;   /*!< Grow the reconnect delay after every failed attempt up to this value, in milliseconds. Default is 0, every attempt then waits reconnect_timeout_ms */
+    float                       reconnect_backoff_multiplier; /*!< Factor applied to the reconnect delay after a failed attempt, must be greater than 1. Default is 2 */
+    bool                        reconnect_backoff_jitter;   /*!< Wait a random time between 0 and the current reconnect delay, spreads the reconnects of many clients after a server outage */
+    bool                        tls_session_resumption;     /*!< Keep the TLS session of a wss:// connection and resume it on reconnect (session ticket or session ID), saving the full handshake. Requires CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS and is not supported with a connection manager. The session is kept while the client runs */
+    esp_websocket_buffer_pool_handle_t buffer_pool;         /*!< Pool leasing the send and receive buffers with CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER, may be shared by several clients; or if null, the client creates its own pool */
 } esp_websocket_client_config_t;
 
+/**
+ * @brief Websocket connection manager configuration
+ *
+ * A connection manager runs the state machine of all attached clients from a single task,
+ * waiting for all of their sockets in one select() call. Attached clients share the manager's
+ * receive buffer, so each additional connection costs neither a task stack nor an rx buffer.
+ */
+typedef struct {
+    int                         task_prio;                  /*!< Manager task priority */
+    const char                  *task_name;                 /*!< Manager task name */
+    int                         task_stack;                 /*!< Manager task stack */
+    bool                        task_pinned;                /*!< Pin the manager task to `task_core_id`, it runs on either core otherwise */
+    int                         task_core_id;               /*!< Core of the manager task if `task_pinned` is set */
+    int                         buffer_size;                /*!< Size of the shared receive buffer, attached clients must not use a bigger `buffer_size` */
+    int                         poll_interval_ms;           /*!< Maximum time the manager task waits in select() (defaults to 1000 ms) */
+    int                         step_timeout_ms;            /*!< Longest time one attached client may block the manager task in a connect, a read or a control frame write, in milliseconds (defaults to 1000 ms). Used instead of a longer `network_timeout_ms`, a connect that takes longer fails and is retried after the reconnect delay */
+} esp_websocket_client_manager_config_t;
+
+/**
+ * @brief Websocket buffer pool configuration
+ *
+ * Buffers are grouped in power-of-two size classes, a returned buffer is kept for the next lease of
+ * its class instead of being freed, so repeated sends and receives neither allocate nor zero memory.
+ */
+typedef struct {
+    int                         max_free_per_class;         /*!< Returned buffers kept per size class (defaults to 2) */
+    int                         idle_timeout_ms;            /*!< Kept buffers unused for this long are freed (defaults to 5000 ms), negative to keep them until the pool is destroyed */
+} esp_websocket_buffer_pool_config_t;
+
+/**
+ * @brief Websocket buffer pool statistics
+ */
+typedef struct {
+    uint32_t                    leases;                     /*!< Buffers handed out */
+    uint32_t                    reuses;                     /*!< Leases served from kept buffers, without allocating */
+    uint32_t                    allocs;                     /*!< Heap allocations */
+    uint32_t                    frees;                      /*!< Heap frees, including idle trimming */
+    size_t                      leased_bytes;               /*!< Bytes currently leased */
+    size_t                      cached_bytes;               /*!< Bytes currently kept for reuse */
+    size_t                      peak_bytes;                 /*!< Peak of leased plus kept bytes */
+} esp_websocket_buffer_pool_stats_t;
+
+#define ESP_WEBSOCKET_RTT_HISTOGRAM_BUCKETS  (8)
+
+/**
+ * @brief Websocket client round trip time statistics
+ *
+ * Every PING carries a timestamp which the server echoes in its PONG. The figures are computed over
+ * the last 32 round trip times.
+ */
+typedef struct {
+    uint32_t                    samples;                    /*!< Round trip times the figures are computed over */
+    uint32_t                    last_us;                    /*!< Latest round trip time, in microseconds */
+    uint32_t                    min_us;                     /*!< Shortest round trip time */
+    uint32_t                    avg_us;                     /*!< Average round trip time */
+    uint32_t                    p99_us;                     /*!< 99th percentile of the round trip time */
+    uint32_t                    max_us;                     /*!< Longest round trip time */
+    uint32_t                    histogram[ESP_WEBSOCKET_RTT_HISTOGRAM_BUCKETS]; /*!< Bucket 0 counts round trip times below 1 ms, bucket i those from 2^(i-1) ms to 2^i ms, the last one all above */
+    uint32_t                    pings_sent;                 /*!< PINGs sent by the client */
+    uint32_t                    pongs_received;             /*!< PONGs answering them */
+    uint32_t                    spikes;                     /*!< Round trip times above 3 times the recent average */
+    uint32_t                    ping_interval_ms;           /*!< Current ping interval */
+} esp_websocket_rtt_stats_t;
+
+/**
+ * @brief Websocket client reconnect statistics
+ *
+ * An outage starts when an established connection is lost or the first connection attempt fails,
+ * and ends when the client connects again.
+ */
+typedef struct {
+    uint32_t                    attempts;                   /*!< Connection attempts made during outages */
+    uint32_t                    failures;                   /*!< Attempts which failed */
+    uint32_t                    reconnects;                 /*!< Outages ended by a successful connection */
+    uint32_t                    last_reconnect_ms;          /*!< Duration of the last outage */
+    uint32_t                    max_reconnect_ms;           /*!< Duration of the longest outage */
+    uint64_t                    total_reconnect_ms;         /*!< Sum of all outage durations */
+} esp_websocket_reconnect_stats_t;
+
+/**
+ * @brief Websocket client TLS connection statistics, collected with tls_session_resumption
+ */
+typedef struct {
+    uint32_t                    handshakes;                 /*!< Successful TLS connections */
+    uint32_t                    session_offers;             /*!< Connections which offered the session of the previous one */
+    uint32_t                    last_handshake_ms;          /*!< TCP connect and TLS handshake time of the last connection */
+    uint64_t                    total_handshake_ms;         /*!< Sum of the connection times */
+    uint64_t                    total_offer_handshake_ms;   /*!< Sum of the connection times which offered a session */
+} esp_websocket_tls_stats_t;
+
 /**
  * @brief      Start a Websocket session
  *             This function must be the first function to call,
@@ -446,6 +556,95 @@ int esp_websocket_client_get_reconnect_timeout(esp_websocket_client_handle_t cli
  */
 esp_err_t esp_websocket_client_set_reconnect_timeout(esp_websocket_client_handle_t client, int reconnect_timeout_ms);
 
+/**
+ * @brief      Cut the current reconnect delay short, e.g. once the station got its IP address back
+ *
+ *  Notes:
+ *  - The backoff starts over from reconnect_timeout_ms.
+ *  - If the client is connecting or connected, the request applies to the next reconnect wait of the
+ *    current outage and is dropped once the connection is established.
+ *  - Clients serviced by a connection manager reconnect within the manager's poll interval.
+ *
+ * @param[in]  client  The client
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_STATE if automatic reconnect is disabled
+ */
+esp_err_t esp_websocket_client_reconnect_now(esp_websocket_client_handle_t client);
+
+/**
+ * @brief      Hold the client disconnected, e.g. while the station has lost its link
+ *
+ *  Notes:
+ *  - A connected client drops the connection within its poll interval and posts WEBSOCKET_EVENT_DISCONNECTED,
+ *    instead of waiting for the PONG timeout. No close frame is sent, the link is assumed to be gone.
+ *  - No reconnect is attempted until esp_websocket_client_resume(). The client keeps running and the
+ *    paused state survives esp_websocket_client_stop() / esp_websocket_client_start().
+ *
+ * @param[in]  client  The client
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_STATE if automatic reconnect is disabled
+ */
+esp_err_t esp_websocket_client_pause(esp_websocket_client_handle_t client);
+
+/**
+ * @brief      Let a paused client reconnect right away, the backoff starts over from reconnect_timeout_ms
+ *
+ * @param[in]  client  The client
+ *
+ * @return
+ *     - ESP_OK on success, also if the client was not paused
+ *     - ESP_ERR_INVALID_STATE if automatic reconnect is disabled
+ */
+esp_err_t esp_websocket_client_resume(esp_websocket_client_handle_t client);
+
+/**
+ * @brief      Check whether the client is paused
+ *
+ * @param[in]  client  The client
+ *
+ * @return     true if esp_websocket_client_pause() was called and the client was not resumed since
+ */
+bool esp_websocket_client_is_paused(esp_websocket_client_handle_t client);
+
+/**
+ * @brief      Get the TLS connection statistics of the client
+ *
+ *  The server may still refuse an offered session and perform a full handshake, compare the average
+ *  connection times with and without an offer to see whether resumption takes place.
+ *
+ * @param[in]  client  The client
+ * @param[out] stats   The statistics
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_NOT_SUPPORTED if tls_session_resumption is not enabled
+ */
+esp_err_t esp_websocket_client_get_tls_stats(esp_websocket_client_handle_t client, esp_websocket_tls_stats_t *stats);
+
+/**
+ * @brief      Get the round trip time statistics of the client
+ *
+ * @param[in]  client  The client
+ * @param[out] stats   The statistics
+ *
+ * @return     esp_err_t
+ */
+esp_err_t esp_websocket_client_get_rtt_stats(esp_websocket_client_handle_t client, esp_websocket_rtt_stats_t *stats);
+
+/**
+ * @brief      Get the reconnect statistics of the client
+ *
+ * @param[in]  client  The client
+ * @param[out] stats   The statistics
+ *
+ * @return     esp_err_t
+ */
+esp_err_t esp_websocket_client_get_reconnect_stats(esp_websocket_client_handle_t client, esp_websocket_reconnect_stats_t *stats);
+
 /**
  * @brief Register the Websocket Events
  *
@@ -460,6 +659,110 @@ esp_err_t esp_websocket_register_events(esp_websocket_client_handle_t client,
                                         esp_event_handler_t event_handler,
                                         void *event_handler_arg);
 
+/**
+ * @brief      Create a connection manager and start its task
+ *             Clients created with `esp_websocket_client_config_t.manager` set to the returned handle
+ *             are serviced by this task instead of creating their own one.
+ *
+ *  Notes:
+ *  - Event handlers of all attached clients run in the manager task, a handler blocking for long
+ *    delays every other connection of the manager
+ *  - An unreachable or unresponsive server delays the other connections by at most `step_timeout_ms`
+ *    per connect attempt, the host name lookup before the connect is not bounded by it
+ *
+ * @param[in]  config  The manager configuration, may be NULL for defaults
+ *
+ * @return
+ *     - `esp_websocket_client_manager_handle_t`
+ *     - NULL if any errors
+ */
+esp_websocket_client_manager_handle_t esp_websocket_client_manager_init(const esp_websocket_client_manager_config_t *config);
+
+/**
+ * @brief      Stop the manager task and free all resources of the manager
+ *
+ *  Notes:
+ *  - All attached clients must be destroyed before, otherwise ESP_ERR_INVALID_STATE is returned
+ *  - Cannot be called from the websocket event handler
+ *
+ * @param[in]  manager  The manager handle
+ *
+ * @return     esp_err_t
+ */
+esp_err_t esp_websocket_client_manager_destroy(esp_websocket_client_manager_handle_t manager);
+
+/**
+ * @brief      Create a buffer pool
+ *
+ * @param[in]  config  The pool configuration, may be NULL for defaults
+ *
+ * @return
+ *     - `esp_websocket_buffer_pool_handle_t`
+ *     - NULL if any errors
+ */
+esp_websocket_buffer_pool_handle_t esp_websocket_buffer_pool_create(const esp_websocket_buffer_pool_config_t *config);
+
+/**
+ * @brief      Free the pool and all buffers kept by it
+ *
+ * @param[in]  pool  The pool handle
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_STATE if buffers are still leased
+ */
+esp_err_t esp_websocket_buffer_pool_destroy(esp_websocket_buffer_pool_handle_t pool);
+
+/**
+ * @brief      Lease a buffer of at least `size` bytes, its content is not initialized
+ *
+ * @param[in]  pool  The pool handle
+ * @param[in]  size  Requested size
+ *
+ * @return
+ *     - Pointer to the buffer
+ *     - NULL if there is not enough memory
+ */
+void *esp_websocket_buffer_pool_lease(esp_websocket_buffer_pool_handle_t pool, size_t size);
+
+/**
+ * @brief      Return a leased buffer to the pool
+ *
+ * @param[in]  pool    The pool handle
+ * @param[in]  buffer  Buffer returned by esp_websocket_buffer_pool_lease(), may be NULL
+ */
+void esp_websocket_buffer_pool_return(esp_websocket_buffer_pool_handle_t pool, void *buffer);
+
+/**
+ * @brief      Free the kept buffers which were not leased within the idle timeout
+ *             Clients using the pool call this periodically from their task.
+ *
+ * @param[in]  pool  The pool handle
+ */
+void esp_websocket_buffer_pool_trim(esp_websocket_buffer_pool_handle_t pool);
+
+/**
+ * @brief      Get the allocation statistics of a pool
+ *
+ * @param[in]  pool   The pool handle
+ * @param[out] stats  The statistics
+ *
+ * @return     esp_err_t
+ */
+esp_err_t esp_websocket_buffer_pool_get_stats(esp_websocket_buffer_pool_handle_t pool, esp_websocket_buffer_pool_stats_t *stats);
+
+/**
+ * @brief      Get the allocation statistics of the pool the client leases its buffers from
+ *
+ * @param[in]  client  The client
+ * @param[out] stats   The statistics
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_NOT_SUPPORTED if CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER is disabled, the buffers are then allocated once on init
+ */
+esp_err_t esp_websocket_client_get_buffer_stats(esp_websocket_client_handle_t client, esp_websocket_buffer_pool_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
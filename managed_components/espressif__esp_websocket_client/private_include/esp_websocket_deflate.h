@@ -0,0 +1,87 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Raw DEFLATE (RFC 1951) codec for the permessage-deflate extension (RFC 7692)
+ *
+ * Both directions are streaming and keep their RAM proportional to the negotiated window:
+ * - the compressor emits fixed Huffman blocks from a greedy LZ77 matcher, it needs up to 6 << window_bits bytes
+ * - the inflater decodes any DEFLATE stream whose distances fit its 1 << window_bits byte history
+ */
+
+#define ESP_WEBSOCKET_DEFLATE_MIN_WINDOW_BITS   (9)
+#define ESP_WEBSOCKET_DEFLATE_MAX_WINDOW_BITS   (15)
+
+typedef struct esp_websocket_deflate *esp_websocket_deflate_handle_t;
+typedef struct esp_websocket_inflate *esp_websocket_inflate_handle_t;
+
+/**
+ * @brief      Create a compressor using a history window of 1 << window_bits bytes
+ */
+esp_websocket_deflate_handle_t esp_websocket_deflate_init(int window_bits);
+
+/**
+ * @brief      Drop the history, the next message is compressed without referring to the previous ones
+ */
+void esp_websocket_deflate_reset(esp_websocket_deflate_handle_t deflate);
+
+void esp_websocket_deflate_destroy(esp_websocket_deflate_handle_t deflate);
+
+/**
+ * @brief      Compress one message into `out`, to be called repeatedly until `done` is set
+ *
+ * Consumes `*in`/`*in_len` as far as the output space allows. Once all input is consumed the
+ * message is terminated with a sync flush, with the trailing 0x00 0x00 0xff 0xff stripped as
+ * required by RFC 7692.
+ *
+ * @return     Number of bytes written to `out`
+ */
+size_t esp_websocket_deflate_message(esp_websocket_deflate_handle_t deflate, const uint8_t **in, size_t *in_len,
+                                     uint8_t *out, size_t out_len, bool *done);
+
+/**
+ * @brief      Create an inflater with a history window of 1 << window_bits bytes
+ */
+esp_websocket_inflate_handle_t esp_websocket_inflate_init(int window_bits);
+
+void esp_websocket_inflate_reset(esp_websocket_inflate_handle_t inflate);
+
+/**
+ * @brief      Prepare for the next message once the current one, including its 0x00 0x00 0xff 0xff tail, was fed
+ *
+ * @param      keep_window  false if the peer does not take over the context (no_context_takeover)
+ */
+void esp_websocket_inflate_end_message(esp_websocket_inflate_handle_t inflate, bool keep_window);
+
+void esp_websocket_inflate_destroy(esp_websocket_inflate_handle_t inflate);
+
+/**
+ * @brief      Decompress a chunk of a message
+ *
+ * Stops when either the input is consumed or `out` is full, so it has to be called again while
+ * `*in_used < in_len` or `*out_written == out_len`. Bits of an incomplete symbol at the end of the
+ * input are kept in the inflater state, chunks may therefore be split at any byte.
+ *
+ * @return
+ *     - ESP_OK on progress
+ *     - ESP_ERR_INVALID_RESPONSE if the stream is corrupted or refers beyond the window
+ */
+esp_err_t esp_websocket_inflate(esp_websocket_inflate_handle_t inflate, const uint8_t *in, size_t in_len, size_t *in_used,
+                                uint8_t *out, size_t out_len, size_t *out_written);
+
+#ifdef __cplusplus
+}
+#endif
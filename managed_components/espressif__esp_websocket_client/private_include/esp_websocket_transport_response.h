@@ -0,0 +1,57 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Transport passing everything through to its parent, which keeps one header of the upgrade response
+ *
+ * esp_transport_ws does not return the headers of the HTTP response to the upgrade request. Placed between
+ * the websocket transport and the TCP or TLS transport, this transport sees the response as it is read and
+ * keeps the value of one header. It does not provide esp_transport_get_socket(), use
+ * esp_websocket_transport_response_get_socket() instead.
+ */
+
+/**
+ * @brief      Create the transport
+ *
+ * @param[in]  parent      TCP or TLS transport, it has to outlive this transport and is not destroyed with it
+ * @param[in]  header      Name of the header to keep, the string has to outlive the transport
+ * @param[in]  value_size  Longest value kept, including the terminating null character
+ *
+ * @return     The transport handle, or NULL if there is not enough memory
+ */
+esp_transport_handle_t esp_websocket_transport_response_init(esp_transport_handle_t parent, const char *header, size_t value_size);
+
+/**
+ * @brief      Value of the header in the response of the last connect
+ *
+ * Repeated headers are joined with ", ", surrounding whitespace is kept.
+ *
+ * @param[out] value  The value, or NULL if the response did not contain the header
+ *
+ * @return
+ *     - ESP_OK
+ *     - ESP_ERR_INVALID_STATE if the response was not read completely
+ *     - ESP_ERR_INVALID_SIZE if the value did not fit into value_size
+ */
+esp_err_t esp_websocket_transport_response_get_header(esp_transport_handle_t t, const char **value);
+
+/**
+ * @brief      Socket of the parent transport
+ */
+int esp_websocket_transport_response_get_socket(esp_transport_handle_t t);
+
+#ifdef __cplusplus
+}
+#endif
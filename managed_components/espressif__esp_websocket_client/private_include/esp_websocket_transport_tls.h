@@ -0,0 +1,53 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_tls.h"
+#include "esp_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * TLS transport resuming its session on reconnect
+ *
+ * esp_transport_ssl creates a new esp_tls context for every connection and does not expose it, so every
+ * reconnect performs a full handshake. This transport keeps the session of the last connection (session ticket
+ * or session ID) and offers it on the next connect, the server falls back to a full handshake if it does not
+ * accept it. It does not provide esp_transport_get_socket().
+ */
+
+/**
+ * @brief      Create the transport
+ *
+ * @param[in]  cfg  TLS configuration, the certificate and key buffers it points to have to outlive the transport.
+ *                  `timeout_ms` and `client_session` are set by the transport on every connect.
+ *
+ * @return     The transport handle, or NULL if there is not enough memory
+ */
+esp_transport_handle_t esp_websocket_transport_tls_init(const esp_tls_cfg_t *cfg);
+
+/**
+ * @brief      Forget the kept session, the next connect performs a full handshake
+ */
+void esp_websocket_transport_tls_clear_session(esp_transport_handle_t t);
+
+/**
+ * @brief      Whether the last connect offered a kept session to the server
+ */
+bool esp_websocket_transport_tls_session_offered(esp_transport_handle_t t);
+
+/**
+ * @brief      Duration of the last connect, TCP connect and TLS handshake, in milliseconds
+ */
+uint32_t esp_websocket_transport_tls_connect_time_ms(esp_transport_handle_t t);
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,32 +12,47 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <esp_websocket_client.h>
 #include "esp_event.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
 #include "unity.h"
-#include "test_utils.h"
 
 #include "unity_fixture.h"
+#if !CONFIG_IDF_TARGET_LINUX
+#include "test_utils.h"
 #include "memory_checks.h"
+#endif
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+#include "esp_timer.h"
+#include "esp_websocket_deflate.h"
+#endif
 
 TEST_GROUP(websocket);
 
 TEST_SETUP(websocket)
 {
-#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 1, 0)
+#if CONFIG_IDF_TARGET_LINUX
+    /* heap accounting of test_utils is not available on the host */
+#elif ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 1, 0)
     /* IDF v5.0 runs some lazy inits within printf()
      * This test sets the leak threshold to 0, so we need to call printf()
      * before recording the heap size in test_utils_record_free_mem()
      */
     printf("TEST_SETUP: websocket\n");
 #endif
+#if !CONFIG_IDF_TARGET_LINUX
     test_utils_record_free_mem();
     TEST_ESP_OK(test_utils_set_leak_level(0, ESP_LEAK_TYPE_CRITICAL, ESP_COMP_LEAK_GENERAL));
+#endif
 }
 
 TEST_TEAR_DOWN(websocket)
 {
+#if !CONFIG_IDF_TARGET_LINUX
     test_utils_finish_and_evaluate_leaks(0, 0);
+#endif
 }
 
 
@@ -70,11 +85,846 @@ TEST(websocket, websocket_set_invalid_url)
     esp_websocket_client_destroy(client);
 }
 
+TEST(websocket, websocket_manager_init_deinit)
+{
+    esp_websocket_client_manager_handle_t manager = esp_websocket_client_manager_init(NULL);
+    TEST_ASSERT_NOT_EQUAL(NULL, manager);
+    const esp_websocket_client_config_t websocket_cfg = {
+        .uri = "ws://echo.websocket.org",
+        .manager = manager,
+    };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, client);
+    // clients have to go first
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_websocket_client_manager_destroy(manager));
+    esp_websocket_client_destroy(client);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_manager_destroy(manager));
+    // let the idle task free the deleted manager task before the leak check
+    vTaskDelay(pdMS_TO_TICKS(10));
+}
+
+TEST(websocket, websocket_manager_buffer_too_big)
+{
+    const esp_websocket_client_manager_config_t manager_cfg = {
+        .buffer_size = 512,
+    };
+    esp_websocket_client_manager_handle_t manager = esp_websocket_client_manager_init(&manager_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, manager);
+    const esp_websocket_client_config_t websocket_cfg = {
+        .uri = "ws://echo.websocket.org",
+        .buffer_size = 1024,
+        .manager = manager,
+    };
+    TEST_ASSERT_NULL(esp_websocket_client_init(&websocket_cfg));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_manager_destroy(manager));
+    vTaskDelay(pdMS_TO_TICKS(10));
+}
+
+TEST(websocket, websocket_task_core)
+{
+    esp_websocket_client_config_t websocket_cfg = {
+        .uri = "ws://echo.websocket.org",
+        .task_pinned = true,
+        .task_core_id = portNUM_PROCESSORS,
+    };
+    TEST_ASSERT_NULL(esp_websocket_client_init(&websocket_cfg));
+    websocket_cfg.task_core_id = portNUM_PROCESSORS - 1;
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, client);
+    esp_websocket_client_destroy(client);
+
+    esp_websocket_client_manager_config_t manager_cfg = {
+        .task_pinned = true,
+        .task_core_id = -1,
+    };
+    TEST_ASSERT_NULL(esp_websocket_client_manager_init(&manager_cfg));
+    manager_cfg.task_core_id = 0;
+    esp_websocket_client_manager_handle_t manager = esp_websocket_client_manager_init(&manager_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, manager);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_manager_destroy(manager));
+    vTaskDelay(pdMS_TO_TICKS(10));
+}
+
+TEST(websocket, websocket_buffer_pool_reuse)
+{
+    esp_websocket_buffer_pool_handle_t pool = esp_websocket_buffer_pool_create(NULL);
+    TEST_ASSERT_NOT_EQUAL(NULL, pool);
+    for (int i = 0; i < 16; i++) {
+        // sizes within one class share the same buffers
+        void *buf = esp_websocket_buffer_pool_lease(pool, 700 + i);
+        TEST_ASSERT_NOT_EQUAL(NULL, buf);
+        memset(buf, 0xaa, 1024);
+        esp_websocket_buffer_pool_return(pool, buf);
+    }
+    esp_websocket_buffer_pool_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_buffer_pool_get_stats(pool, &stats));
+    TEST_ASSERT_EQUAL(16, stats.leases);
+    TEST_ASSERT_EQUAL(1, stats.allocs);
+    TEST_ASSERT_EQUAL(15, stats.reuses);
+    TEST_ASSERT_EQUAL(0, stats.leased_bytes);
+    TEST_ASSERT_EQUAL(1024, stats.cached_bytes);
+    TEST_ASSERT_EQUAL(1024, stats.peak_bytes);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_buffer_pool_destroy(pool));
+}
+
+TEST(websocket, websocket_buffer_pool_limits)
+{
+    const esp_websocket_buffer_pool_config_t pool_cfg = {
+        .max_free_per_class = 1,
+        .idle_timeout_ms = 20,
+    };
+    esp_websocket_buffer_pool_handle_t pool = esp_websocket_buffer_pool_create(&pool_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, pool);
+    void *first = esp_websocket_buffer_pool_lease(pool, 256);
+    void *second = esp_websocket_buffer_pool_lease(pool, 100);
+    void *oversize = esp_websocket_buffer_pool_lease(pool, 40 * 1024);
+    TEST_ASSERT_NOT_EQUAL(NULL, first);
+    TEST_ASSERT_NOT_EQUAL(NULL, second);
+    TEST_ASSERT_NOT_EQUAL(NULL, oversize);
+    // leased buffers keep the pool alive
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_websocket_buffer_pool_destroy(pool));
+
+    esp_websocket_buffer_pool_return(pool, first);
+    esp_websocket_buffer_pool_return(pool, second);
+    esp_websocket_buffer_pool_return(pool, oversize);
+    esp_websocket_buffer_pool_return(pool, NULL);
+    esp_websocket_buffer_pool_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_buffer_pool_get_stats(pool, &stats));
+    // only one buffer of the class is kept, oversize buffers are never cached
+    TEST_ASSERT_EQUAL(3, stats.allocs);
+    TEST_ASSERT_EQUAL(2, stats.frees);
+    TEST_ASSERT_EQUAL(256, stats.cached_bytes);
+    TEST_ASSERT_EQUAL(2 * 256 + 40 * 1024, stats.peak_bytes);
+
+    esp_websocket_buffer_pool_trim(pool);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_buffer_pool_get_stats(pool, &stats));
+    TEST_ASSERT_EQUAL(256, stats.cached_bytes);
+    vTaskDelay(pdMS_TO_TICKS(50));
+    esp_websocket_buffer_pool_trim(pool);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_buffer_pool_get_stats(pool, &stats));
+    TEST_ASSERT_EQUAL(0, stats.cached_bytes);
+    TEST_ASSERT_EQUAL(3, stats.frees);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_buffer_pool_destroy(pool));
+}
+
+TEST(websocket, websocket_buffer_pool_shared)
+{
+    esp_websocket_buffer_pool_handle_t pool = esp_websocket_buffer_pool_create(NULL);
+    TEST_ASSERT_NOT_EQUAL(NULL, pool);
+    const esp_websocket_client_config_t websocket_cfg = {
+        .uri = "ws://echo.websocket.org",
+        .buffer_pool = pool,
+    };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, client);
+    esp_websocket_buffer_pool_stats_t stats;
+#ifdef CONFIG_ESP_WS_CLIENT_ENABLE_DYNAMIC_BUFFER
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_get_buffer_stats(client, &stats));
+#else
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, esp_websocket_client_get_buffer_stats(client, &stats));
+#endif
+    esp_websocket_client_destroy(client);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_buffer_pool_destroy(pool));
+}
+
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+#define TEST_DEFLATE_RUNS   100
+
+static const char s_dashboard[] = "{\"rooms\":["
+                                  "{\"name\":\"salon\",\"temperature\":22.5,\"humidity\":41,\"relays\":[true,false,false,true]},"
+                                  "{\"name\":\"mutfak\",\"temperature\":23.0,\"humidity\":44,\"relays\":[false,false,true,true]},"
+                                  "{\"name\":\"yatak_odasi\",\"temperature\":21.5,\"humidity\":39,\"relays\":[false,false,false,false]}]}";
+
+/* s_dashboard compressed by zlib (level 9, 512 byte window, dynamic Huffman codes), sync flush tail stripped */
+static const uint8_t s_dashboard_zlib[] = {
+    0x74, 0xce, 0xcd, 0x0a, 0xc2, 0x30, 0x10, 0x04, 0xe0, 0x77, 0xd9, 0xf3,
+    0x52, 0xec, 0x8f, 0x07, 0xf3, 0x2a, 0x12, 0x64, 0xa1, 0x5b, 0x0c, 0x4d,
+    0x1a, 0x49, 0x36, 0x87, 0x50, 0xf2, 0xee, 0xb5, 0x07, 0xa5, 0x35, 0x78,
+    0x99, 0xc3, 0xc0, 0x7c, 0xcc, 0x0a, 0xc1, 0x7b, 0x17, 0x41, 0xdd, 0x57,
+    0x58, 0xc8, 0x31, 0x28, 0x88, 0x64, 0xfd, 0x02, 0x08, 0xc2, 0xee, 0xc5,
+    0x81, 0x24, 0x85, 0x77, 0xdb, 0x75, 0xcd, 0x15, 0xe1, 0x99, 0x9c, 0x19,
+    0x8d, 0x64, 0x50, 0x43, 0x8b, 0x10, 0xd8, 0x52, 0xde, 0xa7, 0x12, 0x12,
+    0xe3, 0x44, 0x36, 0x7e, 0x72, 0x2f, 0x74, 0xc1, 0x2f, 0xe9, 0x92, 0x4c,
+    0x34, 0x57, 0x66, 0xdf, 0x5c, 0x4e, 0xe6, 0x70, 0x30, 0x7f, 0xb9, 0xca,
+    0xcc, 0x24, 0x34, 0x3f, 0xfc, 0x48, 0xd1, 0x54, 0x70, 0x7b, 0x3e, 0xdb,
+    0xdf, 0xfe, 0xc0, 0x87, 0xd4, 0x45, 0x97, 0x0d,
+};
+
+static size_t test_deflate(esp_websocket_deflate_handle_t deflate, const char *msg, size_t out_chunk, uint8_t *out)
+{
+    const uint8_t *in = (const uint8_t *)msg;
+    size_t in_len = strlen(msg);
+    size_t len = 0;
+    bool done = false;
+    while (!done) {
+        len += esp_websocket_deflate_message(deflate, &in, &in_len, out + len, out_chunk, &done);
+    }
+    return len;
+}
+
+/* Feeds the message in chunks of `in_chunk` bytes, like the receive path does with frames split by the buffer size */
+static size_t test_inflate(esp_websocket_inflate_handle_t inflate, const uint8_t *msg, size_t len, size_t in_chunk, uint8_t *out, size_t out_size)
+{
+    static const uint8_t tail[] = { 0x00, 0x00, 0xff, 0xff };
+    size_t out_len = 0;
+    for (size_t offset = 0; offset < len + sizeof(tail); offset += in_chunk) {
+        uint8_t chunk[16];
+        size_t chunk_len = 0;
+        for (; chunk_len < in_chunk && offset + chunk_len < len + sizeof(tail); chunk_len++) {
+            size_t i = offset + chunk_len;
+            chunk[chunk_len] = i < len ? msg[i] : tail[i - len];
+        }
+        size_t used = 0;
+        size_t produced = 0;
+        size_t consumed = 0;
+        do {
+            TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_inflate(inflate, chunk + consumed, chunk_len - consumed, &used,
+                                                            out + out_len, out_size - out_len, &produced));
+            consumed += used;
+            out_len += produced;
+        } while (consumed < chunk_len);
+    }
+    return out_len;
+}
+
+TEST(websocket, websocket_deflate_zlib_stream)
+{
+    uint8_t out[sizeof(s_dashboard)];
+    esp_websocket_inflate_handle_t inflate = esp_websocket_inflate_init(9);
+    TEST_ASSERT_NOT_EQUAL(NULL, inflate);
+    for (size_t in_chunk = 1; in_chunk <= 16; in_chunk *= 4) {
+        esp_websocket_inflate_reset(inflate);
+        TEST_ASSERT_EQUAL(strlen(s_dashboard), test_inflate(inflate, s_dashboard_zlib, sizeof(s_dashboard_zlib), in_chunk, out, sizeof(out)));
+        TEST_ASSERT_EQUAL_MEMORY(s_dashboard, out, strlen(s_dashboard));
+    }
+    esp_websocket_inflate_destroy(inflate);
+}
+
+TEST(websocket, websocket_deflate_roundtrip)
+{
+    const size_t len = strlen(s_dashboard);
+    uint8_t *compressed = malloc(2 * len);
+    uint8_t *out = malloc(len);
+    TEST_ASSERT_NOT_EQUAL(NULL, compressed);
+    TEST_ASSERT_NOT_EQUAL(NULL, out);
+
+    for (int bits = ESP_WEBSOCKET_DEFLATE_MIN_WINDOW_BITS; bits <= ESP_WEBSOCKET_DEFLATE_MAX_WINDOW_BITS; bits += 3) {
+        for (int takeover = 0; takeover < 2; takeover++) {
+            esp_websocket_deflate_handle_t deflate = esp_websocket_deflate_init(bits);
+            esp_websocket_inflate_handle_t inflate = esp_websocket_inflate_init(bits);
+            TEST_ASSERT_NOT_EQUAL(NULL, deflate);
+            TEST_ASSERT_NOT_EQUAL(NULL, inflate);
+            size_t first = 0;
+            for (int msg = 0; msg < 3; msg++) {
+                if (!takeover) {
+                    esp_websocket_deflate_reset(deflate);
+                }
+                size_t compressed_len = test_deflate(deflate, s_dashboard, 16, compressed);
+                TEST_ASSERT_LESS_THAN(len, compressed_len);
+                TEST_ASSERT_EQUAL(len, test_inflate(inflate, compressed, compressed_len, 3, out, len));
+                TEST_ASSERT_EQUAL_MEMORY(s_dashboard, out, len);
+                esp_websocket_inflate_end_message(inflate, takeover);
+                if (msg == 0) {
+                    first = compressed_len;
+                } else if (takeover) {
+                    // repeated messages refer to the previous ones
+                    TEST_ASSERT_LESS_THAN(first / 4, compressed_len);
+                } else {
+                    TEST_ASSERT_EQUAL(first, compressed_len);
+                }
+            }
+            esp_websocket_deflate_destroy(deflate);
+            esp_websocket_inflate_destroy(inflate);
+        }
+    }
+    free(compressed);
+    free(out);
+}
+
+/* Bytes a client puts on the wire for a single frame: header, masking key and payload */
+static size_t test_frame_bytes(size_t len)
+{
+    return 2 + 4 + (len >= 126 ? 2 : 0) + len;
+}
+
+TEST(websocket, websocket_deflate_benchmark)
+{
+    const size_t len = strlen(s_dashboard);
+    char *msg = strdup(s_dashboard);
+    uint8_t *compressed = malloc(2 * len);
+    uint8_t *out = malloc(len);
+    TEST_ASSERT_NOT_EQUAL(NULL, msg);
+    TEST_ASSERT_NOT_EQUAL(NULL, compressed);
+    TEST_ASSERT_NOT_EQUAL(NULL, out);
+    char *temperature = strstr(msg, "22.5");
+    char *humidity = strstr(msg, "41") + 1;
+
+    const int window_bits[] = { 9, 10, 12, 15 };
+    for (int i = 0; i < sizeof(window_bits) / sizeof(window_bits[0]); i++) {
+        for (int takeover = 0; takeover < 2; takeover++) {
+            esp_websocket_deflate_handle_t deflate = esp_websocket_deflate_init(window_bits[i]);
+            esp_websocket_inflate_handle_t inflate = esp_websocket_inflate_init(window_bits[i]);
+            TEST_ASSERT_NOT_EQUAL(NULL, deflate);
+            TEST_ASSERT_NOT_EQUAL(NULL, inflate);
+            size_t wire = 0;
+            int64_t deflate_us = 0;
+            int64_t inflate_us = 0;
+            for (int run = 0; run < TEST_DEFLATE_RUNS; run++) {
+                if (!takeover) {
+                    esp_websocket_deflate_reset(deflate);
+                }
+                // every update carries new readings
+                temperature[0] = '1' + run % 3;
+                temperature[3] = '0' + run % 10;
+                humidity[0] = '0' + run % 7;
+                int64_t start = esp_timer_get_time();
+                size_t compressed_len = test_deflate(deflate, msg, 2 * len, compressed);
+                deflate_us += esp_timer_get_time() - start;
+
+                start = esp_timer_get_time();
+                TEST_ASSERT_EQUAL(len, test_inflate(inflate, compressed, compressed_len, 16, out, len));
+                inflate_us += esp_timer_get_time() - start;
+                TEST_ASSERT_EQUAL_MEMORY(msg, out, len);
+                esp_websocket_inflate_end_message(inflate, takeover);
+                wire += test_frame_bytes(compressed_len);
+            }
+            printf("permessage-deflate window_bits=%d context_takeover=%d: %d -> %d bytes on wire per message, "
+                   "deflate %d us, inflate %d us per message\n", window_bits[i], takeover,
+                   (int)test_frame_bytes(len), (int)(wire / TEST_DEFLATE_RUNS),
+                   (int)(deflate_us / TEST_DEFLATE_RUNS), (int)(inflate_us / TEST_DEFLATE_RUNS));
+            esp_websocket_deflate_destroy(deflate);
+            esp_websocket_inflate_destroy(inflate);
+        }
+    }
+    free(msg);
+    free(compressed);
+    free(out);
+}
+#endif // CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+
+#if CONFIG_WEBSOCKET_TEST_LOCAL_SERVERS
+#define TEST_SERVERS        3
+#define TEST_CONNECTED_BIT  BIT0
+#define TEST_DATA_BIT       BIT1
+#define TEST_DISCONNECTED_BIT   BIT2
+
+typedef struct {
+    EventGroupHandle_t bits;
+    char received[32];
+} test_connection_t;
+
+static void test_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    test_connection_t *conn = handler_args;
+    esp_websocket_event_data_t *data = event_data;
+    if (event_id == WEBSOCKET_EVENT_CONNECTED) {
+        xEventGroupSetBits(conn->bits, TEST_CONNECTED_BIT);
+    } else if (event_id == WEBSOCKET_EVENT_DISCONNECTED) {
+        xEventGroupSetBits(conn->bits, TEST_DISCONNECTED_BIT);
+    } else if (event_id == WEBSOCKET_EVENT_DATA && data->op_code == WS_TRANSPORT_OPCODES_TEXT) {
+        snprintf(conn->received, sizeof(conn->received), "%.*s", data->data_len, data->data_ptr);
+        xEventGroupSetBits(conn->bits, TEST_DATA_BIT);
+    }
+}
+
+TEST(websocket, websocket_manager_multiple_servers)
+{
+    esp_websocket_client_manager_handle_t manager = esp_websocket_client_manager_init(NULL);
+    TEST_ASSERT_NOT_EQUAL(NULL, manager);
+
+    esp_websocket_client_handle_t clients[TEST_SERVERS];
+    test_connection_t conns[TEST_SERVERS] = { 0 };
+    for (int i = 0; i < TEST_SERVERS; i++) {
+        const esp_websocket_client_config_t websocket_cfg = {
+            .host = CONFIG_WEBSOCKET_TEST_SERVER_HOST,
+            .port = CONFIG_WEBSOCKET_TEST_SERVER_PORT + i,
+            .manager = manager,
+        };
+        conns[i].bits = xEventGroupCreate();
+        clients[i] = esp_websocket_client_init(&websocket_cfg);
+        TEST_ASSERT_NOT_EQUAL(NULL, clients[i]);
+        esp_websocket_register_events(clients[i], WEBSOCKET_EVENT_ANY, test_event_handler, &conns[i]);
+        TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_start(clients[i]));
+    }
+
+    for (int i = 0; i < TEST_SERVERS; i++) {
+        TEST_ASSERT_TRUE(xEventGroupWaitBits(conns[i].bits, TEST_CONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_CONNECTED_BIT);
+    }
+    // every server echoes the message of its own connection only
+    for (int i = 0; i < TEST_SERVERS; i++) {
+        char msg[16];
+        int len = snprintf(msg, sizeof(msg), "server %d", i);
+        TEST_ASSERT_EQUAL(len, esp_websocket_client_send_text(clients[i], msg, len, portMAX_DELAY));
+    }
+    for (int i = 0; i < TEST_SERVERS; i++) {
+        char expected[16];
+        snprintf(expected, sizeof(expected), "server %d", i);
+        TEST_ASSERT_TRUE(xEventGroupWaitBits(conns[i].bits, TEST_DATA_BIT, pdTRUE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_DATA_BIT);
+        TEST_ASSERT_EQUAL_STRING(expected, conns[i].received);
+    }
+
+    // stopping one connection keeps the others serviced
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_stop(clients[0]));
+    TEST_ASSERT_EQUAL(8, esp_websocket_client_send_text(clients[1], "server 1", 8, portMAX_DELAY));
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(conns[1].bits, TEST_DATA_BIT, pdTRUE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_DATA_BIT);
+
+    for (int i = 0; i < TEST_SERVERS; i++) {
+        esp_websocket_client_destroy(clients[i]);
+        vEventGroupDelete(conns[i].bits);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_manager_destroy(manager));
+}
+
+// accepts the connection and never answers the upgrade request, the way a hung server looks
+#define TEST_SILENT_SERVER_PORT     (CONFIG_WEBSOCKET_TEST_SERVER_PORT + TEST_SERVERS + 5)
+#define TEST_STEP_TIMEOUT_MS        500
+
+TEST(websocket, websocket_manager_unresponsive_server)
+{
+    const esp_websocket_client_manager_config_t manager_cfg = {
+        .step_timeout_ms = TEST_STEP_TIMEOUT_MS,
+    };
+    esp_websocket_client_manager_handle_t manager = esp_websocket_client_manager_init(&manager_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, manager);
+
+    // keeps reconnecting with the default network_timeout_ms, every attempt holds the manager task for one step
+    const esp_websocket_client_config_t silent_cfg = {
+        .host = CONFIG_WEBSOCKET_TEST_SERVER_HOST,
+        .port = TEST_SILENT_SERVER_PORT,
+        .manager = manager,
+        .reconnect_timeout_ms = 100,
+    };
+    test_connection_t silent_conn = { .bits = xEventGroupCreate() };
+    esp_websocket_client_handle_t silent = esp_websocket_client_init(&silent_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, silent);
+    esp_websocket_register_events(silent, WEBSOCKET_EVENT_ANY, test_event_handler, &silent_conn);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_start(silent));
+
+    esp_websocket_client_handle_t clients[TEST_SERVERS];
+    test_connection_t conns[TEST_SERVERS] = { 0 };
+    for (int i = 0; i < TEST_SERVERS; i++) {
+        const esp_websocket_client_config_t websocket_cfg = {
+            .host = CONFIG_WEBSOCKET_TEST_SERVER_HOST,
+            .port = CONFIG_WEBSOCKET_TEST_SERVER_PORT + i,
+            .manager = manager,
+        };
+        conns[i].bits = xEventGroupCreate();
+        clients[i] = esp_websocket_client_init(&websocket_cfg);
+        TEST_ASSERT_NOT_EQUAL(NULL, clients[i]);
+        esp_websocket_register_events(clients[i], WEBSOCKET_EVENT_ANY, test_event_handler, &conns[i]);
+        TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_start(clients[i]));
+    }
+
+    // with network_timeout_ms per attempt the live connections would wait 10 s for every step of the silent one
+    for (int i = 0; i < TEST_SERVERS; i++) {
+        TEST_ASSERT_TRUE(xEventGroupWaitBits(conns[i].bits, TEST_CONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(4 * TEST_STEP_TIMEOUT_MS)) & TEST_CONNECTED_BIT);
+    }
+    for (int round = 0; round < 5; round++) {
+        for (int i = 0; i < TEST_SERVERS; i++) {
+            char msg[16];
+            int len = snprintf(msg, sizeof(msg), "server %d", i);
+            TEST_ASSERT_EQUAL(len, esp_websocket_client_send_text(clients[i], msg, len, portMAX_DELAY));
+            TEST_ASSERT_TRUE(xEventGroupWaitBits(conns[i].bits, TEST_DATA_BIT, pdTRUE, pdTRUE, pdMS_TO_TICKS(4 * TEST_STEP_TIMEOUT_MS)) & TEST_DATA_BIT);
+            TEST_ASSERT_EQUAL_STRING(msg, conns[i].received);
+        }
+    }
+    TEST_ASSERT_FALSE(xEventGroupGetBits(silent_conn.bits) & TEST_CONNECTED_BIT);
+
+    esp_websocket_client_destroy(silent);
+    vEventGroupDelete(silent_conn.bits);
+    for (int i = 0; i < TEST_SERVERS; i++) {
+        esp_websocket_client_destroy(clients[i]);
+        vEventGroupDelete(conns[i].bits);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_manager_destroy(manager));
+}
+
+// the server stops listening for the requested time and drops the connection without a close frame
+#define TEST_RESTART_SERVER_PORT    (CONFIG_WEBSOCKET_TEST_SERVER_PORT + TEST_SERVERS + 1)
+#define TEST_RESTART_DOWN_MS        1500
+
+static void test_restart_server(esp_websocket_client_handle_t client, test_connection_t *conn, int down_ms)
+{
+    char msg[16];
+    int len = snprintf(msg, sizeof(msg), "restart %d", down_ms);
+    xEventGroupClearBits(conn->bits, TEST_CONNECTED_BIT | TEST_DISCONNECTED_BIT);
+    TEST_ASSERT_EQUAL(len, esp_websocket_client_send_text(client, msg, len, portMAX_DELAY));
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(conn->bits, TEST_DISCONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_DISCONNECTED_BIT);
+}
+
+TEST(websocket, websocket_reconnect_backoff)
+{
+    const esp_websocket_client_config_t websocket_cfg = {
+        .host = CONFIG_WEBSOCKET_TEST_SERVER_HOST,
+        .port = TEST_RESTART_SERVER_PORT,
+        .reconnect_timeout_ms = 50,
+        .reconnect_backoff_max_ms = 400,
+        .reconnect_backoff_jitter = true,
+        .network_timeout_ms = 1000,
+    };
+    test_connection_t conn = { .bits = xEventGroupCreate() };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, client);
+    esp_websocket_register_events(client, WEBSOCKET_EVENT_ANY, test_event_handler, &conn);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_start(client));
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(conn.bits, TEST_CONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_CONNECTED_BIT);
+
+    // refused attempts back off up to the limit, the client is back shortly after the server
+    test_restart_server(client, &conn, TEST_RESTART_DOWN_MS);
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(conn.bits, TEST_CONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_CONNECTED_BIT);
+    esp_websocket_reconnect_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_get_reconnect_stats(client, &stats));
+    TEST_ASSERT_EQUAL(1, stats.reconnects);
+    TEST_ASSERT_EQUAL(stats.failures + 1, stats.attempts);
+    TEST_ASSERT_GREATER_OR_EQUAL(2, stats.failures);
+    TEST_ASSERT_GREATER_OR_EQUAL(TEST_RESTART_DOWN_MS - 100, stats.last_reconnect_ms);
+    TEST_ASSERT_LESS_THAN(TEST_RESTART_DOWN_MS + 1000, stats.last_reconnect_ms);
+    TEST_ASSERT_EQUAL(50, esp_websocket_client_get_reconnect_timeout(client));
+
+    // a long delay is cut short once the network is known to be back
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_set_reconnect_timeout(client, 60000));
+    test_restart_server(client, &conn, 200);
+    vTaskDelay(pdMS_TO_TICKS(500));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_reconnect_now(client));
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(conn.bits, TEST_CONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(2000)) & TEST_CONNECTED_BIT);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_get_reconnect_stats(client, &stats));
+    TEST_ASSERT_EQUAL(2, stats.reconnects);
+
+    esp_websocket_client_destroy(client);
+    vEventGroupDelete(conn.bits);
+    vTaskDelay(pdMS_TO_TICKS(10));
+}
+
+TEST(websocket, websocket_pause_resume)
+{
+    const esp_websocket_client_config_t websocket_cfg = {
+        .host = CONFIG_WEBSOCKET_TEST_SERVER_HOST,
+        .port = CONFIG_WEBSOCKET_TEST_SERVER_PORT,
+        .reconnect_timeout_ms = 50,
+    };
+    test_connection_t conn = { .bits = xEventGroupCreate() };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, client);
+    esp_websocket_register_events(client, WEBSOCKET_EVENT_ANY, test_event_handler, &conn);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_start(client));
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(conn.bits, TEST_CONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_CONNECTED_BIT);
+
+    // the connection is dropped within the poll interval and not retried while paused
+    xEventGroupClearBits(conn.bits, TEST_CONNECTED_BIT | TEST_DISCONNECTED_BIT);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_pause(client));
+    TEST_ASSERT_TRUE(esp_websocket_client_is_paused(client));
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(conn.bits, TEST_DISCONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(2000)) & TEST_DISCONNECTED_BIT);
+    TEST_ASSERT_FALSE(esp_websocket_client_is_connected(client));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_reconnect_now(client));
+    TEST_ASSERT_FALSE(xEventGroupWaitBits(conn.bits, TEST_CONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(1000)) & TEST_CONNECTED_BIT);
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_resume(client));
+    TEST_ASSERT_FALSE(esp_websocket_client_is_paused(client));
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(conn.bits, TEST_CONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(2000)) & TEST_CONNECTED_BIT);
+
+    esp_websocket_client_destroy(client);
+    vEventGroupDelete(conn.bits);
+    vTaskDelay(pdMS_TO_TICKS(10));
+}
+
+TEST(websocket, websocket_ping_rtt)
+{
+    const esp_websocket_client_config_t websocket_cfg = {
+        .host = CONFIG_WEBSOCKET_TEST_SERVER_HOST,
+        .port = CONFIG_WEBSOCKET_TEST_SERVER_PORT,
+        .ping_interval_sec = 1,
+        .ping_adaptive_enable = true,
+        .ping_interval_max_sec = 4,
+    };
+    test_connection_t conn = { .bits = xEventGroupCreate() };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, client);
+    esp_websocket_register_events(client, WEBSOCKET_EVENT_ANY, test_event_handler, &conn);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_start(client));
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(conn.bits, TEST_CONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_CONNECTED_BIT);
+
+    // an idle connection is pinged after 1 s, then after 2 s as the first PONG came back in time
+    vTaskDelay(pdMS_TO_TICKS(4500));
+    esp_websocket_rtt_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_get_rtt_stats(client, &stats));
+    TEST_ASSERT_GREATER_OR_EQUAL(2, stats.samples);
+    TEST_ASSERT_EQUAL(stats.samples, stats.pongs_received);
+    TEST_ASSERT_LESS_OR_EQUAL(stats.pings_sent, stats.pongs_received);
+    TEST_ASSERT_LESS_OR_EQUAL(stats.avg_us, stats.min_us);
+    TEST_ASSERT_LESS_OR_EQUAL(stats.p99_us, stats.avg_us);
+    TEST_ASSERT_LESS_OR_EQUAL(stats.max_us, stats.p99_us);
+    uint32_t counted = 0;
+    for (int i = 0; i < ESP_WEBSOCKET_RTT_HISTOGRAM_BUCKETS; i++) {
+        counted += stats.histogram[i];
+    }
+    TEST_ASSERT_EQUAL(stats.samples, counted);
+    TEST_ASSERT_EQUAL(4000, stats.ping_interval_ms);
+
+    // a changed interval starts the adaption over
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_set_ping_interval_sec(client, 2));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_get_rtt_stats(client, &stats));
+    TEST_ASSERT_EQUAL(2000, stats.ping_interval_ms);
+
+    esp_websocket_client_destroy(client);
+    vEventGroupDelete(conn.bits);
+    vTaskDelay(pdMS_TO_TICKS(10));
+}
+
+// echoes in two fragments with a 125 byte PING in between
+#define TEST_INTERLEAVING_SERVER_PORT   (CONFIG_WEBSOCKET_TEST_SERVER_PORT + TEST_SERVERS + 3)
+
+typedef struct {
+    EventGroupHandle_t bits;
+    char message[64];
+    int message_len;
+    int pings;
+    bool ping_complete;
+} test_fragments_t;
+
+static void test_fragments_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    test_fragments_t *frags = handler_args;
+    esp_websocket_event_data_t *data = event_data;
+    if (event_id == WEBSOCKET_EVENT_CONNECTED) {
+        xEventGroupSetBits(frags->bits, TEST_CONNECTED_BIT);
+    } else if (event_id == WEBSOCKET_EVENT_DATA && data->op_code == WS_TRANSPORT_OPCODES_PING) {
+        frags->pings++;
+        frags->ping_complete = data->data_len == 125 && data->payload_len == 125 && data->payload_offset == 0 &&
+                               data->data_ptr[0] == 0 && data->data_ptr[124] == 124;
+    } else if (event_id == WEBSOCKET_EVENT_DATA && (data->op_code == WS_TRANSPORT_OPCODES_TEXT || data->op_code == WS_TRANSPORT_OPCODES_CONT)) {
+        if (data->op_code == WS_TRANSPORT_OPCODES_TEXT && data->payload_offset == 0) {
+            frags->message_len = 0;
+        }
+        if (frags->message_len + data->data_len < sizeof(frags->message)) {
+            memcpy(frags->message + frags->message_len, data->data_ptr, data->data_len);
+            frags->message_len += data->data_len;
+        }
+        frags->message[frags->message_len] = '\0';
+        if (data->fin) {
+            xEventGroupSetBits(frags->bits, TEST_DATA_BIT);
+        }
+    }
+}
+
+TEST(websocket, websocket_interleaved_control_frames)
+{
+    // the PING payload does not fit the data buffer, the PONG has to echo it completely anyway
+    const esp_websocket_client_config_t websocket_cfg = {
+        .host = CONFIG_WEBSOCKET_TEST_SERVER_HOST,
+        .port = TEST_INTERLEAVING_SERVER_PORT,
+        .buffer_size = 32,
+    };
+    test_fragments_t frags = { .bits = xEventGroupCreate() };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, client);
+    esp_websocket_register_events(client, WEBSOCKET_EVENT_ANY, test_fragments_handler, &frags);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_start(client));
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(frags.bits, TEST_CONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_CONNECTED_BIT);
+
+    const char *msg = "fragmented around a ping";
+    TEST_ASSERT_EQUAL(strlen(msg), esp_websocket_client_send_text(client, msg, strlen(msg), portMAX_DELAY));
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(frags.bits, TEST_DATA_BIT, pdTRUE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_DATA_BIT);
+    TEST_ASSERT_EQUAL_STRING(msg, frags.message);
+    TEST_ASSERT_EQUAL(1, frags.pings);
+    TEST_ASSERT_TRUE(frags.ping_complete);
+
+    // the server only replies once it got the matching PONG
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(frags.bits, TEST_DATA_BIT, pdTRUE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_DATA_BIT);
+    TEST_ASSERT_EQUAL_STRING("pong fragmented around a ping", frags.message);
+    TEST_ASSERT_TRUE(esp_websocket_client_is_connected(client));
+
+    esp_websocket_client_destroy(client);
+    vEventGroupDelete(frags.bits);
+    vTaskDelay(pdMS_TO_TICKS(10));
+}
+
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+// same server as TEST_RESTART_SERVER_PORT behind TLS, its session tickets stay valid across the restarts
+#define TEST_TLS_SERVER_PORT        (CONFIG_WEBSOCKET_TEST_SERVER_PORT + TEST_SERVERS + 2)
+#define TEST_TLS_RECONNECTS         10
+
+extern const char server_cert_pem_start[] asm("_binary_server_cert_pem_start");
+
+/* Returns the average time from losing the connection to being connected again */
+static uint32_t test_tls_reconnect_ms(bool resumption)
+{
+    const esp_websocket_client_config_t websocket_cfg = {
+        .host = CONFIG_WEBSOCKET_TEST_SERVER_HOST,
+        .port = TEST_TLS_SERVER_PORT,
+        .transport = WEBSOCKET_TRANSPORT_OVER_SSL,
+        .cert_pem = server_cert_pem_start,
+        .skip_cert_common_name_check = true,
+        .tls_session_resumption = resumption,
+        .reconnect_timeout_ms = 10,
+    };
+    test_connection_t conn = { .bits = xEventGroupCreate() };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, client);
+    esp_websocket_register_events(client, WEBSOCKET_EVENT_ANY, test_event_handler, &conn);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_start(client));
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(conn.bits, TEST_CONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_CONNECTED_BIT);
+    for (int i = 0; i < TEST_TLS_RECONNECTS; i++) {
+        test_restart_server(client, &conn, 1);
+        TEST_ASSERT_TRUE(xEventGroupWaitBits(conn.bits, TEST_CONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_CONNECTED_BIT);
+    }
+
+    esp_websocket_reconnect_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_get_reconnect_stats(client, &stats));
+    TEST_ASSERT_EQUAL(TEST_TLS_RECONNECTS, stats.reconnects);
+    esp_websocket_tls_stats_t tls_stats;
+    if (resumption) {
+        TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_get_tls_stats(client, &tls_stats));
+        TEST_ASSERT_EQUAL(TEST_TLS_RECONNECTS + 1, tls_stats.handshakes);
+        TEST_ASSERT_EQUAL(TEST_TLS_RECONNECTS, tls_stats.session_offers);
+        printf("TLS handshake: %d ms full, %d ms offering the kept session\n",
+               (int)(tls_stats.total_handshake_ms - tls_stats.total_offer_handshake_ms),
+               (int)(tls_stats.total_offer_handshake_ms / tls_stats.session_offers));
+    } else {
+        TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, esp_websocket_client_get_tls_stats(client, &tls_stats));
+    }
+
+    esp_websocket_client_destroy(client);
+    vEventGroupDelete(conn.bits);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    return stats.total_reconnect_ms / stats.reconnects;
+}
+
+TEST(websocket, websocket_tls_resumption_benchmark)
+{
+    uint32_t full_ms = test_tls_reconnect_ms(false);
+    uint32_t resumed_ms = test_tls_reconnect_ms(true);
+    printf("wss:// reconnect: %d ms with full handshakes, %d ms with session resumption\n", (int)full_ms, (int)resumed_ms);
+}
+#endif // CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+#define TEST_DEFLATE_SERVER_PORT    (CONFIG_WEBSOCKET_TEST_SERVER_PORT + TEST_SERVERS)
+// accepts with server_no_context_takeover, client_no_context_takeover and both windows at 9 bits
+#define TEST_DEFLATE_NO_CONTEXT_SERVER_PORT (CONFIG_WEBSOCKET_TEST_SERVER_PORT + TEST_SERVERS + 4)
+#define TEST_DEFLATE_REPEAT         20
+
+typedef struct {
+    EventGroupHandle_t bits;
+    char *received;
+    int received_len;
+    int received_size;
+} test_message_t;
+
+static void test_message_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    test_message_t *msg = handler_args;
+    esp_websocket_event_data_t *data = event_data;
+    if (event_id == WEBSOCKET_EVENT_CONNECTED) {
+        xEventGroupSetBits(msg->bits, TEST_CONNECTED_BIT);
+    } else if (event_id == WEBSOCKET_EVENT_DATA && data->op_code < WS_TRANSPORT_OPCODES_CLOSE) {
+        if (data->payload_offset + data->data_len <= msg->received_size) {
+            memcpy(msg->received + data->payload_offset, data->data_ptr, data->data_len);
+            msg->received_len = data->payload_offset + data->data_len;
+        }
+        if (data->fin) {
+            xEventGroupSetBits(msg->bits, TEST_DATA_BIT);
+        }
+    }
+}
+
+/* Echoes two messages, the second one would be compressed against the context of the first */
+static void test_deflate_echo(int port, int server_window_bits, int client_window_bits)
+{
+    const size_t len = strlen(s_dashboard) * TEST_DEFLATE_REPEAT;
+    char *sent = malloc(len + 1);
+    TEST_ASSERT_NOT_EQUAL(NULL, sent);
+    for (int i = 0; i < TEST_DEFLATE_REPEAT; i++) {
+        strcpy(sent + i * strlen(s_dashboard), s_dashboard);
+    }
+    test_message_t msg = {
+        .bits = xEventGroupCreate(),
+        .received = calloc(1, len),
+        .received_size = len,
+    };
+    TEST_ASSERT_NOT_EQUAL(NULL, msg.received);
+
+    // a small buffer makes both directions span several frames and events
+    const esp_websocket_client_config_t websocket_cfg = {
+        .host = CONFIG_WEBSOCKET_TEST_SERVER_HOST,
+        .port = port,
+        .buffer_size = 128,
+        .permessage_deflate_enable = true,
+        .permessage_deflate_server_window_bits = server_window_bits,
+        .permessage_deflate_client_window_bits = client_window_bits,
+    };
+    esp_websocket_client_handle_t client = esp_websocket_client_init(&websocket_cfg);
+    TEST_ASSERT_NOT_EQUAL(NULL, client);
+    esp_websocket_register_events(client, WEBSOCKET_EVENT_ANY, test_message_handler, &msg);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_websocket_client_start(client));
+    TEST_ASSERT_TRUE(xEventGroupWaitBits(msg.bits, TEST_CONNECTED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_CONNECTED_BIT);
+
+    for (int i = 0; i < 2; i++) {
+        msg.received_len = 0;
+        TEST_ASSERT_EQUAL(len, esp_websocket_client_send_text(client, sent, len, portMAX_DELAY));
+        TEST_ASSERT_TRUE(xEventGroupWaitBits(msg.bits, TEST_DATA_BIT, pdTRUE, pdTRUE, pdMS_TO_TICKS(5000)) & TEST_DATA_BIT);
+        TEST_ASSERT_EQUAL(len, msg.received_len);
+        TEST_ASSERT_EQUAL_MEMORY(sent, msg.received, len);
+    }
+    TEST_ASSERT_TRUE(esp_websocket_client_is_connected(client));
+
+    esp_websocket_client_destroy(client);
+    vEventGroupDelete(msg.bits);
+    free(msg.received);
+    free(sent);
+    vTaskDelay(pdMS_TO_TICKS(10));
+}
+
+TEST(websocket, websocket_deflate_echo)
+{
+    test_deflate_echo(TEST_DEFLATE_SERVER_PORT, 10, 9);
+}
+
+// the server answers without the extension, a compressed frame would make it fail the connection
+TEST(websocket, websocket_deflate_declined)
+{
+    test_deflate_echo(TEST_RESTART_SERVER_PORT, 10, 9);
+}
+
+// neither context_takeover parameter is offered, the server still asks for both and a smaller client window
+TEST(websocket, websocket_deflate_no_context_takeover)
+{
+    test_deflate_echo(TEST_DEFLATE_NO_CONTEXT_SERVER_PORT, 10, 10);
+}
+#endif // CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+#endif // CONFIG_WEBSOCKET_TEST_LOCAL_SERVERS
+
 TEST_GROUP_RUNNER(websocket)
 {
     RUN_TEST_CASE(websocket, websocket_init_deinit)
     RUN_TEST_CASE(websocket, websocket_init_invalid_url)
     RUN_TEST_CASE(websocket, websocket_set_invalid_url)
+    RUN_TEST_CASE(websocket, websocket_manager_init_deinit)
+    RUN_TEST_CASE(websocket, websocket_manager_buffer_too_big)
+    RUN_TEST_CASE(websocket, websocket_task_core)
+    RUN_TEST_CASE(websocket, websocket_buffer_pool_reuse)
+    RUN_TEST_CASE(websocket, websocket_buffer_pool_limits)
+    RUN_TEST_CASE(websocket, websocket_buffer_pool_shared)
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+    RUN_TEST_CASE(websocket, websocket_deflate_zlib_stream)
+    RUN_TEST_CASE(websocket, websocket_deflate_roundtrip)
+    RUN_TEST_CASE(websocket, websocket_deflate_benchmark)
+#endif
+#if CONFIG_WEBSOCKET_TEST_LOCAL_SERVERS
+    RUN_TEST_CASE(websocket, websocket_manager_multiple_servers)
+    RUN_TEST_CASE(websocket, websocket_manager_unresponsive_server)
+    RUN_TEST_CASE(websocket, websocket_reconnect_backoff)
+    RUN_TEST_CASE(websocket, websocket_pause_resume)
+    RUN_TEST_CASE(websocket, websocket_ping_rtt)
+    RUN_TEST_CASE(websocket, websocket_interleaved_control_frames)
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+    RUN_TEST_CASE(websocket, websocket_tls_resumption_benchmark)
+#endif
+#if CONFIG_ESP_WS_CLIENT_ENABLE_PERMESSAGE_DEFLATE
+    RUN_TEST_CASE(websocket, websocket_deflate_echo)
+    RUN_TEST_CASE(websocket, websocket_deflate_declined)
+    RUN_TEST_CASE(websocket, websocket_deflate_no_context_takeover)
+#endif
+#endif
 }
 
 void app_main(void)
@@ -1,8 +1,164 @@
 # SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
 # SPDX-License-Identifier: Apache-2.0
+import asyncio
+import os
+import ssl
+from threading import Event, Thread
 
+import pytest
+import websockets
 from pytest_embedded import Dut
+from SimpleWebSocketServer import SimpleWebSocketServer, WebSocket
+from websockets.extensions.permessage_deflate import ServerPerMessageDeflateFactory
 
+# Must match CONFIG_WEBSOCKET_TEST_SERVER_PORT in sdkconfig.ci.linux
+LOCAL_SERVER_PORT = 8080
+LOCAL_SERVERS = 3
+CERTS_DIR = os.path.join(os.path.dirname(__file__), 'main', 'certs')
 
+
+class WebsocketTestEcho(WebSocket):
+    def handleMessage(self):
+        self.sendMessage(self.data)
+
+
+async def deflate_echo(websocket, *args):
+    async for message in websocket:
+        await websocket.send(message)
+
+
+# Echoes every message in two fragments with a PING of the maximum control frame payload in between,
+# followed by "pong <message>" once the client answered the PING with the same payload
+async def interleaving_echo(websocket, *args):
+    async for message in websocket:
+        pong = None
+
+        async def fragments():
+            nonlocal pong
+            yield message[:len(message) // 2]
+            pong = await websocket.ping(bytes(range(125)))
+            yield message[len(message) // 2:]
+        await websocket.send(fragments())
+        await asyncio.wait_for(pong, 5)
+        await websocket.send('pong ' + message)
+
+
+# Echo server which drops its connections and stops listening for the given number of milliseconds
+# on "restart <ms>", the way a crashed and restarted server looks to the client
+class RestartingEcho(object):
+
+    def __init__(self):
+        self.connections = set()
+        self.restart_ms = 0
+
+    async def handler(self, websocket, *args):
+        self.connections.add(websocket)
+        try:
+            async for message in websocket:
+                if message.startswith('restart '):
+                    self.restart_ms = int(message[len('restart '):])
+                else:
+                    await websocket.send(message)
+        except websockets.ConnectionClosed:
+            pass
+        finally:
+            self.connections.discard(websocket)
+
+
+# Echo servers on consecutive ports the linux test app connects to
+class LocalServers(object):
+
+    def run(self, server):
+        while not self.exit_event.is_set():
+            server.serveonce()
+        server.close()
+
+    # websockets compresses every message once permessage-deflate is negotiated, as the client requires
+    def run_deflate(self, port, extensions=None):
+        async def serve():
+            compression = None if extensions else 'deflate'
+            async with websockets.serve(deflate_echo, '127.0.0.1', port, compression=compression, extensions=extensions):
+                while not self.exit_event.is_set():
+                    await asyncio.sleep(0.1)
+        asyncio.run(serve())
+
+    def run_interleaving(self, port):
+        async def serve():
+            async with websockets.serve(interleaving_echo, '127.0.0.1', port, compression=None):
+                while not self.exit_event.is_set():
+                    await asyncio.sleep(0.1)
+        asyncio.run(serve())
+
+    # accepts connections and never answers the upgrade request, the way a hung server looks
+    def run_silent(self, port):
+        async def silent(reader, writer):
+            await reader.read()
+            writer.close()
+
+        async def serve():
+            async with await asyncio.start_server(silent, '127.0.0.1', port):
+                while not self.exit_event.is_set():
+                    await asyncio.sleep(0.1)
+        asyncio.run(serve())
+
+    def run_restarting(self, port, ssl_context=None):
+        async def serve():
+            echo = RestartingEcho()
+            while not self.exit_event.is_set():
+                async with websockets.serve(echo.handler, '127.0.0.1', port, compression=None, ssl=ssl_context) as server:
+                    while not self.exit_event.is_set() and not echo.restart_ms:
+                        await asyncio.sleep(0.05)
+                    # stop listening first, then drop the connections without a close frame
+                    server.server.close()
+                    for websocket in list(echo.connections):
+                        websocket.transport.abort()
+                if echo.restart_ms:
+                    await asyncio.sleep(echo.restart_ms / 1000)
+                    echo.restart_ms = 0
+        asyncio.run(serve())
+
+    def __init__(self, port, count):
+        self.exit_event = Event()
+        self.threads = []
+        for i in range(count):
+            server = SimpleWebSocketServer('127.0.0.1', port + i, WebsocketTestEcho, selectInterval=0.1)
+            self.threads.append(Thread(target=self.run, args=(server,)))
+        self.threads.append(Thread(target=self.run_deflate, args=(port + count,)))
+        self.threads.append(Thread(target=self.run_restarting, args=(port + count + 1,)))
+        # the ssl context keeps the session ticket keys, so sessions survive the restarts
+        ssl_context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        ssl_context.load_cert_chain(os.path.join(CERTS_DIR, 'server_cert.pem'), os.path.join(CERTS_DIR, 'server_key.pem'))
+        self.threads.append(Thread(target=self.run_restarting, args=(port + count + 2, ssl_context)))
+        self.threads.append(Thread(target=self.run_interleaving, args=(port + count + 3,)))
+        # answers with parameters the client did not offer, which it has to follow
+        no_context = ServerPerMessageDeflateFactory(server_no_context_takeover=True, client_no_context_takeover=True,
+                                                    server_max_window_bits=9, client_max_window_bits=9)
+        self.threads.append(Thread(target=self.run_deflate, args=(port + count + 4, [no_context])))
+        self.threads.append(Thread(target=self.run_silent, args=(port + count + 5,)))
+
+    def __enter__(self):
+        for thread in self.threads:
+            thread.start()
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        self.exit_event.set()
+        for thread in self.threads:
+            thread.join(10)
+
+
+@pytest.fixture
+def local_servers():
+    with LocalServers(LOCAL_SERVER_PORT, LOCAL_SERVERS) as servers:
+        yield servers
+
+
+@pytest.mark.esp32
 def test_websocket(dut: Dut) -> None:
     dut.expect_unity_test_output()
+
+
+@pytest.mark.linux
+@pytest.mark.host_test
+def test_websocket_linux(local_servers, dut: Dut) -> None:
+    dut.expect_unity_test_output(timeout=120)